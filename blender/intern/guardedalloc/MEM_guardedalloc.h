@@ -230,6 +230,11 @@ extern const char *(*MEM_name_ptr)(void *vmemh);
 /* Switch allocator to slower but fully guarded mode. */
 void MEM_use_guarded_allocator(void);
 
+/* Switch allocator to keep small blocks in per-thread caches,
+ * faster for many small allocations from multiple threads.
+ * Has no effect once the fully guarded allocator is used. */
+void MEM_use_thread_cache_allocator(void);
+
 #ifdef __cplusplus
 /* alloc funcs for C++ only */
 #  define MEM_CXX_CLASS_ALLOC_FUNCS(_id) \
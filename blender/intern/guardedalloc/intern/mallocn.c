@@ -127,3 +127,39 @@ void MEM_use_guarded_allocator(void)
   MEM_name_ptr = MEM_guarded_name_ptr;
 #endif
 }
+
+void MEM_use_thread_cache_allocator(void)
+{
+  /* The fully guarded allocator is for debugging, it wins over the thread cache. */
+  if (MEM_mallocN == MEM_guarded_mallocN) {
+    return;
+  }
+  MEM_allocN_len = MEM_cache_allocN_len;
+  MEM_freeN = MEM_cache_freeN;
+  MEM_dupallocN = MEM_cache_dupallocN;
+  MEM_reallocN_id = MEM_cache_reallocN_id;
+  MEM_recallocN_id = MEM_cache_recallocN_id;
+  MEM_callocN = MEM_cache_callocN;
+  MEM_calloc_arrayN = MEM_cache_calloc_arrayN;
+  MEM_mallocN = MEM_cache_mallocN;
+  MEM_malloc_arrayN = MEM_cache_malloc_arrayN;
+  MEM_mallocN_aligned = MEM_cache_mallocN_aligned;
+  MEM_mapallocN = MEM_cache_mapallocN;
+  MEM_printmemlist_pydict = MEM_cache_printmemlist_pydict;
+  MEM_printmemlist = MEM_cache_printmemlist;
+  MEM_callbackmemlist = MEM_cache_callbackmemlist;
+  MEM_printmemlist_stats = MEM_cache_printmemlist_stats;
+  MEM_set_error_callback = MEM_cache_set_error_callback;
+  MEM_consistency_check = MEM_cache_consistency_check;
+  MEM_set_lock_callback = MEM_cache_set_lock_callback;
+  MEM_set_memory_debug = MEM_cache_set_memory_debug;
+  MEM_get_memory_in_use = MEM_cache_get_memory_in_use;
+  MEM_get_mapped_memory_in_use = MEM_cache_get_mapped_memory_in_use;
+  MEM_get_memory_blocks_in_use = MEM_cache_get_memory_blocks_in_use;
+  MEM_reset_peak_memory = MEM_cache_reset_peak_memory;
+  MEM_get_peak_memory = MEM_cache_get_peak_memory;
+
+#ifndef NDEBUG
+  MEM_name_ptr = MEM_cache_name_ptr;
+#endif
+}
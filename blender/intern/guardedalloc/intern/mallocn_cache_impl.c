@@ -0,0 +1,809 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup MEM
+ *
+ * Memory allocation which keeps small blocks in per-thread caches.
+ *
+ * Small blocks are rounded up to a size class and recycled through a free list
+ * of the calling thread, so most allocations don't take any lock nor do any
+ * atomic operation. Free lists which grow too long give half of their blocks
+ * back to a central free list, from which empty free lists are refilled.
+ * Memory of small blocks is never given back to the system.
+ *
+ * Larger and aligned blocks are allocated from the system, like the lock-free
+ * allocator does.
+ *
+ * Memory counters are kept per thread, and only summed up when they are
+ * queried. The peak memory is updated at that moment too.
+ */
+
+#include <stdlib.h>
+#include <string.h> /* memcpy */
+#include <stdarg.h>
+#include <sys/types.h>
+#include <pthread.h>
+
+#include "MEM_guardedalloc.h"
+
+/* to ensure strict conversions */
+#include "../../source/blender/blenlib/BLI_strict_flags.h"
+
+#include "atomic_ops.h"
+#include "mallocn_intern.h"
+
+typedef struct MemHead {
+  /* Length of allocated memory block. */
+  size_t len;
+} MemHead;
+
+typedef struct MemHeadAligned {
+  short alignment;
+  size_t len;
+} MemHeadAligned;
+
+enum {
+  MEMHEAD_MMAP_FLAG = 1,
+  MEMHEAD_ALIGN_FLAG = 2,
+  /* Block comes from a size class, other blocks come from the system. */
+  MEMHEAD_CACHE_FLAG = 4,
+};
+#define MEMHEAD_FLAGS (size_t)(MEMHEAD_MMAP_FLAG | MEMHEAD_ALIGN_FLAG | MEMHEAD_CACHE_FLAG)
+
+#define MEMHEAD_FROM_PTR(ptr) (((MemHead *)ptr) - 1)
+#define PTR_FROM_MEMHEAD(memhead) (memhead + 1)
+#define MEMHEAD_ALIGNED_FROM_PTR(ptr) (((MemHeadAligned *)ptr) - 1)
+#define MEMHEAD_IS_MMAP(memhead) ((memhead)->len & (size_t)MEMHEAD_MMAP_FLAG)
+#define MEMHEAD_IS_ALIGNED(memhead) ((memhead)->len & (size_t)MEMHEAD_ALIGN_FLAG)
+#define MEMHEAD_IS_CACHE(memhead) ((memhead)->len & (size_t)MEMHEAD_CACHE_FLAG)
+
+/* Lengths are aligned to 8 bytes, leaving room for the cache flag. */
+#define SIZET_ALIGN_8(len) ((len + 7) & ~(size_t)7)
+
+/* Size classes are multiples of 16 bytes (MemHead included). */
+#define CACHE_CLASS_SHIFT 4
+#define CACHE_CLASS_NUM 32
+#define CACHE_BLOCK_SIZE(bin_index) ((size_t)((bin_index) + 1) << CACHE_CLASS_SHIFT)
+#define CACHE_LEN_MAX (CACHE_BLOCK_SIZE(CACHE_CLASS_NUM - 1) - sizeof(MemHead))
+#define CACHE_BIN_INDEX(len) (unsigned int)(((len) + sizeof(MemHead) - 1) >> CACHE_CLASS_SHIFT)
+
+/* Bytes a thread keeps in a free list before giving half of them back. */
+#define CACHE_BIN_BYTES (32 * 1024)
+#define CACHE_BIN_LEN_MIN 32
+/* Size of the chunks small blocks are cut from. */
+#define CACHE_CHUNK_SIZE (256 * 1024)
+
+typedef struct CacheFreeBlock {
+  struct CacheFreeBlock *next;
+} CacheFreeBlock;
+
+typedef struct CacheBin {
+  CacheFreeBlock *head;
+  unsigned int len;
+} CacheBin;
+
+typedef struct ThreadCache {
+  struct ThreadCache *next, *prev;
+  CacheBin bins[CACHE_CLASS_NUM];
+  /* Counters of this thread. Blocks can be freed by another thread than the
+   * one which allocated them, so a single counter can be negative. */
+  ptrdiff_t totblock;
+  ptrdiff_t mem_in_use;
+} ThreadCache;
+
+typedef struct CacheChunk {
+  struct CacheChunk *next;
+} CacheChunk;
+
+#if defined(_MSC_VER)
+static __declspec(thread) ThreadCache *thread_cache = NULL;
+#else
+static __thread ThreadCache *thread_cache = NULL;
+#endif
+
+static pthread_once_t thread_cache_once = PTHREAD_ONCE_INIT;
+static pthread_key_t thread_cache_key;
+
+/* Protects everything below. */
+static pthread_mutex_t central_lock = PTHREAD_MUTEX_INITIALIZER;
+static CacheBin central_bins[CACHE_CLASS_NUM];
+static CacheChunk *central_chunks = NULL;
+static ThreadCache *thread_caches = NULL;
+/* Counters of the threads which exited. */
+static ptrdiff_t exited_totblock = 0;
+static ptrdiff_t exited_mem_in_use = 0;
+
+static size_t mmap_in_use = 0, peak_mem = 0;
+static bool malloc_debug_memset = false;
+
+static void (*error_callback)(const char *) = NULL;
+static void (*thread_lock_callback)(void) = NULL;
+static void (*thread_unlock_callback)(void) = NULL;
+
+#ifdef __GNUC__
+__attribute__((format(printf, 1, 2)))
+#endif
+static void
+print_error(const char *str, ...)
+{
+  char buf[512];
+  va_list ap;
+
+  va_start(ap, str);
+  vsnprintf(buf, sizeof(buf), str, ap);
+  va_end(ap);
+  buf[sizeof(buf) - 1] = '\0';
+
+  if (error_callback) {
+    error_callback(buf);
+  }
+}
+
+#if defined(WIN32)
+static void mem_lock_thread(void)
+{
+  if (thread_lock_callback)
+    thread_lock_callback();
+}
+
+static void mem_unlock_thread(void)
+{
+  if (thread_unlock_callback)
+    thread_unlock_callback();
+}
+#endif
+
+/* -------------------------------------------------------------------- */
+/** \name Thread Caches
+ * \{ */
+
+MEM_INLINE unsigned int cache_bin_len_max(const unsigned int bin_index)
+{
+  const unsigned int len = (unsigned int)(CACHE_BIN_BYTES / CACHE_BLOCK_SIZE(bin_index));
+  return len > CACHE_BIN_LEN_MIN ? len : CACHE_BIN_LEN_MIN;
+}
+
+/* Move up to \a len blocks from the head of \a src to \a dst. */
+static void cache_bin_move(CacheBin *dst, CacheBin *src, unsigned int len)
+{
+  while (len-- && src->head) {
+    CacheFreeBlock *block = src->head;
+    src->head = block->next;
+    src->len--;
+    block->next = dst->head;
+    dst->head = block;
+    dst->len++;
+  }
+}
+
+static void thread_cache_exit(void *cache_v)
+{
+  ThreadCache *cache = cache_v;
+
+  pthread_mutex_lock(&central_lock);
+  for (unsigned int i = 0; i < CACHE_CLASS_NUM; i++) {
+    cache_bin_move(&central_bins[i], &cache->bins[i], cache->bins[i].len);
+  }
+  exited_totblock += cache->totblock;
+  exited_mem_in_use += cache->mem_in_use;
+  if (cache->prev) {
+    cache->prev->next = cache->next;
+  }
+  else {
+    thread_caches = cache->next;
+  }
+  if (cache->next) {
+    cache->next->prev = cache->prev;
+  }
+  pthread_mutex_unlock(&central_lock);
+
+  thread_cache = NULL;
+  free(cache);
+}
+
+static void thread_cache_key_create(void)
+{
+  pthread_key_create(&thread_cache_key, thread_cache_exit);
+}
+
+static ThreadCache *thread_cache_create(void)
+{
+  ThreadCache *cache = calloc(1, sizeof(*cache));
+  if (UNLIKELY(cache == NULL)) {
+    return NULL;
+  }
+
+  /* Let the key destructor give the free lists back when the thread exits. */
+  pthread_once(&thread_cache_once, thread_cache_key_create);
+  pthread_setspecific(thread_cache_key, cache);
+
+  pthread_mutex_lock(&central_lock);
+  cache->next = thread_caches;
+  if (thread_caches) {
+    thread_caches->prev = cache;
+  }
+  thread_caches = cache;
+  pthread_mutex_unlock(&central_lock);
+
+  thread_cache = cache;
+  return cache;
+}
+
+MEM_INLINE ThreadCache *thread_cache_get(void)
+{
+  ThreadCache *cache = thread_cache;
+  if (UNLIKELY(cache == NULL)) {
+    cache = thread_cache_create();
+  }
+  return cache;
+}
+
+/* Fill an empty free list from the central one, cutting a new chunk when needed. */
+static bool cache_bin_refill(CacheBin *bin, const unsigned int bin_index)
+{
+  CacheBin *central_bin = &central_bins[bin_index];
+
+  pthread_mutex_lock(&central_lock);
+  if (central_bin->head == NULL) {
+    const size_t block_size = CACHE_BLOCK_SIZE(bin_index);
+    /* First block of the chunk is lost to the chunk link, keeping the others aligned. */
+    CacheChunk *chunk = malloc(CACHE_CHUNK_SIZE);
+    if (UNLIKELY(chunk == NULL)) {
+      pthread_mutex_unlock(&central_lock);
+      return false;
+    }
+    chunk->next = central_chunks;
+    central_chunks = chunk;
+
+    char *block = (char *)chunk + block_size;
+    char *block_end = (char *)chunk + CACHE_CHUNK_SIZE - block_size;
+    for (; block <= block_end; block += block_size) {
+      CacheFreeBlock *free_block = (CacheFreeBlock *)block;
+      free_block->next = central_bin->head;
+      central_bin->head = free_block;
+      central_bin->len++;
+    }
+  }
+  cache_bin_move(bin, central_bin, cache_bin_len_max(bin_index) / 2);
+  pthread_mutex_unlock(&central_lock);
+
+  return true;
+}
+
+MEM_INLINE MemHead *cache_block_alloc(ThreadCache *cache, const unsigned int bin_index)
+{
+  CacheBin *bin = &cache->bins[bin_index];
+  if (UNLIKELY(bin->head == NULL)) {
+    if (!cache_bin_refill(bin, bin_index)) {
+      return NULL;
+    }
+  }
+  CacheFreeBlock *block = bin->head;
+  bin->head = block->next;
+  bin->len--;
+  return (MemHead *)block;
+}
+
+MEM_INLINE void cache_block_free(ThreadCache *cache, MemHead *memh, const unsigned int bin_index)
+{
+  CacheBin *bin = &cache->bins[bin_index];
+  CacheFreeBlock *block = (CacheFreeBlock *)memh;
+  block->next = bin->head;
+  bin->head = block;
+  bin->len++;
+
+  const unsigned int len_max = cache_bin_len_max(bin_index);
+  if (UNLIKELY(bin->len > len_max)) {
+    pthread_mutex_lock(&central_lock);
+    cache_bin_move(&central_bins[bin_index], bin, len_max / 2);
+    pthread_mutex_unlock(&central_lock);
+  }
+}
+
+MEM_INLINE void cache_counters_add(ThreadCache *cache, const size_t len)
+{
+  cache->totblock++;
+  cache->mem_in_use += (ptrdiff_t)len;
+}
+
+MEM_INLINE void cache_counters_sub(ThreadCache *cache, const size_t len)
+{
+  cache->totblock--;
+  cache->mem_in_use -= (ptrdiff_t)len;
+}
+
+/* Sum up the counters of all threads, updating the peak memory. */
+static void cache_counters_sum(ptrdiff_t *r_totblock, ptrdiff_t *r_mem_in_use)
+{
+  pthread_mutex_lock(&central_lock);
+  ptrdiff_t totblock = exited_totblock;
+  ptrdiff_t mem_in_use = exited_mem_in_use;
+  for (ThreadCache *cache = thread_caches; cache; cache = cache->next) {
+    totblock += ((volatile ThreadCache *)cache)->totblock;
+    mem_in_use += ((volatile ThreadCache *)cache)->mem_in_use;
+  }
+  if (mem_in_use > 0 && (size_t)mem_in_use > peak_mem) {
+    peak_mem = (size_t)mem_in_use;
+  }
+  pthread_mutex_unlock(&central_lock);
+
+  *r_totblock = totblock;
+  *r_mem_in_use = mem_in_use;
+}
+
+/** \} */
+
+size_t MEM_cache_allocN_len(const void *vmemh)
+{
+  if (vmemh) {
+    return MEMHEAD_FROM_PTR(vmemh)->len & ~MEMHEAD_FLAGS;
+  }
+  else {
+    return 0;
+  }
+}
+
+void MEM_cache_freeN(void *vmemh)
+{
+  MemHead *memh = MEMHEAD_FROM_PTR(vmemh);
+  size_t len = MEM_cache_allocN_len(vmemh);
+
+  if (vmemh == NULL) {
+    print_error("Attempt to free NULL pointer\n");
+#ifdef WITH_ASSERT_ABORT
+    abort();
+#endif
+    return;
+  }
+
+  ThreadCache *cache = thread_cache_get();
+  if (LIKELY(cache)) {
+    cache_counters_sub(cache, len);
+  }
+
+  if (MEMHEAD_IS_MMAP(memh)) {
+    atomic_sub_and_fetch_z(&mmap_in_use, len);
+#if defined(WIN32)
+    /* our windows mmap implementation is not thread safe */
+    mem_lock_thread();
+#endif
+    if (munmap(memh, len + sizeof(MemHead)))
+      printf("Couldn't unmap memory\n");
+#if defined(WIN32)
+    mem_unlock_thread();
+#endif
+  }
+  else {
+    if (UNLIKELY(malloc_debug_memset && len)) {
+      memset(memh + 1, 255, len);
+    }
+    if (LIKELY(MEMHEAD_IS_CACHE(memh) && cache)) {
+      cache_block_free(cache, memh, CACHE_BIN_INDEX(len));
+    }
+    else if (MEMHEAD_IS_CACHE(memh)) {
+      /* Out of memory for the thread cache, give the block to the central free list. */
+      CacheFreeBlock *block = (CacheFreeBlock *)memh;
+      CacheBin *central_bin = &central_bins[CACHE_BIN_INDEX(len)];
+      pthread_mutex_lock(&central_lock);
+      block->next = central_bin->head;
+      central_bin->head = block;
+      central_bin->len++;
+      pthread_mutex_unlock(&central_lock);
+    }
+    else if (UNLIKELY(MEMHEAD_IS_ALIGNED(memh))) {
+      MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
+      aligned_free(MEMHEAD_REAL_PTR(memh_aligned));
+    }
+    else {
+      free(memh);
+    }
+  }
+}
+
+void *MEM_cache_dupallocN(const void *vmemh)
+{
+  void *newp = NULL;
+  if (vmemh) {
+    MemHead *memh = MEMHEAD_FROM_PTR(vmemh);
+    const size_t prev_size = MEM_cache_allocN_len(vmemh);
+    if (UNLIKELY(MEMHEAD_IS_MMAP(memh))) {
+      newp = MEM_cache_mapallocN(prev_size, "dupli_mapalloc");
+    }
+    else if (UNLIKELY(MEMHEAD_IS_ALIGNED(memh))) {
+      MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
+      newp = MEM_cache_mallocN_aligned(prev_size, (size_t)memh_aligned->alignment, "dupli_malloc");
+    }
+    else {
+      newp = MEM_cache_mallocN(prev_size, "dupli_malloc");
+    }
+    memcpy(newp, vmemh, prev_size);
+  }
+  return newp;
+}
+
+void *MEM_cache_reallocN_id(void *vmemh, size_t len, const char *str)
+{
+  void *newp = NULL;
+
+  if (vmemh) {
+    MemHead *memh = MEMHEAD_FROM_PTR(vmemh);
+    size_t old_len = MEM_cache_allocN_len(vmemh);
+
+    if (LIKELY(!MEMHEAD_IS_ALIGNED(memh))) {
+      newp = MEM_cache_mallocN(len, "realloc");
+    }
+    else {
+      MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
+      newp = MEM_cache_mallocN_aligned(len, (size_t)memh_aligned->alignment, "realloc");
+    }
+
+    if (newp) {
+      if (len < old_len) {
+        /* shrink */
+        memcpy(newp, vmemh, len);
+      }
+      else {
+        /* grow (or remain same size) */
+        memcpy(newp, vmemh, old_len);
+      }
+    }
+
+    MEM_cache_freeN(vmemh);
+  }
+  else {
+    newp = MEM_cache_mallocN(len, str);
+  }
+
+  return newp;
+}
+
+void *MEM_cache_recallocN_id(void *vmemh, size_t len, const char *str)
+{
+  void *newp = NULL;
+
+  if (vmemh) {
+    MemHead *memh = MEMHEAD_FROM_PTR(vmemh);
+    size_t old_len = MEM_cache_allocN_len(vmemh);
+
+    if (LIKELY(!MEMHEAD_IS_ALIGNED(memh))) {
+      newp = MEM_cache_mallocN(len, "recalloc");
+    }
+    else {
+      MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
+      newp = MEM_cache_mallocN_aligned(len, (size_t)memh_aligned->alignment, "recalloc");
+    }
+
+    if (newp) {
+      if (len < old_len) {
+        /* shrink */
+        memcpy(newp, vmemh, len);
+      }
+      else {
+        memcpy(newp, vmemh, old_len);
+
+        if (len > old_len) {
+          /* grow */
+          /* zero new bytes */
+          memset(((char *)newp) + old_len, 0, len - old_len);
+        }
+      }
+    }
+
+    MEM_cache_freeN(vmemh);
+  }
+  else {
+    newp = MEM_cache_callocN(len, str);
+  }
+
+  return newp;
+}
+
+/* Allocate a block of \a len bytes (already aligned), cleared when \a zero is set. */
+MEM_INLINE MemHead *cache_memh_alloc(size_t len, const bool zero)
+{
+  ThreadCache *cache = thread_cache_get();
+  MemHead *memh;
+
+  if (LIKELY(len <= CACHE_LEN_MAX && cache)) {
+    memh = cache_block_alloc(cache, CACHE_BIN_INDEX(len));
+    if (UNLIKELY(memh == NULL)) {
+      return NULL;
+    }
+    memh->len = len | (size_t)MEMHEAD_CACHE_FLAG;
+    if (zero) {
+      memset(memh + 1, 0, len);
+    }
+  }
+  else {
+    memh = zero ? (MemHead *)calloc(1, len + sizeof(MemHead)) :
+                  (MemHead *)malloc(len + sizeof(MemHead));
+    if (UNLIKELY(memh == NULL)) {
+      return NULL;
+    }
+    memh->len = len;
+  }
+
+  if (LIKELY(cache)) {
+    cache_counters_add(cache, len);
+  }
+  return memh;
+}
+
+void *MEM_cache_callocN(size_t len, const char *str)
+{
+  MemHead *memh;
+
+  len = SIZET_ALIGN_8(len);
+
+  memh = cache_memh_alloc(len, true);
+
+  if (LIKELY(memh)) {
+    return PTR_FROM_MEMHEAD(memh);
+  }
+  print_error("Calloc returns null: len=" SIZET_FORMAT " in %s, total %u\n",
+              SIZET_ARG(len),
+              str,
+              (unsigned int)MEM_cache_get_memory_in_use());
+  return NULL;
+}
+
+void *MEM_cache_calloc_arrayN(size_t len, size_t size, const char *str)
+{
+  size_t total_size;
+  if (UNLIKELY(!MEM_size_safe_multiply(len, size, &total_size))) {
+    print_error(
+        "Calloc array aborted due to integer overflow: "
+        "len=" SIZET_FORMAT "x" SIZET_FORMAT " in %s, total %u\n",
+        SIZET_ARG(len),
+        SIZET_ARG(size),
+        str,
+        (unsigned int)MEM_cache_get_memory_in_use());
+    abort();
+    return NULL;
+  }
+
+  return MEM_cache_callocN(total_size, str);
+}
+
+void *MEM_cache_mallocN(size_t len, const char *str)
+{
+  MemHead *memh;
+
+  len = SIZET_ALIGN_8(len);
+
+  memh = cache_memh_alloc(len, false);
+
+  if (LIKELY(memh)) {
+    if (UNLIKELY(malloc_debug_memset && len)) {
+      memset(memh + 1, 255, len);
+    }
+
+    return PTR_FROM_MEMHEAD(memh);
+  }
+  print_error("Malloc returns null: len=" SIZET_FORMAT " in %s, total %u\n",
+              SIZET_ARG(len),
+              str,
+              (unsigned int)MEM_cache_get_memory_in_use());
+  return NULL;
+}
+
+void *MEM_cache_malloc_arrayN(size_t len, size_t size, const char *str)
+{
+  size_t total_size;
+  if (UNLIKELY(!MEM_size_safe_multiply(len, size, &total_size))) {
+    print_error(
+        "Malloc array aborted due to integer overflow: "
+        "len=" SIZET_FORMAT "x" SIZET_FORMAT " in %s, total %u\n",
+        SIZET_ARG(len),
+        SIZET_ARG(size),
+        str,
+        (unsigned int)MEM_cache_get_memory_in_use());
+    abort();
+    return NULL;
+  }
+
+  return MEM_cache_mallocN(total_size, str);
+}
+
+void *MEM_cache_mallocN_aligned(size_t len, size_t alignment, const char *str)
+{
+  MemHeadAligned *memh;
+
+  /* It's possible that MemHead's size is not properly aligned,
+   * do extra padding to deal with this.
+   *
+   * We only support small alignments which fits into short in
+   * order to save some bits in MemHead structure.
+   */
+  size_t extra_padding = MEMHEAD_ALIGN_PADDING(alignment);
+
+  /* Huge alignment values doesn't make sense and they
+   * wouldn't fit into 'short' used in the MemHead.
+   */
+  assert(alignment < 1024);
+
+  /* We only support alignment to a power of two. */
+  assert(IS_POW2(alignment));
+
+  len = SIZET_ALIGN_8(len);
+
+  memh = (MemHeadAligned *)aligned_malloc(len + extra_padding + sizeof(MemHeadAligned), alignment);
+
+  if (LIKELY(memh)) {
+    /* We keep padding in the beginning of MemHead,
+     * this way it's always possible to get MemHead
+     * from the data pointer.
+     */
+    memh = (MemHeadAligned *)((char *)memh + extra_padding);
+
+    if (UNLIKELY(malloc_debug_memset && len)) {
+      memset(memh + 1, 255, len);
+    }
+
+    memh->len = len | (size_t)MEMHEAD_ALIGN_FLAG;
+    memh->alignment = (short)alignment;
+
+    ThreadCache *cache = thread_cache_get();
+    if (LIKELY(cache)) {
+      cache_counters_add(cache, len);
+    }
+
+    return PTR_FROM_MEMHEAD(memh);
+  }
+  print_error("Malloc returns null: len=" SIZET_FORMAT " in %s, total %u\n",
+              SIZET_ARG(len),
+              str,
+              (unsigned int)MEM_cache_get_memory_in_use());
+  return NULL;
+}
+
+void *MEM_cache_mapallocN(size_t len, const char *str)
+{
+  MemHead *memh;
+
+  /* on 64 bit, simply use calloc instead, as mmap does not support
+   * allocating > 4 GB on Windows. the only reason mapalloc exists
+   * is to get around address space limitations in 32 bit OSes. */
+  if (sizeof(void *) >= 8)
+    return MEM_cache_callocN(len, str);
+
+  len = SIZET_ALIGN_8(len);
+
+#if defined(WIN32)
+  /* our windows mmap implementation is not thread safe */
+  mem_lock_thread();
+#endif
+  memh = mmap(NULL, len + sizeof(MemHead), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANON, -1, 0);
+#if defined(WIN32)
+  mem_unlock_thread();
+#endif
+
+  if (memh != (MemHead *)-1) {
+    memh->len = len | (size_t)MEMHEAD_MMAP_FLAG;
+    atomic_add_and_fetch_z(&mmap_in_use, len);
+
+    ThreadCache *cache = thread_cache_get();
+    if (LIKELY(cache)) {
+      cache_counters_add(cache, len);
+    }
+
+    return PTR_FROM_MEMHEAD(memh);
+  }
+  print_error(
+      "Mapalloc returns null, fallback to regular malloc: "
+      "len=" SIZET_FORMAT " in %s, total %u\n",
+      SIZET_ARG(len),
+      str,
+      (unsigned int)mmap_in_use);
+  return MEM_cache_callocN(len, str);
+}
+
+void MEM_cache_printmemlist_pydict(void)
+{
+}
+
+void MEM_cache_printmemlist(void)
+{
+}
+
+/* unused */
+void MEM_cache_callbackmemlist(void (*func)(void *))
+{
+  (void)func; /* Ignored. */
+}
+
+void MEM_cache_printmemlist_stats(void)
+{
+  const size_t mem_in_use = MEM_cache_get_memory_in_use();
+
+  printf("\ntotal memory len: %.3f MB\n", (double)mem_in_use / (double)(1024 * 1024));
+  printf("peak memory len: %.3f MB\n", (double)peak_mem / (double)(1024 * 1024));
+  printf(
+      "\nFor more detailed per-block statistics run Blender with memory debugging command line "
+      "argument.\n");
+
+#ifdef HAVE_MALLOC_STATS
+  printf("System Statistics:\n");
+  malloc_stats();
+#endif
+}
+
+void MEM_cache_set_error_callback(void (*func)(const char *))
+{
+  error_callback = func;
+}
+
+bool MEM_cache_consistency_check(void)
+{
+  return true;
+}
+
+void MEM_cache_set_lock_callback(void (*lock)(void), void (*unlock)(void))
+{
+  thread_lock_callback = lock;
+  thread_unlock_callback = unlock;
+}
+
+void MEM_cache_set_memory_debug(void)
+{
+  malloc_debug_memset = true;
+}
+
+size_t MEM_cache_get_memory_in_use(void)
+{
+  ptrdiff_t totblock, mem_in_use;
+  cache_counters_sum(&totblock, &mem_in_use);
+  return (size_t)mem_in_use;
+}
+
+size_t MEM_cache_get_mapped_memory_in_use(void)
+{
+  return mmap_in_use;
+}
+
+unsigned int MEM_cache_get_memory_blocks_in_use(void)
+{
+  ptrdiff_t totblock, mem_in_use;
+  cache_counters_sum(&totblock, &mem_in_use);
+  return (unsigned int)totblock;
+}
+
+void MEM_cache_reset_peak_memory(void)
+{
+  ptrdiff_t totblock, mem_in_use;
+  cache_counters_sum(&totblock, &mem_in_use);
+  peak_mem = (size_t)mem_in_use;
+}
+
+size_t MEM_cache_get_peak_memory(void)
+{
+  ptrdiff_t totblock, mem_in_use;
+  cache_counters_sum(&totblock, &mem_in_use);
+  return peak_mem;
+}
+
+#ifndef NDEBUG
+const char *MEM_cache_name_ptr(void *vmemh)
+{
+  if (vmemh) {
+    return "unknown block name ptr";
+  }
+  else {
+    return "MEM_cache_name_ptr(NULL)";
+  }
+}
+#endif /* NDEBUG */
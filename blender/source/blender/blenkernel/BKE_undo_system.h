@@ -131,6 +131,7 @@ extern const UndoType *BKE_UNDOSYS_TYPE_MEMFILE;
 extern const UndoType *BKE_UNDOSYS_TYPE_PAINTCURVE;
 extern const UndoType *BKE_UNDOSYS_TYPE_PARTICLE;
 extern const UndoType *BKE_UNDOSYS_TYPE_SCULPT;
+extern const UndoType *BKE_UNDOSYS_TYPE_SELECT;
 extern const UndoType *BKE_UNDOSYS_TYPE_TEXT;
 
 #define BKE_UNDOSYS_TYPE_IS_MEMFILE_SKIP(ty) ELEM(ty, BKE_UNDOSYS_TYPE_IMAGE)
@@ -180,6 +181,7 @@ bool BKE_undosys_step_redo_with_data(UndoStack *ustack, struct bContext *C, Undo
 bool BKE_undosys_step_redo(UndoStack *ustack, struct bContext *C);
 
 bool BKE_undosys_step_load_data(UndoStack *ustack, struct bContext *C, UndoStep *us);
+void BKE_undosys_step_decode_base(UndoStack *ustack, struct bContext *C, UndoStep *us, int dir);
 
 void BKE_undosys_step_undo_from_index(UndoStack *ustack, struct bContext *C, int index);
 UndoStep *BKE_undosys_step_same_type_next(UndoStep *us);
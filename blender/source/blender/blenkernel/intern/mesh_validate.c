@@ -38,6 +38,8 @@
 #include "BLI_edgehash.h"
 #include "BLI_math_base.h"
 #include "BLI_math_vector.h"
+#include "BLI_sort.h"
+#include "BLI_task.h"
 
 #include "BKE_customdata.h"
 #include "BKE_deform.h"
@@ -118,7 +120,7 @@ static int int64_cmp(const void *v1, const void *v2)
   return 0;
 }
 
-static int search_face_cmp(const void *v1, const void *v2)
+static int search_face_cmp(const void *v1, const void *v2, void *UNUSED(ctx))
 {
   const SortFace *sfa = v1, *sfb = v2;
 
@@ -159,7 +161,7 @@ static int int_cmp(const void *v1, const void *v2)
   return *(int *)v1 > *(int *)v2 ? 1 : *(int *)v1 < *(int *)v2 ? -1 : 0;
 }
 
-static int search_poly_cmp(const void *v1, const void *v2)
+static int search_poly_cmp(const void *v1, const void *v2, void *UNUSED(ctx))
 {
   const SortPoly *sp1 = v1, *sp2 = v2;
   const int max_idx = sp1->numverts > sp2->numverts ? sp2->numverts : sp1->numverts;
@@ -180,7 +182,7 @@ static int search_poly_cmp(const void *v1, const void *v2)
   return sp1->numverts > sp2->numverts ? 1 : sp1->numverts < sp2->numverts ? -1 : 0;
 }
 
-static int search_polyloop_cmp(const void *v1, const void *v2)
+static int search_polyloop_cmp(const void *v1, const void *v2, void *UNUSED(ctx))
 {
   const SortPoly *sp1 = v1, *sp2 = v2;
 
@@ -465,7 +467,7 @@ bool BKE_mesh_validate_arrays(Mesh *mesh,
       }
     }
 
-    qsort(sort_faces, totsortface, sizeof(SortFace), search_face_cmp);
+    BLI_parallel_sort(sort_faces, totsortface, sizeof(SortFace), search_face_cmp, NULL);
 
     sf = sort_faces;
     sf_prev = sf;
@@ -669,7 +671,7 @@ bool BKE_mesh_validate_arrays(Mesh *mesh,
     }
 
     /* Second check pass, testing polys using the same verts. */
-    qsort(sort_polys, totpoly, sizeof(SortPoly), search_poly_cmp);
+    BLI_parallel_sort(sort_polys, totpoly, sizeof(SortPoly), search_poly_cmp, NULL);
     sp = prev_sp = sort_polys;
     sp++;
 
@@ -679,7 +681,7 @@ bool BKE_mesh_validate_arrays(Mesh *mesh,
 
       if (sp->invalid) {
         /* Break, because all known invalid polys have been put at the end
-         * by qsort with search_poly_cmp. */
+         * by sorting with search_poly_cmp. */
         break;
       }
 
@@ -704,7 +706,7 @@ bool BKE_mesh_validate_arrays(Mesh *mesh,
     }
 
     /* Third check pass, testing loops used by none or more than one poly. */
-    qsort(sort_polys, totpoly, sizeof(SortPoly), search_polyloop_cmp);
+    BLI_parallel_sort(sort_polys, totpoly, sizeof(SortPoly), search_polyloop_cmp, NULL);
     sp = sort_polys;
     prev_sp = NULL;
     prev_end = 0;
@@ -1321,7 +1323,7 @@ static void to_edgesort(
   ed->is_draw = is_draw;
 }
 
-static int vergedgesort(const void *v1, const void *v2)
+static int vergedgesort(const void *v1, const void *v2, void *UNUSED(ctx))
 {
   const struct EdgeSort *x1 = v1, *x2 = v2;
 
@@ -1401,7 +1403,7 @@ static void mesh_calc_edges_mdata(MVert *UNUSED(allvert),
     }
   }
 
-  qsort(edsort, totedge, sizeof(struct EdgeSort), vergedgesort);
+  BLI_parallel_sort(edsort, totedge, sizeof(struct EdgeSort), vergedgesort, NULL);
 
   /* count final amount */
   for (a = totedge, ed = edsort; a > 1; a--, ed++) {
@@ -1511,6 +1513,101 @@ void BKE_mesh_calc_edges_legacy(Mesh *me, const bool use_old)
   BKE_mesh_strip_loose_faces(me);
 }
 
+/* Sort key of loops which don't make an edge, sorted after all edges. */
+#define EDGE_KEY_NONE UINT64_MAX
+/* Keys sharing a lower vertex are sorted with an insertion sort up to this number. */
+#define EDGE_KEY_INSERTION_SORT_MAX 32
+
+typedef struct MeshCalcEdgesData {
+  const MPoly *mpoly;
+  const MLoop *mloop;
+  /** Index of the first key of each polygon. */
+  const uint *poly_keys_start;
+  uint64_t *keys;
+  uint *key_indices;
+  /** The loop which uses the edge of each key, for keys past the existing edges. */
+  uint *key_loops;
+  uint totedge_orig;
+  /** Highest lower vertex of all edges. */
+  uint vert_max;
+  /** End of the keys of each lower vertex, once the keys are grouped by lower vertex. */
+  const uint *vert_keys_end;
+} MeshCalcEdgesData;
+
+BLI_INLINE uint64_t mesh_edge_key(const uint v1, const uint v2)
+{
+  return (v1 < v2) ? (((uint64_t)v1 << 32) | v2) : (((uint64_t)v2 << 32) | v1);
+}
+
+/* Keys are grouped by their lower vertex, keys without an edge go last. */
+BLI_INLINE uint mesh_edge_key_group(const uint64_t key, const uint vert_len)
+{
+  return (key != EDGE_KEY_NONE) ? (uint)(key >> 32) : vert_len;
+}
+
+static void mesh_calc_edges_keys_cb(void *__restrict userdata,
+                                    const int i,
+                                    const TaskParallelTLS *__restrict tls)
+{
+  const MeshCalcEdgesData *data = userdata;
+  uint *vert_max = tls->userdata_chunk;
+  const MPoly *mp = &data->mpoly[i];
+  const MLoop *ml = &data->mloop[mp->loopstart];
+  const uint totloop = (uint)mp->totloop;
+  uint key_index = data->poly_keys_start[i];
+
+  /* Same order as the edges were found in when an edge-hash was used for this,
+   * starting with the edge from the last loop to the first. */
+  for (uint j = 0, j_prev = totloop - 1; j < totloop; j_prev = j++, key_index++) {
+    const uint v_prev = ml[j_prev].v, v = ml[j].v;
+    if (v_prev != v) {
+      data->keys[key_index] = mesh_edge_key(v_prev, v);
+      *vert_max = MAX2(*vert_max, MIN2(v_prev, v));
+    }
+    else {
+      data->keys[key_index] = EDGE_KEY_NONE;
+    }
+    data->key_indices[key_index] = key_index;
+    data->key_loops[key_index - data->totedge_orig] = (uint)mp->loopstart + j_prev;
+  }
+}
+
+static void mesh_calc_edges_keys_finalize(void *__restrict userdata,
+                                          void *__restrict userdata_chunk)
+{
+  MeshCalcEdgesData *data = userdata;
+  const uint *vert_max = userdata_chunk;
+  data->vert_max = MAX2(data->vert_max, *vert_max);
+}
+
+/* Sort the keys of one lower vertex, usually only a few. */
+static void mesh_calc_edges_sort_vert_cb(void *__restrict userdata,
+                                         const int v,
+                                         const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const MeshCalcEdgesData *data = userdata;
+  const uint start = v ? data->vert_keys_end[v - 1] : 0;
+  const uint end = data->vert_keys_end[v];
+  uint64_t *keys = data->keys;
+  uint *key_indices = data->key_indices;
+
+  if (end - start > EDGE_KEY_INSERTION_SORT_MAX) {
+    BLI_radix_sort_uint64(&keys[start], &key_indices[start], end - start);
+    return;
+  }
+  for (uint i = start + 1; i < end; i++) {
+    const uint64_t key = keys[i];
+    const uint key_index = key_indices[i];
+    uint j;
+    for (j = i; j > start && keys[j - 1] > key; j--) {
+      keys[j] = keys[j - 1];
+      key_indices[j] = key_indices[j - 1];
+    }
+    keys[j] = key;
+    key_indices[j] = key_index;
+  }
+}
+
 /**
  * Calculate edges from polygons
  *
@@ -1520,13 +1617,11 @@ void BKE_mesh_calc_edges_legacy(Mesh *me, const bool use_old)
 void BKE_mesh_calc_edges(Mesh *mesh, bool update, const bool select)
 {
   CustomData edata;
-  EdgeHashIterator *ehi;
-  MPoly *mp;
-  MEdge *med, *med_orig;
-  EdgeHash *eh;
-  unsigned int eh_reserve;
-  int i, totedge, totpoly = mesh->totpoly;
-  int med_index;
+  MEdge *med;
+  const MEdge *medge_orig = mesh->medge;
+  MLoop *mloop = mesh->mloop;
+  const int totpoly = mesh->totpoly;
+  uint i;
   /* select for newly created meshes which are selected [#25595] */
   const short ed_flag = (ME_EDGEDRAW | ME_EDGERENDER) | (select ? SELECT : 0);
 
@@ -1534,79 +1629,146 @@ void BKE_mesh_calc_edges(Mesh *mesh, bool update, const bool select)
     update = false;
   }
 
-  eh_reserve = max_ii(update ? mesh->totedge : 0, BLI_EDGEHASH_SIZE_GUESS_FROM_POLYS(totpoly));
-  eh = BLI_edgehash_new_ex(__func__, eh_reserve);
-
-  if (update) {
-    /* assume existing edges are valid
-     * useful when adding more faces and generating edges from them */
-    med = mesh->medge;
-    for (i = 0; i < mesh->totedge; i++, med++) {
-      BLI_edgehash_insert(eh, med->v1, med->v2, med);
-    }
+  /* A key for every existing edge and for the edge of every loop. Sorting the keys brings the
+   * uses of each edge together, since the sort is stable the first key of each run is the first
+   * use of the edge. Edges are created in the order of their first use. */
+  const uint totedge_orig = update ? (uint)mesh->totedge : 0;
+  uint *poly_keys_start = MEM_mallocN(sizeof(*poly_keys_start) * (size_t)totpoly, __func__);
+  uint keys_len = totedge_orig;
+  for (int p = 0; p < totpoly; p++) {
+    poly_keys_start[p] = keys_len;
+    keys_len += (uint)mesh->mpoly[p].totloop;
+  }
+
+  MeshCalcEdgesData data = {
+      .mpoly = mesh->mpoly,
+      .mloop = mloop,
+      .poly_keys_start = poly_keys_start,
+      .keys = MEM_mallocN(sizeof(*data.keys) * keys_len, __func__),
+      .key_indices = MEM_mallocN(sizeof(*data.key_indices) * keys_len, __func__),
+      .key_loops = MEM_mallocN(sizeof(*data.key_loops) * (keys_len - totedge_orig), __func__),
+      .totedge_orig = totedge_orig,
+  };
+
+  /* assume existing edges are valid
+   * useful when adding more faces and generating edges from them */
+  for (i = 0; i < totedge_orig; i++) {
+    data.keys[i] = mesh_edge_key(medge_orig[i].v1, medge_orig[i].v2);
+    data.key_indices[i] = i;
+    data.vert_max = MAX2(data.vert_max, MIN2(medge_orig[i].v1, medge_orig[i].v2));
+  }
+
+  uint vert_max_chunk = 0;
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1024;
+  settings.userdata_chunk = &vert_max_chunk;
+  settings.userdata_chunk_size = sizeof(vert_max_chunk);
+  settings.func_finalize = mesh_calc_edges_keys_finalize;
+  BLI_task_parallel_range(0, totpoly, &data, mesh_calc_edges_keys_cb, &settings);
+  MEM_freeN(poly_keys_start);
+
+  const uint vert_len = data.vert_max + 1;
+  if (vert_len > keys_len) {
+    /* Few keys for the vertex indices used, sort them all at once. */
+    BLI_radix_sort_uint64(data.keys, data.key_indices, keys_len);
   }
-
-  /* mesh loops (bmesh only) */
-  for (mp = mesh->mpoly, i = 0; i < totpoly; mp++, i++) {
-    MLoop *l = &mesh->mloop[mp->loopstart];
-    int j, v_prev = (l + (mp->totloop - 1))->v;
-    for (j = 0; j < mp->totloop; j++, l++) {
-      if (v_prev != l->v) {
-        void **val_p;
-        if (!BLI_edgehash_ensure_p(eh, v_prev, l->v, &val_p)) {
-          *val_p = NULL;
-        }
-      }
-      v_prev = l->v;
+  else {
+    /* Group the keys by their lower vertex with a counting sort, which keeps their order. */
+    uint *vert_keys_end = MEM_callocN(sizeof(*vert_keys_end) * (vert_len + 1), __func__);
+    for (i = 0; i < keys_len; i++) {
+      vert_keys_end[mesh_edge_key_group(data.keys[i], vert_len)]++;
+    }
+    for (uint v = 0, keys_start = 0; v <= vert_len; v++) {
+      const uint keys_num = vert_keys_end[v];
+      vert_keys_end[v] = keys_start;
+      keys_start += keys_num;
+    }
+    uint64_t *keys_grouped = MEM_mallocN(sizeof(*keys_grouped) * keys_len, __func__);
+    uint *key_indices_grouped = MEM_mallocN(sizeof(*key_indices_grouped) * keys_len, __func__);
+    for (i = 0; i < keys_len; i++) {
+      const uint dst = vert_keys_end[mesh_edge_key_group(data.keys[i], vert_len)]++;
+      keys_grouped[dst] = data.keys[i];
+      key_indices_grouped[dst] = data.key_indices[i];
+    }
+    MEM_freeN(data.keys);
+    MEM_freeN(data.key_indices);
+    data.keys = keys_grouped;
+    data.key_indices = key_indices_grouped;
+    data.vert_keys_end = vert_keys_end;
+
+    /* Then sort the keys of each lower vertex by their higher vertex. */
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.min_iter_per_thread = 4096;
+    BLI_task_parallel_range(0, (int)vert_len, &data, mesh_calc_edges_sort_vert_cb, &settings);
+    MEM_freeN(vert_keys_end);
+  }
+
+  const uint64_t *keys = data.keys;
+  const uint *key_indices = data.key_indices;
+  const uint *key_loops = data.key_loops;
+
+  /* Tag the keys which create an edge: the first use of each edge,
+   * and all existing edges so duplicates among them are kept as they were. */
+  uint *key_edge = MEM_callocN(sizeof(*key_edge) * keys_len, __func__);
+  uint64_t key_prev = EDGE_KEY_NONE;
+  for (i = 0; i < keys_len && keys[i] != EDGE_KEY_NONE; i++) {
+    if (keys[i] != key_prev || key_indices[i] < totedge_orig) {
+      key_edge[key_indices[i]] = 1;
     }
+    key_prev = keys[i];
   }
 
-  totedge = BLI_edgehash_len(eh);
+  /* Number the edges in key order, which is the order of their first use. */
+  uint totedge = 0;
+  for (i = 0; i < keys_len; i++) {
+    const uint is_edge = key_edge[i];
+    key_edge[i] = totedge;
+    totedge += is_edge;
+  }
 
   /* write new edges into a temporary CustomData */
   CustomData_reset(&edata);
-  CustomData_add_layer(&edata, CD_MEDGE, CD_CALLOC, NULL, totedge);
-
+  CustomData_add_layer(&edata, CD_MEDGE, CD_CALLOC, NULL, (int)totedge);
   med = CustomData_get_layer(&edata, CD_MEDGE);
-  for (ehi = BLI_edgehashIterator_new(eh), i = 0; BLI_edgehashIterator_isDone(ehi) == false;
-       BLI_edgehashIterator_step(ehi), ++i, ++med) {
-    if (update && (med_orig = BLI_edgehashIterator_getValue(ehi))) {
-      *med = *med_orig; /* copy from the original */
-    }
-    else {
-      BLI_edgehashIterator_getKey(ehi, &med->v1, &med->v2);
-      med->flag = ed_flag;
-    }
 
-    /* store the new edge index in the hash value */
-    BLI_edgehashIterator_setValue(ehi, POINTER_FROM_INT(i));
-  }
-  BLI_edgehashIterator_free(ehi);
-
-  if (mesh->totpoly) {
-    /* second pass, iterate through all loops again and assign
-     * the newly created edges to them. */
-    for (mp = mesh->mpoly, i = 0; i < mesh->totpoly; mp++, i++) {
-      MLoop *l = &mesh->mloop[mp->loopstart];
-      MLoop *l_prev = (l + (mp->totloop - 1));
-      int j;
-      for (j = 0; j < mp->totloop; j++, l++) {
-        /* lookup hashed edge index */
-        med_index = POINTER_AS_INT(BLI_edgehash_lookup(eh, l_prev->v, l->v));
-        l_prev->e = med_index;
-        l_prev = l;
+  uint edge_index = 0;
+  key_prev = EDGE_KEY_NONE;
+  for (i = 0; i < keys_len; i++) {
+    const uint key_index = key_indices[i];
+    if (keys[i] == EDGE_KEY_NONE) {
+      /* Loops using the same vertex as the next loop have no edge. */
+      mloop[key_loops[key_index - totedge_orig]].e = 0;
+      continue;
+    }
+    if (keys[i] != key_prev) {
+      edge_index = key_edge[key_index];
+      key_prev = keys[i];
+      if (key_index >= totedge_orig) {
+        med[edge_index].v1 = (uint)(keys[i] >> 32);
+        med[edge_index].v2 = (uint)keys[i];
+        med[edge_index].flag = ed_flag;
       }
     }
+    if (key_index < totedge_orig) {
+      med[key_edge[key_index]] = medge_orig[key_index]; /* copy from the original */
+    }
+    else {
+      mloop[key_loops[key_index - totedge_orig]].e = edge_index;
+    }
   }
 
+  MEM_freeN(data.keys);
+  MEM_freeN(data.key_indices);
+  MEM_freeN(data.key_loops);
+  MEM_freeN(key_edge);
+
   /* free old CustomData and assign new one */
   CustomData_free(&mesh->edata, mesh->totedge);
   mesh->edata = edata;
-  mesh->totedge = totedge;
+  mesh->totedge = (int)totedge;
 
   mesh->medge = CustomData_get_layer(&mesh->edata, CD_MEDGE);
-
-  BLI_edgehash_free(eh, NULL);
 }
 
 void BKE_mesh_calc_edges_loose(Mesh *mesh)
@@ -99,6 +99,7 @@ const UndoType *BKE_UNDOSYS_TYPE_MEMFILE = NULL;
 const UndoType *BKE_UNDOSYS_TYPE_PAINTCURVE = NULL;
 const UndoType *BKE_UNDOSYS_TYPE_PARTICLE = NULL;
 const UndoType *BKE_UNDOSYS_TYPE_SCULPT = NULL;
+const UndoType *BKE_UNDOSYS_TYPE_SELECT = NULL;
 const UndoType *BKE_UNDOSYS_TYPE_TEXT = NULL;
 /** \} */
 
@@ -788,6 +789,17 @@ bool BKE_undosys_step_redo(UndoStack *ustack, bContext *C)
   return BKE_undosys_step_redo_with_data(ustack, C, ustack->step_active);
 }
 
+/**
+ * Decode \a us without making it the active step.
+ *
+ * For undo types that only store a partial state on top of an earlier step
+ * (see #BKE_UNDOSYS_TYPE_SELECT), which needs to be loaded first.
+ */
+void BKE_undosys_step_decode_base(UndoStack *ustack, bContext *C, UndoStep *us, int dir)
+{
+  undosys_step_decode(C, G_MAIN, ustack, us, dir, false);
+}
+
 bool BKE_undosys_step_load_data(UndoStack *ustack, bContext *C, UndoStep *us)
 {
   UNDO_NESTED_ASSERT(false);
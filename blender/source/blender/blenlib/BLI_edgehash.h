@@ -150,4 +150,35 @@ BLI_INLINE bool BLI_edgesetIterator_isDone(EdgeSetIterator *esi)
   return esi->index >= esi->length;
 }
 
+/* *** Lock-free EdgeHash / EdgeSet ***
+ *
+ * Edge keys for the tables of BLI_hash_lockfree.h, which can be filled from multiple threads.
+ * Create, free and iterate them with the BLI_lockfree_hash / BLI_lockfree_set functions. */
+
+struct LockfreeHash;
+struct LockfreeSet;
+
+bool BLI_edgehash_lockfree_add(struct LockfreeHash *lh,
+                               unsigned int v0,
+                               unsigned int v1,
+                               void *val);
+void *BLI_edgehash_lockfree_lookup(const struct LockfreeHash *lh,
+                                   unsigned int v0,
+                                   unsigned int v1) ATTR_WARN_UNUSED_RESULT;
+bool BLI_edgehash_lockfree_haskey(const struct LockfreeHash *lh,
+                                  unsigned int v0,
+                                  unsigned int v1) ATTR_WARN_UNUSED_RESULT;
+bool BLI_edgeset_lockfree_add(struct LockfreeSet *ls, unsigned int v0, unsigned int v1);
+bool BLI_edgeset_lockfree_haskey(const struct LockfreeSet *ls,
+                                 unsigned int v0,
+                                 unsigned int v1) ATTR_WARN_UNUSED_RESULT;
+
+BLI_INLINE void BLI_edgehash_lockfree_key_decode(uint64_t key,
+                                                 unsigned int *r_v0,
+                                                 unsigned int *r_v1)
+{
+  *r_v0 = (uint)(key >> 32);
+  *r_v1 = (uint)key;
+}
+
 #endif /* __BLI_EDGEHASH_H__ */
@@ -0,0 +1,106 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2019 Blender Foundation.
+ * All rights reserved.
+ */
+
+#ifndef __BLI_HASH_LOCKFREE_H__
+#define __BLI_HASH_LOCKFREE_H__
+
+/** \file
+ * \ingroup bli
+ *
+ * Fixed size (key -> pointer) hash table and key set, which can be filled
+ * from multiple threads at once (i.e. from #BLI_task_parallel_range).
+ *
+ * Keys are 64 bit integers (pointers can be used as keys with
+ * #BLI_HASH_LOCKFREE_PTR_KEY). The table uses open addressing with linear
+ * probing, it does not grow: reserve enough entries on creation.
+ *
+ * Entries can't be removed, only the whole table can be cleared.
+ */
+
+#include "BLI_compiler_attrs.h"
+#include "BLI_sys_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* This key can't be stored. */
+#define BLI_HASH_LOCKFREE_KEY_EMPTY UINT64_MAX
+
+#define BLI_HASH_LOCKFREE_PTR_KEY(ptr) ((uint64_t)(uintptr_t)(ptr))
+
+struct LockfreeHash;
+typedef struct LockfreeHash LockfreeHash;
+
+struct LockfreeSet;
+typedef struct LockfreeSet LockfreeSet;
+
+typedef struct LockfreeHashIterator {
+  const uint64_t *keys;
+  void **values;
+  uint capacity;
+  uint index;
+} LockfreeHashIterator;
+
+/* ************************************************************************** */
+/* NOTE: These functions are NOT safe for use from threads. */
+
+LockfreeHash *BLI_lockfree_hash_new(const char *info,
+                                    const uint nentries_reserve) ATTR_MALLOC
+    ATTR_WARN_UNUSED_RESULT;
+void BLI_lockfree_hash_free(LockfreeHash *lh);
+void BLI_lockfree_hash_clear(LockfreeHash *lh);
+int BLI_lockfree_hash_len(const LockfreeHash *lh) ATTR_WARN_UNUSED_RESULT;
+
+void BLI_lockfree_hash_iterator_init(LockfreeHashIterator *lhi, LockfreeHash *lh);
+bool BLI_lockfree_hash_iterator_step(LockfreeHashIterator *lhi, uint64_t *r_key, void **r_value);
+
+LockfreeSet *BLI_lockfree_set_new(const char *info,
+                                  const uint nentries_reserve) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+void BLI_lockfree_set_free(LockfreeSet *ls);
+void BLI_lockfree_set_clear(LockfreeSet *ls);
+int BLI_lockfree_set_len(const LockfreeSet *ls) ATTR_WARN_UNUSED_RESULT;
+
+void BLI_lockfree_set_iterator_init(LockfreeHashIterator *lhi, LockfreeSet *ls);
+#define BLI_lockfree_set_iterator_step(lhi, r_key) \
+  BLI_lockfree_hash_iterator_step(lhi, r_key, NULL)
+
+/* ************************************************************************** */
+/* NOTE: These functions are safe for use from threads. */
+
+/* Values added by other threads are only guaranteed to be visible once the
+ * threads are synchronized (i.e. after the parallel loop adding them is done).
+ * Before that, a lookup can find the key of an entry which is still being
+ * added, with a NULL value. */
+
+bool BLI_lockfree_hash_add(LockfreeHash *lh, uint64_t key, void *value);
+void *BLI_lockfree_hash_lookup(const LockfreeHash *lh, uint64_t key) ATTR_WARN_UNUSED_RESULT;
+void *BLI_lockfree_hash_lookup_default(const LockfreeHash *lh,
+                                       uint64_t key,
+                                       void *val_default) ATTR_WARN_UNUSED_RESULT;
+bool BLI_lockfree_hash_haskey(const LockfreeHash *lh, uint64_t key) ATTR_WARN_UNUSED_RESULT;
+
+bool BLI_lockfree_set_add(LockfreeSet *ls, uint64_t key);
+bool BLI_lockfree_set_haskey(const LockfreeSet *ls, uint64_t key) ATTR_WARN_UNUSED_RESULT;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BLI_HASH_LOCKFREE_H__ */
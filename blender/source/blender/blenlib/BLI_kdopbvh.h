@@ -156,6 +156,11 @@ bool BLI_bvhtree_update_node(
     BVHTree *tree, int index, const float co[3], const float co_moving[3], int numpoints);
 void BLI_bvhtree_update_tree(BVHTree *tree);
 
+/* For testing only, free the wide node layout of a balanced tree (see #BVHTreeWide). */
+#ifdef KDOPBVH_INTERNAL_API
+void BLI_bvhtree_wide_free(BVHTree *tree);
+#endif
+
 int BLI_bvhtree_overlap_thread_num(const BVHTree *tree);
 
 /* collision/overlap: check two trees if they overlap,
@@ -44,6 +44,7 @@ struct MemArena *BLI_memarena_new(const size_t bufsize, const char *name) ATTR_W
 void BLI_memarena_free(struct MemArena *ma) ATTR_NONNULL(1);
 void BLI_memarena_use_malloc(struct MemArena *ma) ATTR_NONNULL(1);
 void BLI_memarena_use_calloc(struct MemArena *ma) ATTR_NONNULL(1);
+void BLI_memarena_use_numa_local(struct MemArena *ma) ATTR_NONNULL(1);
 void BLI_memarena_use_align(struct MemArena *ma, const size_t align) ATTR_NONNULL(1);
 void *BLI_memarena_alloc(struct MemArena *ma, size_t size) ATTR_WARN_UNUSED_RESULT
     ATTR_NONNULL(1) ATTR_MALLOC ATTR_ALLOC_SIZE(2);
@@ -26,6 +26,8 @@
 
 #include <stdlib.h>
 
+#include "BLI_sys_types.h"
+
 /* glibc 2.8+ */
 #if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 8))
 #  define BLI_qsort_r qsort_r
@@ -40,4 +42,43 @@ void BLI_qsort_r(void *a, size_t n, size_t es, BLI_sort_cmp_t cmp, void *thunk)
 #endif
     ;
 
+/* Parallel sorting on the task scheduler (sort_parallel.c) */
+
+/**
+ * Sort an array like #BLI_qsort_r, using all threads for large arrays.
+ * Elements comparing equal keep their order when the sort of each chunk does.
+ *
+ * \note \a cmp is called from multiple threads at once, so it must not modify \a thunk.
+ */
+void BLI_parallel_sort(void *a, size_t n, size_t es, BLI_sort_cmp_t cmp, void *thunk)
+#ifdef __GNUC__
+    __attribute__((nonnull(1, 4)))
+#endif
+    ;
+
+/**
+ * Stable radix sorts of \a keys in ascending order.
+ * \a values (may be NULL) is an array of the same length, reordered along with the keys,
+ * typically the original index of each key.
+ */
+void BLI_radix_sort_uint(uint *keys, uint *values, size_t len)
+#ifdef __GNUC__
+    __attribute__((nonnull(1)))
+#endif
+    ;
+void BLI_radix_sort_uint64(uint64_t *keys, uint *values, size_t len)
+#ifdef __GNUC__
+    __attribute__((nonnull(1)))
+#endif
+    ;
+/**
+ * Negative zero sorts before positive zero, NaN's sort before or after all other values
+ * depending on their sign bit.
+ */
+void BLI_radix_sort_float(float *keys, uint *values, size_t len)
+#ifdef __GNUC__
+    __attribute__((nonnull(1)))
+#endif
+    ;
+
 #endif /* __BLI_SORT_H__ */
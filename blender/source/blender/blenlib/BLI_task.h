@@ -37,8 +37,11 @@ struct BLI_mempool;
 
 /* Task Scheduler
  *
- * Central scheduler that holds running threads ready to execute tasks. A single
- * queue holds the task from all pools.
+ * Central scheduler that holds running threads ready to execute tasks. Each
+ * thread of the scheduler (including the main thread) pushes tasks to its own
+ * lock-free deque and runs the newest task from it first, idle threads steal
+ * the oldest tasks from the deques of other threads. Tasks pushed from threads
+ * not managed by the scheduler go to a global queue.
  *
  * Init/exit must be called before/after any task pools are created/freed, and
  * must be called from the main threads. All other scheduler and pool functions
@@ -118,9 +121,11 @@ void *BLI_task_pool_userdata(TaskPool *pool);
 /* optional mutex to use from run function */
 ThreadMutex *BLI_task_pool_user_mutex(TaskPool *pool);
 
-/* Delayed push, use that to reduce thread overhead by accumulating
- * all new tasks into local queue first and pushing it to scheduler
- * from within a single mutex lock.
+/* Delayed push, used to reduce thread overhead by accumulating all new tasks
+ * and pushing them to the scheduler from within a single mutex lock.
+ *
+ * NOTE: No-op since pushing to the per-thread deques doesn't lock anymore,
+ * kept for compatibility.
  */
 void BLI_task_pool_delayed_push_begin(TaskPool *pool, int thread_id);
 void BLI_task_pool_delayed_push_end(TaskPool *pool, int thread_id);
@@ -200,6 +200,17 @@ void BLI_thread_queue_nowait(ThreadQueue *queue);
 void BLI_thread_put_process_on_fast_node(void);
 void BLI_thread_put_thread_on_fast_node(void);
 
+/* Pin task scheduler threads to NUMA nodes (opt-in, disabled by default). */
+void BLI_system_numa_affinity_set(bool use_numa);
+bool BLI_system_numa_affinity_get(void);
+int BLI_system_numa_thread_node(int thread_index);
+bool BLI_thread_put_thread_on_numa_node(int node);
+
+/* Allocate from the NUMA node of the calling thread (when NUMA affinity is used). */
+void *BLI_numa_alloc_local(size_t len, const char *name);
+size_t BLI_numa_alloc_len(const void *ptr);
+void BLI_numa_free(void *ptr);
+
 #ifdef __cplusplus
 }
 #endif
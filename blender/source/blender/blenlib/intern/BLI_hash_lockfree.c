@@ -0,0 +1,297 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2019 Blender Foundation.
+ * All rights reserved.
+ */
+
+/** \file
+ * \ingroup bli
+ *
+ * A key is claimed by a single compare-and-swap on its slot, so threads adding
+ * different keys never wait on each other. The value is written by the thread
+ * which claimed the key, after the swap.
+ */
+
+#include <limits.h>
+#include <string.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_utildefines.h"
+
+#include "BLI_hash_lockfree.h"
+#include "BLI_strict_flags.h"
+
+#include "atomic_ops.h"
+
+#define SLOT_NONE UINT_MAX
+
+struct LockfreeHash {
+  uint64_t *keys;
+  void **values;
+  uint mask;
+};
+
+struct LockfreeSet {
+  uint64_t *keys;
+  uint mask;
+};
+
+/* -------------------------------------------------------------------- */
+/** \name Internal Table Functions
+ * \{ */
+
+BLI_INLINE uint lockfree_key_hash(uint64_t key)
+{
+  /* Finalizer of splitmix64, all bits of the key affect the low bits of the hash. */
+  key ^= key >> 30;
+  key *= 0xbf58476d1ce4e5b9ULL;
+  key ^= key >> 27;
+  key *= 0x94d049bb133111ebULL;
+  key ^= key >> 31;
+  return (uint)key;
+}
+
+static uint lockfree_table_capacity(const uint nentries_reserve)
+{
+  /* Keep the table at most half full, linear probing degrades quickly above that. */
+  BLI_assert(nentries_reserve <= UINT_MAX / 4);
+  uint capacity = 16;
+  while (capacity < nentries_reserve * 2) {
+    capacity <<= 1;
+  }
+  return capacity;
+}
+
+static uint64_t *lockfree_keys_alloc(const uint capacity, const char *info)
+{
+  uint64_t *keys = MEM_mallocN(sizeof(*keys) * capacity, info);
+  memset(keys, 0xff, sizeof(*keys) * capacity);
+  return keys;
+}
+
+/**
+ * Find the slot of \a key, claiming an empty one when it is not in the table yet.
+ *
+ * \return the slot index, or #SLOT_NONE when the table is full.
+ */
+static uint lockfree_slot_ensure(uint64_t *keys,
+                                 const uint mask,
+                                 const uint64_t key,
+                                 bool *r_added)
+{
+  BLI_assert(key != BLI_HASH_LOCKFREE_KEY_EMPTY);
+
+  uint slot = lockfree_key_hash(key) & mask;
+  for (uint i = 0; i <= mask; i++, slot = (slot + 1) & mask) {
+    uint64_t slot_key = ((volatile uint64_t *)keys)[slot];
+    if (slot_key == BLI_HASH_LOCKFREE_KEY_EMPTY) {
+      slot_key = atomic_cas_uint64(&keys[slot], BLI_HASH_LOCKFREE_KEY_EMPTY, key);
+      if (slot_key == BLI_HASH_LOCKFREE_KEY_EMPTY) {
+        *r_added = true;
+        return slot;
+      }
+      /* Another thread claimed the slot first, it may have added the same key. */
+    }
+    if (slot_key == key) {
+      *r_added = false;
+      return slot;
+    }
+  }
+
+  *r_added = false;
+  return SLOT_NONE;
+}
+
+static uint lockfree_slot_find(const uint64_t *keys, const uint mask, const uint64_t key)
+{
+  uint slot = lockfree_key_hash(key) & mask;
+  for (uint i = 0; i <= mask; i++, slot = (slot + 1) & mask) {
+    const uint64_t slot_key = ((const volatile uint64_t *)keys)[slot];
+    if (slot_key == key) {
+      return slot;
+    }
+    if (slot_key == BLI_HASH_LOCKFREE_KEY_EMPTY) {
+      break;
+    }
+  }
+  return SLOT_NONE;
+}
+
+static int lockfree_keys_len(const uint64_t *keys, const uint mask)
+{
+  int len = 0;
+  for (uint i = 0; i <= mask; i++) {
+    if (keys[i] != BLI_HASH_LOCKFREE_KEY_EMPTY) {
+      len++;
+    }
+  }
+  return len;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Hash API
+ * \{ */
+
+LockfreeHash *BLI_lockfree_hash_new(const char *info, const uint nentries_reserve)
+{
+  LockfreeHash *lh = MEM_mallocN(sizeof(*lh), info);
+  const uint capacity = lockfree_table_capacity(nentries_reserve);
+  lh->keys = lockfree_keys_alloc(capacity, info);
+  lh->values = MEM_callocN(sizeof(*lh->values) * capacity, info);
+  lh->mask = capacity - 1;
+  return lh;
+}
+
+void BLI_lockfree_hash_free(LockfreeHash *lh)
+{
+  MEM_freeN(lh->keys);
+  MEM_freeN(lh->values);
+  MEM_freeN(lh);
+}
+
+void BLI_lockfree_hash_clear(LockfreeHash *lh)
+{
+  const uint capacity = lh->mask + 1;
+  memset(lh->keys, 0xff, sizeof(*lh->keys) * capacity);
+  memset(lh->values, 0, sizeof(*lh->values) * capacity);
+}
+
+int BLI_lockfree_hash_len(const LockfreeHash *lh)
+{
+  return lockfree_keys_len(lh->keys, lh->mask);
+}
+
+/**
+ * Add \a key with \a value, unless it's already in the table.
+ *
+ * \return true when the key was added, false when it existed already (the
+ * existing value is kept) or when the table is full.
+ */
+bool BLI_lockfree_hash_add(LockfreeHash *lh, uint64_t key, void *value)
+{
+  bool added;
+  const uint slot = lockfree_slot_ensure(lh->keys, lh->mask, key, &added);
+  BLI_assert(slot != SLOT_NONE);
+  if (added) {
+    lh->values[slot] = value;
+  }
+  return added;
+}
+
+void *BLI_lockfree_hash_lookup(const LockfreeHash *lh, uint64_t key)
+{
+  return BLI_lockfree_hash_lookup_default(lh, key, NULL);
+}
+
+void *BLI_lockfree_hash_lookup_default(const LockfreeHash *lh, uint64_t key, void *val_default)
+{
+  const uint slot = lockfree_slot_find(lh->keys, lh->mask, key);
+  return (slot != SLOT_NONE) ? lh->values[slot] : val_default;
+}
+
+bool BLI_lockfree_hash_haskey(const LockfreeHash *lh, uint64_t key)
+{
+  return lockfree_slot_find(lh->keys, lh->mask, key) != SLOT_NONE;
+}
+
+void BLI_lockfree_hash_iterator_init(LockfreeHashIterator *lhi, LockfreeHash *lh)
+{
+  lhi->keys = lh->keys;
+  lhi->values = lh->values;
+  lhi->capacity = lh->mask + 1;
+  lhi->index = 0;
+}
+
+/**
+ * Get the next entry of the table, in no particular order.
+ *
+ * \return false when all entries have been visited.
+ */
+bool BLI_lockfree_hash_iterator_step(LockfreeHashIterator *lhi, uint64_t *r_key, void **r_value)
+{
+  while (lhi->index < lhi->capacity) {
+    const uint index = lhi->index++;
+    if (lhi->keys[index] != BLI_HASH_LOCKFREE_KEY_EMPTY) {
+      *r_key = lhi->keys[index];
+      if (r_value) {
+        *r_value = lhi->values[index];
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Set API
+ * \{ */
+
+LockfreeSet *BLI_lockfree_set_new(const char *info, const uint nentries_reserve)
+{
+  LockfreeSet *ls = MEM_mallocN(sizeof(*ls), info);
+  const uint capacity = lockfree_table_capacity(nentries_reserve);
+  ls->keys = lockfree_keys_alloc(capacity, info);
+  ls->mask = capacity - 1;
+  return ls;
+}
+
+void BLI_lockfree_set_free(LockfreeSet *ls)
+{
+  MEM_freeN(ls->keys);
+  MEM_freeN(ls);
+}
+
+void BLI_lockfree_set_clear(LockfreeSet *ls)
+{
+  memset(ls->keys, 0xff, sizeof(*ls->keys) * (ls->mask + 1));
+}
+
+int BLI_lockfree_set_len(const LockfreeSet *ls)
+{
+  return lockfree_keys_len(ls->keys, ls->mask);
+}
+
+/**
+ * \return true when the key was added, false when it existed already or the table is full.
+ */
+bool BLI_lockfree_set_add(LockfreeSet *ls, uint64_t key)
+{
+  bool added;
+  const uint slot = lockfree_slot_ensure(ls->keys, ls->mask, key, &added);
+  BLI_assert(slot != SLOT_NONE);
+  UNUSED_VARS_NDEBUG(slot);
+  return added;
+}
+
+bool BLI_lockfree_set_haskey(const LockfreeSet *ls, uint64_t key)
+{
+  return lockfree_slot_find(ls->keys, ls->mask, key) != SLOT_NONE;
+}
+
+void BLI_lockfree_set_iterator_init(LockfreeHashIterator *lhi, LockfreeSet *ls)
+{
+  lhi->keys = ls->keys;
+  lhi->values = NULL;
+  lhi->capacity = ls->mask + 1;
+  lhi->index = 0;
+}
+
+/** \} */
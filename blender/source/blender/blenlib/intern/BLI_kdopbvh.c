@@ -36,8 +36,14 @@
  *   #BLI_bvhtree_overlap, #BVHOverlapData_Shared, #BVHOverlapData_Thread
  * - Range Query:
  *   #BLI_bvhtree_range_query
+ *
+ * After balancing, axis aligned trees (6-DOP) with up to #BVH_WIDE_LANES children per node
+ * also get a wide layout (#BVHTreeWide) used by ray-casts, nearest point and overlap queries,
+ * which test all children of a node at once.
  */
 
+#define KDOPBVH_INTERNAL_API
+
 #include <assert.h>
 
 #include "MEM_guardedalloc.h"
@@ -61,8 +67,21 @@
 /* Check tree is valid. */
 // #define USE_VERIFY_TREE
 
+/* Traverse trees using the wide node layout, see #BVHTreeWide. */
+#define USE_WIDE_NODES
+
 #define MAX_TREETYPE 32
 
+#ifdef USE_WIDE_NODES
+/* Children of a wide node, wider trees don't get a wide layout. */
+#  define BVH_WIDE_LANES 8
+/* Axes of the wide node bounds, only axis aligned trees get a wide layout. */
+#  define BVH_WIDE_AXES 3
+/* Wide nodes aren't deeper than the tree they are built from (at most 32 levels for
+ * binary trees), each level adds less than #BVH_WIDE_LANES items to the traversal stack. */
+#  define BVH_WIDE_STACK_SIZE (32 * (BVH_WIDE_LANES - 1) + 1)
+#endif
+
 /* Setting zero so we can catch bugs in BLI_task/KDOPBVH.
  * TODO(sergey): Deduplicate the limits with PBVH from BKE.
  */
@@ -90,6 +109,35 @@ typedef struct BVHNode {
   char main_axis; /* Axis used to split this node */
 } BVHNode;
 
+#ifdef USE_WIDE_NODES
+/**
+ * A branch of the tree with the children of its sub-tree collapsed into a single node,
+ * until there are #BVH_WIDE_LANES children.
+ * Children keep the depth first order of the original tree.
+ */
+typedef struct BVHWideNode {
+  /** The branch this node was built from (for its bounds). */
+  const BVHNode *node;
+  /** Leafs or branches, NULL for unused lanes. */
+  const BVHNode *children[BVH_WIDE_LANES];
+  /** Index of the wide node of branch children, -1 for leafs and unused lanes. */
+  int children_wide[BVH_WIDE_LANES];
+  int children_len;
+} BVHWideNode;
+
+typedef struct BVHTreeWide {
+  BVHWideNode *nodes;
+  /**
+   * Bounds of the children of each node: for each axis the minimum of all lanes,
+   * followed by the maximum of all lanes (#BVH_WIDE_BV_STRIDE floats per node).
+   */
+  float *bv;
+  int nodes_len;
+} BVHTreeWide;
+
+#  define BVH_WIDE_BV_STRIDE (BVH_WIDE_AXES * 2 * BVH_WIDE_LANES)
+#endif
+
 /* keep under 26 bytes for speed purposes */
 struct BVHTree {
   BVHNode **nodes;
@@ -102,11 +150,14 @@ struct BVHTree {
   axis_t start_axis, stop_axis; /* bvhtree_kdop_axes array indices according to axis */
   axis_t axis;                  /* kdop type (6 => OBB, 7 => AABB, ...) */
   char tree_type;               /* type of tree (4 => quadtree) */
+#ifdef USE_WIDE_NODES
+  BVHTreeWide *wide; /* optional, see #bvhtree_wide_build */
+#endif
 };
 
-/* optimization, ensure we stay small */
-BLI_STATIC_ASSERT((sizeof(void *) == 8 && sizeof(BVHTree) <= 48) ||
-                      (sizeof(void *) == 4 && sizeof(BVHTree) <= 32),
+/* optimization, ensure we stay small (one more pointer for the wide nodes) */
+BLI_STATIC_ASSERT((sizeof(void *) == 8 && sizeof(BVHTree) <= 56) ||
+                      (sizeof(void *) == 4 && sizeof(BVHTree) <= 36),
                   "over sized")
 
 /* avoid duplicating vars in BVHOverlapData_Thread */
@@ -858,6 +909,164 @@ static void non_recursive_bvh_div_nodes(const BVHTree *tree,
 
 /** \} */
 
+#ifdef USE_WIDE_NODES
+
+/* -------------------------------------------------------------------- */
+/** \name Wide Nodes
+ * \{ */
+
+static float bv_area_aabb(const float *bv)
+{
+  const float size[3] = {bv[1] - bv[0], bv[3] - bv[2], bv[5] - bv[4]};
+  return size[0] * size[1] + size[1] * size[2] + size[2] * size[0];
+}
+
+static int bvhtree_wide_build_node(BVHTreeWide *wide, const BVHNode *node)
+{
+  const BVHNode *children[BVH_WIDE_LANES];
+  int children_len = node->totnode;
+  const int index = wide->nodes_len++;
+  BVHWideNode *wnode = &wide->nodes[index];
+
+  memcpy(children, node->children, sizeof(*children) * (size_t)children_len);
+
+  /* Replace the largest branch with its children while they fit,
+   * in place to keep the depth first order. */
+  while (true) {
+    int expand = -1;
+    float expand_area = -1.0f;
+    for (int i = 0; i < children_len; i++) {
+      if (children[i]->totnode && (children_len - 1 + children[i]->totnode <= BVH_WIDE_LANES)) {
+        const float area = bv_area_aabb(children[i]->bv);
+        if (area > expand_area) {
+          expand = i;
+          expand_area = area;
+        }
+      }
+    }
+    if (expand == -1) {
+      break;
+    }
+    const BVHNode *branch = children[expand];
+    memmove(&children[expand + branch->totnode],
+            &children[expand + 1],
+            sizeof(*children) * (size_t)(children_len - (expand + 1)));
+    memcpy(&children[expand], branch->children, sizeof(*children) * (size_t)branch->totnode);
+    children_len += branch->totnode - 1;
+  }
+
+  wnode->node = node;
+  wnode->children_len = children_len;
+  for (int i = 0; i < BVH_WIDE_LANES; i++) {
+    wnode->children[i] = (i < children_len) ? children[i] : NULL;
+    wnode->children_wide[i] = -1;
+  }
+  for (int i = 0; i < children_len; i++) {
+    if (children[i]->totnode) {
+      wnode->children_wide[i] = bvhtree_wide_build_node(wide, children[i]);
+    }
+  }
+  return index;
+}
+
+/**
+ * Copy the bounds of the children into the wide nodes,
+ * needed after building and after the tree was updated.
+ */
+static void bvhtree_wide_refit(const BVHTree *tree)
+{
+  const BVHTreeWide *wide = tree->wide;
+  for (int i = 0; i < wide->nodes_len; i++) {
+    const BVHWideNode *wnode = &wide->nodes[i];
+    float *bv = &wide->bv[i * BVH_WIDE_BV_STRIDE];
+    for (axis_t axis_iter = 0; axis_iter < BVH_WIDE_AXES; axis_iter++) {
+      float *bv_min = &bv[(2 * axis_iter) * BVH_WIDE_LANES];
+      float *bv_max = &bv[(2 * axis_iter + 1) * BVH_WIDE_LANES];
+      for (int lane = 0; lane < BVH_WIDE_LANES; lane++) {
+        const BVHNode *child = wnode->children[lane];
+        bv_min[lane] = child ? child->bv[2 * axis_iter] : FLT_MAX;
+        bv_max[lane] = child ? child->bv[2 * axis_iter + 1] : -FLT_MAX;
+      }
+    }
+  }
+}
+
+static void bvhtree_wide_build(BVHTree *tree)
+{
+  const BVHNode *root = tree->nodes[tree->totleaf];
+
+  /* Trees with more axes (cloth and collision) are mostly used for overlap queries,
+   * where the wide nodes would have to store all of their axes. */
+  if ((tree->tree_type > BVH_WIDE_LANES) || (tree->axis != 6) || (root == NULL) ||
+      (root->totnode == 0)) {
+    return;
+  }
+  BLI_assert((tree->start_axis == 0) && (tree->stop_axis == BVH_WIDE_AXES));
+
+  BVHTreeWide *wide = MEM_mallocN(sizeof(*wide), __func__);
+  /* Collapsing the branches leaves fewer wide nodes than branches, shrunk after building. */
+  wide->nodes = MEM_mallocN(sizeof(*wide->nodes) * (size_t)tree->totbranch, __func__);
+  wide->nodes_len = 0;
+  bvhtree_wide_build_node(wide, root);
+  BLI_assert(wide->nodes_len <= tree->totbranch);
+  wide->nodes = MEM_reallocN(wide->nodes, sizeof(*wide->nodes) * (size_t)wide->nodes_len);
+  wide->bv = MEM_mallocN(sizeof(*wide->bv) * (size_t)(BVH_WIDE_BV_STRIDE * wide->nodes_len),
+                         __func__);
+
+  tree->wide = wide;
+  bvhtree_wide_refit(tree);
+}
+
+static void bvhtree_wide_free(BVHTree *tree)
+{
+  if (tree->wide) {
+    MEM_freeN(tree->wide->nodes);
+    MEM_freeN(tree->wide->bv);
+    MEM_freeN(tree->wide);
+    tree->wide = NULL;
+  }
+}
+
+/** Item of the traversal stack of wide nodes. */
+typedef struct BVHWideStackItem {
+  const BVHNode *node;
+  /** Index of the wide node, -1 for leafs. */
+  int wide;
+  float dist;
+} BVHWideStackItem;
+
+/**
+ * Push the children of a wide node which have a \a dist below \a dist_max,
+ * the nearest last so it's visited first.
+ */
+static int bvhtree_wide_stack_push(BVHWideStackItem *stack,
+                                   int stack_len,
+                                   const BVHWideNode *wnode,
+                                   const float dist[BVH_WIDE_LANES],
+                                   const float dist_max)
+{
+  const int stack_len_prev = stack_len;
+  for (int lane = 0; lane < wnode->children_len; lane++) {
+    if (dist[lane] >= dist_max) {
+      continue;
+    }
+    /* Insertion sort, farthest first. */
+    int i = stack_len++;
+    for (; i > stack_len_prev && stack[i - 1].dist < dist[lane]; i--) {
+      stack[i] = stack[i - 1];
+    }
+    stack[i].node = wnode->children[lane];
+    stack[i].wide = wnode->children_wide[lane];
+    stack[i].dist = dist[lane];
+  }
+  BLI_assert(stack_len <= BVH_WIDE_STACK_SIZE);
+  return stack_len;
+}
+
+/** \} */
+
+#endif /* USE_WIDE_NODES */
+
 /* -------------------------------------------------------------------- */
 /** \name BLI_bvhtree API
  * \{ */
@@ -940,6 +1149,9 @@ fail:
 void BLI_bvhtree_free(BVHTree *tree)
 {
   if (tree) {
+#ifdef USE_WIDE_NODES
+    bvhtree_wide_free(tree);
+#endif
     MEM_SAFE_FREE(tree->nodes);
     MEM_SAFE_FREE(tree->nodearray);
     MEM_SAFE_FREE(tree->nodebv);
@@ -971,6 +1183,10 @@ void BLI_bvhtree_balance(BVHTree *tree)
   build_skip_links(tree, tree->nodes[tree->totleaf], NULL, NULL);
 #endif
 
+#ifdef USE_WIDE_NODES
+  bvhtree_wide_build(tree);
+#endif
+
 #ifdef USE_VERIFY_TREE
   bvhtree_verify(tree);
 #endif
@@ -1044,7 +1260,27 @@ void BLI_bvhtree_update_tree(BVHTree *tree)
   for (; index >= root; index--) {
     node_join(tree, *index);
   }
+
+#ifdef USE_WIDE_NODES
+  if (tree->wide) {
+    bvhtree_wide_refit(tree);
+  }
+#endif
+}
+
+/**
+ * Queries traverse the nodes of the tree itself afterwards,
+ * mainly useful to compare them with the wide node traversal.
+ */
+void BLI_bvhtree_wide_free(BVHTree *tree)
+{
+#ifdef USE_WIDE_NODES
+  bvhtree_wide_free(tree);
+#else
+  UNUSED_VARS(tree);
+#endif
 }
+
 /**
  * Number of times #BLI_bvhtree_insert has been called.
  * mainly useful for asserts functions to check we added the correct number.
@@ -1233,6 +1469,113 @@ static bool tree_overlap_traverse_first_cb(BVHOverlapData_Thread *data_thread,
   return false;
 }
 
+#ifdef USE_WIDE_NODES
+/**
+ * Test \a node1 against all children of a wide node.
+ */
+static void tree_overlap_test_wide(const BVHNode *node1,
+                                   const float *bv2,
+                                   axis_t start_axis,
+                                   axis_t stop_axis,
+                                   bool r_overlap[BVH_WIDE_LANES])
+{
+  for (int lane = 0; lane < BVH_WIDE_LANES; lane++) {
+    r_overlap[lane] = true;
+  }
+  for (axis_t axis_iter = start_axis; axis_iter != stop_axis; axis_iter++) {
+    const float bv1_min = node1->bv[2 * axis_iter];
+    const float bv1_max = node1->bv[2 * axis_iter + 1];
+    const float *bv2_min = &bv2[(2 * axis_iter) * BVH_WIDE_LANES];
+    const float *bv2_max = &bv2[(2 * axis_iter + 1) * BVH_WIDE_LANES];
+    for (int lane = 0; lane < BVH_WIDE_LANES; lane++) {
+      r_overlap[lane] &= !((bv1_min > bv2_max[lane]) | (bv2_min[lane] > bv1_max));
+    }
+  }
+}
+
+/**
+ * A version of #tree_overlap_traverse, #tree_overlap_traverse_cb and
+ * #tree_overlap_traverse_first_cb using the wide nodes of the second tree,
+ * finding the same overlaps in the same order.
+ *
+ * \param node1: Must overlap the bounds of \a wnode2.
+ * \return True when \a break_on_first is set and an overlap was found.
+ */
+static bool tree_overlap_traverse_wide(BVHOverlapData_Thread *data_thread,
+                                       const BVHNode *node1,
+                                       const BVHWideNode *wnode2,
+                                       const bool break_on_first)
+{
+  BVHOverlapData_Shared *data = data_thread->shared;
+  const BVHTreeWide *wide2 = data->tree2->wide;
+
+  if (node1->totnode) {
+    for (int j = 0; j < node1->totnode; j++) {
+      if (tree_overlap_test(node1->children[j], wnode2->node, data->start_axis, data->stop_axis)) {
+        /* Like #tree_overlap_traverse_first_cb, keep looking in the other children. */
+        tree_overlap_traverse_wide(data_thread, node1->children[j], wnode2, break_on_first);
+      }
+    }
+    return false;
+  }
+
+  bool overlap[BVH_WIDE_LANES];
+  tree_overlap_test_wide(node1,
+                         &wide2->bv[(wnode2 - wide2->nodes) * BVH_WIDE_BV_STRIDE],
+                         data->start_axis,
+                         data->stop_axis,
+                         overlap);
+
+  for (int lane = 0; lane < wnode2->children_len; lane++) {
+    if (!overlap[lane]) {
+      continue;
+    }
+    const BVHNode *node2 = wnode2->children[lane];
+    if (node2->totnode) {
+      if (tree_overlap_traverse_wide(data_thread,
+                                     node1,
+                                     &wide2->nodes[wnode2->children_wide[lane]],
+                                     break_on_first)) {
+        return true;
+      }
+      continue;
+    }
+
+    if (UNLIKELY(node1 == node2)) {
+      continue;
+    }
+    if (data->callback &&
+        !data->callback(data->userdata, node1->index, node2->index, data_thread->thread)) {
+      continue;
+    }
+    /* both leafs, insert overlap! */
+    if (data_thread->overlap) {
+      BVHTreeOverlap *overlap_pair = BLI_stack_push_r(data_thread->overlap);
+      overlap_pair->indexA = node1->index;
+      overlap_pair->indexB = node2->index;
+    }
+    if (break_on_first) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Traverse a child of the root of the first tree and the wide nodes of the second tree.
+ */
+static void tree_overlap_traverse_wide_root(BVHOverlapData_Thread *data_thread,
+                                            const BVHNode *node1,
+                                            const bool break_on_first)
+{
+  BVHOverlapData_Shared *data = data_thread->shared;
+  const BVHWideNode *wnode2 = &data->tree2->wide->nodes[0];
+  if (tree_overlap_test(node1, wnode2->node, data->start_axis, data->stop_axis)) {
+    tree_overlap_traverse_wide(data_thread, node1, wnode2, break_on_first);
+  }
+}
+#endif /* USE_WIDE_NODES */
+
 /**
  * Use to check the total number of threads #BLI_bvhtree_overlap will use.
  *
@@ -1250,6 +1593,14 @@ static void bvhtree_overlap_task_cb(void *__restrict userdata,
   BVHOverlapData_Thread *data = &((BVHOverlapData_Thread *)userdata)[j];
   BVHOverlapData_Shared *data_shared = data->shared;
 
+#ifdef USE_WIDE_NODES
+  if (data_shared->tree2->wide) {
+    tree_overlap_traverse_wide_root(
+        data, data_shared->tree1->nodes[data_shared->tree1->totleaf]->children[j], false);
+    return;
+  }
+#endif
+
   if (data_shared->callback) {
     tree_overlap_traverse_cb(data,
                              data_shared->tree1->nodes[data_shared->tree1->totleaf]->children[j],
@@ -1269,6 +1620,14 @@ static void bvhtree_overlap_first_task_cb(void *__restrict userdata,
   BVHOverlapData_Thread *data = &((BVHOverlapData_Thread *)userdata)[j];
   BVHOverlapData_Shared *data_shared = data->shared;
 
+#ifdef USE_WIDE_NODES
+  if (data_shared->tree2->wide) {
+    tree_overlap_traverse_wide_root(
+        data, data_shared->tree1->nodes[data_shared->tree1->totleaf]->children[j], true);
+    return;
+  }
+#endif
+
   tree_overlap_traverse_first_cb(
       data,
       data_shared->tree1->nodes[data_shared->tree1->totleaf]->children[j],
@@ -1454,6 +1813,72 @@ static void dfs_find_nearest_begin(BVHNearestData *data, BVHNode *node)
   dfs_find_nearest_dfs(data, node);
 }
 
+#ifdef USE_WIDE_NODES
+/**
+ * #calc_nearest_point_squared for all children of a wide node.
+ */
+static void calc_nearest_point_squared_wide(const float proj[3],
+                                            const float *bv,
+                                            float r_dist_sq[BVH_WIDE_LANES])
+{
+  for (int lane = 0; lane < BVH_WIDE_LANES; lane++) {
+    r_dist_sq[lane] = 0.0f;
+  }
+  for (int i = 0; i != 3; i++) {
+    const float *bv_min = &bv[(2 * i) * BVH_WIDE_LANES];
+    const float *bv_max = &bv[(2 * i + 1) * BVH_WIDE_LANES];
+    for (int lane = 0; lane < BVH_WIDE_LANES; lane++) {
+      float val = proj[i];
+      val = (bv_min[lane] > val) ? bv_min[lane] : val;
+      val = (bv_max[lane] < val) ? bv_max[lane] : val;
+      r_dist_sq[lane] += (val - proj[i]) * (val - proj[i]);
+    }
+  }
+}
+
+/**
+ * A version of #dfs_find_nearest_begin using the wide nodes,
+ * visiting the children of a node from near to far.
+ */
+static void dfs_find_nearest_wide(BVHNearestData *data, const BVHNode *root)
+{
+  const BVHTreeWide *wide = data->tree->wide;
+  BVHWideStackItem stack[BVH_WIDE_STACK_SIZE];
+  float nearest[3];
+  int stack_len = 0;
+
+  stack[stack_len].node = root;
+  stack[stack_len].wide = 0;
+  stack[stack_len].dist = calc_nearest_point_squared(data->proj, (BVHNode *)root, nearest);
+  stack_len++;
+
+  while (stack_len) {
+    const BVHWideStackItem item = stack[--stack_len];
+    if (item.dist >= data->nearest.dist_sq) {
+      continue;
+    }
+
+    if (item.wide == -1) {
+      if (data->callback) {
+        data->callback(data->userdata, item.node->index, data->co, &data->nearest);
+      }
+      else {
+        data->nearest.index = item.node->index;
+        data->nearest.dist_sq = item.dist;
+        calc_nearest_point_squared(data->proj, (BVHNode *)item.node, data->nearest.co);
+      }
+    }
+    else {
+      float dist_sq[BVH_WIDE_LANES];
+      calc_nearest_point_squared_wide(
+          data->proj, &wide->bv[item.wide * BVH_WIDE_BV_STRIDE], dist_sq);
+      stack_len = bvhtree_wide_stack_push(
+          stack, stack_len, &wide->nodes[item.wide], dist_sq, data->nearest.dist_sq);
+    }
+  }
+}
+#endif /* USE_WIDE_NODES */
+
 /* Priority queue method */
 static void heap_find_nearest_inner(BVHNearestData *data, HeapSimple *heap, BVHNode *node)
 {
@@ -1535,6 +1960,11 @@ int BLI_bvhtree_find_nearest_ex(BVHTree *tree,
     if (flag & BVH_NEAREST_OPTIMAL_ORDER) {
       heap_find_nearest_begin(&data, root);
     }
+#ifdef USE_WIDE_NODES
+    else if (tree->wide) {
+      dfs_find_nearest_wide(&data, root);
+    }
+#endif
     else {
       dfs_find_nearest_begin(&data, root);
     }
@@ -1764,6 +2194,78 @@ static void dfs_raycast(BVHRayCastData *data, BVHNode *node)
   }
 }
 
+#ifdef USE_WIDE_NODES
+/**
+ * #fast_ray_nearest_hit for all children of a wide node.
+ */
+static void fast_ray_nearest_hit_wide(const BVHRayCastData *data,
+                                      const float *bv,
+                                      float r_dist[BVH_WIDE_LANES])
+{
+  const float *bv_x1 = &bv[data->index[0] * BVH_WIDE_LANES];
+  const float *bv_x2 = &bv[data->index[1] * BVH_WIDE_LANES];
+  const float *bv_y1 = &bv[data->index[2] * BVH_WIDE_LANES];
+  const float *bv_y2 = &bv[data->index[3] * BVH_WIDE_LANES];
+  const float *bv_z1 = &bv[data->index[4] * BVH_WIDE_LANES];
+  const float *bv_z2 = &bv[data->index[5] * BVH_WIDE_LANES];
+
+  for (int lane = 0; lane < BVH_WIDE_LANES; lane++) {
+    const float t1x = (bv_x1[lane] - data->ray.origin[0]) * data->idot_axis[0];
+    const float t2x = (bv_x2[lane] - data->ray.origin[0]) * data->idot_axis[0];
+    const float t1y = (bv_y1[lane] - data->ray.origin[1]) * data->idot_axis[1];
+    const float t2y = (bv_y2[lane] - data->ray.origin[1]) * data->idot_axis[1];
+    const float t1z = (bv_z1[lane] - data->ray.origin[2]) * data->idot_axis[2];
+    const float t2z = (bv_z2[lane] - data->ray.origin[2]) * data->idot_axis[2];
+
+    const bool miss = (t1x > t2y) | (t2x < t1y) | (t1x > t2z) | (t2x < t1z) | (t1y > t2z) |
+                      (t2y < t1z) | (t2x < 0.0f) | (t2y < 0.0f) | (t2z < 0.0f) |
+                      (t1x > data->hit.dist) | (t1y > data->hit.dist) | (t1z > data->hit.dist);
+    r_dist[lane] = miss ? FLT_MAX : max_fff(t1x, t1y, t1z);
+  }
+}
+
+/**
+ * A version of #dfs_raycast using the wide nodes, visiting the children of a node
+ * in the order the ray enters them.
+ * Only used for rays without a radius, like #fast_ray_nearest_hit.
+ */
+static void dfs_raycast_wide(BVHRayCastData *data, const BVHNode *root)
+{
+  const BVHTreeWide *wide = data->tree->wide;
+  BVHWideStackItem stack[BVH_WIDE_STACK_SIZE];
+  int stack_len = 0;
+
+  stack[stack_len].node = root;
+  stack[stack_len].wide = 0;
+  stack[stack_len].dist = fast_ray_nearest_hit(data, root);
+  stack_len++;
+
+  while (stack_len) {
+    const BVHWideStackItem item = stack[--stack_len];
+    if (item.dist >= data->hit.dist) {
+      continue;
+    }
+
+    if (item.wide == -1) {
+      if (data->callback) {
+        data->callback(data->userdata, item.node->index, &data->ray, &data->hit);
+      }
+      else {
+        data->hit.index = item.node->index;
+        data->hit.dist = item.dist;
+        madd_v3_v3v3fl(data->hit.co, data->ray.origin, data->ray.direction, item.dist);
+      }
+    }
+    else {
+      float dist[BVH_WIDE_LANES];
+      fast_ray_nearest_hit_wide(data, &wide->bv[item.wide * BVH_WIDE_BV_STRIDE], dist);
+      stack_len = bvhtree_wide_stack_push(
+          stack, stack_len, &wide->nodes[item.wide], dist, data->hit.dist);
+    }
+  }
+}
+#endif /* USE_WIDE_NODES */
+
 /**
  * A version of #dfs_raycast with minor changes to reset the index & dist each ray cast.
  */
@@ -1866,7 +2368,15 @@ int BLI_bvhtree_ray_cast_ex(BVHTree *tree,
   }
 
   if (root) {
-    dfs_raycast(&data, root);
+#ifdef USE_WIDE_NODES
+    if (tree->wide && (data.ray.radius == 0.0f)) {
+      dfs_raycast_wide(&data, root);
+    }
+    else
+#endif
+    {
+      dfs_raycast(&data, root);
+    }
     //      iterative_raycast(&data, root);
   }
 
@@ -36,6 +36,7 @@
 
 #include "BLI_utildefines.h"
 #include "BLI_memarena.h"
+#include "BLI_threads.h"
 #include "BLI_strict_flags.h"
 
 #ifdef WITH_MEM_VALGRIND
@@ -72,17 +73,24 @@ struct MemArena {
   size_t align;
 
   bool use_calloc;
+  bool use_numa_local;
 };
 
-static void memarena_buf_free_all(struct MemBuf *mb)
+static void memarena_buf_free_all(MemArena *ma, struct MemBuf *mb)
 {
   while (mb != NULL) {
     struct MemBuf *mb_next = mb->next;
 
-    /* Unpoison memory because MEM_freeN might overwrite it. */
-    ASAN_UNPOISON_MEMORY_REGION(mb, (uint)MEM_allocN_len(mb));
+    if (ma->use_numa_local) {
+      ASAN_UNPOISON_MEMORY_REGION(mb, (uint)BLI_numa_alloc_len(mb));
+      BLI_numa_free(mb);
+    }
+    else {
+      /* Unpoison memory because MEM_freeN might overwrite it. */
+      ASAN_UNPOISON_MEMORY_REGION(mb, (uint)MEM_allocN_len(mb));
 
-    MEM_freeN(mb);
+      MEM_freeN(mb);
+    }
     mb = mb_next;
   }
 }
@@ -109,6 +117,18 @@ void BLI_memarena_use_malloc(MemArena *ma)
   ma->use_calloc = 0;
 }
 
+/**
+ * Allocate buffers from the NUMA node of the thread using the arena,
+ * only has an effect when NUMA affinity is enabled (see #BLI_system_numa_affinity_set).
+ */
+void BLI_memarena_use_numa_local(MemArena *ma)
+{
+  /* Buffers are freed according to this, it can't change afterwards. */
+  BLI_assert(ma->bufs == NULL);
+
+  ma->use_numa_local = true;
+}
+
 void BLI_memarena_use_align(struct MemArena *ma, const size_t align)
 {
   /* Align must be a power of two. */
@@ -119,7 +139,7 @@ void BLI_memarena_use_align(struct MemArena *ma, const size_t align)
 
 void BLI_memarena_free(MemArena *ma)
 {
-  memarena_buf_free_all(ma->bufs);
+  memarena_buf_free_all(ma, ma->bufs);
 
   VALGRIND_DESTROY_MEMPOOL(ma);
 
@@ -154,8 +174,16 @@ void *BLI_memarena_alloc(MemArena *ma, size_t size)
       ma->cursize = ma->bufsize;
     }
 
-    struct MemBuf *mb = (ma->use_calloc ? MEM_callocN : MEM_mallocN)(sizeof(*mb) + ma->cursize,
-                                                                     ma->name);
+    struct MemBuf *mb;
+    if (ma->use_numa_local) {
+      mb = BLI_numa_alloc_local(sizeof(*mb) + ma->cursize, ma->name);
+      if (ma->use_calloc) {
+        memset(mb, 0, sizeof(*mb) + ma->cursize);
+      }
+    }
+    else {
+      mb = (ma->use_calloc ? MEM_callocN : MEM_mallocN)(sizeof(*mb) + ma->cursize, ma->name);
+    }
     ma->curbuf = mb->data;
     mb->next = ma->bufs;
     ma->bufs = mb;
@@ -200,7 +228,7 @@ void BLI_memarena_clear(MemArena *ma)
     size_t curbuf_used;
 
     if (ma->bufs->next) {
-      memarena_buf_free_all(ma->bufs->next);
+      memarena_buf_free_all(ma, ma->bufs->next);
       ma->bufs->next = NULL;
     }
 
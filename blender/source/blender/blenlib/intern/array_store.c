@@ -751,12 +751,18 @@ BLI_INLINE uint hash_data_single(const uchar p)
 }
 
 /* hash bytes, from BLI_ghashutil_strhash_n */
-static uint hash_data(const uchar *key, size_t n)
+BLI_INLINE uint hash_data(const uchar *key, size_t n)
 {
-  const signed char *p;
+  const signed char *p = (const signed char *)key;
   unsigned int h = HASH_INIT;
 
-  for (p = (const signed char *)key; n--; p++) {
+  /* Four bytes per step, giving the same result as hashing one byte at a time
+   * (multiplying by powers of 33), without each byte depending on the previous step. */
+  for (; n >= 4; n -= 4, p += 4) {
+    h = (h * 1185921u) + ((unsigned int)p[0] * 35937u) + ((unsigned int)p[1] * 1089u) +
+        ((unsigned int)p[2] * 33u) + (unsigned int)p[3];
+  }
+  for (; n--; p++) {
     h = ((h << 5) + h) + (unsigned int)*p;
   }
 
@@ -766,14 +772,38 @@ static uint hash_data(const uchar *key, size_t n)
 #undef HASH_INIT
 
 #ifdef USE_HASH_TABLE_ACCUMULATE
+BLI_INLINE void hash_array_from_data_stride(const uchar *data_slice,
+                                            const size_t data_slice_len,
+                                            const size_t stride,
+                                            hash_key *hash_array)
+{
+  for (size_t i = 0, i_step = 0; i_step < data_slice_len; i++, i_step += stride) {
+    hash_array[i] = hash_data(&data_slice[i_step], stride);
+  }
+}
+
 static void hash_array_from_data(const BArrayInfo *info,
                                  const uchar *data_slice,
                                  const size_t data_slice_len,
                                  hash_key *hash_array)
 {
   if (info->chunk_stride != 1) {
-    for (size_t i = 0, i_step = 0; i_step < data_slice_len; i++, i_step += info->chunk_stride) {
-      hash_array[i] = hash_data(&data_slice[i_step], info->chunk_stride);
+    /* Common strides (mesh custom-data for e.g.) are passed as constants,
+     * so hashing each element can be fully unrolled. */
+    switch (info->chunk_stride) {
+#  define CASE_STRIDE(stride) \
+    case stride: \
+      hash_array_from_data_stride(data_slice, data_slice_len, stride, hash_array); \
+      break
+      CASE_STRIDE(4);
+      CASE_STRIDE(8);
+      CASE_STRIDE(12);
+      CASE_STRIDE(16);
+      CASE_STRIDE(20);
+#  undef CASE_STRIDE
+      default:
+        hash_array_from_data_stride(data_slice, data_slice_len, info->chunk_stride, hash_array);
+        break;
     }
   }
   else {
@@ -856,6 +886,40 @@ static void hash_accum_single(hash_key *hash_array, const size_t hash_array_len,
   }
 }
 
+/**
+ * Calculate the accumulated hashes of \a hash_array, starting at \a hash_index,
+ * giving the same values as running #hash_accum on the whole array.
+ *
+ * Since the table lookup skips over data matching existing chunks,
+ * calculating hashes only as they're needed avoids hashing most of the data
+ * when few changes have been made.
+ *
+ * \return The end of the range which has been calculated (exclusive).
+ */
+static size_t hash_array_from_data_accum_range(const BArrayInfo *info,
+                                               const uchar *data_slice,
+                                               hash_key *hash_array,
+                                               const size_t hash_array_len,
+                                               const size_t hash_index,
+                                               const size_t hash_range_len)
+{
+  BLI_assert(hash_index < hash_array_len);
+  size_t hash_index_end = MIN2(hash_index + hash_range_len, hash_array_len);
+  /* Values near the end of the range also depend on the values read-ahead. */
+  const size_t hash_index_read_end = MIN2(hash_index_end + info->accum_read_ahead_len,
+                                          hash_array_len);
+  hash_array_from_data(info,
+                       &data_slice[hash_index * info->chunk_stride],
+                       (hash_index_read_end - hash_index) * info->chunk_stride,
+                       &hash_array[hash_index]);
+  hash_accum(&hash_array[hash_index], hash_index_read_end - hash_index, info->accum_steps);
+  /* When the read-ahead reaches the end of the array, its values match #hash_accum too. */
+  if (hash_index_read_end == hash_array_len) {
+    hash_index_end = hash_array_len;
+  }
+  return hash_index_end;
+}
+
 static hash_key key_from_chunk_ref(const BArrayInfo *info,
                                    const BChunkRef *cref,
                                    /* avoid reallocating each time */
@@ -1206,9 +1270,11 @@ static BChunkList *bchunk_list_from_data_merge(const BArrayInfo *info,
     const size_t table_hash_array_len = (data_len - i_prev) / info->chunk_stride;
     hash_key *table_hash_array = MEM_mallocN(sizeof(*table_hash_array) * table_hash_array_len,
                                              __func__);
-    hash_array_from_data(info, &data[i_prev], data_len - i_prev, table_hash_array);
-
-    hash_accum(table_hash_array, table_hash_array_len, info->accum_steps);
+    /* Hashes are calculated as they're needed by the lookup, see:
+     * #hash_array_from_data_accum_range. */
+    size_t table_hash_array_calc_len = 0;
+    const size_t table_hash_array_calc_step = MAX2(
+        info->chunk_byte_size / info->chunk_stride, 8 * info->accum_read_ahead_len);
 #else
     /* dummy vars */
     uint i_table_start = 0;
@@ -1292,6 +1358,21 @@ static BChunkList *bchunk_list_from_data_merge(const BArrayInfo *info,
     for (size_t i = i_prev; i < data_len;) {
       /* Assumes exiting chunk isnt a match! */
 
+#ifdef USE_HASH_TABLE_ACCUMULATE
+      {
+        /* Lookups only move forward, so hashes before this are never needed. */
+        const size_t i_table = (i - i_table_start) / info->chunk_stride;
+        if (i_table >= table_hash_array_calc_len) {
+          table_hash_array_calc_len = hash_array_from_data_accum_range(info,
+                                                                       &data[i_table_start],
+                                                                       table_hash_array,
+                                                                       table_hash_array_len,
+                                                                       i_table,
+                                                                       table_hash_array_calc_step);
+        }
+      }
+#endif
+
       const BChunkRef *cref_found = table_lookup(
           info, table, table_len, i_table_start, data, data_len, i, table_hash_array);
       if (cref_found != NULL) {
@@ -31,6 +31,7 @@
 
 #include "BLI_utildefines.h"
 #include "BLI_edgehash.h"
+#include "BLI_hash_lockfree.h"
 #include "BLI_strict_flags.h"
 
 typedef struct _EdgeHash_Edge Edge;
@@ -636,3 +637,41 @@ void BLI_edgesetIterator_free(EdgeSetIterator *esi)
 }
 
 /** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Lock-free EdgeHash / EdgeSet API
+ * \{ */
+
+BLI_INLINE uint64_t edge_lockfree_key(uint v0, uint v1)
+{
+  /* Never #BLI_HASH_LOCKFREE_KEY_EMPTY, since the vertices of an edge differ. */
+  Edge edge = init_edge(v0, v1);
+  return ((uint64_t)edge.v_low << 32) | edge.v_high;
+}
+
+bool BLI_edgehash_lockfree_add(LockfreeHash *lh, uint v0, uint v1, void *value)
+{
+  return BLI_lockfree_hash_add(lh, edge_lockfree_key(v0, v1), value);
+}
+
+void *BLI_edgehash_lockfree_lookup(const LockfreeHash *lh, uint v0, uint v1)
+{
+  return BLI_lockfree_hash_lookup(lh, edge_lockfree_key(v0, v1));
+}
+
+bool BLI_edgehash_lockfree_haskey(const LockfreeHash *lh, uint v0, uint v1)
+{
+  return BLI_lockfree_hash_haskey(lh, edge_lockfree_key(v0, v1));
+}
+
+bool BLI_edgeset_lockfree_add(LockfreeSet *ls, uint v0, uint v1)
+{
+  return BLI_lockfree_set_add(ls, edge_lockfree_key(v0, v1));
+}
+
+bool BLI_edgeset_lockfree_haskey(const LockfreeSet *ls, uint v0, uint v1)
+{
+  return BLI_lockfree_set_haskey(ls, edge_lockfree_key(v0, v1));
+}
+
+/** \} */
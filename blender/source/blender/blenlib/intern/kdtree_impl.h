@@ -22,6 +22,7 @@
 
 #include "BLI_math.h"
 #include "BLI_kdtree_impl.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 #include "BLI_strict_flags.h"
 
@@ -58,6 +59,14 @@ struct KDTree {
 
 #define KD_NODE_UNSET ((uint)-1)
 
+/* Sub-trees with at least this many nodes are balanced in their own task. */
+#define KD_BALANCE_TASK_NODES_MIN 8192
+
+/* Number of queries of #BLI_kdtree_3d_find_nearest_batch traversing the tree together. */
+#define KD_BATCH_LANES 4u
+/* Minimum number of queries of #BLI_kdtree_3d_find_nearest_batch to use threads. */
+#define KD_BATCH_THREADED_MIN 1024u
+
 /** When set we know all values are unbalanced,
  * otherwise clear them when re-balancing: see T62210. */
 #define KD_NODE_ROOT_IS_INIT ((uint)-2)
@@ -143,7 +152,35 @@ void BLI_kdtree_nd_(insert)(KDTree *tree, int index, const float co[KD_DIMS])
 #endif
 }
 
-static uint kdtree_balance(KDTreeNode *nodes, uint nodes_len, uint axis, const uint ofs)
+typedef struct KDTreeBalanceTask {
+  KDTreeNode *nodes;
+  uint nodes_len;
+  uint axis;
+  uint ofs;
+} KDTreeBalanceTask;
+
+static uint kdtree_balance(
+    KDTreeNode *nodes, uint nodes_len, uint axis, const uint ofs, TaskPool *pool);
+
+static void kdtree_balance_task(TaskPool *__restrict pool, void *taskdata, int UNUSED(threadid))
+{
+  KDTreeBalanceTask *task = taskdata;
+  kdtree_balance(task->nodes, task->nodes_len, task->axis, task->ofs, pool);
+}
+
+/**
+ * The root of a sub-tree is its median, which is known before the sub-tree is balanced.
+ */
+BLI_INLINE uint kdtree_balance_root(uint nodes_len, const uint ofs)
+{
+  return (nodes_len == 0) ? KD_NODE_UNSET : (nodes_len / 2) + ofs;
+}
+
+/**
+ * \param pool: When set, large sub-trees are balanced in tasks of this pool.
+ */
+static uint kdtree_balance(
+    KDTreeNode *nodes, uint nodes_len, uint axis, const uint ofs, TaskPool *pool)
 {
   KDTreeNode *node;
   float co;
@@ -192,10 +229,24 @@ static uint kdtree_balance(KDTreeNode *nodes, uint nodes_len, uint axis, const u
   node = &nodes[median];
   node->d = axis;
   axis = (axis + 1) % KD_DIMS;
-  node->left = kdtree_balance(nodes, median, axis, ofs);
-  node->right = kdtree_balance(
-      nodes + median + 1, (nodes_len - (median + 1)), axis, (median + 1) + ofs);
 
+  /* Both halves are independent now, hand over the right one to another thread. */
+  const uint right_len = nodes_len - (median + 1);
+  if (pool && right_len >= KD_BALANCE_TASK_NODES_MIN) {
+    KDTreeBalanceTask *task = MEM_mallocN(sizeof(*task), __func__);
+    task->nodes = nodes + median + 1;
+    task->nodes_len = right_len;
+    task->axis = axis;
+    task->ofs = (median + 1) + ofs;
+    node->right = kdtree_balance_root(task->nodes_len, task->ofs);
+    BLI_task_pool_push(pool, kdtree_balance_task, task, true, TASK_PRIORITY_HIGH);
+  }
+  else {
+    node->right = kdtree_balance(nodes + median + 1, right_len, axis, (median + 1) + ofs, pool);
+  }
+  node->left = kdtree_balance(nodes, median, axis, ofs, pool);
+
+  BLI_assert(node->left == kdtree_balance_root(median, ofs));
   return median + ofs;
 }
 
@@ -208,7 +259,18 @@ void BLI_kdtree_nd_(balance)(KDTree *tree)
     }
   }
 
-  tree->root = kdtree_balance(tree->nodes, tree->nodes_len, 0, 0);
+  /* The resulting tree doesn't depend on the number of threads. */
+  TaskPool *pool = NULL;
+  if (tree->nodes_len >= KD_BALANCE_TASK_NODES_MIN * 2) {
+    pool = BLI_task_pool_create(BLI_task_scheduler_get(), NULL);
+  }
+
+  tree->root = kdtree_balance(tree->nodes, tree->nodes_len, 0, 0, pool);
+
+  if (pool) {
+    BLI_task_pool_work_and_wait(pool);
+    BLI_task_pool_free(pool);
+  }
 
 #ifdef DEBUG
   tree->is_balanced = true;
@@ -330,6 +392,225 @@ int BLI_kdtree_nd_(find_nearest)(const KDTree *tree,
   return min_node->index;
 }
 
+/* -------------------------------------------------------------------- */
+/** \name BLI_kdtree_3d_find_nearest_batch
+ * \{ */
+
+typedef struct KDTreeBatchData {
+  const KDTree *tree;
+  const float (*co)[KD_DIMS];
+  uint co_len;
+  int *r_index;
+  KDTreeNearest *r_nearest;
+} KDTreeBatchData;
+
+typedef struct KDTreeBatchStack {
+  uint node;
+  /** Squared distance of each lane to the node's side of the parent's plane. */
+  float plane_dist_sq[KD_BATCH_LANES];
+} KDTreeBatchStack;
+
+/**
+ * Find the nearest nodes of up to #KD_BATCH_LANES query points at once.
+ *
+ * The queries share a single walk over the tree, visiting a sub-tree when any of them may
+ * find a nearer node in it. Query coordinates are stored per axis, so the distance tests
+ * of all lanes compile to vector operations.
+ */
+static void kdtree_find_nearest_lanes(const KDTree *tree,
+                                      const float (*co)[KD_DIMS],
+                                      const uint lanes_len,
+                                      int *r_index,
+                                      KDTreeNearest *r_nearest)
+{
+  const KDTreeNode *nodes = tree->nodes;
+  float lanes_co[KD_DIMS][KD_BATCH_LANES];
+  float min_dist[KD_BATCH_LANES];
+  uint min_node[KD_BATCH_LANES];
+  KDTreeBatchStack *stack, stack_default[KD_STACK_INIT];
+  uint stack_len_capacity, cur = 0;
+
+  /* Unused lanes repeat the last query. */
+  for (uint lane = 0; lane < KD_BATCH_LANES; lane++) {
+    const float *lane_co = co[MIN2(lane, lanes_len - 1)];
+    for (uint j = 0; j < KD_DIMS; j++) {
+      lanes_co[j][lane] = lane_co[j];
+    }
+
+    /* Start from the nodes on the way down to the leaf containing the point,
+     * without an upper bound the lanes visited later would not skip anything. */
+    uint node_index = tree->root;
+    min_dist[lane] = FLT_MAX;
+    min_node[lane] = tree->root;
+    while (node_index != KD_NODE_UNSET) {
+      const KDTreeNode *node = &nodes[node_index];
+      const float dist_sq = len_squared_vnvn(node->co, lane_co);
+      if (dist_sq < min_dist[lane]) {
+        min_dist[lane] = dist_sq;
+        min_node[lane] = node_index;
+      }
+      node_index = (lane_co[node->d] < node->co[node->d]) ? node->left : node->right;
+    }
+  }
+
+  stack = stack_default;
+  stack_len_capacity = ARRAY_SIZE(stack_default);
+  stack[cur].node = tree->root;
+  for (uint lane = 0; lane < KD_BATCH_LANES; lane++) {
+    stack[cur].plane_dist_sq[lane] = 0.0f;
+  }
+  cur++;
+
+  while (cur--) {
+    const KDTreeBatchStack *item = &stack[cur];
+    const KDTreeNode *node = &nodes[item->node];
+    const uint d = node->d;
+
+    /* Lanes for which the node may still be nearer than the nearest found so far. */
+    bool is_active[KD_BATCH_LANES];
+    bool is_active_any = false;
+    for (uint lane = 0; lane < KD_BATCH_LANES; lane++) {
+      is_active[lane] = (item->plane_dist_sq[lane] < min_dist[lane]);
+      is_active_any |= is_active[lane];
+    }
+    if (!is_active_any) {
+      continue;
+    }
+
+    float dist_sq[KD_BATCH_LANES] = {0.0f};
+    for (uint j = 0; j < KD_DIMS; j++) {
+      for (uint lane = 0; lane < KD_BATCH_LANES; lane++) {
+        const float delta = node->co[j] - lanes_co[j][lane];
+        dist_sq[lane] += delta * delta;
+      }
+    }
+
+    /* Squared distance of each lane to the left and right side, #FLT_MAX for inactive lanes. */
+    float left_dist_sq[KD_BATCH_LANES], right_dist_sq[KD_BATCH_LANES];
+    uint left_is_near_len = 0;
+    for (uint lane = 0; lane < KD_BATCH_LANES; lane++) {
+      if (is_active[lane] && dist_sq[lane] < min_dist[lane]) {
+        min_dist[lane] = dist_sq[lane];
+        min_node[lane] = item->node;
+      }
+      const float plane_dist = node->co[d] - lanes_co[d][lane];
+      const bool left_is_near = (plane_dist >= 0.0f);
+      const float plane_dist_sq = is_active[lane] ? plane_dist * plane_dist : FLT_MAX;
+      left_dist_sq[lane] = (is_active[lane] && left_is_near) ? 0.0f : plane_dist_sq;
+      right_dist_sq[lane] = (is_active[lane] && !left_is_near) ? 0.0f : plane_dist_sq;
+      left_is_near_len += (is_active[lane] && left_is_near);
+    }
+
+    /* Push the side most lanes are on last, so it's visited first. */
+    const uint left = node->left, right = node->right;
+    const bool left_first = (left_is_near_len * 2 >= KD_BATCH_LANES);
+    for (uint side = 0; side < 2; side++) {
+      const bool is_left = (side == 0) != left_first;
+      const uint child = is_left ? left : right;
+      const float *child_dist_sq = is_left ? left_dist_sq : right_dist_sq;
+      bool use_child = false;
+      for (uint lane = 0; lane < KD_BATCH_LANES; lane++) {
+        use_child |= (child_dist_sq[lane] < min_dist[lane]);
+      }
+      if (use_child && child != KD_NODE_UNSET) {
+        stack[cur].node = child;
+        memcpy(stack[cur].plane_dist_sq, child_dist_sq, sizeof(stack[cur].plane_dist_sq));
+        cur++;
+      }
+    }
+
+    if (UNLIKELY(cur + 2 > stack_len_capacity)) {
+      stack_len_capacity += KD_NEAR_ALLOC_INC;
+      if (stack == stack_default) {
+        stack = MEM_mallocN(stack_len_capacity * sizeof(*stack), "KDTree.treestack");
+        memcpy(stack, stack_default, sizeof(stack_default));
+      }
+      else {
+        stack = MEM_reallocN(stack, stack_len_capacity * sizeof(*stack));
+      }
+    }
+  }
+
+  for (uint lane = 0; lane < lanes_len; lane++) {
+    const KDTreeNode *node = &nodes[min_node[lane]];
+    if (r_index) {
+      r_index[lane] = node->index;
+    }
+    if (r_nearest) {
+      r_nearest[lane].index = node->index;
+      r_nearest[lane].dist = sqrtf(min_dist[lane]);
+      copy_vn_vn(r_nearest[lane].co, node->co);
+    }
+  }
+
+  if (stack != stack_default) {
+    MEM_freeN(stack);
+  }
+}
+
+static void kdtree_find_nearest_batch_cb(void *__restrict userdata,
+                                         const int iter,
+                                         const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const KDTreeBatchData *data = userdata;
+  const uint i = (uint)iter * KD_BATCH_LANES;
+  kdtree_find_nearest_lanes(data->tree,
+                            &data->co[i],
+                            MIN2(KD_BATCH_LANES, data->co_len - i),
+                            data->r_index ? &data->r_index[i] : NULL,
+                            data->r_nearest ? &data->r_nearest[i] : NULL);
+}
+
+/**
+ * Find the nearest node of each of the \a co_len points in \a co,
+ * giving the same results as calling #BLI_kdtree_3d_find_nearest for each point
+ * (when several nodes are at the same distance, any of them may be returned).
+ *
+ * Large batches are spread over threads, keep nearby points next to each other in \a co
+ * for best performance.
+ *
+ * \param r_index: Optional, array of \a co_len indices, -1 when the tree is empty.
+ * \param r_nearest: Optional, array of \a co_len results, untouched when the tree is empty.
+ */
+void BLI_kdtree_nd_(find_nearest_batch)(const KDTree *tree,
+                                        const float (*co)[KD_DIMS],
+                                        const uint co_len,
+                                        int *r_index,
+                                        KDTreeNearest *r_nearest)
+{
+#ifdef DEBUG
+  BLI_assert(tree->is_balanced == true);
+#endif
+
+  if (UNLIKELY(tree->root == KD_NODE_UNSET)) {
+    if (r_index) {
+      copy_vn_i(r_index, (int)co_len, -1);
+    }
+    return;
+  }
+
+  KDTreeBatchData data = {
+      .tree = tree,
+      .co = co,
+      .co_len = co_len,
+      .r_index = r_index,
+      .r_nearest = r_nearest,
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (co_len >= KD_BATCH_THREADED_MIN);
+  settings.scheduling_mode = TASK_SCHEDULING_DYNAMIC;
+  settings.min_iter_per_thread = 64;
+  BLI_task_parallel_range(0,
+                          (int)((co_len + KD_BATCH_LANES - 1) / KD_BATCH_LANES),
+                          &data,
+                          kdtree_find_nearest_batch_cb,
+                          &settings);
+}
+
+/** \} */
+
 /**
  * A version of #BLI_kdtree_3d_find_nearest which runs a callback
  * to filter out values.
@@ -0,0 +1,415 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2019 Blender Foundation.
+ * All rights reserved.
+ */
+
+/** \file
+ * \ingroup bli
+ *
+ * Sorting on the task scheduler.
+ *
+ * #BLI_parallel_sort sorts fixed size chunks with #BLI_qsort_r, then merges pairs of sorted runs
+ * until a single run is left. Each merge is split into segments of the output, the start of a
+ * segment in both runs is found with a binary search, so all threads are busy in every round,
+ * including the last one.
+ *
+ * The radix sorts handle one byte of the key per pass, least significant byte first. A pass
+ * counts the bytes of each chunk of the array, turns the counts into write offsets per chunk and
+ * scatters the chunks in parallel, which keeps the sort stable. Passes where all keys have the
+ * same byte are skipped, so small key ranges only take as many passes as they need.
+ */
+
+#include <limits.h>
+#include <string.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_utildefines.h"
+
+#include "BLI_sort.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+
+#include "BLI_strict_flags.h"
+
+/* -------------------------------------------------------------------- */
+/** \name Parallel Merge Sort
+ * \{ */
+
+/* Length of the chunks sorted with #BLI_qsort_r, also the length of the merge segments. */
+#define SORT_CHUNK_LEN 4096u
+
+typedef struct ParallelSortData {
+  char *src;
+  char *dst;
+  size_t len;
+  size_t es;
+  BLI_sort_cmp_t cmp;
+  void *thunk;
+  /** Length of the sorted runs merged in this round. */
+  size_t run_len;
+} ParallelSortData;
+
+static void parallel_sort_chunk_cb(void *__restrict userdata,
+                                   const int iter,
+                                   const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const ParallelSortData *data = userdata;
+  const size_t start = (size_t)iter * SORT_CHUNK_LEN;
+  const size_t len = MIN2(SORT_CHUNK_LEN, data->len - start);
+  BLI_qsort_r(data->src + start * data->es, len, data->es, data->cmp, data->thunk);
+}
+
+static void parallel_sort_merge_cb(void *__restrict userdata,
+                                   const int iter,
+                                   const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const ParallelSortData *data = userdata;
+  const size_t es = data->es;
+  const size_t out = (size_t)iter * SORT_CHUNK_LEN;
+
+  /* The runs merged into this segment, segments never cross the end of a pair of runs
+   * since the run length is a multiple of the segment length. */
+  const size_t left_start = out - out % (data->run_len * 2);
+  const size_t right_start = MIN2(left_start + data->run_len, data->len);
+  const size_t end = MIN2(right_start + data->run_len, data->len);
+  const char *left = data->src + left_start * es;
+  const char *right = data->src + right_start * es;
+  const size_t left_len = right_start - left_start;
+  const size_t right_len = end - right_start;
+
+  /* Number of elements of the left run before the start of the segment,
+   * on equal elements the left run goes first. */
+  const size_t k = out - left_start;
+  size_t lo = k > right_len ? k - right_len : 0;
+  size_t hi = MIN2(k, left_len);
+  while (lo < hi) {
+    const size_t mid = lo + (hi - lo) / 2;
+    if (data->cmp(right + (k - mid - 1) * es, left + mid * es, data->thunk) >= 0) {
+      lo = mid + 1;
+    }
+    else {
+      hi = mid;
+    }
+  }
+
+  size_t i = lo, j = k - lo;
+  char *dst = data->dst + out * es;
+  const char *dst_end = dst + MIN2(SORT_CHUNK_LEN, end - out) * es;
+  for (; dst != dst_end; dst += es) {
+    const char *elem;
+    if (j == right_len ||
+        (i != left_len && data->cmp(right + j * es, left + i * es, data->thunk) >= 0)) {
+      elem = left + (i++) * es;
+    }
+    else {
+      elem = right + (j++) * es;
+    }
+    memcpy(dst, elem, es);
+  }
+}
+
+void BLI_parallel_sort(void *a, size_t n, size_t es, BLI_sort_cmp_t cmp, void *thunk)
+{
+  if (n <= SORT_CHUNK_LEN * 2 || BLI_system_thread_count() <= 1) {
+    BLI_qsort_r(a, n, es, cmp, thunk);
+    return;
+  }
+
+  const size_t chunks_len = (n + SORT_CHUNK_LEN - 1) / SORT_CHUNK_LEN;
+  BLI_assert(chunks_len <= INT_MAX);
+
+  ParallelSortData data = {
+      .src = a,
+      .len = n,
+      .es = es,
+      .cmp = cmp,
+      .thunk = thunk,
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  BLI_task_parallel_range(0, (int)chunks_len, &data, parallel_sort_chunk_cb, &settings);
+
+  char *buf = MEM_mallocN(n * es, __func__);
+  data.dst = buf;
+  for (data.run_len = SORT_CHUNK_LEN; data.run_len < n; data.run_len *= 2) {
+    BLI_task_parallel_range(0, (int)chunks_len, &data, parallel_sort_merge_cb, &settings);
+    SWAP(char *, data.src, data.dst);
+  }
+  if (data.src != a) {
+    memcpy(a, data.src, n * es);
+  }
+  MEM_freeN(buf);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Parallel Radix Sort
+ * \{ */
+
+#define RADIX_BUCKETS 256
+/* Arrays shorter than this are sorted by a single thread. */
+#define RADIX_CHUNK_LEN_MIN 65536u
+
+typedef struct RadixSortData {
+  void *keys_src;
+  void *keys_dst;
+  uint *values_src;
+  uint *values_dst;
+  size_t len;
+  size_t chunk_len;
+  /** 4 or 8. */
+  uint key_size;
+  uint shift;
+  /** Byte counts for all bytes of the keys, #key_size arrays per chunk. */
+  size_t (*chunk_counts_all)[RADIX_BUCKETS];
+  /** Byte counts for the current pass, turned into write offsets before scattering. */
+  size_t (*chunk_offsets)[RADIX_BUCKETS];
+} RadixSortData;
+
+BLI_INLINE uint radix_key_byte(const void *keys, const uint key_size, size_t i, uint shift)
+{
+  if (key_size == 8) {
+    return (uint)(((const uint64_t *)keys)[i] >> shift) & 0xffu;
+  }
+  return (((const uint *)keys)[i] >> shift) & 0xffu;
+}
+
+BLI_INLINE void radix_chunk_range(const RadixSortData *data,
+                                  const int iter,
+                                  size_t *r_start,
+                                  size_t *r_end)
+{
+  *r_start = MIN2((size_t)iter * data->chunk_len, data->len);
+  *r_end = MIN2(*r_start + data->chunk_len, data->len);
+}
+
+static void radix_sort_count_all_cb(void *__restrict userdata,
+                                    const int iter,
+                                    const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const RadixSortData *data = userdata;
+  size_t(*counts)[RADIX_BUCKETS] = &data->chunk_counts_all[(size_t)iter * data->key_size];
+  size_t start, end;
+  radix_chunk_range(data, iter, &start, &end);
+
+  memset(counts, 0, sizeof(*counts) * data->key_size);
+  if (data->key_size == 8) {
+    const uint64_t *keys = data->keys_src;
+    for (size_t i = start; i < end; i++) {
+      const uint64_t key = keys[i];
+      for (uint byte = 0; byte < 8; byte++) {
+        counts[byte][(key >> (byte * 8)) & 0xffu]++;
+      }
+    }
+  }
+  else {
+    const uint *keys = data->keys_src;
+    for (size_t i = start; i < end; i++) {
+      const uint key = keys[i];
+      for (uint byte = 0; byte < 4; byte++) {
+        counts[byte][(key >> (byte * 8)) & 0xffu]++;
+      }
+    }
+  }
+}
+
+static void radix_sort_count_cb(void *__restrict userdata,
+                                const int iter,
+                                const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const RadixSortData *data = userdata;
+  size_t *counts = data->chunk_offsets[iter];
+  size_t start, end;
+  radix_chunk_range(data, iter, &start, &end);
+
+  memset(counts, 0, sizeof(*data->chunk_offsets));
+  for (size_t i = start; i < end; i++) {
+    counts[radix_key_byte(data->keys_src, data->key_size, i, data->shift)]++;
+  }
+}
+
+static void radix_sort_scatter_cb(void *__restrict userdata,
+                                  const int iter,
+                                  const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const RadixSortData *data = userdata;
+  size_t *offsets = data->chunk_offsets[iter];
+  const uint shift = data->shift;
+  const uint *values_src = data->values_src;
+  uint *values_dst = data->values_dst;
+  size_t start, end;
+  radix_chunk_range(data, iter, &start, &end);
+
+  if (data->key_size == 8) {
+    const uint64_t *keys_src = data->keys_src;
+    uint64_t *keys_dst = data->keys_dst;
+    for (size_t i = start; i < end; i++) {
+      const size_t dst = offsets[(keys_src[i] >> shift) & 0xffu]++;
+      keys_dst[dst] = keys_src[i];
+      if (values_src) {
+        values_dst[dst] = values_src[i];
+      }
+    }
+  }
+  else {
+    const uint *keys_src = data->keys_src;
+    uint *keys_dst = data->keys_dst;
+    for (size_t i = start; i < end; i++) {
+      const size_t dst = offsets[(keys_src[i] >> shift) & 0xffu]++;
+      keys_dst[dst] = keys_src[i];
+      if (values_src) {
+        values_dst[dst] = values_src[i];
+      }
+    }
+  }
+}
+
+static void radix_sort(void *keys, uint *values, const size_t len, const uint key_size)
+{
+  if (len < 2) {
+    return;
+  }
+
+  const size_t num_threads = (size_t)BLI_system_thread_count();
+  size_t chunks_len = 1;
+  if (num_threads > 1 && len >= RADIX_CHUNK_LEN_MIN * 2) {
+    /* A few chunks per thread, so a thread which is late to start doesn't hold up a pass. */
+    chunks_len = MIN2(len / RADIX_CHUNK_LEN_MIN, num_threads * 4);
+  }
+
+  RadixSortData data = {
+      .keys_src = keys,
+      .values_src = values,
+      .len = len,
+      .chunk_len = (len + chunks_len - 1) / chunks_len,
+      .key_size = key_size,
+  };
+  data.chunk_counts_all = MEM_mallocN(sizeof(*data.chunk_counts_all) * chunks_len * key_size,
+                                      __func__);
+  data.chunk_offsets = MEM_mallocN(sizeof(*data.chunk_offsets) * chunks_len, __func__);
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (chunks_len > 1);
+
+  /* Counting all bytes at once tells which passes can be skipped,
+   * the counts stay valid for the first pass which isn't. */
+  BLI_task_parallel_range(0, (int)chunks_len, &data, radix_sort_count_all_cb, &settings);
+
+  void *keys_buf = NULL;
+  uint *values_buf = NULL;
+  bool is_first_pass = true;
+
+  for (uint byte = 0; byte < key_size; byte++) {
+    data.shift = byte * 8;
+
+    const uint key_byte = radix_key_byte(data.keys_src, key_size, 0, data.shift);
+    size_t key_byte_count = 0;
+    for (size_t chunk = 0; chunk < chunks_len; chunk++) {
+      key_byte_count += data.chunk_counts_all[chunk * key_size + byte][key_byte];
+    }
+    if (key_byte_count == len) {
+      continue;
+    }
+
+    if (is_first_pass) {
+      for (size_t chunk = 0; chunk < chunks_len; chunk++) {
+        memcpy(data.chunk_offsets[chunk],
+               data.chunk_counts_all[chunk * key_size + byte],
+               sizeof(*data.chunk_offsets));
+      }
+      keys_buf = MEM_mallocN(len * key_size, __func__);
+      values_buf = values ? MEM_mallocN(sizeof(*values_buf) * len, __func__) : NULL;
+      data.keys_dst = keys_buf;
+      data.values_dst = values_buf;
+      is_first_pass = false;
+    }
+    else {
+      BLI_task_parallel_range(0, (int)chunks_len, &data, radix_sort_count_cb, &settings);
+    }
+
+    /* Chunks write each byte value after the earlier chunks, which keeps the order of keys
+     * with the same byte. */
+    size_t offset = 0;
+    for (uint bucket = 0; bucket < RADIX_BUCKETS; bucket++) {
+      for (size_t chunk = 0; chunk < chunks_len; chunk++) {
+        const size_t count = data.chunk_offsets[chunk][bucket];
+        data.chunk_offsets[chunk][bucket] = offset;
+        offset += count;
+      }
+    }
+
+    BLI_task_parallel_range(0, (int)chunks_len, &data, radix_sort_scatter_cb, &settings);
+
+    SWAP(void *, data.keys_src, data.keys_dst);
+    SWAP(uint *, data.values_src, data.values_dst);
+  }
+
+  if (data.keys_src != keys) {
+    memcpy(keys, data.keys_src, len * key_size);
+    if (values) {
+      memcpy(values, data.values_src, sizeof(*values) * len);
+    }
+  }
+
+  MEM_SAFE_FREE(keys_buf);
+  MEM_SAFE_FREE(values_buf);
+  MEM_freeN(data.chunk_counts_all);
+  MEM_freeN(data.chunk_offsets);
+}
+
+void BLI_radix_sort_uint(uint *keys, uint *values, size_t len)
+{
+  radix_sort(keys, values, len, sizeof(*keys));
+}
+
+void BLI_radix_sort_uint64(uint64_t *keys, uint *values, size_t len)
+{
+  radix_sort(keys, values, len, sizeof(*keys));
+}
+
+/**
+ * Flip the sign bit of positive floats and all bits of negative ones,
+ * so their bits sort in the same order as the float values.
+ */
+BLI_INLINE uint radix_float_as_key(uint bits)
+{
+  return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+BLI_INLINE uint radix_float_from_key(uint key)
+{
+  return (key & 0x80000000u) ? (key & 0x7fffffffu) : ~key;
+}
+
+void BLI_radix_sort_float(float *keys, uint *values, size_t len)
+{
+  BLI_STATIC_ASSERT(sizeof(float) == sizeof(uint), "float keys are sorted as uint");
+  uint *keys_bits = (uint *)keys;
+  for (size_t i = 0; i < len; i++) {
+    keys_bits[i] = radix_float_as_key(keys_bits[i]);
+  }
+  radix_sort(keys_bits, values, len, sizeof(*keys_bits));
+  for (size_t i = 0; i < len; i++) {
+    keys_bits[i] = radix_float_from_key(keys_bits[i]);
+  }
+}
+
+/** \} */
@@ -45,18 +45,14 @@
  */
 #define MEMPOOL_SIZE 256
 
-/* Number of tasks which are pushed directly to local thread queue.
+/* Initial number of tasks a per-thread deque can hold, it grows when needed.
  *
- * This allows thread to fetch next task without locking the whole queue.
+ * Must be a power of two.
  */
-#define LOCAL_QUEUE_SIZE 1
+#define DEQUE_INITIAL_SIZE 256
 
-/* Number of tasks which are allowed to be scheduled in a delayed manner.
- *
- * This allows to use less locks per graph node children schedule. More details
- * could be found at TaskThreadLocalStorage::do_delayed_push.
- */
-#define DELAYED_QUEUE_SIZE 4096
+/* Number of times an idle worker thread looks for tasks before it goes to sleep. */
+#define WORKER_SPIN_ROUNDS 16
 
 #ifndef NDEBUG
 #  define ASSERT_THREAD_ID(scheduler, thread_id) \
@@ -137,38 +133,64 @@ typedef struct TaskThreadLocalStorage {
    * The idea is to re-use memory of finished/discarded tasks by this thread.
    */
   TaskMemPool task_mempool;
+} TaskThreadLocalStorage;
 
-  /* Local queue keeps thread alive by keeping small amount of tasks ready
-   * to be picked up without causing global thread locks for synchronization.
-   */
-  int num_local_queue;
-  Task *local_queue[LOCAL_QUEUE_SIZE];
+/* Entry of a task deque.
+ *
+ * The pool is stored next to the task, so other threads can check which pool
+ * the oldest task belongs to before stealing it, without touching the task
+ * itself (which might be finished and freed by then).
+ */
+typedef struct TaskDequeEntry {
+  Task *task;
+  TaskPool *pool;
+} TaskDequeEntry;
 
-  /* Thread can be marked for delayed tasks push. This is helpful when it's
-   * know that lots of subsequent task pushed will happen from the same thread
-   * without "interrupting" for task execution.
-   *
-   * We try to accumulate as much tasks as possible in a local queue without
-   * any locks first, and then we push all of them into a schedulers queue
-   * from within a single mutex lock.
-   */
-  bool do_delayed_push;
-  int num_delayed_queue;
-  Task *delayed_queue[DELAYED_QUEUE_SIZE];
-} TaskThreadLocalStorage;
+/* Circular storage of a task deque.
+ *
+ * When a deque runs full its storage is replaced by a twice as large copy.
+ * Stealing threads might still be reading the old storage, so it is kept
+ * (linked from the new one) until the scheduler is freed.
+ */
+typedef struct TaskDequeStorage {
+  struct TaskDequeStorage *prev;
+  int64_t mask;
+  TaskDequeEntry entries[0];
+} TaskDequeStorage;
+
+/* Lock-free work-stealing deque, one per scheduler thread.
+ *
+ * Based on "Dynamic Circular Work-Stealing Deque" by David Chase and Yossi Lev.
+ * The owner thread pushes and pops tasks at the bottom (newest first, which
+ * keeps the data of a task and its children warm in cache), other threads
+ * steal the oldest tasks from the top.
+ */
+typedef struct TaskDeque {
+  /* Index of the oldest task, advanced by stealing threads and by the owner
+   * when it pops the last task. */
+  int64_t top;
+  /* Keep top and bottom on different cache lines, they are written by different threads. */
+  char _pad[64 - sizeof(int64_t)];
+  /* Index past the newest task, only modified by the owner thread. */
+  int64_t bottom;
+  TaskDequeStorage *storage;
+} TaskDeque;
 
 struct TaskPool {
   TaskScheduler *scheduler;
 
+  /* Number of pushed tasks which are not done yet. Modified atomically,
+   * num_mutex is only used to notify threads waiting for the pool. */
   volatile size_t num;
   ThreadMutex num_mutex;
   ThreadCondition num_cond;
+  /* Number of threads sleeping on num_cond. */
+  volatile unsigned int num_waiting;
 
   void *userdata;
   ThreadMutex user_mutex;
 
   volatile bool do_cancel;
-  volatile bool do_work;
 
   volatile bool is_suspended;
   bool start_suspended;
@@ -201,15 +223,33 @@ struct TaskPool {
 #endif
 };
 
+/* Every scheduler thread (workers and the main thread) pushes tasks to its own
+ * deque and takes tasks from it, and steals from the other deques when it runs
+ * out of work. Tasks pushed from threads which are not managed by the scheduler
+ * go to a global queue instead, as do tasks of background pools when there is
+ * only the background thread (which never steals).
+ *
+ * Threads waiting for a pool (BLI_task_pool_work_and_wait()) only run tasks of
+ * that pool, to avoid deadlocks caused by running unrelated tasks in the middle
+ * of another one. Before a waiting thread looks for tasks of its pool elsewhere,
+ * it hands the tasks of other pools in its own deque over to the global queue,
+ * so they never wait for the thread to finish waiting.
+ */
 struct TaskScheduler {
   pthread_t *threads;
   struct TaskThread *task_threads;
   int num_threads;
   bool background_thread_only;
+  /* Threads are pinned to NUMA nodes, prefer stealing from threads on the same node. */
+  bool use_numa;
 
+  /* Global queue, protected by queue_mutex. */
   ListBase queue;
+  volatile size_t num_queued;
   ThreadMutex queue_mutex;
+  /* Idle worker threads sleep on queue_cond (with queue_mutex). */
   ThreadCondition queue_cond;
+  volatile unsigned int num_sleeping;
 
   ThreadMutex startup_mutex;
   ThreadCondition startup_cond;
@@ -224,6 +264,11 @@ struct TaskScheduler {
 typedef struct TaskThread {
   TaskScheduler *scheduler;
   int id;
+  /* State of the random number generator picking threads to steal from. */
+  uint32_t steal_rng;
+  /* NUMA node the thread is pinned to, -1 if none. */
+  int numa_node;
+  TaskDeque deque;
   TaskThreadLocalStorage tls;
 } TaskThread;
 
@@ -326,113 +371,451 @@ static void task_free(TaskPool *pool, Task *task, const int thread_id)
   }
 }
 
+/* Task Deque */
+
+/* Read a value which is modified by other threads. */
+BLI_INLINE int64_t task_deque_load(const int64_t *value)
+{
+  return *(const volatile int64_t *)value;
+}
+
+BLI_INLINE TaskDequeStorage *task_deque_storage_load(TaskDeque *deque)
+{
+  return *(TaskDequeStorage *volatile *)&deque->storage;
+}
+
+static TaskDequeStorage *task_deque_storage_alloc(const int64_t size, TaskDequeStorage *prev)
+{
+  BLI_assert((size & (size - 1)) == 0);
+  TaskDequeStorage *storage = MEM_mallocN(sizeof(TaskDequeStorage) + sizeof(TaskDequeEntry) * size,
+                                          "TaskDequeStorage");
+  storage->prev = prev;
+  storage->mask = size - 1;
+  return storage;
+}
+
+static void task_deque_init(TaskDeque *deque)
+{
+  deque->top = 0;
+  deque->bottom = 0;
+  deque->storage = task_deque_storage_alloc(DEQUE_INITIAL_SIZE, NULL);
+}
+
+static void task_deque_free(TaskDeque *deque)
+{
+  TaskDequeStorage *storage = deque->storage;
+
+  /* Delete leftover tasks. */
+  for (int64_t i = deque->top; i < deque->bottom; i++) {
+    Task *task = storage->entries[i & storage->mask].task;
+    task_data_free(task, 0);
+    MEM_freeN(task);
+  }
+
+  while (storage) {
+    TaskDequeStorage *prev = storage->prev;
+    MEM_freeN(storage);
+    storage = prev;
+  }
+  deque->storage = NULL;
+}
+
+BLI_INLINE bool task_deque_is_empty(TaskDeque *deque)
+{
+  return task_deque_load(&deque->bottom) <= task_deque_load(&deque->top);
+}
+
+/* Replace the storage by a twice as large one. Only called by the owner thread. */
+static TaskDequeStorage *task_deque_grow(TaskDeque *deque,
+                                         TaskDequeStorage *storage,
+                                         const int64_t top,
+                                         const int64_t bottom)
+{
+  TaskDequeStorage *new_storage = task_deque_storage_alloc((storage->mask + 1) * 2, storage);
+  for (int64_t i = top; i < bottom; i++) {
+    new_storage->entries[i & new_storage->mask] = storage->entries[i & storage->mask];
+  }
+  /* Publish the new storage before any task is pushed to it (full memory barrier). */
+  atomic_cas_ptr((void **)&deque->storage, storage, new_storage);
+  return new_storage;
+}
+
+/* Push a task to the bottom of the deque. Only called by the owner thread. */
+static void task_deque_push(TaskDeque *deque, Task *task)
+{
+  const int64_t bottom = deque->bottom;
+  const int64_t top = task_deque_load(&deque->top);
+  TaskDequeStorage *storage = deque->storage;
+
+  if (bottom - top > storage->mask) {
+    storage = task_deque_grow(deque, storage, top, bottom);
+  }
+
+  TaskDequeEntry *entry = &storage->entries[bottom & storage->mask];
+  entry->task = task;
+  entry->pool = task->pool;
+
+  /* Make the task visible to other threads (full memory barrier). */
+  atomic_add_and_fetch_int64(&deque->bottom, 1);
+}
+
+/* Pop the newest task from the bottom of the deque. Only called by the owner thread. */
+static Task *task_deque_pop(TaskDeque *deque)
+{
+  if (task_deque_is_empty(deque)) {
+    return NULL;
+  }
+
+  /* Reserve the bottom task before reading top (full memory barrier),
+   * so stealing threads and this thread can't both take it. */
+  const int64_t bottom = atomic_sub_and_fetch_int64(&deque->bottom, 1);
+  const int64_t top = task_deque_load(&deque->top);
+
+  if (top > bottom) {
+    /* Emptied by stealing threads in the meantime. */
+    atomic_add_and_fetch_int64(&deque->bottom, 1);
+    return NULL;
+  }
+
+  TaskDequeStorage *storage = deque->storage;
+  Task *task = storage->entries[bottom & storage->mask].task;
+
+  if (top == bottom) {
+    /* Last task, stealing threads might be racing for it. */
+    if (atomic_cas_int64(&deque->top, top, top + 1) != top) {
+      task = NULL;
+    }
+    atomic_add_and_fetch_int64(&deque->bottom, 1);
+  }
+
+  return task;
+}
+
+/* Steal the oldest task from the top of the deque.
+ *
+ * If pool is given, only a task of that pool is stolen. NULL is returned when
+ * there is no (matching) task, or when another thread took it first.
+ */
+static Task *task_deque_steal(TaskDeque *deque, TaskPool *pool)
+{
+  if (task_deque_is_empty(deque)) {
+    return NULL;
+  }
+
+  /* Read top before bottom (full memory barrier). */
+  const int64_t top = atomic_add_and_fetch_int64(&deque->top, 0);
+  const int64_t bottom = task_deque_load(&deque->bottom);
+  if (top >= bottom) {
+    return NULL;
+  }
+
+  TaskDequeStorage *storage = task_deque_storage_load(deque);
+  const TaskDequeEntry entry = storage->entries[top & storage->mask];
+  if (pool != NULL && entry.pool != pool) {
+    return NULL;
+  }
+
+  /* The entry is only valid if top didn't move in the meantime. */
+  if (atomic_cas_int64(&deque->top, top, top + 1) != top) {
+    return NULL;
+  }
+
+  return entry.task;
+}
+
+/* Whether the oldest task of the deque belongs to the pool (no synchronization). */
+static bool task_deque_top_is_from_pool(TaskDeque *deque, TaskPool *pool)
+{
+  const int64_t top = task_deque_load(&deque->top);
+  if (task_deque_load(&deque->bottom) <= top) {
+    return false;
+  }
+  TaskDequeStorage *storage = task_deque_storage_load(deque);
+  return storage->entries[top & storage->mask].pool == pool;
+}
+
 /* Task Scheduler */
 
-static void task_pool_num_decrease(TaskPool *pool, size_t done)
+/* Thread of the scheduler the caller runs in, NULL if it's not managed by the scheduler. */
+BLI_INLINE TaskThread *task_scheduler_current_thread(TaskScheduler *scheduler)
 {
-  BLI_mutex_lock(&pool->num_mutex);
+  return pthread_getspecific(scheduler->tls_id_key);
+}
 
-  BLI_assert(pool->num >= done);
+/* Deque of the calling thread to push tasks of the pool to, NULL if they have to go to the
+ * global queue. This is the case for threads not managed by the scheduler, and for background
+ * pools of a single threaded scheduler: its background thread doesn't steal from deques. */
+BLI_INLINE TaskDeque *task_scheduler_push_deque(TaskScheduler *scheduler, TaskPool *pool)
+{
+  if (scheduler->background_thread_only && pool->run_in_background) {
+    return NULL;
+  }
+  TaskThread *thread = task_scheduler_current_thread(scheduler);
+  return (thread != NULL) ? &thread->deque : NULL;
+}
 
-  pool->num -= done;
+/* Wake up a sleeping worker thread (if any) to pick up newly pushed work. */
+static void task_scheduler_wake_workers(TaskScheduler *scheduler, const bool all)
+{
+  if (scheduler->num_sleeping == 0) {
+    return;
+  }
 
-  if (pool->num == 0) {
-    BLI_condition_notify_all(&pool->num_cond);
+  BLI_mutex_lock(&scheduler->queue_mutex);
+  if (all) {
+    BLI_condition_notify_all(&scheduler->queue_cond);
+  }
+  else {
+    BLI_condition_notify_one(&scheduler->queue_cond);
+  }
+  BLI_mutex_unlock(&scheduler->queue_mutex);
+}
+
+/* Wake up threads waiting for the pool, since it has new tasks to work on. */
+static void task_pool_wake_waiting(TaskPool *pool)
+{
+  if (pool->num_waiting == 0) {
+    return;
   }
 
+  BLI_mutex_lock(&pool->num_mutex);
+  BLI_condition_notify_all(&pool->num_cond);
   BLI_mutex_unlock(&pool->num_mutex);
 }
 
-static void task_pool_num_increase(TaskPool *pool, size_t new)
+static void task_pool_num_decrease(TaskPool *pool, size_t done)
 {
-  BLI_mutex_lock(&pool->num_mutex);
+  /* Lock-free, unless this finishes the pool. Then threads waiting for it are
+   * notified with the mutex held, which also makes sure they don't return from
+   * waiting (and free the pool) while it is being notified. */
+  size_t num = pool->num;
+  while (num > done) {
+    const size_t prev_num = atomic_cas_z((size_t *)&pool->num, num, num - done);
+    if (prev_num == num) {
+      return;
+    }
+    num = prev_num;
+  }
 
-  pool->num += new;
-  BLI_condition_notify_all(&pool->num_cond);
+  BLI_assert(num == done);
 
+  BLI_mutex_lock(&pool->num_mutex);
+  if (atomic_sub_and_fetch_z((size_t *)&pool->num, done) == 0) {
+    BLI_condition_notify_all(&pool->num_cond);
+  }
   BLI_mutex_unlock(&pool->num_mutex);
 }
 
-static bool task_scheduler_thread_wait_pop(TaskScheduler *scheduler, Task **task)
+static void task_pool_num_increase(TaskPool *pool, size_t new)
+{
+  atomic_add_and_fetch_z((size_t *)&pool->num, new);
+}
+
+/* Add a task to the global queue.
+ *
+ * Once the queue is unlocked the task can be taken and run by another thread, which might finish
+ * the pool and let its owner free it. The pool is not necessarily owned by the caller (tasks of
+ * other pools are handed over to the queue by task_pool_work_until_done), so the waiting threads
+ * are checked for while the task is still queued, and the pool is kept alive by an extra count
+ * until they are woken up. */
+static void task_scheduler_queue_push(TaskScheduler *scheduler, Task *task, TaskPriority priority)
 {
-  bool found_task = false;
+  TaskPool *pool = task->pool;
+  bool wake_waiting;
+
   BLI_mutex_lock(&scheduler->queue_mutex);
 
-  while (!scheduler->queue.first && !scheduler->do_exit) {
-    BLI_condition_wait(&scheduler->queue_cond, &scheduler->queue_mutex);
+  if (priority == TASK_PRIORITY_HIGH) {
+    BLI_addhead(&scheduler->queue, task);
+  }
+  else {
+    BLI_addtail(&scheduler->queue, task);
   }
+  atomic_add_and_fetch_z((size_t *)&scheduler->num_queued, 1);
 
-  do {
-    Task *current_task;
+  wake_waiting = (pool->num_waiting != 0);
+  if (wake_waiting) {
+    task_pool_num_increase(pool, 1);
+  }
 
-    /* Assuming we can only have a void queue in 'exit' case here seems logical
-     * (we should only be here after our worker thread has been woken up from a
-     * condition_wait(), which only happens after a new task was added to the queue),
-     * but it is wrong.
-     * Waiting on condition may wake up the thread even if condition is not signaled
-     * (spurious wake-ups), and some race condition may also empty the queue **after**
-     * condition has been signaled, but **before** awoken thread reaches this point...
-     * See http://stackoverflow.com/questions/8594591
-     *
-     * So we only abort here if do_exit is set.
-     */
-    if (scheduler->do_exit) {
-      BLI_mutex_unlock(&scheduler->queue_mutex);
-      return false;
-    }
+  BLI_condition_notify_one(&scheduler->queue_cond);
+  BLI_mutex_unlock(&scheduler->queue_mutex);
+
+  if (wake_waiting) {
+    task_pool_wake_waiting(pool);
+    task_pool_num_decrease(pool, 1);
+  }
+}
 
-    for (current_task = scheduler->queue.first; current_task != NULL;
-         current_task = current_task->next) {
-      TaskPool *pool = current_task->pool;
+/* Take a task from the global queue. If pool is given, only a task of that pool is taken. */
+static Task *task_scheduler_queue_pop(TaskScheduler *scheduler, TaskPool *pool)
+{
+  Task *task;
 
-      if (scheduler->background_thread_only && !pool->run_in_background) {
+  if (scheduler->num_queued == 0) {
+    return NULL;
+  }
+
+  BLI_mutex_lock(&scheduler->queue_mutex);
+
+  for (task = scheduler->queue.first; task; task = task->next) {
+    if (pool != NULL) {
+      if (task->pool != pool) {
         continue;
       }
-
-      *task = current_task;
-      found_task = true;
-      BLI_remlink(&scheduler->queue, *task);
-      break;
     }
-    if (!found_task) {
-      BLI_condition_wait(&scheduler->queue_cond, &scheduler->queue_mutex);
+    else if (scheduler->background_thread_only && !task->pool->run_in_background) {
+      continue;
     }
-  } while (!found_task);
+
+    BLI_remlink(&scheduler->queue, task);
+    atomic_sub_and_fetch_z((size_t *)&scheduler->num_queued, 1);
+    break;
+  }
 
   BLI_mutex_unlock(&scheduler->queue_mutex);
 
-  return true;
+  return task;
 }
 
-BLI_INLINE void handle_local_queue(TaskThreadLocalStorage *tls, const int thread_id)
+/* Whether the global queue has tasks the pool (or a worker thread if pool is NULL)
+ * can take. Called with queue_mutex held. */
+static bool task_scheduler_queue_has_work(TaskScheduler *scheduler, TaskPool *pool)
 {
-  BLI_assert(!tls->do_delayed_push);
-  while (tls->num_local_queue > 0) {
-    /* We pop task from queue before handling it so handler of the task can
-     * push next job to the local queue.
-     */
-    tls->num_local_queue--;
-    Task *local_task = tls->local_queue[tls->num_local_queue];
-    /* TODO(sergey): Double-check work_and_wait() doesn't handle other's
-     * pool tasks.
-     */
-    TaskPool *local_pool = local_task->pool;
-    local_task->run(local_pool, local_task->taskdata, thread_id);
-    task_free(local_pool, local_task, thread_id);
+  if (scheduler->num_queued == 0) {
+    return false;
   }
-  BLI_assert(!tls->do_delayed_push);
+  if (pool == NULL && !scheduler->background_thread_only) {
+    return true;
+  }
+
+  for (Task *task = scheduler->queue.first; task; task = task->next) {
+    if (pool != NULL ? (task->pool == pool) : task->pool->run_in_background) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Steal a task from any thread other than the given one (which can be NULL).
+ * If pool is given, only a task of that pool is stolen. */
+static Task *task_scheduler_steal(TaskScheduler *scheduler, TaskThread *thief, TaskPool *pool)
+{
+  const int num_deques = scheduler->num_threads + 1;
+  int start = 0;
+
+  if (thief != NULL) {
+    /* Pick a random thread to start with, spreads stealing threads over the deques. */
+    uint32_t rng = thief->steal_rng;
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    thief->steal_rng = rng;
+    start = (int)(rng % (uint32_t)num_deques);
+  }
+
+  /* With NUMA affinity, first try threads on the same node: their tasks are likely to work
+   * on memory of that node. */
+  const int numa_node = (thief != NULL && scheduler->use_numa) ? thief->numa_node : -1;
+
+  for (int pass = (numa_node != -1) ? 0 : 1; pass < 2; pass++) {
+    for (int i = 0; i < num_deques; i++) {
+      TaskThread *victim = &scheduler->task_threads[(start + i) % num_deques];
+      if (victim == thief || (pass == 0 && victim->numa_node != numa_node)) {
+        continue;
+      }
+      Task *task = task_deque_steal(&victim->deque, pool);
+      if (task != NULL) {
+        return task;
+      }
+    }
+  }
+
+  return NULL;
+}
+
+/* Run a task (unless its pool got canceled), free it and mark it done. */
+static void task_scheduler_run_task(Task *task, const int thread_id)
+{
+  TaskPool *pool = task->pool;
+
+  if (!pool->do_cancel) {
+    task->run(pool, task->taskdata, thread_id);
+  }
+
+  task_free(pool, task, thread_id);
+
+  /* notify pool task was done */
+  task_pool_num_decrease(pool, 1);
+}
+
+static Task *task_scheduler_worker_get_task(TaskScheduler *scheduler, TaskThread *thread)
+{
+  if (scheduler->background_thread_only) {
+    /* Tasks of regular pools are left to the threads waiting for them. */
+    return task_scheduler_queue_pop(scheduler, NULL);
+  }
+
+  for (int round = 0; round < WORKER_SPIN_ROUNDS; round++) {
+    Task *task = task_deque_pop(&thread->deque);
+    if (task == NULL) {
+      task = task_scheduler_steal(scheduler, thread, NULL);
+    }
+    if (task == NULL) {
+      task = task_scheduler_queue_pop(scheduler, NULL);
+    }
+    if (task != NULL) {
+      return task;
+    }
+  }
+
+  return NULL;
+}
+
+/* Sleep until there might be work for the worker thread.
+ * Returns false if the scheduler is exiting. */
+static bool task_scheduler_worker_sleep(TaskScheduler *scheduler)
+{
+  bool do_exit;
+
+  /* Announce the sleep before checking for work one last time (full memory barrier),
+   * threads pushing tasks check for sleeping threads after pushing. */
+  atomic_add_and_fetch_u((unsigned int *)&scheduler->num_sleeping, 1);
+
+  BLI_mutex_lock(&scheduler->queue_mutex);
+
+  while (!scheduler->do_exit) {
+    bool has_work = task_scheduler_queue_has_work(scheduler, NULL);
+    for (int i = 0; i <= scheduler->num_threads && !has_work && !scheduler->background_thread_only;
+         i++) {
+      has_work = !task_deque_is_empty(&scheduler->task_threads[i].deque);
+    }
+    if (has_work) {
+      break;
+    }
+    BLI_condition_wait(&scheduler->queue_cond, &scheduler->queue_mutex);
+  }
+  do_exit = scheduler->do_exit;
+
+  BLI_mutex_unlock(&scheduler->queue_mutex);
+
+  atomic_sub_and_fetch_u((unsigned int *)&scheduler->num_sleeping, 1);
+
+  return !do_exit;
 }
 
 static void *task_scheduler_thread_run(void *thread_p)
 {
   TaskThread *thread = (TaskThread *)thread_p;
-  TaskThreadLocalStorage *tls = &thread->tls;
   TaskScheduler *scheduler = thread->scheduler;
   int thread_id = thread->id;
-  Task *task;
 
   pthread_setspecific(scheduler->tls_id_key, thread);
 
+  if (thread->numa_node != -1) {
+    BLI_thread_put_thread_on_numa_node(thread->numa_node);
+  }
+
   /* signal the main thread when all threads have started */
   BLI_mutex_lock(&scheduler->startup_mutex);
   scheduler->num_thread_started++;
@@ -442,22 +825,16 @@ static void *task_scheduler_thread_run(void *thread_p)
   BLI_mutex_unlock(&scheduler->startup_mutex);
 
   /* keep popping off tasks */
-  while (task_scheduler_thread_wait_pop(scheduler, &task)) {
-    TaskPool *pool = task->pool;
-
-    /* run task */
-    BLI_assert(!tls->do_delayed_push);
-    task->run(pool, task->taskdata, thread_id);
-    BLI_assert(!tls->do_delayed_push);
-
-    /* delete task */
-    task_free(pool, task, thread_id);
-
-    /* Handle all tasks from local queue. */
-    handle_local_queue(tls, thread_id);
+  for (;;) {
+    Task *task = task_scheduler_worker_get_task(scheduler, thread);
+    if (task == NULL) {
+      if (!task_scheduler_worker_sleep(scheduler)) {
+        break;
+      }
+      continue;
+    }
 
-    /* notify pool task was done */
-    task_pool_num_decrease(pool, 1);
+    task_scheduler_run_task(task, thread_id);
   }
 
   return NULL;
@@ -496,11 +873,30 @@ TaskScheduler *BLI_task_scheduler_create(int num_threads)
   scheduler->task_threads = MEM_mallocN(sizeof(TaskThread) * (num_threads + 1),
                                         "TaskScheduler task threads");
 
-  /* Initialize TLS for main thread. */
-  initialize_task_tls(&scheduler->task_threads[0].tls);
+  /* Initialize TLS and deques of all threads (including the main thread) before
+   * launching any, worker threads steal from all deques. */
+  for (int i = 0; i < num_threads + 1; i++) {
+    TaskThread *thread = &scheduler->task_threads[i];
+    thread->scheduler = scheduler;
+    thread->id = i;
+    thread->steal_rng = (uint32_t)(i + 1) * 2654435761u;
+    /* The main thread is never pinned, it keeps the affinity of the process. */
+    thread->numa_node = (i != 0) ? BLI_system_numa_thread_node(i) : -1;
+    if (thread->numa_node != -1) {
+      scheduler->use_numa = true;
+    }
+    task_deque_init(&thread->deque);
+    initialize_task_tls(&thread->tls);
+  }
 
   pthread_key_create(&scheduler->tls_id_key, NULL);
 
+  /* The main thread pushes to its own deque as well (while it's not waiting,
+   * the worker threads steal from it). */
+  if (BLI_thread_is_main()) {
+    pthread_setspecific(scheduler->tls_id_key, &scheduler->task_threads[0]);
+  }
+
   /* launch threads that will be waiting for work */
   if (num_threads > 0) {
     int i;
@@ -510,9 +906,6 @@ TaskScheduler *BLI_task_scheduler_create(int num_threads)
 
     for (i = 0; i < num_threads; i++) {
       TaskThread *thread = &scheduler->task_threads[i + 1];
-      thread->scheduler = scheduler;
-      thread->id = i + 1;
-      initialize_task_tls(&thread->tls);
 
       if (pthread_create(&scheduler->threads[i], NULL, task_scheduler_thread_run, thread) != 0) {
         fprintf(stderr, "TaskScheduler failed to launch thread %d/%d\n", i, num_threads);
@@ -544,6 +937,9 @@ void BLI_task_scheduler_free(TaskScheduler *scheduler)
   BLI_condition_notify_all(&scheduler->queue_cond);
   BLI_mutex_unlock(&scheduler->queue_mutex);
 
+  if (pthread_getspecific(scheduler->tls_id_key) == &scheduler->task_threads[0]) {
+    pthread_setspecific(scheduler->tls_id_key, NULL);
+  }
   pthread_key_delete(scheduler->tls_id_key);
 
   /* delete threads */
@@ -562,6 +958,7 @@ void BLI_task_scheduler_free(TaskScheduler *scheduler)
   /* Delete task thread data */
   if (scheduler->task_threads) {
     for (int i = 0; i < scheduler->num_threads + 1; i++) {
+      task_deque_free(&scheduler->task_threads[i].deque);
       TaskThreadLocalStorage *tls = &scheduler->task_threads[i].tls;
       free_task_tls(tls);
     }
@@ -591,41 +988,24 @@ int BLI_task_scheduler_num_threads(TaskScheduler *scheduler)
 
 static void task_scheduler_push(TaskScheduler *scheduler, Task *task, TaskPriority priority)
 {
-  task_pool_num_increase(task->pool, 1);
+  TaskPool *pool = task->pool;
+  TaskDeque *deque = task_scheduler_push_deque(scheduler, pool);
 
-  /* add task to queue */
-  BLI_mutex_lock(&scheduler->queue_mutex);
+  task_pool_num_increase(pool, 1);
 
-  if (priority == TASK_PRIORITY_HIGH) {
-    BLI_addhead(&scheduler->queue, task);
-  }
-  else {
-    BLI_addtail(&scheduler->queue, task);
-  }
-
-  BLI_condition_notify_one(&scheduler->queue_cond);
-  BLI_mutex_unlock(&scheduler->queue_mutex);
-}
-
-static void task_scheduler_push_all(TaskScheduler *scheduler,
-                                    TaskPool *pool,
-                                    Task **tasks,
-                                    int num_tasks)
-{
-  if (num_tasks == 0) {
+  if (deque == NULL) {
+    task_scheduler_queue_push(scheduler, task, priority);
     return;
   }
 
-  task_pool_num_increase(pool, num_tasks);
+  /* The own deque is used regardless of the priority: the newest task is taken first by
+   * this thread, while other threads steal the oldest ones. */
+  task_deque_push(deque, task);
 
-  BLI_mutex_lock(&scheduler->queue_mutex);
-
-  for (int i = 0; i < num_tasks; i++) {
-    BLI_addhead(&scheduler->queue, tasks[i]);
+  if (!scheduler->background_thread_only) {
+    task_scheduler_wake_workers(scheduler, false);
   }
-
-  BLI_condition_notify_all(&scheduler->queue_cond);
-  BLI_mutex_unlock(&scheduler->queue_mutex);
+  task_pool_wake_waiting(pool);
 }
 
 static void task_scheduler_clear(TaskScheduler *scheduler, TaskPool *pool)
@@ -646,11 +1026,14 @@ static void task_scheduler_clear(TaskScheduler *scheduler, TaskPool *pool)
       done++;
     }
   }
+  atomic_sub_and_fetch_z((size_t *)&scheduler->num_queued, done);
 
   BLI_mutex_unlock(&scheduler->queue_mutex);
 
   /* notify done */
-  task_pool_num_decrease(pool, done);
+  if (done) {
+    task_pool_num_decrease(pool, done);
+  }
 }
 
 /* Task Pool */
@@ -677,8 +1060,8 @@ static TaskPool *task_pool_create_ex(TaskScheduler *scheduler,
 
   pool->scheduler = scheduler;
   pool->num = 0;
+  pool->num_waiting = 0;
   pool->do_cancel = false;
-  pool->do_work = false;
   pool->is_suspended = is_suspended;
   pool->start_suspended = is_suspended;
   pool->num_suspended = 0;
@@ -796,11 +1179,6 @@ void BLI_task_pool_free(TaskPool *pool)
   BLI_threaded_malloc_end();
 }
 
-BLI_INLINE bool task_can_use_local_queues(TaskPool *pool, int thread_id)
-{
-  return (thread_id != -1 && (thread_id != pool->thread_id || pool->do_work));
-}
-
 static void task_pool_push(TaskPool *pool,
                            TaskRunFunction run,
                            void *taskdata,
@@ -827,31 +1205,10 @@ static void task_pool_push(TaskPool *pool,
     atomic_fetch_and_add_z(&pool->num_suspended, 1);
     return;
   }
-  /* Populate to any local queue first, this is cheapest push ever. */
-  if (task_can_use_local_queues(pool, thread_id)) {
+  if (thread_id != -1) {
     ASSERT_THREAD_ID(pool->scheduler, thread_id);
-    TaskThreadLocalStorage *tls = get_task_tls(pool, thread_id);
-    /* Try to push to a local execution queue.
-     * These tasks will be picked up next.
-     */
-    if (tls->num_local_queue < LOCAL_QUEUE_SIZE) {
-      tls->local_queue[tls->num_local_queue] = task;
-      tls->num_local_queue++;
-      return;
-    }
-    /* If we are in the delayed tasks push mode, we push tasks to a
-     * temporary local queue first without any locks, and then move them
-     * to global execution queue with a single lock.
-     */
-    if (tls->do_delayed_push && tls->num_delayed_queue < DELAYED_QUEUE_SIZE) {
-      tls->delayed_queue[tls->num_delayed_queue] = task;
-      tls->num_delayed_queue++;
-      return;
-    }
   }
-  /* Do push to a global execution pool, slowest possible method,
-   * causes quite reasonable amount of threading overhead.
-   */
+  /* Push to the deque of the current thread if it has one, the global queue otherwise. */
   task_scheduler_push(pool->scheduler, task, priority);
 }
 
@@ -881,107 +1238,141 @@ void BLI_task_pool_push_from_thread(TaskPool *pool,
   task_pool_push(pool, run, taskdata, free_taskdata, NULL, priority, thread_id);
 }
 
-void BLI_task_pool_work_and_wait(TaskPool *pool)
+/* Whether a task of the pool can be taken from any deque or the global queue.
+ * Called with the num_mutex of the pool held. */
+static bool task_pool_has_work(TaskPool *pool)
 {
-  TaskThreadLocalStorage *tls = get_task_tls(pool, pool->thread_id);
   TaskScheduler *scheduler = pool->scheduler;
+  bool has_work = false;
 
-  if (atomic_fetch_and_and_uint8((uint8_t *)&pool->is_suspended, 0)) {
-    if (pool->num_suspended) {
-      task_pool_num_increase(pool, pool->num_suspended);
-      BLI_mutex_lock(&scheduler->queue_mutex);
-
-      BLI_movelisttolist(&scheduler->queue, &pool->suspended_queue);
-
-      BLI_condition_notify_all(&scheduler->queue_cond);
-      BLI_mutex_unlock(&scheduler->queue_mutex);
-
-      pool->num_suspended = 0;
+  for (int i = 0; i <= scheduler->num_threads; i++) {
+    if (task_deque_top_is_from_pool(&scheduler->task_threads[i].deque, pool)) {
+      return true;
     }
   }
 
-  pool->do_work = true;
-
-  ASSERT_THREAD_ID(pool->scheduler, pool->thread_id);
+  if (scheduler->num_queued != 0) {
+    BLI_mutex_lock(&scheduler->queue_mutex);
+    has_work = task_scheduler_queue_has_work(scheduler, pool);
+    BLI_mutex_unlock(&scheduler->queue_mutex);
+  }
 
-  handle_local_queue(tls, pool->thread_id);
+  return has_work;
+}
 
-  BLI_mutex_lock(&pool->num_mutex);
+/* Run (or discard, when canceled) tasks of the pool until all of them are done.
+ *
+ * Only tasks of this pool are run here, running a task of another pool could
+ * end up waiting for a pool which is blocked by the caller.
+ */
+static void task_pool_work_until_done(TaskPool *pool)
+{
+  TaskScheduler *scheduler = pool->scheduler;
+  TaskThread *thread = task_scheduler_current_thread(scheduler);
 
   while (pool->num != 0) {
-    Task *task, *work_task = NULL;
-    bool found_task = false;
-
-    BLI_mutex_unlock(&pool->num_mutex);
-
-    BLI_mutex_lock(&scheduler->queue_mutex);
+    Task *task = NULL;
+
+    if (thread != NULL) {
+      /* The newest tasks of the own deque are most likely to be from this pool.
+       * Tasks of other pools are handed over to the global queue, so they don't
+       * wait for this pool to be done. */
+      while ((task = task_deque_pop(&thread->deque)) != NULL && task->pool != pool) {
+        task_scheduler_queue_push(scheduler, task, TASK_PRIORITY_HIGH);
+      }
+    }
+    if (task == NULL) {
+      task = task_scheduler_steal(scheduler, thread, pool);
+    }
+    if (task == NULL) {
+      task = task_scheduler_queue_pop(scheduler, pool);
+    }
 
-    /* find task from this pool. if we get a task from another pool,
-     * we can get into deadlock */
+    if (task != NULL) {
+      task_scheduler_run_task(task, pool->thread_id);
+      continue;
+    }
 
-    for (task = scheduler->queue.first; task; task = task->next) {
-      if (task->pool == pool) {
-        work_task = task;
-        found_task = true;
-        BLI_remlink(&scheduler->queue, task);
-        break;
-      }
+    /* Nothing to take, wait until the remaining tasks are done or new ones are pushed.
+     * The counter is increased before checking for work (full memory barrier), threads
+     * pushing tasks check it after pushing. */
+    atomic_add_and_fetch_u((unsigned int *)&pool->num_waiting, 1);
+    BLI_mutex_lock(&pool->num_mutex);
+    while (pool->num != 0 && !task_pool_has_work(pool)) {
+      BLI_condition_wait(&pool->num_cond, &pool->num_mutex);
     }
+    BLI_mutex_unlock(&pool->num_mutex);
+    atomic_sub_and_fetch_u((unsigned int *)&pool->num_waiting, 1);
+  }
 
-    BLI_mutex_unlock(&scheduler->queue_mutex);
+  /* The thread which finished the last task might still be notifying, make sure
+   * it's done with the pool before the caller is allowed to free it. */
+  BLI_mutex_lock(&pool->num_mutex);
+  BLI_mutex_unlock(&pool->num_mutex);
+}
 
-    /* if found task, do it, otherwise wait until other tasks are done */
-    if (found_task) {
-      /* run task */
-      BLI_assert(!tls->do_delayed_push);
-      work_task->run(pool, work_task->taskdata, pool->thread_id);
-      BLI_assert(!tls->do_delayed_push);
+void BLI_task_pool_work_and_wait(TaskPool *pool)
+{
+  TaskScheduler *scheduler = pool->scheduler;
 
-      /* delete task */
-      task_free(pool, task, pool->thread_id);
+  if (atomic_fetch_and_and_uint8((uint8_t *)&pool->is_suspended, 0)) {
+    if (pool->num_suspended) {
+      TaskDeque *deque = task_scheduler_push_deque(scheduler, pool);
+      Task *task, *prevtask;
 
-      /* Handle all tasks from local queue. */
-      handle_local_queue(tls, pool->thread_id);
+      task_pool_num_increase(pool, pool->num_suspended);
 
-      /* notify pool task was done */
-      task_pool_num_decrease(pool, 1);
-    }
+      /* Suspended queue holds the newest task first. */
+      for (task = pool->suspended_queue.last; task; task = prevtask) {
+        prevtask = task->prev;
+        if (deque != NULL) {
+          task_deque_push(deque, task);
+        }
+        else {
+          task_scheduler_queue_push(scheduler, task, TASK_PRIORITY_LOW);
+        }
+      }
+      BLI_listbase_clear(&pool->suspended_queue);
 
-    BLI_mutex_lock(&pool->num_mutex);
-    if (pool->num == 0) {
-      break;
-    }
+      if (!scheduler->background_thread_only) {
+        task_scheduler_wake_workers(scheduler, true);
+      }
 
-    if (!found_task) {
-      BLI_condition_wait(&pool->num_cond, &pool->num_mutex);
+      pool->num_suspended = 0;
     }
   }
 
-  BLI_mutex_unlock(&pool->num_mutex);
+  ASSERT_THREAD_ID(pool->scheduler, pool->thread_id);
 
-  BLI_assert(tls->num_local_queue == 0);
+  task_pool_work_until_done(pool);
 }
 
 void BLI_task_pool_work_wait_and_reset(TaskPool *pool)
 {
   BLI_task_pool_work_and_wait(pool);
 
-  pool->do_work = false;
   pool->is_suspended = pool->start_suspended;
 }
 
 void BLI_task_pool_cancel(TaskPool *pool)
 {
+  Task *task, *nexttask;
+
   pool->do_cancel = true;
 
   task_scheduler_clear(pool->scheduler, pool);
 
-  /* wait until all entries are cleared */
-  BLI_mutex_lock(&pool->num_mutex);
-  while (pool->num) {
-    BLI_condition_wait(&pool->num_cond, &pool->num_mutex);
+  /* Discard the tasks which are still queued in deques, wait for running ones to finish. */
+  task_pool_work_until_done(pool);
+
+  /* Tasks of a suspended pool which was never activated. */
+  for (task = pool->suspended_queue.first; task; task = nexttask) {
+    nexttask = task->next;
+    task_data_free(task, pool->thread_id);
+    MEM_freeN(task);
   }
-  BLI_mutex_unlock(&pool->num_mutex);
+  BLI_listbase_clear(&pool->suspended_queue);
+  pool->num_suspended = 0;
 
   pool->do_cancel = false;
 }
@@ -1001,25 +1392,16 @@ ThreadMutex *BLI_task_pool_user_mutex(TaskPool *pool)
   return &pool->user_mutex;
 }
 
+/* Tasks are pushed to the lock-free deque of the pushing thread, so there is
+ * nothing left to batch anymore. Kept for API compatibility. */
 void BLI_task_pool_delayed_push_begin(TaskPool *pool, int thread_id)
 {
-  if (task_can_use_local_queues(pool, thread_id)) {
-    ASSERT_THREAD_ID(pool->scheduler, thread_id);
-    TaskThreadLocalStorage *tls = get_task_tls(pool, thread_id);
-    tls->do_delayed_push = true;
-  }
+  UNUSED_VARS(pool, thread_id);
 }
 
 void BLI_task_pool_delayed_push_end(TaskPool *pool, int thread_id)
 {
-  if (task_can_use_local_queues(pool, thread_id)) {
-    ASSERT_THREAD_ID(pool->scheduler, thread_id);
-    TaskThreadLocalStorage *tls = get_task_tls(pool, thread_id);
-    BLI_assert(tls->do_delayed_push);
-    task_scheduler_push_all(pool->scheduler, pool, tls->delayed_queue, tls->num_delayed_queue);
-    tls->do_delayed_push = false;
-    tls->num_delayed_queue = 0;
-  }
+  UNUSED_VARS(pool, thread_id);
 }
 
 /* Parallel range routines */
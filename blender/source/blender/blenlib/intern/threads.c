@@ -123,6 +123,7 @@ static pthread_mutex_t _fftw_lock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_mutex_t _view3d_lock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_t mainid;
 static bool is_numa_available = false;
+static bool use_numa_affinity = false;
 static unsigned int thread_levels = 0; /* threads can be invoked inside threads */
 static int num_threads_override = 0;
 
@@ -966,3 +967,121 @@ void BLI_thread_put_thread_on_fast_node(void)
   }
 #endif
 }
+
+/* NUMA affinity of the task scheduler threads.
+ *
+ * Opt-in: when enabled, worker threads of schedulers created afterwards are
+ * pinned to NUMA nodes, and mempools/arenas which ask for it allocate memory
+ * from the node of the calling thread. Only has an effect on systems with more
+ * than one NUMA node. */
+
+void BLI_system_numa_affinity_set(bool use_numa)
+{
+  use_numa_affinity = use_numa;
+}
+
+bool BLI_system_numa_affinity_get(void)
+{
+  return use_numa_affinity;
+}
+
+static bool numa_affinity_is_active(void)
+{
+  return use_numa_affinity && is_numa_available && numaAPI_GetNumNodes() > 1;
+}
+
+/* NUMA node the scheduler thread with the given index is pinned to,
+ * -1 if NUMA affinity is not used.
+ *
+ * Threads fill the processors of the first node first, then of the next ones. */
+int BLI_system_numa_thread_node(int thread_index)
+{
+  if (!numa_affinity_is_active()) {
+    return -1;
+  }
+
+  const int num_nodes = numaAPI_GetNumNodes();
+  int num_processors = 0;
+  for (int node = 0; node < num_nodes; node++) {
+    if (numaAPI_IsNodeAvailable(node)) {
+      num_processors += numaAPI_GetNumNodeProcessors(node);
+    }
+  }
+  if (num_processors == 0) {
+    return -1;
+  }
+
+  int index = thread_index % num_processors;
+  for (int node = 0; node < num_nodes; node++) {
+    if (!numaAPI_IsNodeAvailable(node)) {
+      continue;
+    }
+    const int num_node_processors = numaAPI_GetNumNodeProcessors(node);
+    if (index < num_node_processors) {
+      return node;
+    }
+    index -= num_node_processors;
+  }
+  return -1;
+}
+
+bool BLI_thread_put_thread_on_numa_node(int node)
+{
+  if (!is_numa_available || node < 0) {
+    return false;
+  }
+  return numaAPI_RunThreadOnNode(node);
+}
+
+/* Header in front of the memory returned by BLI_numa_alloc_local(),
+ * keeps the memory 16 bytes aligned. */
+typedef struct NumaAllocHeader {
+  /* Requested size. */
+  size_t len;
+  /* Size of the NUMA allocation, 0 when allocated with MEM_mallocN. */
+  size_t numa_size;
+} NumaAllocHeader;
+
+/**
+ * Allocate memory on the NUMA node of the calling thread when NUMA affinity is enabled,
+ * with #MEM_mallocN otherwise. Must be freed with #BLI_numa_free.
+ *
+ * \note Memory is allocated in whole pages, only meant for large blocks.
+ */
+void *BLI_numa_alloc_local(size_t len, const char *name)
+{
+  NumaAllocHeader *header = NULL;
+
+  if (numa_affinity_is_active()) {
+    const size_t numa_size = sizeof(NumaAllocHeader) + len;
+    header = numaAPI_AllocateLocal(numa_size);
+    if (header != NULL) {
+      header->numa_size = numa_size;
+    }
+  }
+  if (header == NULL) {
+    header = MEM_mallocN(sizeof(NumaAllocHeader) + len, name);
+    header->numa_size = 0;
+  }
+
+  header->len = len;
+  return header + 1;
+}
+
+size_t BLI_numa_alloc_len(const void *ptr)
+{
+  const NumaAllocHeader *header = (const NumaAllocHeader *)ptr - 1;
+  return header->len;
+}
+
+void BLI_numa_free(void *ptr)
+{
+  NumaAllocHeader *header = (NumaAllocHeader *)ptr - 1;
+
+  if (header->numa_size != 0) {
+    numaAPI_Free(header, header->numa_size);
+  }
+  else {
+    MEM_freeN(header);
+  }
+}
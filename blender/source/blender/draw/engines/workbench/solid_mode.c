@@ -81,6 +81,12 @@ static void workbench_solid_view_update(void *vedata)
   workbench_taa_view_updated(data);
 }
 
+static void workbench_solid_view_retarget(void *vedata)
+{
+  WORKBENCH_Data *data = vedata;
+  workbench_private_data_view_retarget(data->stl->g_data);
+}
+
 static void workbench_solid_id_update(void *UNUSED(vedata), struct ID *id)
 {
   if (GS(id->name) == ID_OB) {
@@ -118,4 +124,5 @@ DrawEngineType draw_engine_workbench_solid = {
     &workbench_solid_view_update,
     &workbench_solid_id_update,
     &workbench_render_to_image,
+    &workbench_solid_view_retarget,
 };
@@ -79,6 +79,12 @@ static void workbench_transparent_view_update(void *vedata)
   workbench_taa_view_updated(data);
 }
 
+static void workbench_transparent_view_retarget(void *vedata)
+{
+  WORKBENCH_Data *data = vedata;
+  workbench_private_data_view_retarget(data->stl->g_data);
+}
+
 static const DrawEngineDataSize workbench_data_size = DRW_VIEWPORT_DATA_SIZE(WORKBENCH_Data);
 
 DrawEngineType draw_engine_workbench_transparent = {
@@ -96,4 +102,5 @@ DrawEngineType draw_engine_workbench_transparent = {
     &workbench_transparent_view_update,
     NULL,
     NULL,
+    &workbench_transparent_view_retarget,
 };
@@ -36,6 +36,50 @@ void workbench_effect_info_init(WORKBENCH_EffectInfo *effect_info)
   effect_info->view_updated = true;
 }
 
+/* Data derived from the default view, used by the cavity and specular shaders. */
+static void workbench_private_data_view_init(WORKBENCH_PrivateData *wpd)
+{
+  float invproj[4][4];
+  const bool is_persp = DRW_view_is_persp_get(NULL);
+  /* view vectors for the corners of the view frustum.
+   * Can be used to recreate the world space position easily */
+  float viewvecs[3][4] = {
+      {-1.0f, -1.0f, -1.0f, 1.0f},
+      {1.0f, -1.0f, -1.0f, 1.0f},
+      {-1.0f, 1.0f, -1.0f, 1.0f},
+  };
+  int i;
+
+  DRW_view_winmat_get(NULL, wpd->winmat, false);
+  DRW_view_winmat_get(NULL, invproj, true);
+
+  /* convert the view vectors to view space */
+  for (i = 0; i < 3; i++) {
+    mul_m4_v4(invproj, viewvecs[i]);
+    /* normalized trick see:
+     * http://www.derschmale.com/2014/01/26/reconstructing-positions-from-the-depth-buffer */
+    mul_v3_fl(viewvecs[i], 1.0f / viewvecs[i][3]);
+    if (is_persp) {
+      mul_v3_fl(viewvecs[i], 1.0f / viewvecs[i][2]);
+    }
+    viewvecs[i][3] = 1.0;
+
+    copy_v4_v4(wpd->viewvecs[i], viewvecs[i]);
+  }
+
+  /* we need to store the differences */
+  wpd->viewvecs[1][0] -= wpd->viewvecs[0][0];
+  wpd->viewvecs[1][1] = wpd->viewvecs[2][1] - wpd->viewvecs[0][1];
+
+  /* calculate a depth offset as well */
+  if (!is_persp) {
+    float vec_far[] = {-1.0f, -1.0f, 1.0f, 1.0f};
+    mul_m4_v4(invproj, vec_far);
+    mul_v3_fl(vec_far, 1.0f / vec_far[3]);
+    wpd->viewvecs[1][2] = vec_far[2] - wpd->viewvecs[0][2];
+  }
+}
+
 void workbench_private_data_init(WORKBENCH_PrivateData *wpd)
 {
   const DRWContextState *draw_ctx = DRW_context_state_get();
@@ -144,17 +188,6 @@ void workbench_private_data_init(WORKBENCH_PrivateData *wpd)
   /* Cavity settings */
   {
     const int ssao_samples = scene->display.matcap_ssao_samples;
-
-    float invproj[4][4];
-    const bool is_persp = DRW_view_is_persp_get(NULL);
-    /* view vectors for the corners of the view frustum.
-     * Can be used to recreate the world space position easily */
-    float viewvecs[3][4] = {
-        {-1.0f, -1.0f, -1.0f, 1.0f},
-        {1.0f, -1.0f, -1.0f, 1.0f},
-        {-1.0f, 1.0f, -1.0f, 1.0f},
-    };
-    int i;
     const float *size = DRW_viewport_size_get();
 
     wpd->ssao_params[0] = ssao_samples;
@@ -169,34 +202,7 @@ void workbench_private_data_init(WORKBENCH_PrivateData *wpd)
                 wpd->shading.cavity_ridge_factor,
                 scene->display.matcap_ssao_attenuation);
 
-    DRW_view_winmat_get(NULL, wpd->winmat, false);
-    DRW_view_winmat_get(NULL, invproj, true);
-
-    /* convert the view vectors to view space */
-    for (i = 0; i < 3; i++) {
-      mul_m4_v4(invproj, viewvecs[i]);
-      /* normalized trick see:
-       * http://www.derschmale.com/2014/01/26/reconstructing-positions-from-the-depth-buffer */
-      mul_v3_fl(viewvecs[i], 1.0f / viewvecs[i][3]);
-      if (is_persp) {
-        mul_v3_fl(viewvecs[i], 1.0f / viewvecs[i][2]);
-      }
-      viewvecs[i][3] = 1.0;
-
-      copy_v4_v4(wpd->viewvecs[i], viewvecs[i]);
-    }
-
-    /* we need to store the differences */
-    wpd->viewvecs[1][0] -= wpd->viewvecs[0][0];
-    wpd->viewvecs[1][1] = wpd->viewvecs[2][1] - wpd->viewvecs[0][1];
-
-    /* calculate a depth offset as well */
-    if (!is_persp) {
-      float vec_far[] = {-1.0f, -1.0f, 1.0f, 1.0f};
-      mul_m4_v4(invproj, vec_far);
-      mul_v3_fl(vec_far, 1.0f / vec_far[3]);
-      wpd->viewvecs[1][2] = vec_far[2] - wpd->viewvecs[0][2];
-    }
+    workbench_private_data_view_init(wpd);
   }
 
   wpd->volumes_do = false;
@@ -223,6 +229,20 @@ void workbench_private_data_get_light_direction(WORKBENCH_PrivateData *wpd,
   DRW_uniformbuffer_update(wpd->world_ubo, wd);
 }
 
+/**
+ * Update the view dependent data after the default view was moved,
+ * the shading groups reference it so the caches don't need to be rebuilt.
+ */
+void workbench_private_data_view_retarget(WORKBENCH_PrivateData *wpd)
+{
+  float light_direction[3];
+
+  workbench_private_data_view_init(wpd);
+  studiolight_update_world(wpd, wpd->studio_light, &wpd->world_data);
+  /* Also uploads the world UBO. */
+  workbench_private_data_get_light_direction(wpd, light_direction);
+}
+
 void workbench_private_data_free(WORKBENCH_PrivateData *wpd)
 {
   BLI_ghash_free(wpd->material_hash, NULL, MEM_freeN);
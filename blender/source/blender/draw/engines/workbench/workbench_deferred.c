@@ -1362,6 +1362,11 @@ void workbench_deferred_draw_finish(WORKBENCH_Data *vedata)
   WORKBENCH_StorageList *stl = vedata->stl;
   WORKBENCH_PrivateData *wpd = stl->g_data;
 
+  /* Drawn again for the other eye. */
+  if (DRW_state_is_stereo_redraw_pending()) {
+    return;
+  }
+
   /* XXX TODO(fclem) do not discard UBOS after drawing! Store them per viewport. */
   workbench_private_data_free(wpd);
   workbench_volume_smoke_textures_free(wpd);
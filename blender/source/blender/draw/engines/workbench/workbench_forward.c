@@ -809,6 +809,11 @@ void workbench_forward_draw_finish(WORKBENCH_Data *vedata)
   WORKBENCH_StorageList *stl = vedata->stl;
   WORKBENCH_PrivateData *wpd = stl->g_data;
 
+  /* Drawn again for the other eye. */
+  if (DRW_state_is_stereo_redraw_pending()) {
+    return;
+  }
+
   workbench_private_data_free(wpd);
   workbench_volume_smoke_textures_free(wpd);
 }
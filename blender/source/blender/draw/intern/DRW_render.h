@@ -167,6 +167,10 @@ typedef struct DrawEngineType {
                           struct RenderEngine *engine,
                           struct RenderLayer *layer,
                           const struct rcti *rect);
+
+  /* Update the data computed from the default view in cache_init,
+   * after the view was moved once the caches are populated (VR eyes). */
+  void (*view_retarget)(void *vedata);
 } DrawEngineType;
 
 #ifndef __DRW_ENGINE_H__
@@ -682,6 +686,7 @@ bool DRW_state_do_color_management(void);
 bool DRW_state_is_scene_render(void);
 bool DRW_state_is_opengl_render(void);
 bool DRW_state_is_playback(void);
+bool DRW_state_is_stereo_redraw_pending(void);
 bool DRW_state_show_text(void);
 bool DRW_state_draw_support(void);
 bool DRW_state_draw_background(void);
@@ -1577,9 +1577,190 @@ void DRW_draw_view(const bContext *C)
   DST.options.draw_background = (scene->r.alphamode == R_ADDSKY) ||
                                 (v3d->shading.type != OB_RENDER);
   DST.options.do_color_management = true;
+#if WITH_VR
+  RegionView3D *rv3d = ar->regiondata;
+  DST.options.is_stereo_single_pass = (rv3d->rflag & RV3D_IS_VR) && vr_get_obj()->single_pass;
+#endif
   DRW_draw_render_loop_ex(depsgraph, engine_type, ar, v3d, viewport, C);
 }
 
+/* Draw the populated caches from the current view,
+ * followed by everything that is drawn on top of the scene. */
+static void drw_draw_render_loop_view(Depsgraph *depsgraph,
+                                      ARegion *ar,
+                                      View3D *v3d,
+                                      const bool do_annotations)
+{
+#if WITH_VR
+  RegionView3D *rv3d = ar->regiondata;
+  const double timing_start = vr_timing_now();
+  if (rv3d->rflag & RV3D_IS_VR) {
+    /* Update VR matrices and pre-render. */
+    eStereoViews side = v3d->multiview_eye;
+    vr_update_view_matrix(side, rv3d->viewinv);
+    vr_update_projection_matrix(side, rv3d->winmat);
+    vr_pre_scene_render(side);
+  }
+#endif
+
+  GPU_framebuffer_bind(DST.default_framebuffer);
+
+  DRW_state_reset();
+
+  const bool background_drawn = drw_engines_draw_background();
+
+  GPU_framebuffer_bind(DST.default_framebuffer);
+
+  DRW_draw_callbacks_pre_scene();
+  if (DST.draw_ctx.evil_C) {
+    ED_region_draw_cb_draw(DST.draw_ctx.evil_C, DST.draw_ctx.ar, REGION_DRAW_PRE_VIEW);
+  }
+
+  drw_engines_draw_scene();
+
+  if (!background_drawn) {
+    drw_draw_background_alpha_under();
+  }
+
+  /* Fix 3D view being "laggy" on macos and win+nvidia. (See T56996, T61474) */
+  GPU_flush();
+
+  /* annotations - temporary drawing buffer (3d space) */
+  /* XXX: Or should we use a proper draw/overlay engine for this case? */
+  if (do_annotations) {
+    GPU_depth_test(false);
+    bool annotations_drawn = false;
+#if WITH_VR
+    if (rv3d->rflag & RV3D_IS_VR) {
+      /* VR annotation strokes are drawn from cached batches. */
+      Scene *scene_input = DEG_get_input_scene(depsgraph);
+      annotations_drawn = vr_draw_annotations(scene_input->gpd, scene_input->r.cfra);
+    }
+#endif
+    if (!annotations_drawn) {
+      /* XXX: as scene->gpd is not copied for COW yet */
+      ED_annotation_draw_view3d(DEG_get_input_scene(depsgraph), depsgraph, v3d, ar, true);
+    }
+    GPU_depth_test(true);
+  }
+
+#if WITH_VR
+  /* Render VR controllers and menus. */
+  if (rv3d->rflag & RV3D_IS_VR) {  
+    vr_post_scene_render(v3d->multiview_eye);
+  }
+#endif
+
+  DRW_draw_callbacks_post_scene();
+  DRW_state_reset();
+
+  if (DST.draw_ctx.evil_C) {
+    GPU_depth_test(false);
+    ED_region_draw_cb_draw(DST.draw_ctx.evil_C, DST.draw_ctx.ar, REGION_DRAW_POST_VIEW);
+    GPU_depth_test(true);
+    /* Callback can be nasty and do whatever they want with the state.
+     * Don't trust them! */
+    DRW_state_reset();
+  }
+
+  drw_debug_draw();
+
+  GPU_depth_test(false);
+  drw_engines_draw_text();
+  GPU_depth_test(true);
+
+  if (DST.draw_ctx.evil_C) {
+    /* needed so gizmo isn't obscured */
+    if ((v3d->gizmo_flag & V3D_GIZMO_HIDE) == 0) {
+      glDisable(GL_DEPTH_TEST);
+      DRW_draw_gizmo_3d();
+    }
+
+    DRW_draw_region_info();
+
+    /* annotations - temporary drawing buffer (screenspace) */
+    /* XXX: Or should we use a proper draw/overlay engine for this case? */
+    if (((v3d->flag2 & V3D_HIDE_OVERLAYS) == 0) && (do_annotations)) {
+      GPU_depth_test(false);
+      /* XXX: as scene->gpd is not copied for COW yet */
+      ED_annotation_draw_view3d(DEG_get_input_scene(depsgraph), depsgraph, v3d, ar, false);
+      GPU_depth_test(true);
+    }
+
+    if ((v3d->gizmo_flag & V3D_GIZMO_HIDE) == 0) {
+      /* Draw 2D after region info so we can draw on top of the camera passepartout overlay.
+       * 'DRW_draw_region_info' sets the projection in pixel-space. */
+      GPU_depth_test(false);
+      DRW_draw_gizmo_2d();
+      GPU_depth_test(true);
+    }
+  }
+
+#if WITH_VR
+  if (rv3d->rflag & RV3D_IS_VR) {
+    vr_timing_record(VR_TIMING_SCENE, v3d->multiview_eye, timing_start);
+  }
+#endif
+}
+
+#if WITH_VR
+static void drw_engines_view_retarget(void)
+{
+  for (LinkData *link = DST.enabled_engines.first; link; link = link->next) {
+    DrawEngineType *engine = link->data;
+    ViewportEngineData *data = drw_viewport_engine_data_ensure(engine);
+
+    if (engine->view_retarget) {
+      engine->view_retarget(data);
+    }
+  }
+}
+
+/* Recompute the region matrices for v3d->multiview_eye and move the default view there. */
+static void drw_view_default_from_region(Depsgraph *depsgraph, ARegion *ar, View3D *v3d)
+{
+  RegionView3D *rv3d = ar->regiondata;
+
+  ED_view3d_draw_setup_view(
+      NULL, depsgraph, DEG_get_input_scene(depsgraph), ar, v3d, NULL, NULL, NULL);
+
+  normalize_v3_v3(DST.screenvecs[0], rv3d->viewinv[0]);
+  normalize_v3_v3(DST.screenvecs[1], rv3d->viewinv[1]);
+  DST.pixsize = rv3d->pixsize;
+
+  drw_view_default_retarget(rv3d->viewmat, rv3d->winmat);
+  drw_engines_view_retarget();
+}
+
+/**
+ * Single-pass stereo for the VR region: the caches were populated once and the
+ * left eye was drawn into the viewport bound by the window manager (the one of
+ * the right eye). Keep that image in the left eye viewport, then move the views
+ * to the right eye so the same caches can be drawn again.
+ */
+static void drw_stereo_single_pass_next_eye(Depsgraph *depsgraph, ARegion *ar, View3D *v3d)
+{
+  GPUViewport *viewport_left = WM_draw_region_get_viewport(ar, STEREO_LEFT_ID);
+  DefaultFramebufferList *dfbl = GPU_viewport_framebuffer_list_get(viewport_left);
+
+  GPU_framebuffer_blit(
+      DST.default_framebuffer, 0, dfbl->default_fb, 0, GPU_COLOR_BIT | GPU_DEPTH_BIT);
+
+  v3d->multiview_eye = STEREO_RIGHT_ID;
+  drw_view_default_from_region(depsgraph, ar, v3d);
+}
+
+/* Late-latching: re-sample the eye positions right before drawing the VR region,
+ * so that the view matrices (view UBO) are based on the latest tracking data.
+ * Done once per frame, the other eye uses the latched positions as well. */
+static void drw_vr_late_latch(Depsgraph *depsgraph, ARegion *ar, View3D *v3d)
+{
+  if (vr_latch_tracking() == 0) {
+    drw_view_default_from_region(depsgraph, ar, v3d);
+  }
+}
+#endif
+
 /**
  * Used for both regular and off-screen drawing.
  * Need to reset DST before calling this function
@@ -1679,16 +1860,6 @@ void DRW_draw_render_loop_ex(struct Depsgraph *depsgraph,
 
   DRW_stats_begin();
 
-#if WITH_VR
-  if (rv3d->rflag & RV3D_IS_VR) {
-    /* Update VR matrices and pre-render. */
-    eStereoViews side = v3d->multiview_eye;
-    vr_update_view_matrix(side, rv3d->viewinv);
-    vr_update_projection_matrix(side, rv3d->winmat);
-    vr_pre_scene_render(side);
-  }
-#endif
-
   GPU_framebuffer_bind(DST.default_framebuffer);
 
   /* Start Drawing */
@@ -1696,84 +1867,18 @@ void DRW_draw_render_loop_ex(struct Depsgraph *depsgraph,
 
   DRW_hair_update();
 
-  const bool background_drawn = drw_engines_draw_background();
-
-  GPU_framebuffer_bind(DST.default_framebuffer);
-
-  DRW_draw_callbacks_pre_scene();
-  if (DST.draw_ctx.evil_C) {
-    ED_region_draw_cb_draw(DST.draw_ctx.evil_C, DST.draw_ctx.ar, REGION_DRAW_PRE_VIEW);
-  }
-
-  drw_engines_draw_scene();
-
-  if (!background_drawn) {
-    drw_draw_background_alpha_under();
-  }
-
-  /* Fix 3D view being "laggy" on macos and win+nvidia. (See T56996, T61474) */
-  GPU_flush();
-
-  /* annotations - temporary drawing buffer (3d space) */
-  /* XXX: Or should we use a proper draw/overlay engine for this case? */
-  if (do_annotations) {
-    GPU_depth_test(false);
-    /* XXX: as scene->gpd is not copied for COW yet */
-    ED_annotation_draw_view3d(DEG_get_input_scene(depsgraph), depsgraph, v3d, ar, true);
-    GPU_depth_test(true);
-  }
-
 #if WITH_VR
-  /* Render VR controllers and menus. */
-  if (rv3d->rflag & RV3D_IS_VR) {  
-    vr_post_scene_render(v3d->multiview_eye);
+  if (rv3d->rflag & RV3D_IS_VR) {
+    drw_vr_late_latch(depsgraph, ar, v3d);
   }
-#endif
-
-  DRW_draw_callbacks_post_scene();
-  DRW_state_reset();
-
-  if (DST.draw_ctx.evil_C) {
-    GPU_depth_test(false);
-    ED_region_draw_cb_draw(DST.draw_ctx.evil_C, DST.draw_ctx.ar, REGION_DRAW_POST_VIEW);
-    GPU_depth_test(true);
-    /* Callback can be nasty and do whatever they want with the state.
-     * Don't trust them! */
-    DRW_state_reset();
+  if (DST.options.is_stereo_single_pass) {
+    /* Left eye first, the caches are then drawn again for the right eye. */
+    drw_draw_render_loop_view(depsgraph, ar, v3d, do_annotations);
+    drw_stereo_single_pass_next_eye(depsgraph, ar, v3d);
   }
+#endif
 
-  drw_debug_draw();
-
-  GPU_depth_test(false);
-  drw_engines_draw_text();
-  GPU_depth_test(true);
-
-  if (DST.draw_ctx.evil_C) {
-    /* needed so gizmo isn't obscured */
-    if ((v3d->gizmo_flag & V3D_GIZMO_HIDE) == 0) {
-      glDisable(GL_DEPTH_TEST);
-      DRW_draw_gizmo_3d();
-    }
-
-    DRW_draw_region_info();
-
-    /* annotations - temporary drawing buffer (screenspace) */
-    /* XXX: Or should we use a proper draw/overlay engine for this case? */
-    if (((v3d->flag2 & V3D_HIDE_OVERLAYS) == 0) && (do_annotations)) {
-      GPU_depth_test(false);
-      /* XXX: as scene->gpd is not copied for COW yet */
-      ED_annotation_draw_view3d(DEG_get_input_scene(depsgraph), depsgraph, v3d, ar, false);
-      GPU_depth_test(true);
-    }
-
-    if ((v3d->gizmo_flag & V3D_GIZMO_HIDE) == 0) {
-      /* Draw 2D after region info so we can draw on top of the camera passepartout overlay.
-       * 'DRW_draw_region_info' sets the projection in pixel-space. */
-      GPU_depth_test(false);
-      DRW_draw_gizmo_2d();
-      GPU_depth_test(true);
-    }
-  }
+  drw_draw_render_loop_view(depsgraph, ar, v3d, do_annotations);
 
   DRW_stats_reset();
 
@@ -2815,6 +2920,15 @@ bool DRW_state_is_opengl_render(void)
   return DST.options.is_image_render && !DST.options.is_scene_render;
 }
 
+/**
+ * Whether the caches are drawn again for the other eye after this draw
+ * (VR single-pass stereo), so per draw data must be kept until then.
+ */
+bool DRW_state_is_stereo_redraw_pending(void)
+{
+  return DST.options.is_stereo_single_pass && DST.draw_ctx.v3d->multiview_eye != STEREO_RIGHT_ID;
+}
+
 bool DRW_state_is_playback(void)
 {
   if (DST.draw_ctx.evil_C != NULL) {
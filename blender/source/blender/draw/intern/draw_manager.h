@@ -484,6 +484,7 @@ typedef struct DRWManager {
     uint do_color_management : 1;
     uint draw_background : 1;
     uint draw_text : 1;
+    uint is_stereo_single_pass : 1;
   } options;
 
   /* Current rendering context */
@@ -559,6 +560,8 @@ void *drw_viewport_engine_data_ensure(void *engine_type);
 
 void drw_state_set(DRWState state);
 
+void drw_view_default_retarget(const float viewmat[4][4], const float winmat[4][4]);
+
 void drw_debug_draw(void);
 void drw_debug_init(void);
 
@@ -1635,18 +1635,12 @@ void DRW_view_update_sub(DRWView *view, const float viewmat[4][4], const float w
   draw_view_matrix_state_update(&view->storage, viewmat, winmat);
 }
 
-/* Update matrices of a view created with DRW_view_create. */
-void DRW_view_update(DRWView *view,
-                     const float viewmat[4][4],
-                     const float winmat[4][4],
-                     const float (*culling_viewmat)[4],
-                     const float (*culling_winmat)[4])
+static void draw_view_update(DRWView *view,
+                             const float viewmat[4][4],
+                             const float winmat[4][4],
+                             const float (*culling_viewmat)[4],
+                             const float (*culling_winmat)[4])
 {
-  /* DO NOT UPDATE THE DEFAULT VIEW.
-   * Create subviews instead, or a copy. */
-  BLI_assert(view != DST.view_default);
-  BLI_assert(view->parent == NULL);
-
   view->is_dirty = true;
 
   draw_view_matrix_state_update(&view->storage, viewmat, winmat);
@@ -1703,6 +1697,53 @@ void DRW_view_update(DRWView *view,
 #endif
 }
 
+/* Update matrices of a view created with DRW_view_create. */
+void DRW_view_update(DRWView *view,
+                     const float viewmat[4][4],
+                     const float winmat[4][4],
+                     const float (*culling_viewmat)[4],
+                     const float (*culling_winmat)[4])
+{
+  /* DO NOT UPDATE THE DEFAULT VIEW.
+   * Create subviews instead, or a copy. */
+  BLI_assert(view != DST.view_default);
+  BLI_assert(view->parent == NULL);
+
+  draw_view_update(view, viewmat, winmat, culling_viewmat, culling_winmat);
+}
+
+/**
+ * Move the default view to another camera once the caches are populated,
+ * to draw them again from a different eye (single-pass stereo).
+ * Sub-views that follow the default view (depth offset, jitter...) keep
+ * their offset to it, other sub-views (i.e. probe faces) are left untouched.
+ */
+void drw_view_default_retarget(const float viewmat[4][4], const float winmat[4][4])
+{
+  DRWView *view_default = DST.view_default;
+  BLI_assert(view_default != NULL);
+
+  BLI_memblock_iter iter;
+  BLI_memblock_iternew(DST.vmempool->views, &iter);
+  DRWView *view;
+  while ((view = BLI_memblock_iterstep(&iter))) {
+    if (view->parent != view_default ||
+        !equals_m4m4(view->storage.viewmat, view_default->storage.viewmat)) {
+      continue;
+    }
+    /* Offset of the sub-view projection, in clip space. */
+    float offset[4][4], sub_winmat[4][4];
+    mul_m4_m4m4(offset, view->storage.winmat, view_default->storage.wininv);
+    mul_m4_m4m4(sub_winmat, offset, winmat);
+    DRW_view_update_sub(view, viewmat, sub_winmat);
+  }
+
+  draw_view_update(view_default, viewmat, winmat, NULL, NULL);
+
+  DST.view_active = view_default;
+  DST.view_previous = NULL;
+}
+
 /* Return default view if it is a viewport render. */
 const DRWView *DRW_view_default_get(void)
 {
@@ -42,6 +42,7 @@ struct wmOperatorType;
 /* undo.c */
 void ED_undo_push(struct bContext *C, const char *str);
 void ED_undo_push_op(struct bContext *C, struct wmOperator *op);
+void ED_undo_push_select(struct bContext *C, const char *str);
 void ED_undo_grouped_push(struct bContext *C, const char *str);
 void ED_undo_grouped_push_op(struct bContext *C, struct wmOperator *op);
 void ED_undo_pop_op(struct bContext *C, struct wmOperator *op);
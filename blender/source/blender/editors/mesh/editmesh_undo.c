@@ -133,12 +133,112 @@ static struct {
 
 } um_arraystore = {{NULL}};
 
+/**
+ * Arrays to add as states, collected so they can be added together.
+ * Each store is only accessed by a single thread,
+ * so layers with different strides are added in parallel.
+ */
+typedef struct UMArrayStateAdd {
+  BArrayStore *bs;
+  /** Owned, freed once it's been added. */
+  void *data;
+  size_t data_len;
+  const BArrayState *state_reference;
+  BArrayState **r_state;
+} UMArrayStateAdd;
+
+typedef struct UMArrayStateAddList {
+  UMArrayStateAdd *items;
+  int items_len;
+  /** Unique stores used by `items`. */
+  BArrayStore **stores;
+  int stores_len;
+} UMArrayStateAddList;
+
+static void um_arraystore_state_add_init(UMArrayStateAddList *state_adds, const int items_len_max)
+{
+  state_adds->items = MEM_mallocN(sizeof(*state_adds->items) * items_len_max, __func__);
+  state_adds->items_len = 0;
+  state_adds->stores = MEM_mallocN(sizeof(*state_adds->stores) * items_len_max, __func__);
+  state_adds->stores_len = 0;
+}
+
+static void um_arraystore_state_add_push(UMArrayStateAddList *state_adds,
+                                         BArrayStore *bs,
+                                         void *data,
+                                         const size_t data_len,
+                                         const BArrayState *state_reference,
+                                         BArrayState **r_state)
+{
+  UMArrayStateAdd *item = &state_adds->items[state_adds->items_len++];
+  item->bs = bs;
+  item->data = data;
+  item->data_len = data_len;
+  item->state_reference = state_reference;
+  item->r_state = r_state;
+
+  for (int i = 0; i < state_adds->stores_len; i++) {
+    if (state_adds->stores[i] == bs) {
+      return;
+    }
+  }
+  state_adds->stores[state_adds->stores_len++] = bs;
+}
+
+/* Add all arrays which use a single store, in the order they were pushed. */
+static void um_arraystore_state_add_store(UMArrayStateAddList *state_adds, const int store_index)
+{
+  BArrayStore *bs = state_adds->stores[store_index];
+  for (int i = 0; i < state_adds->items_len; i++) {
+    UMArrayStateAdd *item = &state_adds->items[i];
+    if (item->bs == bs) {
+      *item->r_state = BLI_array_store_state_add(
+          bs, item->data, item->data_len, item->state_reference);
+      if (item->data) {
+        MEM_freeN(item->data);
+      }
+    }
+  }
+}
+
+#  ifdef USE_ARRAY_STORE_THREAD
+static void um_arraystore_state_add_store_cb(void *__restrict userdata,
+                                             const int store_index,
+                                             const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  um_arraystore_state_add_store(userdata, store_index);
+}
+#  endif
+
+static void um_arraystore_state_add_finish(UMArrayStateAddList *state_adds)
+{
+#  ifdef USE_ARRAY_STORE_THREAD
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (state_adds->stores_len > 1);
+  settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(
+      0, state_adds->stores_len, state_adds, um_arraystore_state_add_store_cb, &settings);
+#  else
+  for (int i = 0; i < state_adds->stores_len; i++) {
+    um_arraystore_state_add_store(state_adds, i);
+  }
+#  endif
+
+  MEM_freeN(state_adds->items);
+  MEM_freeN(state_adds->stores);
+}
+
+/**
+ * \param state_adds: When NULL, only free the arrays.
+ */
 static void um_arraystore_cd_compact(struct CustomData *cdata,
                                      const size_t data_len,
-                                     bool create,
+                                     UMArrayStateAddList *state_adds,
                                      const BArrayCustomData *bcd_reference,
                                      BArrayCustomData **r_bcd_first)
 {
+  const bool create = (state_adds != NULL);
   if (data_len == 0) {
     if (create) {
       *r_bcd_first = NULL;
@@ -206,18 +306,22 @@ static void um_arraystore_cd_compact(struct CustomData *cdata,
                                           i < bcd_reference_current->states_len) ?
                                              bcd_reference_current->states[i] :
                                              NULL;
-          bcd->states[i] = BLI_array_store_state_add(
-              bs, layer->data, (size_t)data_len * stride, state_reference);
+          /* Takes ownership of the data. */
+          um_arraystore_state_add_push(state_adds,
+                                       bs,
+                                       layer->data,
+                                       (size_t)data_len * stride,
+                                       state_reference,
+                                       &bcd->states[i]);
         }
         else {
           bcd->states[i] = NULL;
         }
       }
-
-      if (layer->data) {
+      else if (layer->data) {
         MEM_freeN(layer->data);
-        layer->data = NULL;
       }
+      layer->data = NULL;
     }
 
     if (create) {
@@ -285,14 +389,22 @@ static void um_arraystore_compact_ex(UndoMesh *um, const UndoMesh *um_ref, bool
 {
   Mesh *me = &um->me;
 
+  UMArrayStateAddList state_adds_buf, *state_adds = NULL;
+  if (create) {
+    state_adds = &state_adds_buf;
+    um_arraystore_state_add_init(state_adds,
+                                 me->vdata.totlayer + me->edata.totlayer + me->ldata.totlayer +
+                                     me->pdata.totlayer + (me->key ? me->key->totkey : 0) + 1);
+  }
+
   um_arraystore_cd_compact(
-      &me->vdata, me->totvert, create, um_ref ? um_ref->store.vdata : NULL, &um->store.vdata);
+      &me->vdata, me->totvert, state_adds, um_ref ? um_ref->store.vdata : NULL, &um->store.vdata);
   um_arraystore_cd_compact(
-      &me->edata, me->totedge, create, um_ref ? um_ref->store.edata : NULL, &um->store.edata);
+      &me->edata, me->totedge, state_adds, um_ref ? um_ref->store.edata : NULL, &um->store.edata);
   um_arraystore_cd_compact(
-      &me->ldata, me->totloop, create, um_ref ? um_ref->store.ldata : NULL, &um->store.ldata);
+      &me->ldata, me->totloop, state_adds, um_ref ? um_ref->store.ldata : NULL, &um->store.ldata);
   um_arraystore_cd_compact(
-      &me->pdata, me->totpoly, create, um_ref ? um_ref->store.pdata : NULL, &um->store.pdata);
+      &me->pdata, me->totpoly, state_adds, um_ref ? um_ref->store.pdata : NULL, &um->store.pdata);
 
   if (me->key && me->key->totkey) {
     const size_t stride = me->key->elemsize;
@@ -308,14 +420,17 @@ static void um_arraystore_compact_ex(UndoMesh *um, const UndoMesh *um_ref, bool
         BArrayState *state_reference = (um_ref && um_ref->me.key && (i < um_ref->me.key->totkey)) ?
                                            um_ref->store.keyblocks[i] :
                                            NULL;
-        um->store.keyblocks[i] = BLI_array_store_state_add(
-            bs, keyblock->data, (size_t)keyblock->totelem * stride, state_reference);
+        um_arraystore_state_add_push(state_adds,
+                                     bs,
+                                     keyblock->data,
+                                     (size_t)keyblock->totelem * stride,
+                                     state_reference,
+                                     &um->store.keyblocks[i]);
       }
-
-      if (keyblock->data) {
+      else if (keyblock->data) {
         MEM_freeN(keyblock->data);
-        keyblock->data = NULL;
       }
+      keyblock->data = NULL;
     }
   }
 
@@ -326,16 +441,23 @@ static void um_arraystore_compact_ex(UndoMesh *um, const UndoMesh *um_ref, bool
       const size_t stride = sizeof(*me->mselect);
       BArrayStore *bs = BLI_array_store_at_size_ensure(
           &um_arraystore.bs_stride, stride, ARRAY_CHUNK_SIZE);
-      um->store.mselect = BLI_array_store_state_add(
-          bs, me->mselect, (size_t)me->totselect * stride, state_reference);
+      um_arraystore_state_add_push(state_adds,
+                                   bs,
+                                   me->mselect,
+                                   (size_t)me->totselect * stride,
+                                   state_reference,
+                                   &um->store.mselect);
+    }
+    else {
+      MEM_freeN(me->mselect);
     }
 
     /* keep me->totselect for validation */
-    MEM_freeN(me->mselect);
     me->mselect = NULL;
   }
 
   if (create) {
+    um_arraystore_state_add_finish(state_adds);
     um_arraystore.users += 1;
   }
 
@@ -3933,6 +3933,8 @@ static void proj_paint_state_thread_init(ProjPaintState *ps, const bool reset_th
 
   for (a = 0; a < ps->thread_tot; a++) {
     ps->arena_mt[a] = BLI_memarena_new(MEM_SIZE_OPTIMAL(1 << 16), "project paint arena");
+    /* Bucket data is allocated by the task painting with it. */
+    BLI_memarena_use_numa_local(ps->arena_mt[a]);
   }
 }
 
@@ -67,6 +67,8 @@
 #include "UI_interface.h"
 #include "UI_resources.h"
 
+#include "undo_intern.h"
+
 /** We only need this locally. */
 static CLG_LogRef LOG = {"ed.undo"};
 
@@ -76,7 +78,7 @@ static CLG_LogRef LOG = {"ed.undo"};
  * Non-operator undo editor functions.
  * \{ */
 
-void ED_undo_push(bContext *C, const char *str)
+static void ed_undo_push_ex(bContext *C, const char *str, const UndoType *ut)
 {
   CLOG_INFO(&LOG, 1, "name='%s'", str);
 
@@ -93,7 +95,12 @@ void ED_undo_push(bContext *C, const char *str)
     BKE_undosys_stack_limit_steps_and_memory(wm->undo_stack, steps - 1, 0);
   }
 
-  BKE_undosys_step_push(wm->undo_stack, C, str);
+  if (ut != NULL) {
+    BKE_undosys_step_push_with_type(wm->undo_stack, C, str, ut);
+  }
+  else {
+    BKE_undosys_step_push(wm->undo_stack, C, str);
+  }
 
   if (U.undomemory != 0) {
     const size_t memory_limit = (size_t)U.undomemory * 1024 * 1024;
@@ -107,6 +114,28 @@ void ED_undo_push(bContext *C, const char *str)
   WM_file_tag_modified();
 }
 
+void ED_undo_push(bContext *C, const char *str)
+{
+  ed_undo_push_ex(C, str, NULL);
+}
+
+/**
+ * Push an undo step that only stores the selection (object bases or mesh edit-mode elements),
+ * which is much cheaper than a memfile or edit-mesh step and can be pushed at interactive rates.
+ *
+ * Falls back to #ED_undo_push when the selection can't be stored on its own
+ * (other modes, or no full undo step to apply it on top of).
+ */
+void ED_undo_push_select(bContext *C, const char *str)
+{
+  if (ED_select_undosys_is_compatible(C)) {
+    ed_undo_push_ex(C, str, BKE_UNDOSYS_TYPE_SELECT);
+  }
+  else {
+    ed_undo_push_ex(C, str, NULL);
+  }
+}
+
 /**
  * \note Also check #undo_history_exec in bottom if you change notifiers.
  */
@@ -0,0 +1,406 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup edundo
+ *
+ * Selection-only undo steps.
+ *
+ * Stores the selection state as bitmaps (object bases in object mode,
+ * BMesh elements in mesh edit-mode) on top of the previous full undo step
+ * (the "base" step: a memfile or edit-mesh step), which is loaded before
+ * the selection is applied. This avoids writing a memfile or copying the
+ * mesh for every selection change, see #ED_undo_push_select.
+ */
+
+#include <string.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "CLG_log.h"
+
+#include "DNA_layer_types.h"
+#include "DNA_mesh_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+#include "BLI_utildefines.h"
+#include "BLI_bitmap.h"
+#include "BLI_listbase.h"
+#include "BLI_string.h"
+
+#include "BKE_context.h"
+#include "BKE_editmesh.h"
+#include "BKE_layer.h"
+#include "BKE_main.h"
+#include "BKE_undo_system.h"
+
+#include "DEG_depsgraph.h"
+
+#include "ED_mesh.h"
+#include "ED_outliner.h"
+#include "ED_undo.h"
+
+#include "WM_api.h"
+#include "WM_types.h"
+
+#include "bmesh.h"
+
+#include "undo_intern.h"
+
+/** We only need this locally. */
+static CLG_LogRef LOG = {"ed.undo.select"};
+
+/* -------------------------------------------------------------------- */
+/** \name Implements ED Undo System
+ * \{ */
+
+typedef struct SelectUndoHistory {
+  uint index;
+  char htype;
+} SelectUndoHistory;
+
+/** Selection of one mesh in edit-mode. */
+typedef struct SelectUndoStep_Elem {
+  UndoRefID_Object obedit_ref;
+  uint verts_len, edges_len, faces_len;
+  BLI_bitmap *verts, *edges, *faces;
+  /** Index of the active face (-1 when unset). */
+  int act_face;
+  SelectUndoHistory *history;
+  uint history_len;
+  short selectmode;
+} SelectUndoStep_Elem;
+
+typedef struct SelectUndoStep {
+  UndoStep step;
+
+  /* Object mode (when 'elems_len' is zero). */
+  UndoRefID_Scene scene_ref;
+  char view_layer_name[64];
+  BLI_bitmap *bases;
+  uint bases_len;
+  /** Index of the active base (-1 when unset). */
+  int base_active;
+
+  /* Edit-mode. */
+  SelectUndoStep_Elem *elems;
+  uint elems_len;
+} SelectUndoStep;
+
+/**
+ * The step holding the full state selection steps are applied on top of.
+ * Steps other than selection steps are their own base.
+ */
+static UndoStep *select_undosys_step_base(UndoStep *us)
+{
+  while (us && (us->type == BKE_UNDOSYS_TYPE_SELECT)) {
+    us = us->prev;
+  }
+  return us;
+}
+
+static void select_undosys_encode_editmesh(SelectUndoStep_Elem *elem, BMEditMesh *em)
+{
+  BMesh *bm = em->bm;
+  BMIter iter;
+  BMVert *v;
+  BMEdge *e;
+  BMFace *f;
+  int i;
+
+  BM_mesh_elem_index_ensure(bm, BM_VERT | BM_EDGE | BM_FACE);
+
+  elem->verts_len = (uint)bm->totvert;
+  elem->edges_len = (uint)bm->totedge;
+  elem->faces_len = (uint)bm->totface;
+  elem->verts = BLI_BITMAP_NEW(elem->verts_len, __func__);
+  elem->edges = BLI_BITMAP_NEW(elem->edges_len, __func__);
+  elem->faces = BLI_BITMAP_NEW(elem->faces_len, __func__);
+
+  BM_ITER_MESH_INDEX (v, &iter, bm, BM_VERTS_OF_MESH, i) {
+    if (BM_elem_flag_test(v, BM_ELEM_SELECT)) {
+      BLI_BITMAP_ENABLE(elem->verts, i);
+    }
+  }
+  BM_ITER_MESH_INDEX (e, &iter, bm, BM_EDGES_OF_MESH, i) {
+    if (BM_elem_flag_test(e, BM_ELEM_SELECT)) {
+      BLI_BITMAP_ENABLE(elem->edges, i);
+    }
+  }
+  BM_ITER_MESH_INDEX (f, &iter, bm, BM_FACES_OF_MESH, i) {
+    if (BM_elem_flag_test(f, BM_ELEM_SELECT)) {
+      BLI_BITMAP_ENABLE(elem->faces, i);
+    }
+  }
+
+  elem->act_face = bm->act_face ? BM_elem_index_get(bm->act_face) : -1;
+
+  elem->history_len = (uint)BLI_listbase_count(&bm->selected);
+  if (elem->history_len) {
+    elem->history = MEM_mallocN(sizeof(*elem->history) * elem->history_len, __func__);
+    SelectUndoHistory *hist = elem->history;
+    for (BMEditSelection *ese = bm->selected.first; ese; ese = ese->next, hist++) {
+      hist->index = (uint)BM_elem_index_get(ese->ele);
+      hist->htype = ese->htype;
+    }
+  }
+
+  elem->selectmode = em->selectmode;
+}
+
+static bool select_undosys_decode_editmesh(SelectUndoStep_Elem *elem, BMEditMesh *em)
+{
+  BMesh *bm = em->bm;
+  BMIter iter;
+  BMVert *v;
+  BMEdge *e;
+  BMFace *f;
+  int i;
+
+  if ((elem->verts_len != (uint)bm->totvert) || (elem->edges_len != (uint)bm->totedge) ||
+      (elem->faces_len != (uint)bm->totface)) {
+    return false;
+  }
+
+  BM_mesh_elem_table_ensure(bm, BM_VERT | BM_EDGE | BM_FACE);
+
+  BM_ITER_MESH_INDEX (v, &iter, bm, BM_VERTS_OF_MESH, i) {
+    BM_elem_flag_set(v, BM_ELEM_SELECT, BLI_BITMAP_TEST_BOOL(elem->verts, i));
+  }
+  BM_ITER_MESH_INDEX (e, &iter, bm, BM_EDGES_OF_MESH, i) {
+    BM_elem_flag_set(e, BM_ELEM_SELECT, BLI_BITMAP_TEST_BOOL(elem->edges, i));
+  }
+  BM_ITER_MESH_INDEX (f, &iter, bm, BM_FACES_OF_MESH, i) {
+    BM_elem_flag_set(f, BM_ELEM_SELECT, BLI_BITMAP_TEST_BOOL(elem->faces, i));
+  }
+
+  bm->act_face = (elem->act_face != -1) ? BM_face_at_index(bm, elem->act_face) : NULL;
+
+  BM_select_history_clear(bm);
+  for (uint j = 0; j < elem->history_len; j++) {
+    const SelectUndoHistory *hist = &elem->history[j];
+    BMElem *ele;
+    switch (hist->htype) {
+      case BM_VERT:
+        ele = (BMElem *)BM_vert_at_index(bm, (int)hist->index);
+        break;
+      case BM_EDGE:
+        ele = (BMElem *)BM_edge_at_index(bm, (int)hist->index);
+        break;
+      default:
+        ele = (BMElem *)BM_face_at_index(bm, (int)hist->index);
+        break;
+    }
+    BM_select_history_store_notest(bm, ele);
+  }
+
+  em->selectmode = elem->selectmode;
+  bm->selectmode = elem->selectmode;
+
+  /* Updates the selection totals, the stored state is already flushed. */
+  EDBM_selectmode_flush(em);
+
+  return true;
+}
+
+static bool select_undosys_step_encode(struct bContext *C, struct Main *bmain, UndoStep *us_p)
+{
+  SelectUndoStep *us = (SelectUndoStep *)us_p;
+  ViewLayer *view_layer = CTX_data_view_layer(C);
+
+  if (CTX_data_edit_object(C)) {
+    uint objects_len = 0;
+    Object **objects = BKE_view_layer_array_from_objects_in_edit_mode_unique_data(
+        view_layer, NULL, &objects_len);
+
+    us->elems = MEM_callocN(sizeof(*us->elems) * objects_len, __func__);
+    us->elems_len = objects_len;
+
+    for (uint i = 0; i < objects_len; i++) {
+      Object *ob = objects[i];
+      SelectUndoStep_Elem *elem = &us->elems[i];
+      Mesh *me = ob->data;
+
+      elem->obedit_ref.ptr = ob;
+      select_undosys_encode_editmesh(elem, me->edit_mesh);
+
+      us->step.data_size += BLI_BITMAP_SIZE(elem->verts_len) + BLI_BITMAP_SIZE(elem->edges_len) +
+                            BLI_BITMAP_SIZE(elem->faces_len) +
+                            sizeof(*elem->history) * elem->history_len;
+    }
+    MEM_freeN(objects);
+
+    /* The edit-mesh selection isn't written into the mesh yet. */
+    bmain->is_memfile_undo_flush_needed = true;
+
+    return (objects_len != 0);
+  }
+
+  us->scene_ref.ptr = CTX_data_scene(C);
+  STRNCPY(us->view_layer_name, view_layer->name);
+
+  us->bases_len = (uint)BLI_listbase_count(&view_layer->object_bases);
+  us->bases = BLI_BITMAP_NEW(us->bases_len, __func__);
+  us->base_active = -1;
+
+  uint i = 0;
+  for (Base *base = view_layer->object_bases.first; base; base = base->next, i++) {
+    if (base->flag & BASE_SELECTED) {
+      BLI_BITMAP_ENABLE(us->bases, i);
+    }
+    if (base == view_layer->basact) {
+      us->base_active = (int)i;
+    }
+  }
+  us->step.data_size = BLI_BITMAP_SIZE(us->bases_len);
+
+  return true;
+}
+
+static void select_undosys_step_decode(
+    struct bContext *C, struct Main *UNUSED(bmain), UndoStep *us_p, int dir, bool UNUSED(is_final))
+{
+  SelectUndoStep *us = (SelectUndoStep *)us_p;
+
+  /* The memfile state (object mode) is loaded by the undo system before decoding,
+   * edit-mode base steps need to be loaded here unless they're already current
+   * (when stepping between selection steps of the same base). */
+  UndoStack *ustack = ED_undo_stack_get();
+  UndoStep *us_base = select_undosys_step_base(us_p);
+  if ((us_base != NULL) && (us_base->type != BKE_UNDOSYS_TYPE_MEMFILE) &&
+      (select_undosys_step_base(ustack->step_active) != us_base)) {
+    BKE_undosys_step_decode_base(ustack, C, us_base, dir);
+  }
+
+  if (us->elems_len != 0) {
+    for (uint i = 0; i < us->elems_len; i++) {
+      SelectUndoStep_Elem *elem = &us->elems[i];
+      Object *obedit = elem->obedit_ref.ptr;
+      Mesh *me = obedit->data;
+      if ((me->edit_mesh == NULL) || !select_undosys_decode_editmesh(elem, me->edit_mesh)) {
+        CLOG_ERROR(&LOG,
+                   "name='%s', edit-mesh of object '%s' doesn't match, undo state invalid",
+                   us_p->name,
+                   obedit->id.name);
+        continue;
+      }
+      DEG_id_tag_update(&me->id, ID_RECALC_SELECT);
+      WM_event_add_notifier(C, NC_GEOM | ND_SELECT, me);
+    }
+
+    Scene *scene = CTX_data_scene(C);
+    scene->toolsettings->selectmode = us->elems[0].selectmode;
+    return;
+  }
+
+  Scene *scene = us->scene_ref.ptr;
+  ViewLayer *view_layer = BLI_findstring(
+      &scene->view_layers, us->view_layer_name, offsetof(ViewLayer, name));
+  if ((view_layer == NULL) ||
+      ((uint)BLI_listbase_count(&view_layer->object_bases) != us->bases_len)) {
+    CLOG_ERROR(&LOG, "name='%s', object bases don't match, undo state invalid", us_p->name);
+    return;
+  }
+
+  uint i = 0;
+  for (Base *base = view_layer->object_bases.first; base; base = base->next, i++) {
+    SET_FLAG_FROM_TEST(base->flag, BLI_BITMAP_TEST_BOOL(us->bases, i), BASE_SELECTED);
+  }
+  view_layer->basact = (us->base_active != -1) ?
+                           BLI_findlink(&view_layer->object_bases, us->base_active) :
+                           NULL;
+
+  DEG_id_tag_update(&scene->id, ID_RECALC_SELECT);
+  WM_event_add_notifier(C, NC_SCENE | ND_OB_SELECT, scene);
+  ED_outliner_select_sync_from_object_tag(C);
+}
+
+static void select_undosys_step_free(UndoStep *us_p)
+{
+  SelectUndoStep *us = (SelectUndoStep *)us_p;
+
+  for (uint i = 0; i < us->elems_len; i++) {
+    SelectUndoStep_Elem *elem = &us->elems[i];
+    MEM_freeN(elem->verts);
+    MEM_freeN(elem->edges);
+    MEM_freeN(elem->faces);
+    MEM_SAFE_FREE(elem->history);
+  }
+  MEM_SAFE_FREE(us->elems);
+  MEM_SAFE_FREE(us->bases);
+}
+
+static void select_undosys_foreach_ID_ref(UndoStep *us_p,
+                                          UndoTypeForEachIDRefFn foreach_ID_ref_fn,
+                                          void *user_data)
+{
+  SelectUndoStep *us = (SelectUndoStep *)us_p;
+
+  if (us->elems_len == 0) {
+    foreach_ID_ref_fn(user_data, ((UndoRefID *)&us->scene_ref));
+  }
+  for (uint i = 0; i < us->elems_len; i++) {
+    SelectUndoStep_Elem *elem = &us->elems[i];
+    foreach_ID_ref_fn(user_data, ((UndoRefID *)&elem->obedit_ref));
+  }
+}
+
+/* Export for ED_undo_sys. */
+void ED_select_undosys_type(UndoType *ut)
+{
+  ut->name = "Select";
+  /* Never used from context, see #ED_undo_push_select. */
+  ut->poll = NULL;
+  ut->step_encode = select_undosys_step_encode;
+  ut->step_decode = select_undosys_step_decode;
+  ut->step_free = select_undosys_step_free;
+
+  ut->step_foreach_ID_ref = select_undosys_foreach_ID_ref;
+
+  ut->use_context = true;
+
+  ut->step_size = sizeof(SelectUndoStep);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Utilities
+ * \{ */
+
+/**
+ * Whether a selection step can be pushed in the current context,
+ * otherwise a full undo step is needed (which selection steps can then use as base).
+ */
+bool ED_select_undosys_is_compatible(bContext *C)
+{
+  UndoStack *ustack = ED_undo_stack_get();
+  UndoStep *us_base = select_undosys_step_base(ustack->step_active);
+
+  /* The base must hold the state of the current mode. */
+  if ((us_base == NULL) || (us_base->type->poll == NULL) || !us_base->type->poll(C)) {
+    return false;
+  }
+
+  Object *obedit = CTX_data_edit_object(C);
+  if (obedit) {
+    return (obedit->type == OB_MESH);
+  }
+  return (us_base->type == BKE_UNDOSYS_TYPE_MEMFILE);
+}
+
+/** \} */
@@ -24,8 +24,13 @@
 /* internal exports only */
 
 struct UndoType;
+struct bContext;
 
 /* memfile_undo.c */
 void ED_memfile_undosys_type(struct UndoType *ut);
 
+/* select_undo.c */
+void ED_select_undosys_type(struct UndoType *ut);
+bool ED_select_undosys_is_compatible(struct bContext *C);
+
 #endif /* __UNDO_INTERN_H__ */
@@ -59,6 +59,9 @@ void ED_undosys_type_init(void)
   /* Text editor */
   BKE_UNDOSYS_TYPE_TEXT = BKE_undosys_type_append(ED_text_undosys_type);
 
+  /* Selection only (never used from context). */
+  BKE_UNDOSYS_TYPE_SELECT = BKE_undosys_type_append(ED_select_undosys_type);
+
   /* Keep global undo last (as a fallback). */
   BKE_UNDOSYS_TYPE_MEMFILE = BKE_undosys_type_append(ED_memfile_undosys_type);
 }
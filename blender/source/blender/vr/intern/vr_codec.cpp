@@ -0,0 +1,472 @@
+/*
+* ***** BEGIN GPL LICENSE BLOCK *****
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software Foundation,
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+* The Original Code is Copyright (C) 2019 by Blender Foundation.
+* All rights reserved.
+*
+* Contributor(s): MARUI-PlugIn, Multiplexed Reality
+*
+* ***** END GPL LICENSE BLOCK *****
+*/
+
+/** \file blender/vr/intern/vr_codec.cpp
+*   \ingroup vr
+*
+* Tile-based delta codec for remote image streaming.
+*/
+
+#include "vr_types.h"
+
+#include "vr_codec.h"
+
+#include <stdlib.h>
+
+/* Largest supported tile edge length (limits the per-tile stack buffers). */
+#define VR_CODEC_TILE_SIZE_MAX 64
+#define VR_CODEC_TILE_PIXELS_MAX (VR_CODEC_TILE_SIZE_MAX * VR_CODEC_TILE_SIZE_MAX)
+/* Worst case size of a coded tile payload (literal-only coding: one op byte per 128 pixels). */
+#define VR_CODEC_PAYLOAD_BOUND(num_pixels) ((num_pixels) * VR_CODEC_DEPTH + (num_pixels) / 128 + 2)
+
+/***************************************************************************************************
+ * \class										VR_Codec
+ ***************************************************************************************************
+ * Tile-based delta codec for remote image streaming.
+ **************************************************************************************************/
+
+/* Per-byte (modulo 256) difference of two packed RGBA pixels. */
+static inline uint pixel_sub(uint a, uint b)
+{
+	return ((a | 0x80808080u) - (b & 0x7F7F7F7Fu)) ^ ((a ^ ~b) & 0x80808080u);
+}
+
+/* Per-byte (modulo 256) sum of two packed RGBA pixels. */
+static inline uint pixel_add(uint a, uint b)
+{
+	return ((a & 0x7F7F7F7Fu) + (b & 0x7F7F7F7Fu)) ^ ((a ^ b) & 0x80808080u);
+}
+
+/* Run-length code n packed pixels. Returns the number of bytes written. */
+static uint rle_encode(const uint *px, uint n, uchar *out)
+{
+	uchar *o = out;
+	uint i = 0;
+	while (i < n) {
+		/* Run of identical pixels. */
+		uint run = 1;
+		while (i + run < n && run < 128 && px[i + run] == px[i]) {
+			++run;
+		}
+		if (run >= 2) {
+			*o++ = (uchar)(0x80 | (run - 1));
+			memcpy(o, &px[i], 4);
+			o += 4;
+			i += run;
+			continue;
+		}
+		/* Literal span up to the start of the next run. */
+		const uint start = i++;
+		uint count = 1;
+		while (i < n && count < 128) {
+			if (i + 1 < n && px[i + 1] == px[i]) {
+				break;
+			}
+			++i;
+			++count;
+		}
+		*o++ = (uchar)(count - 1);
+		memcpy(o, &px[start], count * 4);
+		o += count * 4;
+	}
+	return (uint)(o - out);
+}
+
+/* Decode a run-length coded tile payload into n packed pixels.
+ * Returns false if the payload is malformed. */
+static bool rle_decode(const uchar *in, uint in_size, uint *px, uint n)
+{
+	const uchar *end = in + in_size;
+	uint i = 0;
+	while (i < n) {
+		if (in >= end) {
+			return false;
+		}
+		const uchar c = *in++;
+		const uint count = (uint)(c & 0x7F) + 1;
+		if (i + count > n) {
+			return false;
+		}
+		if (c & 0x80) {
+			if (in + 4 > end) {
+				return false;
+			}
+			uint p;
+			memcpy(&p, in, 4);
+			in += 4;
+			for (uint j = 0; j < count; ++j) {
+				px[i++] = p;
+			}
+		}
+		else {
+			if (in + count * 4 > end) {
+				return false;
+			}
+			memcpy(&px[i], in, count * 4);
+			in += count * 4;
+			i += count;
+		}
+	}
+	return (in == end);
+}
+
+/* Spatial prediction residuals of a tile (tw * th pixels):
+ * difference to the left neighbor, or to the upper neighbor for the first column. */
+static void spatial_residual(const uint *px, uint *r, uint tw, uint th)
+{
+	for (uint y = 0; y < th; ++y) {
+		const uint *row = px + y * tw;
+		uint *r_row = r + y * tw;
+		r_row[0] = (y == 0) ? row[0] : pixel_sub(row[0], row[-(int)tw]);
+		for (uint x = 1; x < tw; ++x) {
+			r_row[x] = pixel_sub(row[x], row[x - 1]);
+		}
+	}
+}
+
+/* Inverse of spatial_residual() (in-place). */
+static void spatial_reconstruct(uint *px, uint tw, uint th)
+{
+	for (uint y = 0; y < th; ++y) {
+		uint *row = px + y * tw;
+		if (y > 0) {
+			row[0] = pixel_add(row[-(int)tw], row[0]);
+		}
+		for (uint x = 1; x < tw; ++x) {
+			row[x] = pixel_add(row[x - 1], row[x]);
+		}
+	}
+}
+
+/* Encode one tile and update the reference image.
+ * Returns the payload size in bytes, or 0 if the tile is unchanged. */
+static uint encode_tile(const uchar *pixels, uchar *reference, uint w,
+						uint x0, uint y0, uint tw, uint th,
+						uint mask, bool keyframe, uchar *out, uchar *r_mode)
+{
+	uint px[VR_CODEC_TILE_PIXELS_MAX];
+	uint residual[VR_CODEC_TILE_PIXELS_MAX];
+	uchar temporal_out[VR_CODEC_PAYLOAD_BOUND(VR_CODEC_TILE_PIXELS_MAX)];
+	const uint n = tw * th;
+
+	/* Quantize and compare to the reference. */
+	bool changed = keyframe;
+	for (uint y = 0; y < th; ++y) {
+		const size_t row = ((size_t)(y0 + y) * w + x0) * VR_CODEC_DEPTH;
+		const uchar *src = pixels + row;
+		const uchar *ref = reference + row;
+		uint *p = px + y * tw;
+		for (uint x = 0; x < tw; ++x, src += VR_CODEC_DEPTH, ref += VR_CODEC_DEPTH) {
+			memcpy(&p[x], src, 4);
+			p[x] &= mask;
+			if (!changed) {
+				uint q;
+				memcpy(&q, ref, 4);
+				changed = (p[x] != q);
+			}
+		}
+	}
+	if (!changed) {
+		return 0;
+	}
+
+	spatial_residual(px, residual, tw, th);
+	uint size = rle_encode(residual, n, out);
+	*r_mode = VR_Codec::TILEMODE_SPATIAL;
+
+	if (!keyframe) {
+		for (uint y = 0; y < th; ++y) {
+			const uchar *ref = reference + ((size_t)(y0 + y) * w + x0) * VR_CODEC_DEPTH;
+			const uint *p = px + y * tw;
+			uint *r = residual + y * tw;
+			for (uint x = 0; x < tw; ++x, ref += VR_CODEC_DEPTH) {
+				uint q;
+				memcpy(&q, ref, 4);
+				r[x] = pixel_sub(p[x], q);
+			}
+		}
+		const uint size_temporal = rle_encode(residual, n, temporal_out);
+		if (size_temporal < size) {
+			memcpy(out, temporal_out, size_temporal);
+			size = size_temporal;
+			*r_mode = VR_Codec::TILEMODE_TEMPORAL;
+		}
+	}
+
+	/* The client now holds the quantized tile. */
+	for (uint y = 0; y < th; ++y) {
+		memcpy(reference + ((size_t)(y0 + y) * w + x0) * VR_CODEC_DEPTH, px + y * tw, tw * VR_CODEC_DEPTH);
+	}
+
+	return size;
+}
+
+VR_Codec::VR_Codec()
+	: quant_bits(0)
+	, w(0)
+	, h(0)
+	, tile_size(0)
+	, tiles_x(0)
+	, tiles_y(0)
+	, tile_bound(0)
+	, reference(0)
+	, scratch(0)
+	, tile_sizes(0)
+	, tile_modes(0)
+	, frame_id(0)
+	, keyframe_pending(true)
+{
+	memset(&last_stats, 0, sizeof(last_stats));
+}
+
+VR_Codec::~VR_Codec()
+{
+	release();
+}
+
+uint VR_Codec::tile_payload_bound(uint num_pixels)
+{
+	return VR_CODEC_PAYLOAD_BOUND(num_pixels);
+}
+
+uint VR_Codec::max_encoded_size(uint w, uint h, uint tile_size)
+{
+	if (tile_size == 0) {
+		return 0;
+	}
+	const uint num_tiles = ((w + tile_size - 1) / tile_size) * ((h + tile_size - 1) / tile_size);
+	return (uint)sizeof(FrameHeader) +
+		   num_tiles * ((uint)sizeof(TileHeader) + tile_payload_bound(tile_size * tile_size));
+}
+
+uint VR_Codec::max_encoded_size() const
+{
+	return max_encoded_size(w, h, tile_size);
+}
+
+bool VR_Codec::init(uint w, uint h, uint tile_size)
+{
+	release();
+
+	if (w == 0 || h == 0 || w > 0xFFFF || h > 0xFFFF ||
+		tile_size == 0 || tile_size > VR_CODEC_TILE_SIZE_MAX) {
+		return false;
+	}
+
+	this->w = w;
+	this->h = h;
+	this->tile_size = tile_size;
+	this->tiles_x = (w + tile_size - 1) / tile_size;
+	this->tiles_y = (h + tile_size - 1) / tile_size;
+	this->tile_bound = tile_payload_bound(tile_size * tile_size);
+
+	const uint num_tiles = tiles_x * tiles_y;
+	if (num_tiles > 0xFFFF) {
+		release();
+		return false;
+	}
+	reference = (uchar*)calloc((size_t)w * h, VR_CODEC_DEPTH);
+	scratch = (uchar*)malloc((size_t)num_tiles * tile_bound);
+	tile_sizes = (uint*)calloc(num_tiles, sizeof(uint));
+	tile_modes = (uchar*)calloc(num_tiles, sizeof(uchar));
+	if (!reference || !scratch || !tile_sizes || !tile_modes) {
+		release();
+		return false;
+	}
+
+	reset();
+	return true;
+}
+
+void VR_Codec::release()
+{
+	if (reference) {
+		free(reference);
+		reference = 0;
+	}
+	if (scratch) {
+		free(scratch);
+		scratch = 0;
+	}
+	if (tile_sizes) {
+		free(tile_sizes);
+		tile_sizes = 0;
+	}
+	if (tile_modes) {
+		free(tile_modes);
+		tile_modes = 0;
+	}
+	w = h = tile_size = 0;
+	tiles_x = tiles_y = tile_bound = 0;
+}
+
+void VR_Codec::reset()
+{
+	keyframe_pending = true;
+}
+
+const VR_Codec::Stats& VR_Codec::stats() const
+{
+	return last_stats;
+}
+
+uint VR_Codec::encode(const uchar *pixels, uchar *out, uint out_size)
+{
+	if (!reference || !pixels || !out || out_size < max_encoded_size()) {
+		return 0;
+	}
+
+	const bool keyframe = keyframe_pending;
+
+	/* Lossy coding drops the low color bits (alpha is kept exact). */
+	const uchar m = (uchar)(0xFF << (quant_bits > 7 ? 7 : quant_bits));
+	const uchar mask_bytes[VR_CODEC_DEPTH] = { m, m, m, 0xFF };
+	uint mask;
+	memcpy(&mask, mask_bytes, 4);
+
+	const int num_tiles = (int)(tiles_x * tiles_y);
+#pragma omp parallel for schedule(dynamic)
+	for (int t = 0; t < num_tiles; ++t) {
+		const uint tx = (uint)t % tiles_x;
+		const uint ty = (uint)t / tiles_x;
+		const uint x0 = tx * tile_size;
+		const uint y0 = ty * tile_size;
+		const uint tw = (x0 + tile_size > w) ? (w - x0) : tile_size;
+		const uint th = (y0 + tile_size > h) ? (h - y0) : tile_size;
+		tile_sizes[t] = encode_tile(pixels, reference, w, x0, y0, tw, th, mask, keyframe,
+									scratch + (size_t)t * tile_bound, &tile_modes[t]);
+	}
+
+	/* Assemble the frame from the changed tiles. */
+	uchar *o = out + sizeof(FrameHeader);
+	uint num_coded = 0;
+	for (int t = 0; t < num_tiles; ++t) {
+		const uint size = tile_sizes[t];
+		if (size == 0) {
+			continue;
+		}
+		TileHeader tile_header;
+		tile_header.index = (ushort)t;
+		tile_header.mode = tile_modes[t];
+		tile_header.reserved = 0;
+		tile_header.size = size;
+		memcpy(o, &tile_header, sizeof(TileHeader));
+		o += sizeof(TileHeader);
+		memcpy(o, scratch + (size_t)t * tile_bound, size);
+		o += size;
+		++num_coded;
+	}
+
+	FrameHeader header;
+	header.magic = VR_CODEC_MAGIC;
+	header.frame_id = frame_id;
+	header.w = (ushort)w;
+	header.h = (ushort)h;
+	header.tile_size = (uchar)tile_size;
+	header.flags = keyframe ? FLAG_KEYFRAME : FLAG_NONE;
+	header.quant_bits = (uchar)(quant_bits > 7 ? 7 : quant_bits);
+	header.reserved = 0;
+	header.num_tiles = num_coded;
+	memcpy(out, &header, sizeof(FrameHeader));
+
+	const uint encoded_size = (uint)(o - out);
+
+	last_stats.frame_id = frame_id;
+	last_stats.tiles_total = (uint)num_tiles;
+	last_stats.tiles_coded = num_coded;
+	last_stats.encoded_size = encoded_size;
+	last_stats.keyframe = keyframe;
+
+	keyframe_pending = false;
+	++frame_id;
+
+	return encoded_size;
+}
+
+bool VR_Codec::decode(const uchar *in, uint in_size, uchar *pixels, uint w, uint h)
+{
+	if (!in || !pixels || in_size < sizeof(FrameHeader)) {
+		return false;
+	}
+
+	FrameHeader header;
+	memcpy(&header, in, sizeof(FrameHeader));
+	if (header.magic != VR_CODEC_MAGIC || header.w != w || header.h != h ||
+		header.tile_size == 0 || header.tile_size > VR_CODEC_TILE_SIZE_MAX) {
+		return false;
+	}
+
+	const uint tile_size = header.tile_size;
+	const uint tiles_x = (w + tile_size - 1) / tile_size;
+	const uint tiles_y = (h + tile_size - 1) / tile_size;
+
+	uint residual[VR_CODEC_TILE_PIXELS_MAX];
+	const uchar *p = in + sizeof(FrameHeader);
+	const uchar *end = in + in_size;
+	for (uint i = 0; i < header.num_tiles; ++i) {
+		if (p + sizeof(TileHeader) > end) {
+			return false;
+		}
+		TileHeader tile_header;
+		memcpy(&tile_header, p, sizeof(TileHeader));
+		p += sizeof(TileHeader);
+		if (tile_header.index >= tiles_x * tiles_y || p + tile_header.size > end) {
+			return false;
+		}
+
+		const uint x0 = (tile_header.index % tiles_x) * tile_size;
+		const uint y0 = (tile_header.index / tiles_x) * tile_size;
+		const uint tw = (x0 + tile_size > w) ? (w - x0) : tile_size;
+		const uint th = (y0 + tile_size > h) ? (h - y0) : tile_size;
+		if (!rle_decode(p, tile_header.size, residual, tw * th)) {
+			return false;
+		}
+		p += tile_header.size;
+
+		if (tile_header.mode == TILEMODE_SPATIAL) {
+			spatial_reconstruct(residual, tw, th);
+			for (uint y = 0; y < th; ++y) {
+				memcpy(pixels + ((size_t)(y0 + y) * w + x0) * VR_CODEC_DEPTH, residual + y * tw, tw * VR_CODEC_DEPTH);
+			}
+		}
+		else if (tile_header.mode == TILEMODE_TEMPORAL) {
+			const uint *r = residual;
+			for (uint y = 0; y < th; ++y) {
+				uchar *dst = pixels + ((size_t)(y0 + y) * w + x0) * VR_CODEC_DEPTH;
+				for (uint x = 0; x < tw; ++x, dst += VR_CODEC_DEPTH) {
+					uint q;
+					memcpy(&q, dst, 4);
+					q = pixel_add(q, *r++);
+					memcpy(dst, &q, 4);
+				}
+			}
+		}
+		else {
+			return false;
+		}
+	}
+
+	return (p == end);
+}
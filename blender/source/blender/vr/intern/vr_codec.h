@@ -0,0 +1,134 @@
+/*
+* ***** BEGIN GPL LICENSE BLOCK *****
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software Foundation,
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+* The Original Code is Copyright (C) 2019 by Blender Foundation.
+* All rights reserved.
+*
+* Contributor(s): MARUI-PlugIn, Multiplexed Reality
+*
+* ***** END GPL LICENSE BLOCK *****
+*/
+
+/** \file blender/vr/intern/vr_codec.h
+*   \ingroup vr
+*/
+
+#ifndef __VR_CODEC_H__
+#define __VR_CODEC_H__
+
+#include "vr_types.h"
+
+#define VR_CODEC_MAGIC		0x31435256	/* Stream identifier ("VRC1") at the start of each encoded frame. */
+#define VR_CODEC_TILE_SIZE	32			/* Default tile edge length in pixels. */
+#define VR_CODEC_DEPTH		4			/* Bytes per pixel (RGBA). */
+
+/* Tile-based delta codec for remote image streaming.
+ * Each image is split into square tiles. Only tiles that changed since the
+ * previous (delivered) frame are coded. A tile is coded either as the per-byte
+ * difference to the client's copy of that tile (temporal) or to its left / upper
+ * neighbor pixel (spatial), whichever is smaller, and compressed with a fast
+ * pixel run-length coder. Optionally the low color bits are dropped (lossy).
+ *
+ * Encoded frame layout:
+ *   FrameHeader, then FrameHeader::num_tiles times { TileHeader, payload }.
+ * Tile payload (run-length coded 32bit residuals):
+ *   op byte c: (c & 0x80) ? run of (c & 0x7F) + 1 copies of the following residual
+ *                         : (c + 1) literal residuals follow. */
+class VR_Codec
+{
+public:
+	/* Encoded frame flags. */
+	typedef enum Flag {
+		FLAG_NONE		= 0x00	/* Delta frame: tiles are coded relative to the previous frame. */
+		,
+		FLAG_KEYFRAME	= 0x01	/* Key frame: all tiles are coded, without reference to a previous frame. */
+	} Flag;
+
+	/* Header preceding each encoded frame. */
+	typedef struct FrameHeader {
+		uint	magic;		/* Stream identifier (VR_CODEC_MAGIC). */
+		uint	frame_id;	/* Sequential frame number (for diagnostics). */
+		ushort	w;			/* Image width in pixels. */
+		ushort	h;			/* Image height in pixels. */
+		uchar	tile_size;	/* Tile edge length in pixels. */
+		uchar	flags;		/* Frame flags (see Flag). */
+		uchar	quant_bits;	/* Number of least significant color bits dropped by lossy coding. */
+		uchar	reserved;	/* Padding (zero). */
+		uint	num_tiles;	/* Number of tiles coded in this frame. */
+	} FrameHeader;
+
+	/* Tile prediction modes. */
+	typedef enum TileMode {
+		TILEMODE_SPATIAL	= 0	/* Residual to the left neighbor pixel (upper neighbor for the first column). */
+		,
+		TILEMODE_TEMPORAL	= 1	/* Residual to the same pixel of the previous frame. */
+	} TileMode;
+
+	/* Header preceding each encoded tile. */
+	typedef struct TileHeader {
+		ushort	index;		/* Tile index (row-major). */
+		uchar	mode;		/* Tile prediction mode (see TileMode). */
+		uchar	reserved;	/* Padding (zero). */
+		uint	size;		/* Size of the tile payload in bytes. */
+	} TileHeader;
+
+	/* Per-frame encoding statistics. */
+	typedef struct Stats {
+		uint	frame_id;		/* Frame number of the last encoded frame. */
+		uint	tiles_total;	/* Number of tiles in the image. */
+		uint	tiles_coded;	/* Number of tiles that were coded (changed). */
+		uint	encoded_size;	/* Size of the encoded frame in bytes. */
+		bool	keyframe;		/* Whether the last frame was a key frame. */
+	} Stats;
+
+	VR_Codec();		/* Constructor. */
+	~VR_Codec();	/* Destructor. */
+
+	bool init(uint w, uint h, uint tile_size = VR_CODEC_TILE_SIZE);	/* Allocate state for images of the given size. */
+	void release();	/* Free allocated state. */
+	void reset();	/* Force the next frame to be a key frame (i.e. after the client (re)connected). */
+
+	uint	quant_bits;	/* Number of least significant color bits to drop (0 = lossless, up to 7). */
+
+	uint max_encoded_size() const;	/* Upper bound of the size of one encoded frame. */
+	static uint max_encoded_size(uint w, uint h, uint tile_size = VR_CODEC_TILE_SIZE);	/* Upper bound of the size of one encoded frame. */
+
+	uint encode(const uchar *pixels, uchar *out, uint out_size);	/* Encode an RGBA image. Returns the encoded size in bytes (0 on failure). */
+	static bool decode(const uchar *in, uint in_size, uchar *pixels, uint w, uint h);	/* Apply an encoded frame to the previously decoded RGBA image. */
+
+	const Stats& stats() const;	/* Statistics of the last encoded frame. */
+protected:
+	uint	w;			/* Image width in pixels. */
+	uint	h;			/* Image height in pixels. */
+	uint	tile_size;	/* Tile edge length in pixels. */
+	uint	tiles_x;	/* Number of tile columns. */
+	uint	tiles_y;	/* Number of tile rows. */
+	uint	tile_bound;	/* Upper bound of the size of one encoded tile payload. */
+
+	uchar	*reference;		/* The image as reconstructed by the client (quantized). */
+	uchar	*scratch;		/* Encoding buffer (one tile_bound slot per tile). */
+	uint	*tile_sizes;	/* Encoded payload size per tile (0 = unchanged). */
+	uchar	*tile_modes;	/* Prediction mode per tile (see TileMode). */
+
+	uint	frame_id;			/* Sequential number of the next frame. */
+	bool	keyframe_pending;	/* Whether the next frame must be a key frame. */
+	Stats	last_stats;			/* Statistics of the last encoded frame. */
+
+	static uint tile_payload_bound(uint num_pixels);	/* Upper bound of the size of a coded tile with num_pixels pixels. */
+};
+
+#endif /* __VR_CODEC_H__ */
@@ -307,6 +307,22 @@ Mat44f VR_Draw::modelview_matrix;
 Mat44f VR_Draw::modelview_matrix_inv;
 float VR_Draw::color_vector[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
 
+bool VR_Draw::batch_active(false);
+uchar VR_Draw::batch_depth(3);
+bool VR_Draw::batch_blend(true);
+VR_Draw::BatchVertex VR_Draw::batch_verts[VR_DRAW_BATCH_VERTS];
+uint VR_Draw::batch_num_verts(0);
+VR_Draw::BatchRange VR_Draw::batch_ranges[VR_DRAW_BATCH_RANGES];
+uint VR_Draw::batch_num_ranges(0);
+uint VR_Draw::batch_vertex_array(0);
+uint VR_Draw::batch_vertex_buffer(0);
+
+uint VR_Draw::atlas_texture(0);
+uint VR_Draw::atlas_generation(0);
+uint VR_Draw::atlas_x(0);
+uint VR_Draw::atlas_y(0);
+uint VR_Draw::atlas_shelf_height(0);
+
 VR_Draw::VR_Draw()
 {
 	//
@@ -466,6 +482,22 @@ int VR_Draw::init(void* display, void* drawable, void* context)
 
 void VR_Draw::uninit()
 {
+	if (batch_vertex_array) {
+		glDeleteVertexArrays(1, &batch_vertex_array);
+		batch_vertex_array = 0;
+	}
+	if (batch_vertex_buffer) {
+		glDeleteBuffers(1, &batch_vertex_buffer);
+		batch_vertex_buffer = 0;
+	}
+	if (atlas_texture) {
+		glDeleteTextures(1, &atlas_texture);
+		atlas_texture = 0;
+	}
+	batch_active = false;
+	batch_num_verts = 0;
+	batch_num_ranges = 0;
+
 	if (controller_tex) {
 		delete controller_tex;
 		controller_tex = NULL;
@@ -1012,7 +1044,8 @@ void VR_Draw::set_color(const float& r, const float& g, const float& b, const fl
 	VR_Draw::color_vector[3] = a;
 }
 
-void VR_Draw::set_blend(bool on_off)
+/* Apply a blend state to OpenGL. */
+static void apply_blend(bool on_off)
 {
 	if (on_off) {
 		glEnable(GL_BLEND);
@@ -1022,8 +1055,19 @@ void VR_Draw::set_blend(bool on_off)
 	}
 }
 
-void VR_Draw::set_depth_test(bool on_off, bool write_depth)
+void VR_Draw::set_blend(bool on_off)
+{
+	VR_Draw::batch_blend = on_off;
+	if (!VR_Draw::batch_active) {
+		apply_blend(on_off);
+	}
+}
+
+/* Apply a depth test state (bit 0: test, bit 1: write) to OpenGL. */
+static void apply_depth_test(uchar depth)
 {
+	const bool on_off = (depth & 1) != 0;
+	const bool write_depth = (depth & 2) != 0;
 	if (on_off) { /* testing depth */
 		if (write_depth) { /* testing depth and writing to depth buffer */
 			glEnable(GL_DEPTH_TEST);
@@ -1050,6 +1094,14 @@ void VR_Draw::set_depth_test(bool on_off, bool write_depth)
 	}
 }
 
+void VR_Draw::set_depth_test(bool on_off, bool write_depth)
+{
+	VR_Draw::batch_depth = (on_off ? 1 : 0) | (write_depth ? 2 : 0);
+	if (!VR_Draw::batch_active) {
+		apply_depth_test(VR_Draw::batch_depth);
+	}
+}
+
 static void Util_Image_decodePNGRGBA_readData(png_structp png_ptr, png_bytep data, png_uint_32 length)
 {
 	uchar** b = (uchar**)png_get_io_ptr(png_ptr);
@@ -1136,7 +1188,8 @@ static bool createTextureFromPNG(const uchar* data, uint& texture_id, uint& w, u
 VR_Draw::Shader::Shader()
 	: program(0), vertex_shader(0), fragment_shader(0),
 	position_location(0), normal_location(0), uv_location(0), modelview_location(0),
-	projection_location(0), normal_matrix_location(0), color_location(0), sampler_location(0)
+	projection_location(0), normal_matrix_location(0), color_location(0), sampler_location(0),
+	vertex_color_location(-1)
 {
 	//
 }
@@ -1190,6 +1243,7 @@ int VR_Draw::Shader::create(const char* vss, const char* fss, bool tex)
 	this->modelview_location = glGetUniformLocation(program, "modelview");
 	this->projection_location = glGetUniformLocation(program, "projection");
 	this->color_location = glGetUniformLocation(program, "color");
+	this->vertex_color_location = glGetAttribLocation(program, "vertex_color");
 
 	return 0;
 }
@@ -1227,6 +1281,14 @@ GLuint VR_Draw::Shader::texture_shader()
 	return shader_tex.program;
 }
 
+GLuint VR_Draw::Shader::batch_shader()
+{
+	if (!shader_batch.program) {
+		shader_batch.create(shader_batch_vsource, shader_batch_fsource, true);
+	}
+	return shader_batch.program;
+}
+
 VR_Draw::Shader VR_Draw::Shader::shader_col;
 
 const char* const VR_Draw::Shader::shader_col_vsource(STRING(#version 120\n
@@ -1281,9 +1343,37 @@ void main()
 }
 ));
 
+VR_Draw::Shader VR_Draw::Shader::shader_batch;
+
+const char* const VR_Draw::Shader::shader_batch_vsource(STRING(#version 120\n
+	attribute vec4 position;
+	attribute vec2 uv;
+	attribute vec4 vertex_color;
+	varying vec2 texcoord;
+	varying vec4 front_color;
+void main()
+{
+	gl_Position = position; /* already transformed to clip space */
+	texcoord = uv;
+	front_color = vertex_color;
+}
+));
+
+const char* const VR_Draw::Shader::shader_batch_fsource(STRING(#version 120\n
+	varying vec2 texcoord;
+	varying vec4 front_color;
+	uniform sampler2D tex;
+void main()
+{
+	gl_FragColor = texture2D(tex, texcoord) * front_color;
+}
+));
+
 VR_Draw::Texture::Texture(const uchar* png_blob)
 	: png_blob(png_blob)
 	, implementation(0)
+	, atlas_generation(0)
+	, atlas_fits(true)
 {
 	//
 }
@@ -1292,6 +1382,9 @@ VR_Draw::Texture::Texture(const Texture& cpy)
 {
 	this->png_blob = cpy.png_blob;
 	this->implementation = cpy.implementation;
+	std::memcpy(this->atlas_uv, cpy.atlas_uv, sizeof(float) * 4);
+	this->atlas_generation = cpy.atlas_generation;
+	this->atlas_fits = cpy.atlas_fits;
 }
 
 VR_Draw::Texture::~Texture()
@@ -1305,6 +1398,9 @@ VR_Draw::Texture& VR_Draw::Texture::operator= (const Texture& o)
 {
 	this->png_blob = o.png_blob;
 	this->implementation = o.implementation;
+	std::memcpy(this->atlas_uv, o.atlas_uv, sizeof(float) * 4);
+	this->atlas_generation = o.atlas_generation;
+	this->atlas_fits = o.atlas_fits;
 
 	return *this;
 }
@@ -1465,6 +1561,11 @@ VR_Draw::Model* VR_Draw::Model::create(float* verts, float* nrmls, float* uvs, u
 
 int VR_Draw::Model::render()
 {
+	/* Render batched primitives first to keep the drawing order. */
+	if (VR_Draw::batch_active) {
+		VR_Draw::flush_batch();
+	}
+
 	/* Save previous OpenGL state */
 	GLint prior_program;
 	glGetIntegerv(GL_CURRENT_PROGRAM, &prior_program);
@@ -1542,338 +1643,477 @@ int VR_Draw::Model::render(const Mat44f& pos)
 	return e;
 }
 
-void VR_Draw::render_rect(float left, float right, float top, float bottom, float z, float u, float v, Texture *tex)
+/***************************************************************************************************
+ * \class                                  VR_Draw (batching)
+ ***************************************************************************************************
+ * Retained-mode rendering of rects, frames, boxes and strings: primitives are transformed on the
+ * CPU, collected in one streaming vertex buffer and rendered in as few draw calls as possible.
+ * Images are packed into a texture atlas, so that differently textured primitives share a draw.
+ **************************************************************************************************/
+/* Texture coordinates of the white block in the atlas (for non-textured primitives). */
+static const float atlas_white_uv[2] = { 2.0f / float(VR_DRAW_ATLAS_SIZE), 2.0f / float(VR_DRAW_ATLAS_SIZE) };
+
+void VR_Draw::atlas_create()
 {
-	/* Save previous OpenGL state */
-	GLint prior_program;
-	glGetIntegerv(GL_CURRENT_PROGRAM, &prior_program);
-	GLboolean prior_backface_culling = glIsEnabled(GL_CULL_FACE);
-	GLboolean prior_blend_enabled = glIsEnabled(GL_BLEND);
-	GLboolean prior_depth_test = glIsEnabled(GL_DEPTH_TEST);
-	GLboolean prior_texture_enabled = glIsEnabled(GL_TEXTURE_2D);
+	GLint prior_texture_binding_2d;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &prior_texture_binding_2d);
 
-	glDisable(GL_CULL_FACE);
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	/* Create the (transparent) atlas, with a white block for non-textured primitives. */
+	uchar *clear = (uchar*)calloc(VR_DRAW_ATLAS_SIZE * VR_DRAW_ATLAS_SIZE, 4);
+	glGenTextures(1, &VR_Draw::atlas_texture);
+	glBindTexture(GL_TEXTURE_2D, VR_Draw::atlas_texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, VR_DRAW_ATLAS_SIZE, VR_DRAW_ATLAS_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid*)clear);
+	memset(clear, 0xff, 4 * 4 * 4);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 4, 4, GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid*)clear);
+	free(clear);
+
+	VR_Draw::atlas_x = 4 + VR_DRAW_ATLAS_PADDING;
+	VR_Draw::atlas_y = 0;
+	VR_Draw::atlas_shelf_height = 4 + VR_DRAW_ATLAS_PADDING;
+	++VR_Draw::atlas_generation;
 
-	if (tex) {
-		glUseProgram(VR_Draw::Shader::texture_shader());
+	glBindTexture(GL_TEXTURE_2D, prior_texture_binding_2d);
+}
+
+bool VR_Draw::atlas_add(Texture* tex)
+{
+	if (!VR_Draw::atlas_texture) {
+		VR_Draw::atlas_create();
 	}
-	else {
-		glUseProgram(VR_Draw::Shader::color_shader());
+	if (tex->atlas_generation == VR_Draw::atlas_generation) {
+		return true;
 	}
-	GLint prior_vertex_array_binding;
-	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &prior_vertex_array_binding);
-	GLint prior_array_buffer;
-	glGetIntegerv(GL_ARRAY_BUFFER, &prior_array_buffer);
+	if (!tex->atlas_fits || !tex->png_blob) {
+		return false;
+	}
+
 	GLint prior_texture_binding_2d;
 	glGetIntegerv(GL_TEXTURE_BINDING_2D, &prior_texture_binding_2d);
-	GLint prior_texture_unit;
-	glGetIntegerv(GL_ACTIVE_TEXTURE, (GLint*)&prior_texture_unit);
 
-	if (tex) {
-		glEnable(GL_TEXTURE_2D);
-		glActiveTexture(GL_TEXTURE0);
-		tex->bind();
+	uchar *img;
+	uint w, h;
+	if (!decodePNGRGBA(tex->png_blob, img, w, h)) {
+		tex->atlas_fits = false;
+		glBindTexture(GL_TEXTURE_2D, prior_texture_binding_2d);
+		return false;
 	}
 
-	/* Load uniforms */
-	if (tex) {
-		glUniformMatrix4fv(VR_Draw::Shader::shader_tex.modelview_location, 1, false, (float*)VR_Draw::modelview_matrix.m);
-		glUniformMatrix4fv(VR_Draw::Shader::shader_tex.projection_location, 1, false, (float*)VR_Draw::projection_matrix.m);
-		glUniformMatrix4fv(VR_Draw::Shader::shader_tex.normal_matrix_location, 1, true, (float*)VR_Draw::modelview_matrix_inv.m);
-		glUniform4fv(VR_Draw::Shader::shader_tex.color_location, 1, (float*)VR_Draw::color_vector);
+	const uint pw = w + 2 * VR_DRAW_ATLAS_PADDING;
+	const uint ph = h + 2 * VR_DRAW_ATLAS_PADDING;
+	if (w > VR_DRAW_ATLAS_MAX_ITEM || h > VR_DRAW_ATLAS_MAX_ITEM) {
+		tex->atlas_fits = false;
 	}
 	else {
-		glUniformMatrix4fv(VR_Draw::Shader::shader_col.modelview_location, 1, false, (float*)VR_Draw::modelview_matrix.m);
-		glUniformMatrix4fv(VR_Draw::Shader::shader_col.projection_location, 1, false, (float*)VR_Draw::projection_matrix.m);
-		glUniform4fv(VR_Draw::Shader::shader_col.color_location, 1, (float*)VR_Draw::color_vector);
+		/* Shelf packing: start a new shelf when the current one is full. */
+		if (VR_Draw::atlas_x + pw > VR_DRAW_ATLAS_SIZE) {
+			VR_Draw::atlas_x = 0;
+			VR_Draw::atlas_y += VR_Draw::atlas_shelf_height;
+			VR_Draw::atlas_shelf_height = 0;
+		}
+		if (VR_Draw::atlas_y + ph > VR_DRAW_ATLAS_SIZE) {
+			tex->atlas_fits = false;
+		}
 	}
-
-	/* Create vertex array */
-	static GLuint vertex_array;
-	if (!vertex_array) {
-		glGenVertexArrays(1, &vertex_array);
+	if (!tex->atlas_fits) {
+		free(img);
+		glBindTexture(GL_TEXTURE_2D, prior_texture_binding_2d);
+		return false;
 	}
-	glBindVertexArray(vertex_array);
 
-	/* Create vertex buffer */
-	static GLfloat vertex_data[4][3];
-	vertex_data[0][0] = left;  vertex_data[0][1] = bottom; vertex_data[0][2] = z;
-	vertex_data[1][0] = right; vertex_data[1][1] = bottom; vertex_data[1][2] = z;
-	vertex_data[2][0] = left;  vertex_data[2][1] = top;    vertex_data[2][2] = z;
-	vertex_data[3][0] = right; vertex_data[3][1] = top;    vertex_data[3][2] = z;
+	const uint x = VR_Draw::atlas_x + VR_DRAW_ATLAS_PADDING;
+	const uint y = VR_Draw::atlas_y + VR_DRAW_ATLAS_PADDING;
+	glBindTexture(GL_TEXTURE_2D, VR_Draw::atlas_texture);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid*)img);
+	glBindTexture(GL_TEXTURE_2D, prior_texture_binding_2d);
+	free(img);
 
-	static GLuint verts = 0;
-	if (!verts) {
-		glGenBuffers(1, &verts);
-	}
-	glBindBuffer(GL_ARRAY_BUFFER, verts);
-	glBufferData(GL_ARRAY_BUFFER, 3 * 4 * sizeof(float), vertex_data, GL_STATIC_DRAW);
-	if (tex) {
-		glVertexAttribPointer(VR_Draw::Shader::shader_tex.position_location, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 3, (void*)0);
-		glEnableVertexAttribArray(VR_Draw::Shader::shader_tex.position_location);
-	}
-	else {
-		glVertexAttribPointer(VR_Draw::Shader::shader_col.position_location, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 3, (void*)0);
-		glEnableVertexAttribArray(VR_Draw::Shader::shader_col.position_location);
-	}
+	tex->atlas_uv[0] = float(x) / float(VR_DRAW_ATLAS_SIZE);
+	tex->atlas_uv[1] = float(y) / float(VR_DRAW_ATLAS_SIZE);
+	tex->atlas_uv[2] = float(x + w) / float(VR_DRAW_ATLAS_SIZE);
+	tex->atlas_uv[3] = float(y + h) / float(VR_DRAW_ATLAS_SIZE);
+	tex->atlas_generation = VR_Draw::atlas_generation;
 
-	static GLuint nrmls = 0;
-	static GLuint uvs = 0;
-	if (tex) {
-		/* Create normal buffer */
-		static const GLfloat normal_data[] = {
-			0.0f, 0.0f, 1.0f,
-			0.0f, 0.0f, 1.0f,
-			0.0f, 0.0f, 1.0f,
-			0.0f, 0.0f, 1.0f
-		};
-		if (!nrmls) {
-			glGenBuffers(1, &nrmls);
-			glBindBuffer(GL_ARRAY_BUFFER, nrmls);
-			glBufferData(GL_ARRAY_BUFFER, 3 * 4 * sizeof(float), normal_data, GL_STATIC_DRAW);
-		}
-		else {
-			glBindBuffer(GL_ARRAY_BUFFER, nrmls);
-		}
-		glVertexAttribPointer(VR_Draw::Shader::shader_tex.normal_location, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 3, (void*)0);
-		glEnableVertexAttribArray(VR_Draw::Shader::shader_tex.normal_location);
-
-		/* Create uv buffer */
-		static GLfloat uv_data[4][2];
-		uv_data[0][0] = 0.0f; uv_data[0][1] = v;
-		uv_data[1][0] = u;    uv_data[1][1] = v;
-		uv_data[2][0] = 0.0f; uv_data[2][1] = 0.0f;
-		uv_data[3][0] = u;    uv_data[3][1] = 0.0f;
-
-		if (!uvs) {
-			glGenBuffers(1, &uvs);
-		}
-		glBindBuffer(GL_ARRAY_BUFFER, uvs);
-		glBufferData(GL_ARRAY_BUFFER, 2 * 4 * sizeof(float), uv_data, GL_STATIC_DRAW);
-		glVertexAttribPointer(VR_Draw::Shader::shader_tex.uv_location, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 2, (void*)0);
-		glEnableVertexAttribArray(VR_Draw::Shader::shader_tex.uv_location);
+	VR_Draw::atlas_x += pw;
+	if (VR_Draw::atlas_shelf_height < ph) {
+		VR_Draw::atlas_shelf_height = ph;
 	}
 
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	return true;
+}
 
-	if (tex) {
-		glDisableVertexAttribArray(VR_Draw::Shader::shader_tex.position_location);
-		glDisableVertexAttribArray(VR_Draw::Shader::shader_tex.normal_location);
-		glDisableVertexAttribArray(VR_Draw::Shader::shader_tex.uv_location);
-	}
-	else {
-		glDisableVertexAttribArray(VR_Draw::Shader::shader_col.position_location);
+void VR_Draw::begin_batch()
+{
+	if (VR_Draw::batch_active) {
+		return;
 	}
 
-	/* Restore previous OpenGL state */
-	glBindVertexArray(prior_vertex_array_binding);
-	glBindBuffer(GL_ARRAY_BUFFER, prior_array_buffer);
-	glBindTexture(GL_TEXTURE_2D, prior_texture_binding_2d);
-	glActiveTexture(prior_texture_unit);
+	/* Pick up the current depth test state (may have been changed outside of VR_Draw). */
+	GLboolean depth_test = glIsEnabled(GL_DEPTH_TEST);
+	GLint depth_func;
+	glGetIntegerv(GL_DEPTH_FUNC, &depth_func);
+	GLboolean depth_mask;
+	glGetBooleanv(GL_DEPTH_WRITEMASK, &depth_mask);
+	VR_Draw::batch_depth = ((depth_test && depth_func != GL_ALWAYS) ? 1 : 0) | (depth_mask ? 2 : 0);
+	VR_Draw::batch_blend = (glIsEnabled(GL_BLEND) == GL_TRUE);
 
-	glUseProgram(prior_program);
-	prior_backface_culling ? glEnable(GL_CULL_FACE) : glDisable(GL_CULL_FACE);
-	prior_blend_enabled ? glEnable(GL_BLEND) : glDisable(GL_BLEND);
-	prior_depth_test ? glEnable(GL_DEPTH_TEST) : glDisable(GL_DEPTH_TEST);
-	prior_texture_enabled ? glEnable(GL_TEXTURE_2D) : glDisable(GL_TEXTURE_2D);
+	VR_Draw::batch_active = true;
 }
 
-void VR_Draw::render_frame(float left, float right, float top, float bottom, float b, float z)
+void VR_Draw::end_batch()
 {
+	if (!VR_Draw::batch_active) {
+		return;
+	}
+
+	VR_Draw::flush_batch();
+	VR_Draw::batch_active = false;
+}
+
+void VR_Draw::flush_batch()
+{
+	if (!VR_Draw::batch_num_verts) {
+		return;
+	}
+	if (!VR_Draw::atlas_texture) {
+		VR_Draw::atlas_create();
+	}
+
 	/* Save previous OpenGL state */
 	GLint prior_program;
 	glGetIntegerv(GL_CURRENT_PROGRAM, &prior_program);
 	GLboolean prior_backface_culling = glIsEnabled(GL_CULL_FACE);
-	GLboolean prior_blend_enabled = glIsEnabled(GL_BLEND);
-	GLboolean prior_depth_test = glIsEnabled(GL_DEPTH_TEST);
 	GLboolean prior_texture_enabled = glIsEnabled(GL_TEXTURE_2D);
 
 	glDisable(GL_CULL_FACE);
-	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glEnable(GL_TEXTURE_2D);
 
-	glUseProgram(VR_Draw::Shader::color_shader());
-
+	glUseProgram(VR_Draw::Shader::batch_shader());
 	GLint prior_vertex_array_binding;
 	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &prior_vertex_array_binding);
 	GLint prior_array_buffer;
 	glGetIntegerv(GL_ARRAY_BUFFER, &prior_array_buffer);
+	GLint prior_texture_binding_2d;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &prior_texture_binding_2d);
+	GLint prior_texture_unit;
+	glGetIntegerv(GL_ACTIVE_TEXTURE, (GLint*)&prior_texture_unit);
+	GLfloat prior_line_width;
+	glGetFloatv(GL_LINE_WIDTH, &prior_line_width);
 
-	/* Load uniforms */
-	glUniformMatrix4fv(VR_Draw::Shader::shader_col.modelview_location, 1, false, (float*)VR_Draw::modelview_matrix.m);
-	glUniformMatrix4fv(VR_Draw::Shader::shader_col.projection_location, 1, false, (float*)VR_Draw::projection_matrix.m);
-	glUniform4fv(VR_Draw::Shader::shader_col.color_location, 1, (float*)VR_Draw::color_vector);
-
-	/* Create vertex array */
-	static GLuint vertex_array;
-	if (!vertex_array) {
-		glGenVertexArrays(1, &vertex_array);
-	}
-	glBindVertexArray(vertex_array);
-
-	/* Create vertex buffer */
-	static GLfloat vertex_data[10][3];
-	vertex_data[0][0] = left - b;	vertex_data[0][1] = top + b;    vertex_data[0][2] = z;
-	vertex_data[1][0] = left;	    vertex_data[1][1] = top;		vertex_data[1][2] = z;
-	vertex_data[2][0] = right + b;	vertex_data[2][1] = top + b;	vertex_data[2][2] = z;
-	vertex_data[2][0] = right + b;	vertex_data[2][1] = top + b;	vertex_data[2][2] = z;
-	vertex_data[3][0] = right;		vertex_data[3][1] = top;        vertex_data[3][2] = z;
-	vertex_data[4][0] = right + b;	vertex_data[4][1] = bottom - b;	vertex_data[4][2] = z;
-	vertex_data[5][0] = right;		vertex_data[5][1] = bottom;		vertex_data[5][2] = z;
-	vertex_data[6][0] = left - b;	vertex_data[6][1] = bottom - b; vertex_data[6][2] = z;
-	vertex_data[7][0] = left;		vertex_data[7][1] = bottom;     vertex_data[7][2] = z;
-	vertex_data[8][0] = left - b;	vertex_data[8][1] = top + b;    vertex_data[8][2] = z;
-	vertex_data[9][0] = left;	    vertex_data[9][1] = top;		vertex_data[9][2] = z;
-
-	static GLuint verts = 0;
-	if (!verts) {
-		glGenBuffers(1, &verts);
+	glActiveTexture(GL_TEXTURE0);
+	glUniform1i(VR_Draw::Shader::shader_batch.sampler_location, 0);
+
+	if (!VR_Draw::batch_vertex_array) {
+		glGenVertexArrays(1, &VR_Draw::batch_vertex_array);
+	}
+	glBindVertexArray(VR_Draw::batch_vertex_array);
+
+	/* Orphan the previous buffer storage, so that the upload does not wait for pending draws. */
+	if (!VR_Draw::batch_vertex_buffer) {
+		glGenBuffers(1, &VR_Draw::batch_vertex_buffer);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, VR_Draw::batch_vertex_buffer);
+	glBufferData(GL_ARRAY_BUFFER, VR_DRAW_BATCH_VERTS * sizeof(BatchVertex), 0, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, VR_Draw::batch_num_verts * sizeof(BatchVertex), VR_Draw::batch_verts);
+
+	const Shader& shader = VR_Draw::Shader::shader_batch;
+	glVertexAttribPointer(shader.position_location, 4, GL_FLOAT, GL_FALSE, sizeof(BatchVertex), (void*)offsetof(BatchVertex, position));
+	glEnableVertexAttribArray(shader.position_location);
+	glVertexAttribPointer(shader.uv_location, 2, GL_FLOAT, GL_FALSE, sizeof(BatchVertex), (void*)offsetof(BatchVertex, uv));
+	glEnableVertexAttribArray(shader.uv_location);
+	glVertexAttribPointer(shader.vertex_color_location, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(BatchVertex), (void*)offsetof(BatchVertex, color));
+	glEnableVertexAttribArray(shader.vertex_color_location);
+
+	Texture *bound_texture = 0;
+	glBindTexture(GL_TEXTURE_2D, VR_Draw::atlas_texture);
+	int depth = -1;
+	int blend = -1;
+	for (uint i = 0; i < VR_Draw::batch_num_ranges; ++i) {
+		const BatchRange& range = VR_Draw::batch_ranges[i];
+		if (range.texture != bound_texture) {
+			if (range.texture) {
+				range.texture->bind();
+			}
+			else {
+				glBindTexture(GL_TEXTURE_2D, VR_Draw::atlas_texture);
+			}
+			bound_texture = range.texture;
+		}
+		if (range.depth != depth) {
+			apply_depth_test(range.depth);
+			depth = range.depth;
+		}
+		if (range.blend != blend) {
+			apply_blend(range.blend);
+			blend = range.blend;
+		}
+		if (range.mode == GL_LINES) {
+			glLineWidth(2.0f);
+			if (range.stipple) {
+				glLineStipple(1, 0xF0F0);
+				glEnable(GL_LINE_STIPPLE);
+			}
+		}
+		glDrawArrays(range.mode, range.first, range.count);
+		if (range.stipple) {
+			glDisable(GL_LINE_STIPPLE);
+		}
 	}
-	glBindBuffer(GL_ARRAY_BUFFER, verts);
-	glBufferData(GL_ARRAY_BUFFER, 10 * 3 * sizeof(float), vertex_data, GL_STATIC_DRAW);
-	glVertexAttribPointer(VR_Draw::Shader::shader_col.position_location, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 3, (void*)0);
-	glEnableVertexAttribArray(VR_Draw::Shader::shader_col.position_location);
 
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, 10);
-
-	glDisableVertexAttribArray(VR_Draw::Shader::shader_col.position_location);
+	glDisableVertexAttribArray(shader.position_location);
+	glDisableVertexAttribArray(shader.uv_location);
+	glDisableVertexAttribArray(shader.vertex_color_location);
 
 	/* Restore previous OpenGL state */
+	glLineWidth(prior_line_width);
 	glBindVertexArray(prior_vertex_array_binding);
 	glBindBuffer(GL_ARRAY_BUFFER, prior_array_buffer);
+	glBindTexture(GL_TEXTURE_2D, prior_texture_binding_2d);
+	glActiveTexture(prior_texture_unit);
 
 	glUseProgram(prior_program);
 	prior_backface_culling ? glEnable(GL_CULL_FACE) : glDisable(GL_CULL_FACE);
-	prior_blend_enabled ? glEnable(GL_BLEND) : glDisable(GL_BLEND);
-	prior_depth_test ? glEnable(GL_DEPTH_TEST) : glDisable(GL_DEPTH_TEST);
 	prior_texture_enabled ? glEnable(GL_TEXTURE_2D) : glDisable(GL_TEXTURE_2D);
+	apply_depth_test(VR_Draw::batch_depth);
+	apply_blend(VR_Draw::batch_blend);
+
+	VR_Draw::batch_num_verts = 0;
+	VR_Draw::batch_num_ranges = 0;
 }
 
-void VR_Draw::render_box(const Coord3Df& p0, const Coord3Df& p1, bool outline)
+VR_Draw::BatchVertex* VR_Draw::batch_add(uint mode, Texture* texture, uint num_verts, bool stipple, bool depth_write)
 {
-	/* Save previous OpenGL state */
-	GLint prior_program;
-	glGetIntegerv(GL_CURRENT_PROGRAM, &prior_program);
-	GLboolean prior_backface_culling = glIsEnabled(GL_CULL_FACE);
-	GLboolean prior_blend_enabled = glIsEnabled(GL_BLEND);
-	GLboolean prior_depth_test = glIsEnabled(GL_DEPTH_TEST);
-	GLboolean prior_texture_enabled = glIsEnabled(GL_TEXTURE_2D);
-
-	glDisable(GL_CULL_FACE);
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glDepthMask(GL_FALSE);
-
-	glUseProgram(VR_Draw::Shader::color_shader());
+	if (VR_Draw::batch_num_verts + num_verts > VR_DRAW_BATCH_VERTS) {
+		VR_Draw::flush_batch();
+	}
 
-	GLint prior_vertex_array_binding;
-	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &prior_vertex_array_binding);
-	GLint prior_array_buffer;
-	glGetIntegerv(GL_ARRAY_BUFFER, &prior_array_buffer);
+	const uchar depth = depth_write ? VR_Draw::batch_depth : (VR_Draw::batch_depth & ~2);
+	BatchRange *range = VR_Draw::batch_num_ranges ? &VR_Draw::batch_ranges[VR_Draw::batch_num_ranges - 1] : 0;
+	if (!range || range->mode != mode || range->texture != texture || range->depth != depth ||
+		range->blend != VR_Draw::batch_blend || range->stipple != stipple) {
+		if (VR_Draw::batch_num_ranges == VR_DRAW_BATCH_RANGES) {
+			VR_Draw::flush_batch();
+		}
+		range = &VR_Draw::batch_ranges[VR_Draw::batch_num_ranges++];
+		range->mode = mode;
+		range->texture = texture;
+		range->depth = depth;
+		range->blend = VR_Draw::batch_blend;
+		range->stipple = stipple;
+		range->first = VR_Draw::batch_num_verts;
+		range->count = 0;
+	}
+
+	BatchVertex *v = &VR_Draw::batch_verts[VR_Draw::batch_num_verts];
+	VR_Draw::batch_num_verts += num_verts;
+	range->count += num_verts;
+	return v;
+}
 
-	/* Load uniforms */
-	glUniformMatrix4fv(VR_Draw::Shader::shader_col.modelview_location, 1, false, (float*)VR_Draw::modelview_matrix.m);
-	glUniformMatrix4fv(VR_Draw::Shader::shader_col.projection_location, 1, false, (float*)VR_Draw::projection_matrix.m);
-	glUniform4fv(VR_Draw::Shader::shader_col.color_location, 1, (float*)VR_Draw::color_vector);
+void VR_Draw::batch_vertex(BatchVertex* v, const Mat44f& mvp, float x, float y, float z, float u, float w, const uchar color[4])
+{
+	for (int i = 0; i < 4; ++i) {
+		v->position[i] = x * mvp.m[0][i] + y * mvp.m[1][i] + z * mvp.m[2][i] + mvp.m[3][i];
+	}
+	v->uv[0] = u;
+	v->uv[1] = w;
+	memcpy(v->color, color, 4);
+}
 
-	/* Create vertex array */
-	static GLuint vertex_array;
-	if (!vertex_array) {
-		glGenVertexArrays(1, &vertex_array);
+void VR_Draw::batch_strip(const Mat44f& mvp, const float (*pos)[3], const float (*uv)[2], uint n, Texture* texture, const uchar color[4], bool depth_write)
+{
+	BatchVertex *v = VR_Draw::batch_add(GL_TRIANGLES, texture, (n - 2) * 3, false, depth_write);
+	for (uint i = 0; i < n - 2; ++i) {
+		for (uint j = 0; j < 3; ++j, ++v) {
+			const float *p = pos[i + j];
+			const float *t = uv ? uv[i + j] : atlas_white_uv;
+			VR_Draw::batch_vertex(v, mvp, p[0], p[1], p[2], t[0], t[1], color);
+		}
 	}
-	glBindVertexArray(vertex_array);
+}
 
-	/* Create vertex buffer */
-	static GLfloat vertex_data[14][3];
-	vertex_data[0][0] = p0.x;		vertex_data[0][1] = p0.y;		vertex_data[0][2] = p0.z;
-	vertex_data[1][0] = p0.x;		vertex_data[1][1] = p0.y;		vertex_data[1][2] = p1.z;
-	vertex_data[2][0] = p0.x;		vertex_data[2][1] = p1.y;		vertex_data[2][2] = p0.z;
-	vertex_data[3][0] = p0.x;		vertex_data[3][1] = p1.y;		vertex_data[3][2] = p1.z;
-	vertex_data[4][0] = p1.x;		vertex_data[4][1] = p1.y;		vertex_data[4][2] = p1.z;
-	vertex_data[5][0] = p0.x;		vertex_data[5][1] = p0.y;		vertex_data[5][2] = p1.z;
-	vertex_data[6][0] = p1.x;		vertex_data[6][1] = p0.y;		vertex_data[6][2] = p1.z;
-	vertex_data[7][0] = p0.x;		vertex_data[7][1] = p0.y;		vertex_data[7][2] = p0.z;
-	vertex_data[8][0] = p1.x;		vertex_data[8][1] = p0.y;		vertex_data[8][2] = p0.z;
-	vertex_data[9][0] = p0.x;		vertex_data[9][1] = p1.y;		vertex_data[9][2] = p0.z;
-	vertex_data[10][0] = p1.x;		vertex_data[10][1] = p1.y;		vertex_data[10][2] = p0.z;
-	vertex_data[11][0] = p1.x;		vertex_data[11][1] = p1.y;		vertex_data[11][2] = p1.z;
-	vertex_data[12][0] = p1.x;		vertex_data[12][1] = p0.y;		vertex_data[12][2] = p0.z;
-	vertex_data[13][0] = p1.x;		vertex_data[13][1] = p0.y;		vertex_data[13][2] = p1.z;
+void VR_Draw::batch_color(uchar color[4], bool shaded)
+{
+	/* Same as the textured shader: darken by the angle between the (0, 0, 1) normal and the view. */
+	float shade = 1.0f;
+	if (shaded) {
+		const Mat44f& inv = VR_Draw::modelview_matrix_inv;
+		const float len = sqrtf(inv.m[0][2] * inv.m[0][2] + inv.m[1][2] * inv.m[1][2] + inv.m[2][2] * inv.m[2][2] + inv.m[3][2] * inv.m[3][2]);
+		shade = (len > 0.0f) ? inv.m[2][2] / len : 1.0f;
+		if (shade < 0.1f) {
+			shade = 0.1f;
+		}
+		else if (shade > 1.0f) {
+			shade = 1.0f;
+		}
+	}
+	for (int i = 0; i < 4; ++i) {
+		float c = VR_Draw::color_vector[i] * ((i < 3) ? shade : 1.0f);
+		c = (c < 0.0f) ? 0.0f : ((c > 1.0f) ? 1.0f : c);
+		color[i] = (uchar)(c * 255.0f + 0.5f);
+	}
+}
 
-	static GLuint verts = 0;
-	if (!verts) {
-		glGenBuffers(1, &verts);
+void VR_Draw::render_rect(float left, float right, float top, float bottom, float z, float u, float v, Texture *tex)
+{
+	const bool implicit_batch = !VR_Draw::batch_active;
+	if (implicit_batch) {
+		VR_Draw::begin_batch();
 	}
-	glBindBuffer(GL_ARRAY_BUFFER, verts);
-	glBufferData(GL_ARRAY_BUFFER, 14 * 3 * sizeof(float), vertex_data, GL_STATIC_DRAW);
-	glVertexAttribPointer(VR_Draw::Shader::shader_col.position_location, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 3, (void*)0);
-	glEnableVertexAttribArray(VR_Draw::Shader::shader_col.position_location);
 
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, 14);
+	const Mat44f mvp = VR_Draw::modelview_matrix * VR_Draw::projection_matrix;
+	uchar color[4];
+	VR_Draw::batch_color(color, tex != 0);
 
-	/* Draw the cube outline */
-	if (outline) {
-		GLfloat line_width;
-		glGetFloatv(GL_LINE_WIDTH, &line_width);
-		glLineWidth(2.0f);
-
-		VR_Draw::set_color(0.0f, 0.0f, 0.0f, 0.4f);
-		static GLfloat line_vertex_data[16][3];
-		line_vertex_data[0][0] = p0.x;	line_vertex_data[0][1] = p0.y;		line_vertex_data[0][2] = p0.z;
-		line_vertex_data[1][0] = p0.x;	line_vertex_data[1][1] = p1.y;		line_vertex_data[1][2] = p0.z;
-		line_vertex_data[2][0] = p1.x;	line_vertex_data[2][1] = p1.y;		line_vertex_data[2][2] = p0.z;
-		line_vertex_data[3][0] = p1.x;	line_vertex_data[3][1] = p0.y;		line_vertex_data[3][2] = p0.z;
-		line_vertex_data[4][0] = p0.x;	line_vertex_data[4][1] = p0.y;		line_vertex_data[4][2] = p0.z;
-		line_vertex_data[5][0] = p0.x;	line_vertex_data[5][1] = p0.y;		line_vertex_data[5][2] = p1.z;
-		line_vertex_data[6][0] = p0.x;	line_vertex_data[6][1] = p1.y;		line_vertex_data[6][2] = p1.z;
-		line_vertex_data[7][0] = p0.x;	line_vertex_data[7][1] = p1.y;		line_vertex_data[7][2] = p0.z;
-		line_vertex_data[8][0] = p0.x;	line_vertex_data[8][1] = p1.y;		line_vertex_data[8][2] = p1.z;
-		line_vertex_data[9][0] = p1.x;	line_vertex_data[9][1] = p1.y;		line_vertex_data[9][2] = p1.z;
-		line_vertex_data[10][0] = p1.x;	line_vertex_data[10][1] = p1.y;		line_vertex_data[10][2] = p0.z;
-		line_vertex_data[11][0] = p1.x;	line_vertex_data[11][1] = p1.y;		line_vertex_data[11][2] = p1.z;
-		line_vertex_data[12][0] = p1.x;	line_vertex_data[12][1] = p0.y;		line_vertex_data[12][2] = p1.z;
-		line_vertex_data[13][0] = p1.x;	line_vertex_data[13][1] = p0.y;		line_vertex_data[13][2] = p0.z;
-		line_vertex_data[14][0] = p1.x;	line_vertex_data[14][1] = p0.y;		line_vertex_data[14][2] = p1.z;
-		line_vertex_data[15][0] = p0.x;	line_vertex_data[15][1] = p0.y;		line_vertex_data[15][2] = p1.z;
-
-		static GLuint line_verts = 0;
-		if (!line_verts) {
-			glGenBuffers(1, &line_verts);
+	const float vertex_data[4][3] = {
+		{ left,  bottom, z },
+		{ right, bottom, z },
+		{ left,  top,    z },
+		{ right, top,    z }
+	};
+	if (tex) {
+		float uv_data[4][2] = {
+			{ 0.0f, v },
+			{ u,    v },
+			{ 0.0f, 0.0f },
+			{ u,    0.0f }
+		};
+		/* Repeating textures can't be taken from the atlas. */
+		Texture *range_tex = tex;
+		if (u <= 1.0f && v <= 1.0f && VR_Draw::atlas_add(tex)) {
+			for (int i = 0; i < 4; ++i) {
+				uv_data[i][0] = tex->atlas_uv[0] + uv_data[i][0] * (tex->atlas_uv[2] - tex->atlas_uv[0]);
+				uv_data[i][1] = tex->atlas_uv[1] + uv_data[i][1] * (tex->atlas_uv[3] - tex->atlas_uv[1]);
+			}
+			range_tex = 0;
 		}
-		glBindBuffer(GL_ARRAY_BUFFER, line_verts);
-		glBufferData(GL_ARRAY_BUFFER, 16 * 3 * sizeof(float), line_vertex_data, GL_STATIC_DRAW);
-		glVertexAttribPointer(VR_Draw::Shader::shader_col.position_location, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 3, (void*)0);
-
-		glDrawArrays(GL_LINE_STRIP, 0, 16);
+		VR_Draw::batch_strip(mvp, vertex_data, uv_data, 4, range_tex, color);
+	}
+	else {
+		VR_Draw::batch_strip(mvp, vertex_data, 0, 4, 0, color);
+	}
 
-		VR_Draw::set_color(1.0f, 1.0f, 1.0f, 0.7f);
-		glLineStipple(1, 0xF0F0);
-		glEnable(GL_LINE_STIPPLE);
+	if (implicit_batch) {
+		VR_Draw::end_batch();
+	}
+}
 
-		glDrawArrays(GL_LINE_STRIP, 0, 16);
+void VR_Draw::render_frame(float left, float right, float top, float bottom, float b, float z)
+{
+	const bool implicit_batch = !VR_Draw::batch_active;
+	if (implicit_batch) {
+		VR_Draw::begin_batch();
+	}
+
+	const Mat44f mvp = VR_Draw::modelview_matrix * VR_Draw::projection_matrix;
+	uchar color[4];
+	VR_Draw::batch_color(color, false);
+
+	const float vertex_data[10][3] = {
+		{ left - b,  top + b,    z },
+		{ left,      top,        z },
+		{ right + b, top + b,    z },
+		{ right,     top,        z },
+		{ right + b, bottom - b, z },
+		{ right,     bottom,     z },
+		{ left - b,  bottom - b, z },
+		{ left,      bottom,     z },
+		{ left - b,  top + b,    z },
+		{ left,      top,        z }
+	};
+	VR_Draw::batch_strip(mvp, vertex_data, 0, 10, 0, color);
 
-		glDisable(GL_LINE_STIPPLE);
-		if (line_width != 2.0f)
-			glLineWidth(line_width);
+	if (implicit_batch) {
+		VR_Draw::end_batch();
 	}
+}
 
-	glDisableVertexAttribArray(VR_Draw::Shader::shader_col.position_location);
+void VR_Draw::render_box(const Coord3Df& p0, const Coord3Df& p1, bool outline)
+{
+	const bool implicit_batch = !VR_Draw::batch_active;
+	if (implicit_batch) {
+		VR_Draw::begin_batch();
+	}
+
+	const Mat44f mvp = VR_Draw::modelview_matrix * VR_Draw::projection_matrix;
+	uchar color[4];
+	VR_Draw::batch_color(color, false);
+
+	/* Boxes are transparent volumes: don't write depth. */
+	const float vertex_data[14][3] = {
+		{ p0.x, p0.y, p0.z },
+		{ p0.x, p0.y, p1.z },
+		{ p0.x, p1.y, p0.z },
+		{ p0.x, p1.y, p1.z },
+		{ p1.x, p1.y, p1.z },
+		{ p0.x, p0.y, p1.z },
+		{ p1.x, p0.y, p1.z },
+		{ p0.x, p0.y, p0.z },
+		{ p1.x, p0.y, p0.z },
+		{ p0.x, p1.y, p0.z },
+		{ p1.x, p1.y, p0.z },
+		{ p1.x, p1.y, p1.z },
+		{ p1.x, p0.y, p0.z },
+		{ p1.x, p0.y, p1.z }
+	};
+	VR_Draw::batch_strip(mvp, vertex_data, 0, 14, 0, color, false);
 
-	/* Restore previous OpenGL state */
-	glBindVertexArray(prior_vertex_array_binding);
-	glBindBuffer(GL_ARRAY_BUFFER, prior_array_buffer);
+	/* Draw the cube outline */
+	if (outline) {
+		const float line_vertex_data[16][3] = {
+			{ p0.x, p0.y, p0.z },
+			{ p0.x, p1.y, p0.z },
+			{ p1.x, p1.y, p0.z },
+			{ p1.x, p0.y, p0.z },
+			{ p0.x, p0.y, p0.z },
+			{ p0.x, p0.y, p1.z },
+			{ p0.x, p1.y, p1.z },
+			{ p0.x, p1.y, p0.z },
+			{ p0.x, p1.y, p1.z },
+			{ p1.x, p1.y, p1.z },
+			{ p1.x, p1.y, p0.z },
+			{ p1.x, p1.y, p1.z },
+			{ p1.x, p0.y, p1.z },
+			{ p1.x, p0.y, p0.z },
+			{ p1.x, p0.y, p1.z },
+			{ p0.x, p0.y, p1.z }
+		};
 
-	glUseProgram(prior_program);
-	prior_backface_culling ? glEnable(GL_CULL_FACE) : glDisable(GL_CULL_FACE);
-	prior_blend_enabled ? glEnable(GL_BLEND) : glDisable(GL_BLEND);
-	prior_depth_test ? glEnable(GL_DEPTH_TEST) : glDisable(GL_DEPTH_TEST);
-	prior_texture_enabled ? glEnable(GL_TEXTURE_2D) : glDisable(GL_TEXTURE_2D);
+		/* Solid dark outline, then stippled bright outline on top. */
+		for (int pass = 0; pass < 2; ++pass) {
+			if (pass == 0) {
+				VR_Draw::set_color(0.0f, 0.0f, 0.0f, 0.4f);
+			}
+			else {
+				VR_Draw::set_color(1.0f, 1.0f, 1.0f, 0.7f);
+			}
+			VR_Draw::batch_color(color, false);
+			BatchVertex *v = VR_Draw::batch_add(GL_LINES, 0, 15 * 2, (pass == 1), false);
+			for (int i = 0; i < 15; ++i) {
+				for (int j = 0; j < 2; ++j, ++v) {
+					const float *p = line_vertex_data[i + j];
+					VR_Draw::batch_vertex(v, mvp, p[0], p[1], p[2], atlas_white_uv[0], atlas_white_uv[1], color);
+				}
+			}
+		}
+	}
+
+	if (implicit_batch) {
+		VR_Draw::end_batch();
+	}
 }
 
 void VR_Draw::render_ball(float r, bool golf)
 {
+	/* Render batched primitives first to keep the drawing order. */
+	if (VR_Draw::batch_active) {
+		VR_Draw::flush_batch();
+	}
+
 	/* Save previous OpenGL state */
 	GLint prior_program;
 	glGetIntegerv(GL_CURRENT_PROGRAM, &prior_program);
@@ -1971,6 +2211,11 @@ void VR_Draw::render_ball(float r, bool golf)
 
 void VR_Draw::render_arrow(const Coord3Df& from, const Coord3Df& to, float width)
 {
+	/* Render batched primitives first to keep the drawing order. */
+	if (VR_Draw::batch_active) {
+		VR_Draw::flush_batch();
+	}
+
 	/* Save previous OpenGL state */
 	GLint prior_program;
 	glGetIntegerv(GL_CURRENT_PROGRAM, &prior_program);
@@ -2046,35 +2291,23 @@ void VR_Draw::render_string(const char* str, float w, float h, VR_HAlign h_align
 		ascii_tex = new Texture(ascii_png);
 	}
 
-	/* 2: Save previous OpenGL state. */
-	GLint prior_program;
-	glGetIntegerv(GL_CURRENT_PROGRAM, &prior_program);
-	GLboolean prior_backface_culling = glIsEnabled(GL_CULL_FACE);
-	GLboolean prior_blend_enabled = glIsEnabled(GL_BLEND);
-	GLboolean prior_depth_test = glIsEnabled(GL_DEPTH_TEST);
-	GLboolean prior_texture_enabled = glIsEnabled(GL_TEXTURE_2D);
-
-	glDisable(GL_CULL_FACE);
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glEnable(GL_TEXTURE_2D);
-
-	glUseProgram(VR_Draw::Shader::texture_shader());
-	GLint prior_vertex_array_binding;
-	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &prior_vertex_array_binding);
-	GLint prior_array_buffer;
-	glGetIntegerv(GL_ARRAY_BUFFER, &prior_array_buffer);
-	GLint prior_texture_binding_2d;
-	glGetIntegerv(GL_TEXTURE_BINDING_2D, &prior_texture_binding_2d);
-	GLint prior_texture_unit;
-	glGetIntegerv(GL_ACTIVE_TEXTURE, (GLint*)&prior_texture_unit);
-
-	glActiveTexture(GL_TEXTURE0);
+	const bool implicit_batch = !VR_Draw::batch_active;
+	if (implicit_batch) {
+		VR_Draw::begin_batch();
+	}
 
-	/* Bind the texture (and create the texture implementation if necessary). */
-	ascii_tex->bind();
+	/* 2: Get the glyph texture coordinates (in the atlas, if possible). */
+	static const float full_uv[4] = { 0.0f, 0.0f, 1.0f, 1.0f };
+	Texture *range_tex = 0;
+	const float *tex_uv = ascii_tex->atlas_uv;
+	if (!VR_Draw::atlas_add(ascii_tex)) {
+		range_tex = ascii_tex;
+		tex_uv = full_uv;
+	}
+	const float u_scale = (tex_uv[2] - tex_uv[0]) / 14.0f;
+	const float v_scale = (tex_uv[3] - tex_uv[1]) / 7.0f;
 
-	/* 3: Walk over all characters and render them. */
+	/* 3: Walk over all characters and add them. */
 	int i;
 	float full_height = h;
 	float full_width = 0.0f;
@@ -2118,37 +2351,9 @@ void VR_Draw::render_string(const char* str, float w, float h, VR_HAlign h_align
 	float x = x_offset;
 	float y = y_offset;
 
-	/* Load uniforms */
-	glUniformMatrix4fv(VR_Draw::Shader::shader_tex.modelview_location, 1, false, (float*)VR_Draw::modelview_matrix.m);
-	glUniformMatrix4fv(VR_Draw::Shader::shader_tex.projection_location, 1, false, (float*)VR_Draw::projection_matrix.m);
-	glUniformMatrix4fv(VR_Draw::Shader::shader_tex.normal_matrix_location, 1, true, (float*)VR_Draw::modelview_matrix_inv.m);
-	glUniform4fv(VR_Draw::Shader::shader_tex.color_location, 1, (float*)VR_Draw::color_vector);
-
-	/* Create vertex array */
-	static GLuint vertex_array;
-	if (!vertex_array) {
-		glGenVertexArrays(1, &vertex_array);
-	}
-	glBindVertexArray(vertex_array);
-
-	/* Create normal buffer */
-	static const GLfloat normal_data[] = {
-		0.0f, 0.0f, 1.0f,
-		0.0f, 0.0f, 1.0f,
-		0.0f, 0.0f, 1.0f,
-		0.0f, 0.0f, 1.0f
-	};
-	static GLuint nrmls = 0;
-	if (!nrmls) {
-		glGenBuffers(1, &nrmls);
-		glBindBuffer(GL_ARRAY_BUFFER, nrmls);
-		glBufferData(GL_ARRAY_BUFFER, 3 * 4 * sizeof(float), normal_data, GL_STATIC_DRAW);
-	}
-	else {
-		glBindBuffer(GL_ARRAY_BUFFER, nrmls);
-	}
-	glVertexAttribPointer(VR_Draw::Shader::shader_tex.normal_location, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 3, (void*)0);
-	glEnableVertexAttribArray(VR_Draw::Shader::shader_tex.normal_location);
+	const Mat44f mvp = VR_Draw::modelview_matrix * VR_Draw::projection_matrix;
+	uchar color[4];
+	VR_Draw::batch_color(color, true);
 
 	i = 0;
 	while (str[i]) {
@@ -2172,57 +2377,29 @@ void VR_Draw::render_string(const char* str, float w, float h, VR_HAlign h_align
 		int col = index % 14; /* row in 14x7 grid */
 		int row = (index - col) / 14; /* col in 14x7 grid */
 
-		/* Create vertex buffer */
-		static GLfloat vertex_data[4][3];
-		vertex_data[0][0] = x;     vertex_data[0][1] = y - h; vertex_data[0][2] = z_offset; /* bottom-left */
-		vertex_data[1][0] = x + w; vertex_data[1][1] = y - h; vertex_data[1][2] = z_offset; /* bottom-right */
-		vertex_data[2][0] = x;     vertex_data[2][1] = y;     vertex_data[2][2] = z_offset; /* top-left */
-		vertex_data[3][0] = x + w; vertex_data[3][1] = y;     vertex_data[3][2] = z_offset; /* top-right */
-
-		static GLuint verts = 0;
-		if (!verts) {
-			glGenBuffers(1, &verts);
-		}
-		glBindBuffer(GL_ARRAY_BUFFER, verts);
-		glBufferData(GL_ARRAY_BUFFER, 3 * 4 * sizeof(float), vertex_data, GL_STATIC_DRAW); //GL_DYNAMIC_DRAW);
-		glVertexAttribPointer(VR_Draw::Shader::shader_tex.position_location, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 3, (void*)0);
-		glEnableVertexAttribArray(VR_Draw::Shader::shader_tex.position_location);
-
-		/* Create uv buffers */
-		static GLfloat uv_data[4][2];
-		uv_data[0][0] = float(col + 0) / 14.0f; uv_data[0][1] = float(row + 1) / 7.0f;
-		uv_data[1][0] = float(col + 1) / 14.0f; uv_data[1][1] = float(row + 1) / 7.0f;
-		uv_data[2][0] = float(col + 0) / 14.0f, uv_data[2][1] = float(row + 0) / 7.0f;
-		uv_data[3][0] = float(col + 1) / 14.0f; uv_data[3][1] = float(row + 0) / 7.0f;
-
-		static GLuint uvs = 0;
-		if (!uvs) {
-			glGenBuffers(1, &uvs);
-		}
-		glBindBuffer(GL_ARRAY_BUFFER, uvs);
-		glBufferData(GL_ARRAY_BUFFER, 2 * 4 * sizeof(float), uv_data, GL_STATIC_DRAW);
-		glVertexAttribPointer(VR_Draw::Shader::shader_tex.uv_location, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 2, (void*)0);
-		glEnableVertexAttribArray(VR_Draw::Shader::shader_tex.uv_location);
-
-		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+		const float vertex_data[4][3] = {
+			{ x,     y - h, z_offset }, /* bottom-left */
+			{ x + w, y - h, z_offset }, /* bottom-right */
+			{ x,     y,     z_offset }, /* top-left */
+			{ x + w, y,     z_offset }  /* top-right */
+		};
+		const float u0 = tex_uv[0] + float(col + 0) * u_scale;
+		const float u1 = tex_uv[0] + float(col + 1) * u_scale;
+		const float v0 = tex_uv[1] + float(row + 0) * v_scale;
+		const float v1 = tex_uv[1] + float(row + 1) * v_scale;
+		const float uv_data[4][2] = {
+			{ u0, v1 },
+			{ u1, v1 },
+			{ u0, v0 },
+			{ u1, v0 }
+		};
+		VR_Draw::batch_strip(mvp, vertex_data, uv_data, 4, range_tex, color);
 
 		++i;
 		x += w;
 	}
 
-	glDisableVertexAttribArray(VR_Draw::Shader::shader_tex.position_location);
-	glDisableVertexAttribArray(VR_Draw::Shader::shader_tex.normal_location);
-	glDisableVertexAttribArray(VR_Draw::Shader::shader_tex.uv_location);
-
-	/* 4: Restore previous OpenGL state */
-	glBindVertexArray(prior_vertex_array_binding);
-	glBindBuffer(GL_ARRAY_BUFFER, prior_array_buffer);
-	glBindTexture(GL_TEXTURE_2D, prior_texture_binding_2d);
-	glActiveTexture(prior_texture_unit);
-
-	glUseProgram(prior_program);
-	prior_backface_culling ? glEnable(GL_CULL_FACE) : glDisable(GL_CULL_FACE);
-	prior_blend_enabled ? glEnable(GL_BLEND) : glDisable(GL_BLEND);
-	prior_depth_test ? glEnable(GL_DEPTH_TEST) : glDisable(GL_DEPTH_TEST);
-	prior_texture_enabled ? glEnable(GL_TEXTURE_2D) : glDisable(GL_TEXTURE_2D);
+	if (implicit_batch) {
+		VR_Draw::end_batch();
+	}
 }
@@ -30,6 +30,12 @@
 #ifndef __VR_DRAW_H__
 #define __VR_DRAW_H__
 
+#define VR_DRAW_BATCH_VERTS		16384	/* Capacity (in vertices) of the streaming vertex buffer used for batched rendering. */
+#define VR_DRAW_BATCH_RANGES	256		/* Maximum number of draw ranges (state changes) per batch flush. */
+#define VR_DRAW_ATLAS_SIZE		2048	/* Width and height (in pixels) of the texture atlas. */
+#define VR_DRAW_ATLAS_MAX_ITEM	512		/* Maximum width / height (in pixels) of an image to be packed into the atlas. */
+#define VR_DRAW_ATLAS_PADDING	2		/* Transparent border (in pixels) around each image in the atlas. */
+
 class VR_Draw
 {
 	VR_Draw();	/* Constructor. */
@@ -70,6 +76,7 @@ protected:
 		int		normal_matrix_location;	/* Location of the shader normal matrix. normal_matrix = transpose(inverse(modelview)). */
 		int		color_location;		/* Location of the shader color vector. */
 		int		sampler_location;	/* Location of the shader sampler. */
+		int		vertex_color_location;	/* Location of the shader per-vertex color (if any). */
 		
 		Shader();	/* Default constructor. */
 		~Shader();  /* Default destructor. */
@@ -78,13 +85,17 @@ protected:
 
 		static uint		color_shader();	/* The default (non-textured) shader. */
 		static uint		texture_shader();/* The default textured shader. */
+		static uint		batch_shader();	/* The shader for batched rendering. */
 		static Shader	shader_col;	/* The default (non-textured) shader. */
 		static Shader   shader_tex; /* The default textured shader. */
+		static Shader	shader_batch;	/* The shader for batched rendering (clip space positions, vertex colors). */
 	private:
 		static const char* const shader_col_vsource;	/* Vertex shader source code for the default (non-textured) shader. */
 		static const char* const shader_col_fsource;	/* Fragment shader source code for the default (non-textured) shader. */
 		static const char* const shader_tex_vsource;	/* Vertex shader source code for the textured shader. */
 		static const char* const shader_tex_fsource;	/* Fragment shader source code for the textured shader. */
+		static const char* const shader_batch_vsource;	/* Vertex shader source code for the batch shader. */
+		static const char* const shader_batch_fsource;	/* Fragment shader source code for the batch shader. */
 	} Shader;
 
 	/* Texture objects and global texture library (texture ID and metainfo). */
@@ -108,6 +119,9 @@ protected:
 		const uchar*	png_blob;	/* Binary image data buffer (in PNG format), if created from PNG. */
 		
 		TextureImplementation* implementation;	/* API dependent instance of this texture. */
+		float	atlas_uv[4];	/* Texture coordinates (u0, v0, u1, v1) of the image in the atlas. */
+		uint	atlas_generation;	/* Atlas generation the image was packed into (0: not packed yet). */
+		bool	atlas_fits;	/* Whether the image can be packed into the atlas. */
 		bool create_implementation();	/* Internal helper function to generate the implementation object. */
 	public:
 		Texture(const uchar* png_blob);	/* Create/get texture from PNG format block in memory. */
@@ -116,6 +130,8 @@ protected:
 
 		Texture& operator= (const Texture& o);	/* Assignment operator. */
 
+		friend class VR_Draw;
+
 		uint width();	/* Get image width (in pixels). */
 		uint height();	/* Get image height (in pixels). */
 
@@ -140,6 +156,47 @@ protected:
 		virtual int render();	/* Render the model. */
 		virtual int render(const Mat44f& pos);	/* Render the model at the given position. */
 	} Model;
+
+	/* Vertex of the streaming vertex buffer. Positions are transformed to clip space when the
+	 * primitive is added, so that primitives with different transformations share one draw. */
+	typedef struct BatchVertex {
+		float	position[4];	/* Clip space position. */
+		float	uv[2];	/* Texture coordinates (in the atlas or the range texture). */
+		uchar	color[4];	/* Vertex color (already shaded). */
+	} BatchVertex;
+
+	/* Consecutive vertices rendered with the same OpenGL state. */
+	typedef struct BatchRange {
+		uint	mode;	/* Primitive type (GL_TRIANGLES or GL_LINES). */
+		Texture* texture;	/* Texture to bind (0: the atlas). */
+		uchar	depth;	/* Depth test state (see set_depth_test()): bit 0: test, bit 1: write. */
+		bool	blend;	/* Whether alpha blending is enabled (see set_blend()). */
+		bool	stipple;	/* Whether lines are stippled. */
+		uint	first;	/* First vertex of the range. */
+		uint	count;	/* Number of vertices in the range. */
+	} BatchRange;
+
+	static bool	batch_active;	/* Whether primitives are currently collected (between begin_batch() and end_batch()). */
+	static uchar	batch_depth;	/* Depth test state to use for newly added primitives. */
+	static bool	batch_blend;	/* Blend state to use for newly added primitives. */
+	static BatchVertex	batch_verts[VR_DRAW_BATCH_VERTS];	/* Vertices added since the last flush. */
+	static uint	batch_num_verts;	/* Number of vertices in batch_verts. */
+	static BatchRange	batch_ranges[VR_DRAW_BATCH_RANGES];	/* Draw ranges added since the last flush. */
+	static uint	batch_num_ranges;	/* Number of ranges in batch_ranges. */
+	static uint	batch_vertex_array;	/* Vertex array for batched rendering. */
+	static uint	batch_vertex_buffer;	/* Streaming vertex buffer for batched rendering. */
+
+	static uint	atlas_texture;	/* OpenGL texture of the atlas. */
+	static uint	atlas_generation;	/* Incremented whenever the atlas is (re-)created. */
+	static uint	atlas_x, atlas_y;	/* Position of the next image on the current shelf. */
+	static uint	atlas_shelf_height;	/* Height of the current shelf. */
+
+	static void atlas_create();	/* Create the (empty) texture atlas. */
+	static bool atlas_add(Texture* tex);	/* Pack the image of a texture into the atlas. Returns false if it does not fit. */
+	static BatchVertex* batch_add(uint mode, Texture* texture, uint num_verts, bool stipple = false, bool depth_write = true);	/* Reserve vertices for a primitive (flushes if necessary). */
+	static void batch_vertex(BatchVertex* v, const Mat44f& mvp, float x, float y, float z, float u, float w, const uchar color[4]);	/* Fill in a batch vertex. */
+	static void batch_strip(const Mat44f& mvp, const float (*pos)[3], const float (*uv)[2], uint n, Texture* texture, const uchar color[4], bool depth_write = true);	/* Add a triangle strip (as triangles). */
+	static void batch_color(uchar color[4], bool shaded);	/* Get the current color as bytes (optionally shaded like the textured shader). */
 public:
 	/* Controller models / textures. */
 	static Model *controller_model[VR_SIDES]; /* Controller models (left and right). */
@@ -274,6 +331,10 @@ public:
 	static void set_color(const float& r, const float& g, const float& b, const float& a);	/* Set the current object / render color. */
 	static void set_blend(bool on_off);	/* Enable/disable alpha blending. */
 	static void set_depth_test(bool on_off, bool write_depth);	/* Enable / disable depth testing. */
+
+	static void begin_batch();	/* Start collecting rects, frames, boxes and strings into one streaming vertex buffer. */
+	static void flush_batch();	/* Render all primitives collected so far. */
+	static void end_batch();	/* Render all collected primitives and stop batching. */
 	
 	static void render_rect(float left, float right, float top, float bottom, float z, float u=1.0f, float v=1.0f, Texture* tex=0);	/* Render a rectangle with currently set transformation. */
 	static void render_frame(float left, float right, float top, float bottom, float b, float z = 0);	/* Render a flat frame. */
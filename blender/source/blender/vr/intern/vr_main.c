@@ -33,12 +33,18 @@
 
 #include "vr_main.h"
 
+#include "BLI_fileops.h"
 #include "BLI_math.h"
+#include "BLI_path_util.h"
 
 #include "DNA_camera_types.h"
+#include "DNA_scene_types.h"
 #include "DNA_screen_types.h"
+#include "DNA_userdef_types.h"
+#include "DNA_view3d_types.h"
 #include "DNA_windowmanager_types.h"
 
+#include "BKE_appdir.h"
 #include "BKE_camera.h"
 #include "BKE_library.h"
 #include "BKE_library_query.h"
@@ -49,7 +55,11 @@
 
 #include "ED_object.h"
 
+#include "GPU_context.h"
 #include "GPU_framebuffer.h"
+#include "GPU_shader.h"
+#include "GPU_state.h"
+#include "GPU_texture.h"
 #include "GPU_viewport.h"
 
 #include "draw_manager.h"
@@ -89,6 +99,8 @@ typedef int(__stdcall *c_setEyeParams)(int side, float fx, float fy, float cx, f
 typedef int(__stdcall *c_getDefaultEyeParams)(int side, float* fx, float* fy, float* cx, float* cy);	/* Get the HMD's default parameters. */
 typedef int(__stdcall *c_getDefaultEyeTexSize)(int* w, int* h, int side);	/* Get the default eye texture size. */
 typedef int(__stdcall *c_updateTrackingVR)(void);	/* Update the t_eye positions based on latest tracking data. */
+typedef int(__stdcall *c_latchTrackingVR)(void);	/* Re-sample the t_eye positions shortly before rendering (late-latching). (optional) */
+typedef int(__stdcall *c_getActualHMDPosition)(float t_hmd[4][4]);	/* Measured (not predicted) position of the HMD when the last frame was displayed. (optional) */
 typedef int(__stdcall *c_getEyePositions)(float t_eye[VR_SIDES][4][4]);	/* Last tracked position of the eyes. */
 typedef int(__stdcall *c_getHMDPosition)(float t_hmd[4][4]);	/* Last tracked position of the HMD. */
 typedef int(__stdcall *c_getControllerPositions)(float t_controller[VR_MAX_CONTROLLERS][4][4]);	/* Last tracked position of the controllers. */
@@ -105,6 +117,8 @@ static c_setEyeParams vr_dll_set_eye_params;
 static c_getDefaultEyeParams vr_dll_get_default_eye_params;
 static c_getDefaultEyeTexSize vr_dll_get_default_eye_tex_size;
 static c_updateTrackingVR vr_dll_update_tracking_vr;
+static c_latchTrackingVR vr_dll_latch_tracking_vr;
+static c_getActualHMDPosition vr_dll_get_actual_hmd_position;
 static c_getEyePositions vr_dll_get_eye_positions;
 static c_getHMDPosition vr_dll_get_hmd_position;
 static c_getControllerPositions vr_dll_get_controller_positions;
@@ -121,6 +135,58 @@ VR *vr_get_obj() { return &vr; }
 /* Temporary VR camera to use if scene does not contain a camera. */
 static Object *vr_temp_cam = NULL;
 
+/* Print statistics of the HMD pose prediction error (predicted vs. measured) to the console. */
+#define VR_POSE_PREDICTION_LOG 0
+/* Number of frames over which the pose prediction error statistics are accumulated. */
+#define VR_POSE_PREDICTION_LOG_FRAMES 90
+
+/* Write the frame timings to a JSON trace file in the temporary directory on exit. */
+#define VR_TIMING_TRACE 0
+
+/* Environment variable with the path of a recording to replay (selects the BlenderXR_Replay backend). */
+#define VR_REPLAY_ENV_FILE "BLENDERXR_REPLAY"
+/* Environment variable with the path to record the session to (see vr_record_begin()). */
+#define VR_RECORD_ENV_FILE "BLENDERXR_RECORD"
+
+/* Environment variable with the range of the adaptive render scale: "min[:max]" (fractions of the default eye texture size). */
+#define VR_RENDER_SCALE_ENV "BLENDERXR_RENDER_SCALE"
+/* Default range of the adaptive render scale. */
+#define VR_RENDER_SCALE_MIN 0.5f
+#define VR_RENDER_SCALE_MAX 1.0f
+/* Granularity of render scale changes (every change reallocates the viewport buffers). */
+#define VR_RENDER_SCALE_STEP 0.05f
+/* GPU time budget of a frame (ms, 90 Hz) and the fraction of it to aim for. */
+#define VR_RENDER_SCALE_BUDGET 11.1f
+#define VR_RENDER_SCALE_HEADROOM 0.85f
+/* Number of measured frames between render scale adjustments. */
+#define VR_RENDER_SCALE_INTERVAL 30
+/* Print render scale changes to the console. */
+#define VR_RENDER_SCALE_LOG 0
+/* Number of frames of GPU timer queries in flight (results are read without stalling). */
+#define VR_GPU_TIMER_FRAMES 4
+
+/* Environment variable enabling foveated rendering: "1" (gaze from the eye tracker, if any, else the lens center)
+ * or "u,v" (fixed synthetic gaze point, 0~1 from the bottom-left of the eye images). */
+#define VR_FOVEATION_ENV "BLENDERXR_FOVEATION"
+/* Size of the full-resolution inset (fraction of the eye image width / height). */
+#define VR_FOVEATION_INSET_SIZE 0.35f
+/* Resolution of the periphery (fraction of the render resolution). */
+#define VR_FOVEATION_PERIPHERY_SCALE 0.5f
+/* Width of the blend between the inset and the periphery (fraction of the inset size). */
+#define VR_FOVEATION_FEATHER 0.15f
+
+/* Recording file format (must match src/vr_replay.h). */
+#define VR_RECORD_MAGIC "BXRR"
+#define VR_RECORD_VERSION 1
+
+/* Session recording state. */
+static FILE *vr_record_file = NULL;
+static int vr_record_frames = 0;
+
+/* Pose prediction measurement hook (if any). */
+static VR_PosePredictionHook vr_pose_prediction_hook = NULL;
+static void *vr_pose_prediction_hook_userdata = NULL;
+
 /* The active VR dll (if any). */
 #ifdef WIN32
 static HINSTANCE vr_dll;
@@ -162,7 +228,8 @@ static int vr_load_dll_functions(VR_Type type)
   /* The shared library must be in the folder that contains the Blender executable.
    * "BlenderXR_OpenXR.dll/.so" also requires "openxr-loader-1_0.dll/.so" to be present.
    * "BlenderXR_SteamVR.dll/.so" also requires "openvr_api.dll/.so" to be present.
-   * "BlenderXR_Fove.dll" also requires "FoveClient.dll". */
+   * "BlenderXR_Fove.dll" also requires "FoveClient.dll".
+   * "BlenderXR_Replay.dll/.so" has no dependencies (no HMD or GPU required). */
   switch (type) {
   case VR_TYPE_MAGICLEAP: {
     return -1;
@@ -231,6 +298,38 @@ static int vr_load_dll_functions(VR_Type type)
     }
     break;
   }
+  case VR_TYPE_REPLAY: {
+#ifdef WIN32
+    vr_dll = LoadLibrary("BlenderXR_Replay.dll");
+#elif defined __linux__
+    static char proc_path[PATH_MAX];
+    static char path[PATH_MAX];
+    memset(path, 0, sizeof(path));
+    pid_t pid = getpid();
+    sprintf(proc_path, "/proc/%d/exe", pid);
+    ssize_t len = readlink(proc_path, path, PATH_MAX);
+    if (len != -1) {
+      /* Replace the "blender" tail */
+      sprintf(&path[len - 7], "libBlenderXR_Replay.so");
+      vr_dll = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    }
+#elif defined __APPLE__
+    static char proc_path[PROC_PIDPATHINFO_MAXSIZE];
+    static char path[PATH_MAX];
+    memset(path, 0, sizeof(path));
+    pid_t pid = getpid();
+    int len = proc_pidpath(pid, path, PATH_MAX);
+    if (len > 0) {
+      /* Replace the "blender.app/Contents/MacOS/blender" tail */
+      sprintf(&path[len - 34], "libBlenderXR_Replay.dylib");
+      vr_dll = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    }
+#endif
+    if (vr_dll) {
+      vr.type = VR_TYPE_REPLAY;
+    }
+    break;
+  }
   case VR_TYPE_OCULUS: {
 #ifdef WIN32
     vr_dll = LoadLibrary("BlenderXR_Oculus.dll");
@@ -258,6 +357,10 @@ static int vr_load_dll_functions(VR_Type type)
       else if (i == VR_TYPE_OPENXR) {
         continue;
       }
+      else if (i == VR_TYPE_REPLAY) {
+        /* Only used when requested explicitly. */
+        continue;
+      }
       else if (i == VR_TYPE_STEAM) {
 #ifdef WIN32
         vr_dll = LoadLibrary("BlenderXR_SteamVR.dll");
@@ -343,6 +446,9 @@ static int vr_load_dll_functions(VR_Type type)
 	if (!vr_dll_update_tracking_vr) {
 		return -1;
 	}
+	/* Optional (not exported by older shared libraries). */
+	vr_dll_latch_tracking_vr = (c_latchTrackingVR)GetProcAddress(vr_dll, "c_latchTrackingVR");
+	vr_dll_get_actual_hmd_position = (c_getActualHMDPosition)GetProcAddress(vr_dll, "c_getActualHMDPosition");
 	vr_dll_get_eye_positions = (c_getEyePositions)GetProcAddress(vr_dll, "c_getEyePositions");
 	if (!vr_dll_get_eye_positions) {
 		return -1;
@@ -404,6 +510,9 @@ static int vr_load_dll_functions(VR_Type type)
 	if (!vr_dll_update_tracking_vr) {
 		return -1;
 	}
+	/* Optional (not exported by older shared libraries). */
+	vr_dll_latch_tracking_vr = (c_latchTrackingVR)dlsym(vr_dll, "c_latchTrackingVR");
+	vr_dll_get_actual_hmd_position = (c_getActualHMDPosition)dlsym(vr_dll, "c_getActualHMDPosition");
 	vr_dll_get_eye_positions = (c_getEyePositions)dlsym(vr_dll, "c_getEyePositions");
 	if (!vr_dll_get_eye_positions) {
 		return -1;
@@ -546,6 +655,211 @@ static int vr_delete_temp_camera(void)
   return 0;
 }
 
+/* Number of remote streaming readbacks that can be in flight. */
+#define VR_STREAM_READBACK_COUNT 3
+
+/* Asynchronous readback of the eye images for remote streaming. */
+typedef struct VR_StreamReadback {
+	int width;	/* Width (per eye) of the streamed images. */
+	int height;	/* Height (per eye) of the streamed images. */
+	GPUOffScreen *offscreen;	/* Downscaled eye images (left eye in the lower half, right eye in the upper half). */
+	GPUShader *shader;	/* Downscale / flip / depth-to-alpha shader. */
+	GLuint pbo[VR_STREAM_READBACK_COUNT];	/* Pixel buffer objects receiving the readbacks. */
+	GLsync fence[VR_STREAM_READBACK_COUNT];	/* Fences signaled when the corresponding readback finished. */
+	unsigned int queued;	/* Number of readbacks started. */
+	unsigned int fetched;	/* Number of readbacks finished / discarded. */
+} VR_StreamReadback;
+static VR_StreamReadback vr_stream = { 0 };
+
+/* Fullscreen quad (triangle strip without vertex buffer). */
+static const char *vr_stream_vert_glsl =
+	"out vec2 uv;\n"
+	"void main()\n"
+	"{\n"
+	"	uv = vec2(gl_VertexID & 1, gl_VertexID >> 1);\n"
+	"	gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);\n"
+	"}\n";
+
+/* Nearest-neighbor downscale with the same orientation as VR_Network::resample_pixels():
+ * flipped vertically (top row first after readback). The two horizontal flips of the CPU
+ * resampler cancel out. Pixels at the far plane get zero alpha (for see-through displays). */
+static const char *vr_stream_frag_glsl =
+	"uniform sampler2D colortex;\n"
+	"uniform sampler2D depthtex;\n"
+	"uniform int depth_to_alpha;\n"
+	"in vec2 uv;\n"
+	"out vec4 fragColor;\n"
+	"void main()\n"
+	"{\n"
+	"	ivec2 size = textureSize(colortex, 0);\n"
+	"	ivec2 texel = min(ivec2(vec2(uv.x, 1.0 - uv.y) * vec2(size)), size - 1);\n"
+	"	vec3 color = texelFetch(colortex, texel, 0).rgb;\n"
+	"	float depth = texelFetch(depthtex, texel, 0).r;\n"
+	"	fragColor = vec4(color, (depth_to_alpha != 0 && depth == 1.0) ? 0.0 : 1.0);\n"
+	"}\n";
+
+/* Periphery (bilinearly upscaled) with the inset blended on top. */
+static const char *vr_foveation_frag_glsl =
+	"uniform sampler2D periphery;\n"
+	"uniform sampler2D inset;\n"
+	"uniform vec4 inset_rect;\n"
+	"uniform float feather;\n"
+	"in vec2 uv;\n"
+	"out vec4 fragColor;\n"
+	"void main()\n"
+	"{\n"
+	"	vec4 color = texture(periphery, uv);\n"
+	"	vec2 inset_uv = (uv - inset_rect.xy) / (inset_rect.zw - inset_rect.xy);\n"
+	"	vec2 edge = min(inset_uv, 1.0 - inset_uv);\n"
+	"	float weight = smoothstep(0.0, feather, min(edge.x, edge.y));\n"
+	"	if (weight > 0.0) {\n"
+	"		color = mix(color, texture(inset, inset_uv), weight);\n"
+	"	}\n"
+	"	fragColor = color;\n"
+	"}\n";
+
+/* Foveated rendering shader (shared by both eyes). */
+static GPUShader *vr_foveation_shader = NULL;
+
+/* Enable foveated rendering if requested by VR_FOVEATION_ENV. */
+static void vr_foveation_init(void)
+{
+	const char *foveation = getenv(VR_FOVEATION_ENV);
+	if (!foveation || !foveation[0] || STREQ(foveation, "0")) {
+		return;
+	}
+
+	float gaze[2];
+	if (sscanf(foveation, "%f,%f", &gaze[0], &gaze[1]) == 2) {
+		vr_set_gaze(gaze);
+	}
+	vr_set_foveation(1);
+}
+
+void vr_set_foveation(int enable)
+{
+	vr.foveation = enable;
+}
+
+void vr_set_gaze(const float gaze[2])
+{
+	if (gaze) {
+		for (int side = 0; side < VR_SIDES; ++side) {
+			vr.gaze[side][0] = clamp_f(gaze[0], 0.0f, 1.0f);
+			vr.gaze[side][1] = clamp_f(gaze[1], 0.0f, 1.0f);
+		}
+		vr.gaze_synthetic = 1;
+	}
+	else {
+		vr.gaze_synthetic = 0;
+	}
+}
+
+/* Update the gaze point and the full-resolution inset of an eye. */
+static void vr_foveation_inset_update(int side)
+{
+	float *gaze = vr.gaze[side];
+
+	if (!vr.gaze_synthetic) {
+		/* Lens center (principal point) unless the eye tracker reports a gaze. */
+		gaze[0] = vr.cx[side];
+		gaze[1] = 1.0f - vr.cy[side];
+
+		/* The Fove module reports the gaze as a point along the gaze ray, in place of the mono controller. */
+		const VR_Controller *tracker = vr.controller[VR_SIDE_MONO];
+		if (vr.type == VR_TYPE_FOVE && tracker && tracker->available) {
+			float p[3];
+			mul_v3_m4v3(p, vr.t_eye_inv[VR_SPACE_REAL][side], vr.t_controller[VR_SPACE_REAL][VR_SIDE_MONO][3]);
+			if (p[2] < -FLT_EPSILON) {
+				gaze[0] = clamp_f(vr.cx[side] + vr.fx[side] * p[0] / -p[2], 0.0f, 1.0f);
+				gaze[1] = clamp_f(1.0f - vr.cy[side] + vr.fy[side] * p[1] / -p[2], 0.0f, 1.0f);
+			}
+		}
+	}
+
+	/* Keep the inset inside the image. */
+	const float half = VR_FOVEATION_INSET_SIZE * 0.5f;
+	const float u = clamp_f(gaze[0], half, 1.0f - half);
+	const float v = clamp_f(gaze[1], half, 1.0f - half);
+	float *inset = vr.foveation_inset[side];
+	inset[0] = u - half;
+	inset[1] = v - half;
+	inset[2] = u + half;
+	inset[3] = v + half;
+}
+
+/* Composite the periphery and the inset of an eye into its foveated image. Requires the draw manager's context. */
+static void vr_foveation_composite(int side)
+{
+	GPUViewport *periphery = vr.viewport[side];
+	GPUViewport *inset = vr.viewport_inset[side];
+	if (!periphery->txl->color || !inset || !inset->txl->color) {
+		return;
+	}
+
+	if (!vr.foveated[side]) {
+		char err_out[256] = "unknown error";
+		vr.foveated[side] = GPU_offscreen_create(vr.tex_width, vr.tex_height, 0, false, false, err_out);
+		if (!vr.foveated[side]) {
+			printf("vr_foveation_composite() : Could not create offscreen buffer (%s).", err_out);
+			vr.foveation = 0;
+			return;
+		}
+	}
+	if (!vr_foveation_shader) {
+		vr_foveation_shader = GPU_shader_create(vr_stream_vert_glsl, vr_foveation_frag_glsl, NULL, NULL, NULL, "vr_foveation");
+		if (!vr_foveation_shader) {
+			printf("vr_foveation_composite() : Could not create shader.");
+			vr.foveation = 0;
+			return;
+		}
+	}
+
+	GPU_offscreen_bind(vr.foveated[side], true);
+	GPU_blend(false);
+	GPU_depth_test(false);
+	glViewport(0, 0, vr.tex_width, vr.tex_height);
+
+	GPUShader *shader = vr_foveation_shader;
+	GPU_shader_bind(shader);
+	glUniform1i(GPU_shader_get_uniform_ensure(shader, "periphery"), 0);
+	glUniform1i(GPU_shader_get_uniform_ensure(shader, "inset"), 1);
+	glUniform4fv(GPU_shader_get_uniform_ensure(shader, "inset_rect"), 1, vr.foveation_inset[side]);
+	glUniform1f(GPU_shader_get_uniform_ensure(shader, "feather"), VR_FOVEATION_FEATHER);
+
+	GPU_texture_bind(periphery->txl->color, 0);
+	GPU_texture_filter_mode(periphery->txl->color, true);
+	GPU_texture_bind(inset->txl->color, 1);
+	GPU_texture_filter_mode(inset->txl->color, true);
+	GPU_draw_primitive(GPU_PRIM_TRI_STRIP, 4);
+	GPU_texture_filter_mode(inset->txl->color, false);
+	GPU_texture_unbind(inset->txl->color);
+	GPU_texture_filter_mode(periphery->txl->color, false);
+	GPU_texture_unbind(periphery->txl->color);
+
+	GPU_shader_unbind();
+	GPU_offscreen_unbind(vr.foveated[side], true);
+}
+
+/* Free the foveated rendering buffers. */
+static void vr_foveation_free(void)
+{
+	for (int side = 0; side < VR_SIDES; ++side) {
+		if (vr.viewport_inset[side]) {
+			GPU_viewport_free(vr.viewport_inset[side]);
+			vr.viewport_inset[side] = NULL;
+		}
+		if (vr.foveated[side]) {
+			GPU_offscreen_free(vr.foveated[side]);
+			vr.foveated[side] = NULL;
+		}
+	}
+	if (vr_foveation_shader) {
+		GPU_shader_free(vr_foveation_shader);
+		vr_foveation_shader = NULL;
+	}
+}
+
 /* Copy-pasted from wm_draw_offscreen_texture_parameters(). */
 static void vr_draw_offscreen_texture_parameters(GPUOffScreen *offscreen)
 {
@@ -566,6 +880,182 @@ static void vr_draw_offscreen_texture_parameters(GPUOffScreen *offscreen)
 	glBindTexture(GL_TEXTURE_2D, 0);
 }
 
+/* GPU frame time measurement of the eye renders.
+ * The timestamp queries are issued when the eye regions are bound, i.e. in the window's context.
+ * Query objects aren't shared between contexts, so they are only valid in the context that created them. */
+typedef struct VR_GpuTimer {
+	GLuint queries[VR_GPU_TIMER_FRAMES][VR_SIDES][2];	/* Start / end timestamp queries per frame slot and bound view. */
+	unsigned char issued[VR_GPU_TIMER_FRAMES];	/* Bit (1 << view): queries of the view were issued in the slot. */
+	int slot;	/* Frame slot of the current frame. */
+	int frame_done;	/* Whether the current frame was submitted (the next bind starts a new frame). */
+	int samples;	/* Number of frames measured since the last render scale adjustment. */
+	int initialized;	/* Whether the queries were created. */
+	int free_pending;	/* Whether the queries are to be deleted (as soon as their context is current). */
+	GPUContext *context;	/* Context the queries were created in. */
+} VR_GpuTimer;
+static VR_GpuTimer vr_gpu_timer = { 0 };
+
+/* Set the render scale and the corresponding eye render size. */
+static void vr_render_scale_set(float scale)
+{
+	vr.render_scale = scale;
+	vr.render_width = max_ii(1, (int)(vr.tex_width * scale + 0.5f));
+	vr.render_height = max_ii(1, (int)(vr.tex_height * scale + 0.5f));
+}
+
+/* Initialize the render scale (after the default eye texture size is known). */
+static void vr_render_scale_init(void)
+{
+	float scale_min = VR_RENDER_SCALE_MIN;
+	float scale_max = VR_RENDER_SCALE_MAX;
+
+	const char *range = getenv(VR_RENDER_SCALE_ENV);
+	if (range && range[0]) {
+		int n = sscanf(range, "%f:%f", &scale_min, &scale_max);
+		if (n == 1) {
+			scale_max = max_ff(scale_min, VR_RENDER_SCALE_MAX);
+		}
+		else if (n != 2) {
+			printf("vr_init() : Invalid %s \"%s\" (expected \"min[:max]\").\n", VR_RENDER_SCALE_ENV, range);
+			scale_min = VR_RENDER_SCALE_MIN;
+			scale_max = VR_RENDER_SCALE_MAX;
+		}
+	}
+
+	vr_set_render_scale_range(scale_min, scale_max);
+}
+
+void vr_set_render_scale_range(float scale_min, float scale_max)
+{
+	CLAMP(scale_min, VR_RENDER_SCALE_STEP, 1.0f);
+	CLAMP(scale_max, scale_min, 1.0f);
+	vr.render_scale_min = scale_min;
+	vr.render_scale_max = scale_max;
+
+	/* Start at full quality and let the controller scale down if needed. */
+	vr_render_scale_set(scale_max);
+	vr.gpu_time = 0.0f;
+	vr_gpu_timer.samples = 0;
+}
+
+/* Adjust the render scale to the measured GPU time of the last frames.
+ * The GPU time is assumed to be proportional to the number of pixels (scale^2).
+ * The scale decreases as far as needed at once, but increases one step at a time. */
+static void vr_render_scale_update(void)
+{
+	if (vr.render_scale_min >= vr.render_scale_max || vr.gpu_time <= 0.0f) {
+		return;
+	}
+
+	const float target = VR_RENDER_SCALE_BUDGET * VR_RENDER_SCALE_HEADROOM;
+	float scale = vr.render_scale * sqrtf(target / vr.gpu_time);
+	scale = floorf(scale / VR_RENDER_SCALE_STEP + 1e-3f) * VR_RENDER_SCALE_STEP;
+	scale = min_ff(scale, vr.render_scale + VR_RENDER_SCALE_STEP);
+	CLAMP(scale, vr.render_scale_min, vr.render_scale_max);
+
+	if (fabsf(scale - vr.render_scale) < VR_RENDER_SCALE_STEP * 0.5f) {
+		return;
+	}
+
+#if VR_RENDER_SCALE_LOG
+	printf("VR render scale: %.2f -> %.2f (GPU %.2f ms)\n", vr.render_scale, scale, vr.gpu_time);
+#endif
+	vr_render_scale_set(scale);
+	/* Measure the new scale from scratch. */
+	vr.gpu_time = 0.0f;
+}
+
+/* Start a new frame of GPU time measurement: collect the (oldest) frame slot that is about to be
+ * reused, if its results are available, and adjust the render scale. Requires the context of the queries. */
+static void vr_gpu_timer_frame_begin(void)
+{
+	VR_GpuTimer *timer = &vr_gpu_timer;
+
+	timer->slot = (timer->slot + 1) % VR_GPU_TIMER_FRAMES;
+	timer->frame_done = 0;
+
+	const unsigned char issued = timer->issued[timer->slot];
+	timer->issued[timer->slot] = 0;
+	if (!issued) {
+		return;
+	}
+
+	GLuint64 elapsed = 0;
+	for (int view = 0; view < VR_SIDES; ++view) {
+		if (!(issued & (1 << view))) {
+			continue;
+		}
+		GLuint available = 0;
+		glGetQueryObjectuiv(timer->queries[timer->slot][view][1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) {
+			/* GPU is more than VR_GPU_TIMER_FRAMES frames behind: drop the measurement. */
+			return;
+		}
+		GLuint64 t_start, t_end;
+		glGetQueryObjectui64v(timer->queries[timer->slot][view][0], GL_QUERY_RESULT, &t_start);
+		glGetQueryObjectui64v(timer->queries[timer->slot][view][1], GL_QUERY_RESULT, &t_end);
+		if (t_end > t_start) {
+			elapsed += t_end - t_start;
+		}
+	}
+
+	const float ms = (float)((double)elapsed * 1e-6);
+	vr.gpu_time = (vr.gpu_time > 0.0f) ? interpf(ms, vr.gpu_time, 0.1f) : ms;
+
+	if (++timer->samples >= VR_RENDER_SCALE_INTERVAL) {
+		timer->samples = 0;
+		vr_render_scale_update();
+	}
+}
+
+/* Delete the GPU timer queries, in the context that created them (like vr_stream_readback_free()).
+ * If that context isn't current, the queries are kept and deleted the next time it is. */
+static void vr_gpu_timer_free(void)
+{
+	VR_GpuTimer *timer = &vr_gpu_timer;
+
+	if (timer->initialized) {
+		if (timer->context != GPU_context_active_get()) {
+			timer->free_pending = 1;
+			return;
+		}
+		glDeleteQueries(VR_GPU_TIMER_FRAMES * VR_SIDES * 2, &timer->queries[0][0][0]);
+	}
+	memset(timer, 0, sizeof(*timer));
+}
+
+/* Issue the start / end timestamp query of a bound view. */
+static void vr_gpu_timer_query(int view, int end)
+{
+	VR_GpuTimer *timer = &vr_gpu_timer;
+
+	if (!GLEW_ARB_timer_query) {
+		return;
+	}
+	GPUContext *context = GPU_context_active_get();
+	if (timer->initialized && timer->context != context) {
+		/* The queries belong to another context (i.e. the window was recreated)
+		 * and can't be deleted from this one: start over. */
+		memset(timer, 0, sizeof(*timer));
+	}
+	else if (timer->free_pending) {
+		vr_gpu_timer_free();
+	}
+	if (!timer->initialized) {
+		glGenQueries(VR_GPU_TIMER_FRAMES * VR_SIDES * 2, &timer->queries[0][0][0]);
+		timer->initialized = 1;
+		timer->context = context;
+	}
+	if (!end && timer->frame_done) {
+		vr_gpu_timer_frame_begin();
+	}
+
+	glQueryCounter(timer->queries[timer->slot][view][end], GL_TIMESTAMP);
+	if (end) {
+		timer->issued[timer->slot] |= (1 << view);
+	}
+}
+
 int vr_init(bContext *C)
 {
   memset(&vr, 0, sizeof(vr));
@@ -573,7 +1063,13 @@ int vr_init(bContext *C)
   int type;
   int autodetect = (U.vr_device == 0);
 
-  if (U.vr_openxr) {
+  const char *replay_path = getenv(VR_REPLAY_ENV_FILE);
+  if (replay_path && replay_path[0]) {
+    /* Replay a recorded session (headless benchmarks). */
+    type = VR_TYPE_REPLAY;
+    autodetect = 0;
+  }
+  else if (U.vr_openxr) {
     switch ((VR_Device_Type)U.vr_device) {
     case VR_DEVICE_TYPE_MAGICLEAP: {
       type = VR_TYPE_MAGICLEAP;
@@ -631,6 +1127,8 @@ int vr_init(bContext *C)
       vr_api_get_params_remote();
       vr.aperture_u = 1.0f;
       vr.aperture_v = 1.0f;
+      vr_render_scale_init();
+      vr_foveation_init();
       vr.clip_sta = VR_CLIP_NEAR;
       vr.clip_end = VR_CLIP_FAR;
       vr_api_get_transforms_remote();
@@ -670,14 +1168,21 @@ int vr_init(bContext *C)
         vr_dll_get_default_eye_tex_size(&vr.tex_width, &vr.tex_height, 0);
         vr.aperture_u = 1.0f;
         vr.aperture_v = 1.0f;
+        vr_render_scale_init();
+        vr_foveation_init();
         vr.clip_sta = VR_CLIP_NEAR;
         vr.clip_end = VR_CLIP_FAR;
         vr_dll_get_eye_positions(vr.t_eye[VR_SPACE_REAL]);
         vr_dll_get_hmd_position(vr.t_hmd[VR_SPACE_REAL]);
         vr_dll_get_controller_positions(vr.t_controller[VR_SPACE_REAL]);
+        copy_m4_m4(vr.t_hmd_rendered, vr.t_hmd[VR_SPACE_REAL]);
 
         vr.ctx = C;
         vr.initialized = 1;
+
+#if VR_POSE_PREDICTION_LOG
+        vr_set_pose_prediction_hook(vr_pose_prediction_log, NULL);
+#endif
       }
       else {
         vr_dll_uninit_vr();
@@ -742,6 +1247,11 @@ int vr_init_ui(void)
       vr_dll_get_controller_states(vr.controller);
     } 
 		vr.ui_initialized = 1;
+
+		const char *record_path = getenv(VR_RECORD_ENV_FILE);
+		if (record_path && record_path[0] && vr.type != VR_TYPE_REPLAY) {
+			vr_record_begin(record_path);
+		}
 	}
 
 	if (!vr.ui_initialized) {
@@ -757,6 +1267,19 @@ int vr_uninit(void)
 {
 	BLI_assert(vr.initialized);
 
+#if VR_TIMING_TRACE
+	char timing_path[FILE_MAX];
+	BLI_join_dirfile(timing_path, sizeof(timing_path), BKE_tempdir_base(), "vr_timing.json");
+	if (vr_timing_dump(timing_path) == 0) {
+		printf("VR frame timings written to %s\n", timing_path);
+	}
+#endif
+
+	if (vr_record_file) {
+		const int frames = vr_record_end();
+		printf("VR session recording finished (%d frames).\n", frames);
+	}
+
 	if (vr.ui_initialized) {
 		vr_api_uninit_ui();
 		/* Free controller structs. */
@@ -848,9 +1371,31 @@ void vr_free_viewports(ARegion *ar)
 		MEM_freeN(ar->draw_buffer);
 		ar->draw_buffer = NULL;
 	}
+
+	vr_stream_readback_free();
+	vr_foveation_free();
+	vr_gpu_timer_free();
+}
+
+/* Size (in pixels) of the eye image as a whole at the resolution of the current pass. */
+static void vr_draw_pass_resolution(int *r_width, int *r_height)
+{
+	const float scale = (vr.draw_pass == VR_DRAW_PASS_PERIPHERY) ? VR_FOVEATION_PERIPHERY_SCALE : 1.0f;
+	*r_width = max_ii(1, (int)(vr.render_width * scale + 0.5f));
+	*r_height = max_ii(1, (int)(vr.render_height * scale + 0.5f));
 }
 
 void vr_draw_region_bind(ARegion *ar, int side)
+{
+	vr_draw_region_bind_pass(ar, side, 0);
+}
+
+int vr_draw_region_passes(void)
+{
+	return vr.foveation ? 2 : 1;
+}
+
+void vr_draw_region_bind_pass(ARegion *ar, int side, int pass)
 {
 	BLI_assert(vr.initialized);
 
@@ -858,14 +1403,50 @@ void vr_draw_region_bind(ARegion *ar, int side)
 		return;
 	}
 
-	/* Render with VR dimensions, regardless of window size. */
+	/* Foveated rendering: the inset first, so that the VR UI keeps the projection of the whole image. */
+	if (vr.foveation) {
+		vr.draw_pass = (pass == 0) ? VR_DRAW_PASS_INSET : VR_DRAW_PASS_PERIPHERY;
+	}
+	else {
+		vr.draw_pass = VR_DRAW_PASS_FULL;
+	}
+
+	/* Render with VR dimensions (scaled by the render scale), regardless of window size.
+	 * The viewport buffers are reallocated when the size changes, and the blit to the HMD
+	 * stretches them over the eye textures. */
+	int width, height;
+	vr_draw_pass_resolution(&width, &height);
+
+	GPUViewport *viewport = vr.viewport[side];
+	if (vr.draw_pass == VR_DRAW_PASS_INSET) {
+		vr_foveation_inset_update(side);
+		const float *inset = vr.foveation_inset[side];
+		width = max_ii(1, (int)((inset[2] - inset[0]) * width + 0.5f));
+		height = max_ii(1, (int)((inset[3] - inset[1]) * height + 0.5f));
+
+		if (!vr.viewport_inset[side]) {
+			vr.viewport_inset[side] = GPU_viewport_create();
+		}
+		/* The draw manager draws into the viewport of the bound view. */
+		viewport = ar->draw_buffer->viewport[side] = vr.viewport_inset[side];
+	}
+
 	rcti rect;
 	rect.xmin = 0;
-	rect.xmax = vr.tex_width;
+	rect.xmax = width;
 	rect.ymin = 0;
-	rect.ymax = vr.tex_height;
+	rect.ymax = height;
 
-	GPU_viewport_bind(vr.viewport[side], &rect);
+	if (vr.single_pass && vr.viewport[VR_SIDE_LEFT]) {
+		/* The right eye is drawn into the left eye's buffers, which have to match in size. */
+		GPU_viewport_bind(vr.viewport[VR_SIDE_LEFT], &rect);
+		GPU_viewport_unbind(vr.viewport[VR_SIDE_LEFT]);
+	}
+
+	GPU_viewport_bind(viewport, &rect);
+	if (pass == 0) {
+		vr_gpu_timer_query(side, 0);
+	}
 
 	ar->draw_buffer->bound_view = side;
 }
@@ -880,7 +1461,258 @@ void vr_draw_region_unbind(ARegion *ar, int side)
 
 	ar->draw_buffer->bound_view = -1;
 
+	if (vr.draw_pass == VR_DRAW_PASS_INSET) {
+		ar->draw_buffer->viewport[side] = vr.viewport[side];
+		GPU_viewport_unbind(vr.viewport_inset[side]);
+		return;
+	}
+	if (vr.draw_pass == VR_DRAW_PASS_PERIPHERY) {
+		vr_foveation_composite(side);
+	}
+
+	vr_gpu_timer_query(side, 1);
 	GPU_viewport_unbind(vr.viewport[side]);
+	vr.draw_pass = VR_DRAW_PASS_FULL;
+}
+
+int vr_draw_region_single_pass_supported(const View3D *v3d)
+{
+	/* EEVEE, external engines and workbench TAA accumulate samples over redraws
+	 * in per-viewport buffers, which can't be shared between the eyes.
+	 * Workbench shadows are culled for the view the caches are populated from.
+	 * Foveated rendering draws every eye in two passes. */
+	if (v3d->shading.type > OB_SOLID || vr.foveation) {
+		return 0;
+	}
+	if (U.viewport_aa > SCE_DISPLAY_AA_FXAA) {
+		return 0;
+	}
+	if (v3d->shading.type == OB_SOLID && (v3d->shading.flag & V3D_SHADING_SHADOW)) {
+		return 0;
+	}
+	return 1;
+}
+
+static int vr_stream_readback_init(int width, int height)
+{
+	char err_out[256] = "unknown error";
+
+	vr_stream.offscreen = GPU_offscreen_create(width, height * VR_SIDES, 0, false, false, err_out);
+	if (!vr_stream.offscreen) {
+		printf("vr_stream_readback_init() : Could not create offscreen buffer (%s).", err_out);
+		return -1;
+	}
+	vr_stream.shader = GPU_shader_create(vr_stream_vert_glsl, vr_stream_frag_glsl, NULL, NULL, NULL, "vr_stream");
+	if (!vr_stream.shader) {
+		printf("vr_stream_readback_init() : Could not create shader.");
+		vr_stream_readback_free();
+		return -1;
+	}
+
+	glGenBuffers(VR_STREAM_READBACK_COUNT, vr_stream.pbo);
+	for (int i = 0; i < VR_STREAM_READBACK_COUNT; ++i) {
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, vr_stream.pbo[i]);
+		glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4 * VR_SIDES, NULL, GL_STREAM_READ);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	vr_stream.width = width;
+	vr_stream.height = height;
+	vr_stream.queued = vr_stream.fetched = 0;
+
+	return 0;
+}
+
+void vr_stream_readback_free(void)
+{
+	for (int i = 0; i < VR_STREAM_READBACK_COUNT; ++i) {
+		if (vr_stream.fence[i]) {
+			glDeleteSync(vr_stream.fence[i]);
+		}
+	}
+	if (vr_stream.pbo[0]) {
+		glDeleteBuffers(VR_STREAM_READBACK_COUNT, vr_stream.pbo);
+	}
+	if (vr_stream.shader) {
+		GPU_shader_free(vr_stream.shader);
+	}
+	if (vr_stream.offscreen) {
+		GPU_offscreen_free(vr_stream.offscreen);
+	}
+	memset(&vr_stream, 0, sizeof(vr_stream));
+}
+
+int vr_stream_readback_queue(int width, int height, int depth_to_alpha)
+{
+	BLI_assert(vr.initialized);
+
+	GPUTexture *color_tex[VR_SIDES];
+	GPUTexture *depth_tex[VR_SIDES];
+	for (int side = 0; side < VR_SIDES; ++side) {
+		GPUViewport *viewport = vr.viewport[side];
+		if (!viewport || !viewport->fbl->default_fb) {
+			return -1;
+		}
+		color_tex[side] = viewport->txl->color;
+		depth_tex[side] = viewport->txl->depth;
+		if (!color_tex[side] || !depth_tex[side]) {
+			return -1;
+		}
+	}
+
+	if (vr_stream.width != width || vr_stream.height != height) {
+		vr_stream_readback_free();
+		if (vr_stream_readback_init(width, height) != 0) {
+			return -1;
+		}
+	}
+	if (vr_stream.queued - vr_stream.fetched >= VR_STREAM_READBACK_COUNT) {
+		/* All readback buffers are in flight. */
+		return 1;
+	}
+
+	/* Downscale both eyes into the stream buffer. */
+	GPU_offscreen_bind(vr_stream.offscreen, true);
+	GPU_blend(false);
+	GPU_depth_test(false);
+
+	GPUShader *shader = vr_stream.shader;
+	GPU_shader_bind(shader);
+	glUniform1i(GPU_shader_get_uniform_ensure(shader, "colortex"), 0);
+	glUniform1i(GPU_shader_get_uniform_ensure(shader, "depthtex"), 1);
+	glUniform1i(GPU_shader_get_uniform_ensure(shader, "depth_to_alpha"), depth_to_alpha);
+	for (int side = 0; side < VR_SIDES; ++side) {
+		glViewport(0, side * height, width, height);
+		GPU_texture_bind(color_tex[side], 0);
+		GPU_texture_bind(depth_tex[side], 1);
+		GPU_draw_primitive(GPU_PRIM_TRI_STRIP, 4);
+		GPU_texture_unbind(depth_tex[side]);
+		GPU_texture_unbind(color_tex[side]);
+	}
+	GPU_shader_unbind();
+
+	/* Start the asynchronous readback. Both eyes end up contiguous in the buffer
+	 * (left eye first), since the left eye was drawn into the lower half. */
+	const unsigned int slot = vr_stream.queued % VR_STREAM_READBACK_COUNT;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, vr_stream.pbo[slot]);
+	glReadPixels(0, 0, width, height * VR_SIDES, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	vr_stream.fence[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	GPU_offscreen_unbind(vr_stream.offscreen, true);
+
+	/* Submit now, so the fence can signal without waiting for the next flush. */
+	glFlush();
+	++vr_stream.queued;
+
+	return 0;
+}
+
+int vr_stream_readback_fetch(unsigned char *pixels_left, unsigned char *pixels_right)
+{
+	if (vr_stream.queued == vr_stream.fetched) {
+		return -1;
+	}
+
+	const unsigned int slot = vr_stream.fetched % VR_STREAM_READBACK_COUNT;
+	GLenum status = glClientWaitSync(vr_stream.fence[slot], 0, 0);
+	if (status == GL_TIMEOUT_EXPIRED) {
+		/* Not finished yet (don't stall). */
+		return -1;
+	}
+	glDeleteSync(vr_stream.fence[slot]);
+	vr_stream.fence[slot] = NULL;
+	++vr_stream.fetched;
+	if (status == GL_WAIT_FAILED) {
+		return -1;
+	}
+
+	const size_t size = (size_t)vr_stream.width * vr_stream.height * 4;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, vr_stream.pbo[slot]);
+	const unsigned char *data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)size * VR_SIDES, GL_MAP_READ_BIT);
+	if (data) {
+		memcpy(pixels_left, data, size);
+		memcpy(pixels_right, data + size, size);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	return data ? 0 : -1;
+}
+
+int vr_record_begin(const char *filepath)
+{
+	BLI_assert(vr.initialized);
+
+	if (vr_record_file) {
+		vr_record_end();
+	}
+
+	FILE *file = BLI_fopen(filepath, "wb");
+	if (!file) {
+		printf("vr_record_begin() : Could not open %s for writing.\n", filepath);
+		return -1;
+	}
+
+	/* Header: magic, version, HMD type, eye texture size, eye parameters. */
+	const unsigned int header[4] = { VR_RECORD_VERSION, (unsigned int)vr.device_type, (unsigned int)vr.tex_width, (unsigned int)vr.tex_height };
+	float eye_params[VR_SIDES][4];
+	for (int side = 0; side < VR_SIDES; ++side) {
+		eye_params[side][0] = vr.fx[side];
+		eye_params[side][1] = vr.fy[side];
+		eye_params[side][2] = vr.cx[side];
+		eye_params[side][3] = vr.cy[side];
+	}
+	fwrite(VR_RECORD_MAGIC, 4, 1, file);
+	fwrite(header, sizeof(header), 1, file);
+	fwrite(eye_params, sizeof(eye_params), 1, file);
+
+	vr_record_file = file;
+	vr_record_frames = 0;
+
+	return 0;
+}
+
+/* Append the current (real-world) tracking and controller states to the recording. */
+static void vr_record_frame(void)
+{
+	FILE *file = vr_record_file;
+
+	unsigned char controller_mask = 0;
+	for (int i = 0; i < VR_MAX_CONTROLLERS; ++i) {
+		if (vr.controller[i] && vr.controller[i]->available) {
+			controller_mask |= (1 << i);
+		}
+	}
+
+	fwrite(vr.t_hmd[VR_SPACE_REAL], sizeof(float[4][4]), 1, file);
+	fwrite(vr.t_eye[VR_SPACE_REAL], sizeof(float[VR_SIDES][4][4]), 1, file);
+	fwrite(&controller_mask, sizeof(controller_mask), 1, file);
+	for (int i = 0; i < VR_MAX_CONTROLLERS; ++i) {
+		if (!(controller_mask & (1 << i))) {
+			continue;
+		}
+		const VR_Controller *c = vr.controller[i];
+		const float analog[6] = { c->dpad[0], c->dpad[1], c->stick[0], c->stick[1], c->trigger_pressure, c->grip_pressure };
+		fwrite(vr.t_controller[VR_SPACE_REAL][i], sizeof(float[4][4]), 1, file);
+		fwrite(&c->buttons, sizeof(c->buttons), 1, file);
+		fwrite(&c->buttons_touched, sizeof(c->buttons_touched), 1, file);
+		fwrite(analog, sizeof(analog), 1, file);
+	}
+
+	++vr_record_frames;
+}
+
+int vr_record_end(void)
+{
+	if (!vr_record_file) {
+		return -1;
+	}
+
+	fclose(vr_record_file);
+	vr_record_file = NULL;
+
+	return vr_record_frames;
 }
 
 int vr_update_tracking(void)
@@ -889,15 +1721,29 @@ int vr_update_tracking(void)
 
   int error;
 
+  /* Tracking update marks the start of a new VR frame. */
+  vr_api_timing_begin_frame();
+  const double timing_start = vr_api_timing_now();
+
   if (vr.type == VR_TYPE_MAGICLEAP) {
     vr_api_get_transforms_remote();
   }
   else {
     error = vr_dll_update_tracking_vr();
 
+    /* Compare the HMD position the last frame was rendered with to the measured one. */
+    if (vr_pose_prediction_hook && vr_dll_get_actual_hmd_position && !error) {
+      float t_actual[4][4];
+      if (vr_dll_get_actual_hmd_position(t_actual) == 0) {
+        vr_pose_prediction_hook(vr.t_hmd_rendered, t_actual, vr_pose_prediction_hook_userdata);
+      }
+    }
+
     /* Get hmd and eye positions. */
     vr_dll_get_hmd_position(vr.t_hmd[VR_SPACE_REAL]);
     vr_dll_get_eye_positions(vr.t_eye[VR_SPACE_REAL]);
+    copy_m4_m4(vr.t_hmd_rendered, vr.t_hmd[VR_SPACE_REAL]);
+    vr.tracking_latched = 0;
 
     /* Get controller positions. */
     vr_dll_get_controller_positions(vr.t_controller[VR_SPACE_REAL]);
@@ -912,10 +1758,16 @@ int vr_update_tracking(void)
       vr_dll_get_controller_states(vr.controller);
     }
 
+		if (vr_record_file) {
+			vr_record_frame();
+		}
+
 		/* Update the UI. */
 		error = vr_api_update_tracking_ui();
 	}
 
+	vr_api_timing_record(VR_TIMING_TRACKING, 0, timing_start);
+
 	if (error) {
 		vr.tracking = 0;
 	}
@@ -926,23 +1778,100 @@ int vr_update_tracking(void)
 	return error;
 }
 
+int vr_latch_tracking(void)
+{
+	BLI_assert(vr.initialized);
+
+	if (vr.type == VR_TYPE_MAGICLEAP || vr.tracking_latched || !vr.tracking || !vr_dll_latch_tracking_vr) {
+		return -1;
+	}
+	/* Only try once per frame. */
+	vr.tracking_latched = 1;
+
+	if (vr_dll_latch_tracking_vr()) {
+		return -1;
+	}
+
+	/* Only the eyes (and so the view matrices) are updated.
+	 * The UI keeps the HMD position from vr_update_tracking() for this frame. */
+	vr_dll_get_eye_positions(vr.t_eye[VR_SPACE_REAL]);
+	vr_dll_get_hmd_position(vr.t_hmd_rendered);
+
+	return 0;
+}
+
+void vr_set_pose_prediction_hook(VR_PosePredictionHook hook, void *userdata)
+{
+	vr_pose_prediction_hook = hook;
+	vr_pose_prediction_hook_userdata = userdata;
+}
+
+void vr_pose_prediction_log(const float t_predicted[4][4], const float t_actual[4][4], void *UNUSED(userdata))
+{
+	static int frames = 0;
+	static float sum_dist = 0.0f, max_dist = 0.0f;
+	static float sum_angle = 0.0f, max_angle = 0.0f;
+
+	float q_predicted[4], q_actual[4];
+	mat4_to_quat(q_predicted, t_predicted);
+	mat4_to_quat(q_actual, t_actual);
+	float angle = angle_normalized_qtqt(q_predicted, q_actual);
+	if (angle > (float)M_PI) {
+		angle = 2.0f * (float)M_PI - angle;
+	}
+	/* Real-world space is in meters. */
+	const float dist = len_v3v3(t_predicted[3], t_actual[3]) * 1000.0f;
+
+	sum_dist += dist;
+	max_dist = max_ff(max_dist, dist);
+	sum_angle += angle;
+	max_angle = max_ff(max_angle, angle);
+
+	if (++frames == VR_POSE_PREDICTION_LOG_FRAMES) {
+		printf("VR pose prediction error (%d frames): translation mean %.2f mm, max %.2f mm; rotation mean %.3f deg, max %.3f deg\n",
+		       frames,
+		       sum_dist / frames, max_dist,
+		       RAD2DEGF(sum_angle / frames), RAD2DEGF(max_angle));
+		frames = 0;
+		sum_dist = max_dist = 0.0f;
+		sum_angle = max_angle = 0.0f;
+	}
+}
+
 int vr_blit(void)
 {
 	BLI_assert(vr.initialized);
 
+	/* The next bind starts a new frame of GPU time measurement. */
+	vr_gpu_timer.frame_done = 1;
+
   if (vr.type == VR_TYPE_MAGICLEAP) {
     return 0;
   }
 
 	int error;
+	const double timing_start = vr_api_timing_now();
 
 #if WITH_VR
-	vr_dll_blit_eyes((void*)(&(vr.viewport[VR_SIDE_LEFT]->fbl->default_fb->attachments[2].tex->bindcode)),
-			     	 (void*)(&(vr.viewport[VR_SIDE_RIGHT]->fbl->default_fb->attachments[2].tex->bindcode)),
-					 &vr.aperture_u, &vr.aperture_v);
+	if (vr.foveation && vr.foveated[VR_SIDE_LEFT] && vr.foveated[VR_SIDE_RIGHT]) {
+		/* Foveated rendering: blit the composited images. */
+		GLuint bindcode[VR_SIDES];
+		for (int side = 0; side < VR_SIDES; ++side) {
+			bindcode[side] = GPU_texture_opengl_bindcode(GPU_offscreen_color_texture(vr.foveated[side]));
+		}
+		vr_dll_blit_eyes((void*)&bindcode[VR_SIDE_LEFT], (void*)&bindcode[VR_SIDE_RIGHT],
+						 &vr.aperture_u, &vr.aperture_v);
+	}
+	else {
+		vr_dll_blit_eyes((void*)(&(vr.viewport[VR_SIDE_LEFT]->fbl->default_fb->attachments[2].tex->bindcode)),
+						 (void*)(&(vr.viewport[VR_SIDE_RIGHT]->fbl->default_fb->attachments[2].tex->bindcode)),
+						 &vr.aperture_u, &vr.aperture_v);
+	}
 #endif
 	error = vr_dll_submit_frame();
 
+	vr_api_timing_record(VR_TIMING_BLIT, 0, timing_start);
+
 	return error;
 }
 
@@ -959,11 +1888,20 @@ void vr_post_scene_render(int side)
 	vr_api_post_render(side);
 }
 
+int vr_draw_annotations(struct bGPdata *gpd, int cfra)
+{
+	BLI_assert(vr.ui_initialized);
+
+	return vr_api_draw_annotations(gpd, cfra);
+}
+
 void vr_do_interaction(void)
 {
 	BLI_assert(vr.ui_initialized);
 
+	const double timing_start = vr_api_timing_now();
 	vr_api_execute_operations();
+	vr_api_timing_record(VR_TIMING_OPERATIONS, 0, timing_start);
 }
 
 void vr_do_post_render_interaction(void)
@@ -1039,22 +1977,26 @@ void vr_compute_viewplane(const View3D *v3d, CameraParams *params, int winx, int
 		pixsize = (sensor_size * params->clip_start) / params->lens;
 	}
 
+	/* Pixel size at the resolution of the current pass. */
+	int res_width, res_height;
+	vr_draw_pass_resolution(&res_width, &res_height);
+
 	switch (params->sensor_fit) {
 		case CAMERA_SENSOR_FIT_AUTO: {
-			if (xasp * vr.tex_width >= yasp *vr.tex_height) {
-				viewfac = vr.tex_width;
+			if (xasp * res_width >= yasp * res_height) {
+				viewfac = res_width;
 			}
 			else {
-				viewfac = params->ycor * vr.tex_height;
+				viewfac = params->ycor * res_height;
 			}
 			break;
 		}
 		case CAMERA_SENSOR_FIT_HOR: {
-			viewfac = vr.tex_width;
+			viewfac = res_width;
 			break;
 		}
 		case CAMERA_SENSOR_FIT_VERT: {
-			viewfac = params->ycor * vr.tex_height;
+			viewfac = params->ycor * res_height;
 			break;
 		}
 	}
@@ -1067,13 +2009,13 @@ void vr_compute_viewplane(const View3D *v3d, CameraParams *params, int winx, int
 	params->offsetx = (vr.cx[side] - 0.5f)*2.0f * xasp;
 	params->offsety = (vr.cy[side] - 0.5f)*2.0f * yasp;
 
-	dx = params->shiftx * viewfac + vr.tex_width * params->offsetx;
-	dy = params->shifty * viewfac + vr.tex_height * params->offsety;
+	dx = params->shiftx * viewfac + res_width * params->offsetx;
+	dy = params->shifty * viewfac + res_height * params->offsety;
 
 	/* Compute view plane:
      * centered and at distance 1.0: */
-	float res_x = (float)vr.tex_width;
-	float res_y = (float)vr.tex_height;
+	float res_x = (float)res_width;
+	float res_y = (float)res_height;
 	float pfx = vr.fx[side] * res_x;
 	float pfy = vr.fy[side] * res_y;
 	float pcx = vr.cx[side] * res_x;
@@ -1083,6 +2025,15 @@ void vr_compute_viewplane(const View3D *v3d, CameraParams *params, int winx, int
 	viewplane.ymax = ((res_y - pcy) / pfy) * params->clip_start;
 	viewplane.ymin = (-pcy / pfy) * params->clip_start;
 
+	if (vr.draw_pass == VR_DRAW_PASS_INSET) {
+		/* Foveated rendering: only the part of the view plane covered by the inset. */
+		const float *inset = vr.foveation_inset[side];
+		viewplane.xmin = ((inset[0] - vr.cx[side]) / vr.fx[side]) * params->clip_start;
+		viewplane.xmax = ((inset[2] - vr.cx[side]) / vr.fx[side]) * params->clip_start;
+		viewplane.ymin = ((inset[1] - (1.0f - vr.cy[side])) / vr.fy[side]) * params->clip_start;
+		viewplane.ymax = ((inset[3] - (1.0f - vr.cy[side])) / vr.fy[side]) * params->clip_start;
+	}
+
 	/* Used for rendering (offset by near-clip with perspective views), passed to RE_SetPixelSize.
 	 * For viewport drawing 'RegionView3D.pixsize'. */
 	params->viewdx = pixsize;
@@ -1118,6 +2069,21 @@ void vr_compute_viewplane(const View3D *v3d, CameraParams *params, int winx, int
 	}
 }
 
+double vr_timing_now(void)
+{
+	return vr_api_timing_now();
+}
+
+void vr_timing_record(VR_TimingStage stage, int index, double start)
+{
+	vr_api_timing_record(stage, index, start);
+}
+
+int vr_timing_dump(const char *filepath)
+{
+	return vr_api_timing_dump(filepath);
+}
+
 void vr_compute_viewmat(int side, float viewmat_out[4][4])
 {
 	BLI_assert(vr.initialized);
@@ -31,6 +31,8 @@
 #include "vr_main.h"
 
 #include "vr_network.h"
+#include "vr_resample.h"
+#include "vr_timing.h"
 
 #include "BLI_math.h"
 
@@ -66,9 +68,6 @@
 #endif
 #include <ctime>
 
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include "stb_image_write.h"
-
 /***************************************************************************************************
  * \class										VR_Network
  ***************************************************************************************************
@@ -80,10 +79,8 @@
 char VR_Network::control_sequence[] = { (char)-1, (char)0, (char)-1, (char)0 };
 bool VR_Network::initialized(false);
 std::atomic<bool> VR_Network::data_new;
-std::atomic<bool> VR_Network::img_processed;
 
 char VR_Network::recv_buf[VR_NETWORK_RECV_BUF_SIZE] = { 0 };
-char VR_Network::send_buf[VR_NETWORK_SEND_BUF_SIZE] = { 0 };
 
 VR_Network::NetworkStatus VR_Network::network_status(NETWORKSTATUS_INACTIVE);
 
@@ -94,7 +91,18 @@ void *VR_Network::img_thread(0);
 VR_Network::Thread::Runlevel VR_Network::img_runlvl;
 VR_Network::Thread::Condition VR_Network::img_condition;
 
-VR_Network::ImageData VR_Network::image_data[VR_SIDES];
+VR_Network::FrameSlot VR_Network::frame_slots[VR_NETWORK_FRAME_SLOTS];
+std::atomic<uint> VR_Network::frame_ready;
+uint VR_Network::frame_back(0);
+uint VR_Network::frame_front(0);
+
+VR_Network::Packet VR_Network::packets[VR_NETWORK_PACKET_SLOTS];
+uint VR_Network::packet_buf_size(0);
+std::atomic<uint> VR_Network::packet_head;
+std::atomic<uint> VR_Network::packet_tail;
+std::atomic<uint> VR_Network::stream_generation;
+
+VR_Codec VR_Network::codec[VR_SIDES];
 
 std::vector<VR_Network::NetworkAdapter> VR_Network::network_adapters;
 
@@ -184,80 +192,140 @@ bool VR_Network::update_network_adapters()
 
 bool VR_Network::set_image_size(uint width, uint height, uint depth)
 {
-	if (width == 0 || height == 0 || depth == 0) {
+	if (width == 0 || height == 0 || depth != VR_CODEC_DEPTH) {
 		return false;
 	}
 
 	VR_Network::condition.enter();
 
-	/* Allocate bitmap buffer */
+	/* Allocate bitmap buffers */
+	for (int slot = 0; slot < VR_NETWORK_FRAME_SLOTS; ++slot) {
+		for (int i = 0; i < VR_SIDES; ++i) {
+			ImageData& data = VR_Network::frame_slots[slot].image[i];
+			data.w = width;
+			data.h = height;
+			data.d = depth;
+			if (data.buf) {
+				free(data.buf);
+			}
+			data.buf = (uchar*)malloc(width * height * depth);
+			if (!data.buf) {
+				data.w = data.h = data.d = 0;
+				VR_Network::condition.leave_silent();
+				return false;
+			}
+		}
+	}
 	for (int i = 0; i < VR_SIDES; ++i) {
-		ImageData& data = VR_Network::image_data[i];
-		data.w = width;
-		data.h = height;
-		data.d = depth;
-		if (data.buf) {
-			free(data.buf);
+		if (!VR_Network::codec[i].init(width, height)) {
+			VR_Network::condition.leave_silent();
+			return false;
 		}
-		data.compressed_size = 0;
-		data.buf = (uchar*)malloc(width * height * depth);
-		if (!data.buf) {
-			data.w = data.h = data.d = 0;
+	}
+
+	/* Allocate packet buffers (encoded left and right images) */
+	VR_Network::packet_buf_size = VR_Network::codec[VR_SIDE_LEFT].max_encoded_size() +
+								  VR_Network::codec[VR_SIDE_RIGHT].max_encoded_size();
+	for (int slot = 0; slot < VR_NETWORK_PACKET_SLOTS; ++slot) {
+		Packet& packet = VR_Network::packets[slot];
+		if (packet.buf) {
+			free(packet.buf);
+		}
+		packet.size[VR_SIDE_LEFT] = packet.size[VR_SIDE_RIGHT] = 0;
+		packet.buf = (uchar*)malloc(VR_Network::packet_buf_size);
+		if (!packet.buf) {
+			VR_Network::packet_buf_size = 0;
 			VR_Network::condition.leave_silent();
 			return false;
 		}
 	}
 
+	/* Initial slot ownership: render thread, published (not fresh), image thread. */
+	VR_Network::frame_back = 0;
+	VR_Network::frame_ready = 1;
+	VR_Network::frame_front = 2;
+	VR_Network::packet_head = 0;
+	VR_Network::packet_tail = 0;
+
 	VR_Network::condition.leave_silent();
 	return true;
 }
 
+void VR_Network::reset_stream()
+{
+	/* Packets encoded for the previous client will be discarded by next_packet()
+	 * and the image thread will restart with a key frame. */
+	++VR_Network::stream_generation;
+}
+
+VR_Network::ImageData *VR_Network::begin_frame()
+{
+	return VR_Network::frame_slots[VR_Network::frame_back].image;
+}
+
+void VR_Network::publish_frame()
+{
+	/* Swap the back slot with the ready slot. If the previous frame was not
+	 * acquired yet it is simply replaced: the image thread always gets the latest. */
+	uint ready = VR_Network::frame_ready.exchange(VR_Network::frame_back | VR_NETWORK_FRAME_FRESH);
+	VR_Network::frame_back = ready & ~VR_NETWORK_FRAME_FRESH;
+
+	/* Wake the image thread. */
+	VR_Network::img_condition.enter();
+	VR_Network::img_condition.leave_signal();
+}
+
+bool VR_Network::frame_pending()
+{
+	return (VR_Network::frame_ready & VR_NETWORK_FRAME_FRESH) != 0;
+}
+
+bool VR_Network::acquire_frame()
+{
+	if (!VR_Network::frame_pending()) {
+		return false;
+	}
+	/* Only the render thread sets the fresh flag, so the exchange can't lose a frame. */
+	uint ready = VR_Network::frame_ready.exchange(VR_Network::frame_front);
+	VR_Network::frame_front = ready & ~VR_NETWORK_FRAME_FRESH;
+	return true;
+}
+
+VR_Network::Packet *VR_Network::next_packet()
+{
+	const uint generation = VR_Network::stream_generation;
+	uint tail = VR_Network::packet_tail;
+	while (tail != VR_Network::packet_head) {
+		Packet& packet = VR_Network::packets[tail % VR_NETWORK_PACKET_SLOTS];
+		if (packet.generation == generation) {
+			return &packet;
+		}
+		/* Encoded for a previous client: discard. */
+		VR_Network::packet_tail = ++tail;
+	}
+	return NULL;
+}
+
+void VR_Network::release_packet()
+{
+	++VR_Network::packet_tail;
+
+	/* Wake the image thread (it may be waiting for a free packet slot). */
+	VR_Network::img_condition.enter();
+	VR_Network::img_condition.leave_signal();
+}
+
 bool VR_Network::resample_pixels(const uchar *pixels, uint w_old, uint h_old,
 											  uchar *pixels_new, uint w_new, uint h_new, uint depth,
 											  const uint *depth_buffer)
 {
-	if (!pixels || !pixels_new) {
+	if (depth != VR_CODEC_DEPTH) {
 		return false;
 	}
 
 	/* Set alpha channel (used for alpha blend) based on depth buffer
 	 * to remove viewport background for see-through displays. */
-	bool depth_to_alpha = depth_buffer ? true : false;
-	uchar *depth_buffer_u8 = depth_buffer ? (uchar*)depth_buffer : NULL;
-
-	int size_old = (int)(w_old * h_old * depth);
-	float w_scale = (float)w_new / (float)w_old;
-	float h_scale = (float)h_new / (float)h_old;
-#pragma omp parallel for
-	for (int y = 0; y < (int)h_new; ++y) {
-		for (int x = 0; x < (int)w_new; ++x) {
-			/* NOTE: Vertical flip */
-			int pixel = (y * (w_new * depth) + ((w_new - x) * depth)) - depth;
-			int closest_pixel = ((int)((float)y / h_scale) * (w_old * depth)) + ((int)((float)x / w_scale) * depth);
-			/* NOTE: Horizontal flip */
-			/* RGBA */
-			int offset = (size_old - 1) - closest_pixel;
-			pixels_new[pixel] = pixels[offset + 1];
-			pixels_new[pixel + 1] = pixels[offset + 2];
-			pixels_new[pixel + 2] = pixels[offset + 3];
-			if (depth_to_alpha) {
-				/* Depth buffer is in <depth 24, stencil 8> format */
-				uint d_u32 = *(uint*)(&depth_buffer_u8[offset]);
-				float d = (d_u32 >> 8) / 16777215.0f;
-				if (d == 1.0f) { //|| d < VR_CLIP_NEAR || d > VR_CLIP_FAR) {
-					pixels_new[pixel + 3] = 0;
-				}
-				else {
-					pixels_new[pixel + 3] = 255;
-				}
-			}
-			else {
-				pixels_new[pixel + 3] = 255;
-			}
-		}
-	}
-
-	return true;
+	return VR_Resample::downsample(pixels, w_old, h_old, pixels_new, w_new, h_new, depth_buffer);
 }
 
 bool VR_Network::start()
@@ -265,13 +333,14 @@ bool VR_Network::start()
 	if (!VR_Network::thread) {
 		VR_Network::initialized = false;
 		VR_Network::data_new = false;
-		VR_Network::img_processed = false;
 
 		/* Intialize image data. */
-		if (!VR_Network::set_image_size(320, 240, 4)) { //480, 360, 4)) { //640, 480, 4)) { //1280, 960, 4)) {
+		if (!VR_Network::set_image_size(VR_NETWORK_IMAGE_WIDTH, VR_NETWORK_IMAGE_HEIGHT, VR_CODEC_DEPTH)) {
 			return false;
 		}
-		VR_Network::image_data[0].quality = VR_Network::image_data[1].quality = 100;
+		for (int i = 0; i < VR_SIDES; ++i) {
+			VR_Network::codec[i].quant_bits = VR_NETWORK_IMAGE_QUANT_BITS;
+		}
 
 		VR_Network::runlvl = Thread::RUNLEVEL_UNSTARTED;
 #ifdef WIN32
@@ -506,23 +575,16 @@ bool VR_Network::receive_data(int& socket)
 #endif
 
 #ifdef WIN32
-bool VR_Network::send_data(unsigned long long& socket)
+bool VR_Network::send_data(unsigned long long& socket, const Packet *packet)
 {
 	const int control_sequence_length = sizeof(VR_Network::control_sequence);
 	char *control_sequence_buf_ptr = VR_Network::control_sequence;
 	bool control_sequence_sent = false;
 	uint control_bytes_sent = 0;
 
-	static char local_buf[VR_NETWORK_SEND_BUF_SIZE];
-	static uint size_l = 0;
-	static uint size_r = 0;
-	if (VR_Network::img_processed) {
-		size_l = VR_Network::image_data[VR_SIDE_LEFT].compressed_size;
-		size_r = VR_Network::image_data[VR_SIDE_RIGHT].compressed_size;
-		memcpy(local_buf, VR_Network::send_buf, size_l);
-		memcpy(&local_buf[size_l], &VR_Network::send_buf[size_l], size_r);
-		VR_Network::img_processed = false;
-	}
+	/* Sizes of zero tell the client that there is no new image. */
+	uint size_l = packet ? packet->size[VR_SIDE_LEFT] : 0;
+	uint size_r = packet ? packet->size[VR_SIDE_RIGHT] : 0;
 
 	const int size_sequence_length_l = 4;
 	char *size_sequence_buf_ptr_l = (char*)&size_l;
@@ -539,12 +601,13 @@ bool VR_Network::send_data(unsigned long long& socket)
 #else
 	const uint send_buf_size = 4;
 #endif
-	char *send_buf_ptr = local_buf;
+	char *send_buf_ptr = packet ? (char*)packet->buf : NULL;
 	uint bytes_sent = 0;
 
 	clock_t start = clock();
 
-	while (bytes_sent < send_buf_size && (clock() - start) < CLOCKS_PER_SEC) {
+	/* NOTE: Loop until the size sequence was sent as well, since the data may be empty. */
+	while ((!size_sequence_sent_r || bytes_sent < send_buf_size) && (clock() - start) < CLOCKS_PER_SEC) {
 		int ret;
 		if (!control_sequence_sent) {
 			/* First try to send control sequence */
@@ -631,7 +694,7 @@ bool VR_Network::send_data(unsigned long long& socket)
 			case WSAENOTSOCK: { printf("SOCKET ERROR: WSAENOTSOCK"); return false; }
 			case WSAEOPNOTSUPP: { printf("SOCKET ERROR: WSAEOPNOTSUPP"); return false; }
 			case WSAESHUTDOWN: { printf("SOCKET ERROR: WSAESHUTDOWN"); return false; }
-			case WSAEWOULDBLOCK: { if (bytes_sent == send_buf_size) { return true; } continue; }
+			case WSAEWOULDBLOCK: { if (size_sequence_sent_r && bytes_sent == send_buf_size) { return true; } continue; }
 			case WSAEMSGSIZE: { continue; }
 			case WSAEINVAL: { printf("SOCKET ERROR: WSAEINVAL"); return false; }
 			case WSAECONNABORTED: { printf("SOCKET ERROR: WSAECONNABORTED"); return false; }
@@ -644,7 +707,7 @@ bool VR_Network::send_data(unsigned long long& socket)
 		}
 	}
 
-	if (bytes_sent == send_buf_size) {
+	if (size_sequence_sent_r && bytes_sent == send_buf_size) {
 		return true;
 	}
 	else {
@@ -653,35 +716,39 @@ bool VR_Network::send_data(unsigned long long& socket)
 	}
 }
 #else
-bool VR_Network::send_data(int& socket)
+bool VR_Network::send_data(int& socket, const Packet *packet)
 {
 	const int control_sequence_length = sizeof(VR_Network::control_sequence);
 	char *control_sequence_buf_ptr = VR_Network::control_sequence;
 	bool control_sequence_sent = false;
 	int control_bytes_sent = 0;
 
+	/* Sizes of zero tell the client that there is no new image. */
+	uint size_l = packet ? packet->size[VR_SIDE_LEFT] : 0;
+	uint size_r = packet ? packet->size[VR_SIDE_RIGHT] : 0;
+
 	const int size_sequence_length_l = 4;
-	char *size_sequence_buf_ptr_l = (char*)& VR_Network::image_data[VR_SIDE_LEFT].compressed_size;
+	char *size_sequence_buf_ptr_l = (char*)&size_l;
 	bool size_sequence_sent_l = false;
 	int size_bytes_sent_l = 0;
 
 	const int size_sequence_length_r = 4;
-	char *size_sequence_buf_ptr_r = (char*)& VR_Network::image_data[VR_SIDE_RIGHT].compressed_size;
+	char *size_sequence_buf_ptr_r = (char*)&size_r;
 	bool size_sequence_sent_r = false;
 	int size_bytes_sent_r = 0;
 
 #if VR_NETWORK_IMAGE_STREAMING
-	const int send_buf_size = VR_Network::image_data[VR_SIDE_LEFT].compressed_size +
-							  VR_Network::image_data[VR_SIDE_RIGHT].compressed_size;
+	const int send_buf_size = (int)(size_l + size_r);
 #else
 	const int send_buf_size = 4;
 #endif
-	char *send_buf_ptr = VR_Network::send_buf;
+	char *send_buf_ptr = packet ? (char*)packet->buf : NULL;
 	int bytes_sent = 0;
 
 	clock_t start = clock();
 
-	while (bytes_sent < send_buf_size && (clock() - start) < CLOCKS_PER_SEC) {
+	/* NOTE: Loop until the size sequence was sent as well, since the data may be empty. */
+	while ((!size_sequence_sent_r || bytes_sent < send_buf_size) && (clock() - start) < CLOCKS_PER_SEC) {
 		int ret;
 		if (!control_sequence_sent) {
 			/* First try to send control sequence */
@@ -767,7 +834,7 @@ bool VR_Network::send_data(int& socket)
 			case ENOTSOCK: { printf("SOCKET ERROR: ENOTSOCK"); return false; }
 			case EOPNOTSUPP: { printf("SOCKET ERROR: EOPNOTSUPP"); return false; }
 			case ESHUTDOWN: { printf("SOCKET ERROR: ESHUTDOWN"); return false; }
-			case EWOULDBLOCK: { if (bytes_sent == send_buf_size) { return true; } continue; }
+			case EWOULDBLOCK: { if (size_sequence_sent_r && bytes_sent == send_buf_size) { return true; } continue; }
 			case EMSGSIZE: { continue; }
 			case EINVAL: { printf("SOCKET ERROR: EINVAL"); return false; }
 			case ECONNABORTED: { printf("SOCKET ERROR: ECONNABORTED"); return false; }
@@ -780,7 +847,7 @@ bool VR_Network::send_data(int& socket)
 		}
 	}
 
-	if (bytes_sent == send_buf_size) {
+	if (size_sequence_sent_r && bytes_sent == send_buf_size) {
 		return true;
 	}
 	else {
@@ -887,6 +954,7 @@ uint __stdcall VR_Network::thread_func(void *data)
 
 		/* If we arrive here, the client successfully connected */
 		VR_Network::network_status = NETWORKSTATUS_CONNECTED;
+		reset_stream();	/* the new client has no previous image */
 
 		/* Enter the "wait-for-request-and-send-data" loop */
 		while (VR_Network::runlvl == Thread::RUNLEVEL_RUNNING && current_ip_address == U.vr_network_ipaddr) {
@@ -902,13 +970,16 @@ uint __stdcall VR_Network::thread_func(void *data)
 			VR_Network::condition.enter();	/* lock the data buffer */
 
 #if VR_NETWORK_IMAGE_STREAMING
-			if (!VR_Network::img_processed) { /* wait a bit for the next update */
+			Packet *packet = VR_Network::next_packet();
+			if (!packet) { /* wait a bit for the next update */
 				VR_Network::condition.wait(100);
-				if (!VR_Network::img_processed) {
+				packet = VR_Network::next_packet();
+				if (!packet) {
 					//printf("timeout waiting for new data");
 				}
 			}
 #else
+			Packet *packet = NULL;
 			if (!VR_Network::data_new) { /* wait a bit for the next update */
 				VR_Network::condition.wait(100);
 				if (!VR_Network::data_new) {
@@ -923,12 +994,17 @@ uint __stdcall VR_Network::thread_func(void *data)
 			VR_Network::condition.leave_signal();	/* finished using the data buffer */
 
 			/* Send data */
-			if (!send_data(client_socket)) {
+			if (!send_data(client_socket, packet)) {
 				break; /*some problem sending the data (or: timeout) close and re-connect */
 			}
+			if (packet) {
+				/* The client's next request acknowledges the packet. */
+				VR_Network::release_packet();
+			}
 		}
 		/* if we arrive here, either the user changed the IP or we lost the connection */
 		VR_Network::network_status = NETWORKSTATUS_DISCONNECT;
+		reset_stream();
 		shutdown(client_socket, SD_SEND);
 		closesocket(client_socket);
 		if (listen_socket != INVALID_SOCKET) {
@@ -1052,6 +1128,7 @@ void VR_Network::thread_func()
 
 		/* If we arrive here, the client successfully connected */
 		VR_Network::network_status = NETWORKSTATUS_CONNECTED;
+		reset_stream();	/* the new client has no previous image */
 
 		/* Enter the "wait-for-request-and-send-data" loop */
 		while (VR_Network::runlvl == Thread::RUNLEVEL_RUNNING && current_ip_address == U.vr_network_ipaddr) {
@@ -1067,13 +1144,16 @@ void VR_Network::thread_func()
 			VR_Network::condition.enter();	/* lock the data buffer */
 
 #if VR_NETWORK_IMAGE_STREAMING
-			if (!VR_Network::img_processed) { /* wait a bit for the next update */
+			Packet *packet = VR_Network::next_packet();
+			if (!packet) { /* wait a bit for the next update */
 				VR_Network::condition.wait(100);
-				if (!VR_Network::img_processed) {
+				packet = VR_Network::next_packet();
+				if (!packet) {
 					//printf("timeout waiting for new data");
 				}
 			}
 #else
+			Packet *packet = NULL;
 			if (!VR_Network::data_new) { /* wait a bit for the next update */
 				VR_Network::condition.wait(100);
 				if (!VR_Network::data_new) {
@@ -1088,12 +1168,17 @@ void VR_Network::thread_func()
 			VR_Network::condition.leave_signal();	/* finished using the data buffer */
 
 			/* Send data */
-			if (!send_data(client_socket)) {
+			if (!send_data(client_socket, packet)) {
 				break; /*some problem sending the data (or: timeout) close and re-connect */
 			}
+			if (packet) {
+				/* The client's next request acknowledges the packet. */
+				VR_Network::release_packet();
+			}
 		}
 		/* if we arrive here, either the user changed the IP or we lost the connection */
 		VR_Network::network_status = NETWORKSTATUS_DISCONNECT;
+		reset_stream();
 		close(client_socket);
 		if (listen_socket != 0) {
 			close(listen_socket);
@@ -1122,47 +1207,53 @@ void VR_Network::img_thread_func()
 	VR_Network::img_condition.wait(50);
 	VR_Network::img_condition.leave_signal();
 
+	uint generation = (uint)-1;	/* Stream generation the codecs are synchronized with. */
+
 	while (VR_Network::img_runlvl == Thread::RUNLEVEL_RUNNING) {
-		if (!VR_Network::data_new) {
-#ifdef WIN32
-			Sleep(100);
-#else
-			usleep(100000);
-#endif
+		/* Wait for a new frame and a free packet slot. */
+		VR_Network::img_condition.enter();
+		while (VR_Network::img_runlvl == Thread::RUNLEVEL_RUNNING &&
+			   (!VR_Network::frame_pending() ||
+				VR_Network::packet_head - VR_Network::packet_tail >= VR_NETWORK_PACKET_SLOTS)) {
+			VR_Network::img_condition.wait(100);
+		}
+		VR_Network::img_condition.leave_silent();
+		if (!VR_Network::acquire_frame()) {
 			continue;
 		}
 
-		bool error[VR_SIDES] = { false, false };
-		uchar *out[VR_SIDES] = { 0, 0 };
-		int size[VR_SIDES] = { 0, 0 };
-
-#pragma omp parallel for
-		for (int i = 0; i < VR_SIDES; ++i) {
-			ImageData& data = VR_Network::image_data[i];
-			out[i] = stbi_zlib_compress(data.buf, VR_NETWORK_SEND_BUF_SIZE_HALF, &size[i], data.quality);
-		}
-		if (error[VR_SIDE_LEFT] || error[VR_SIDE_RIGHT] ||
-			(size[VR_SIDE_LEFT] + size[VR_SIDE_RIGHT] > VR_NETWORK_SEND_BUF_SIZE)) {
-			goto loop_end;
-		}
-		if (!VR_Network::img_processed) {
-			ImageData& data_left = VR_Network::image_data[VR_SIDE_LEFT];
-			ImageData& data_right = VR_Network::image_data[VR_SIDE_RIGHT];
-			data_left.compressed_size = (uint)size[VR_SIDE_LEFT];
-			data_right.compressed_size = (uint)size[VR_SIDE_RIGHT];
-			memcpy(&VR_Network::send_buf, out[VR_SIDE_LEFT], data_left.compressed_size);
-			memcpy(&VR_Network::send_buf[data_left.compressed_size], out[VR_SIDE_RIGHT], data_right.compressed_size);
-			VR_Network::img_processed = true;
+		const uint stream_generation = VR_Network::stream_generation;
+		if (stream_generation != generation) {
+			/* New client: start with a key frame. */
+			for (int i = 0; i < VR_SIDES; ++i) {
+				VR_Network::codec[i].reset();
+			}
+			generation = stream_generation;
 		}
 
-loop_end:
-		for (int i = 0; i < VR_SIDES; ++i) {
-			if (out[i]) {
-				free(out[i]);
-			}
+		/* Encode directly into the packet (left image, then right image). */
+		const uint head = VR_Network::packet_head;
+		Packet& packet = VR_Network::packets[head % VR_NETWORK_PACKET_SLOTS];
+		const ImageData *images = VR_Network::frame_slots[VR_Network::frame_front].image;
+		VR_Timing::Scope timing(VR_TIMING_ENCODE);
+		uint size_l = VR_Network::codec[VR_SIDE_LEFT].encode(images[VR_SIDE_LEFT].buf, packet.buf, VR_Network::packet_buf_size);
+		uint size_r = 0;
+		if (size_l) {
+			size_r = VR_Network::codec[VR_SIDE_RIGHT].encode(images[VR_SIDE_RIGHT].buf, &packet.buf[size_l], VR_Network::packet_buf_size - size_l);
+		}
+		if (!size_l || !size_r) {
+			/* The client would be out of sync: start over with a key frame. */
+			generation = (uint)-1;
+			continue;
 		}
+		packet.size[VR_SIDE_LEFT] = size_l;
+		packet.size[VR_SIDE_RIGHT] = size_r;
+		packet.generation = stream_generation;
 
-		VR_Network::data_new = false;
+		/* Publish the packet and wake the networking thread. */
+		VR_Network::condition.enter();
+		VR_Network::packet_head = head + 1;
+		VR_Network::condition.leave_signal();
 	}
 
 	/* If we arrive here, runlevel was set to false */
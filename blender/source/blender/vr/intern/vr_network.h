@@ -33,14 +33,27 @@
 #include "vr_types.h"
 #include "vr_main.h"
 
+#include "vr_codec.h"
+
 #include <string>
 #include <vector>
 #include <atomic>
 
-/* Size (bytes) of the VR data to send / receive. */
+/* Size (bytes) of the VR data to receive. */
 #define VR_NETWORK_RECV_BUF_SIZE	sizeof(VR_Network::NetworkData)
-#define VR_NETWORK_SEND_BUF_SIZE	614400 // 320*240*4*2 //1382400 // 480*360*4*2 //2457600 //640*480*4*2 //9830400 // 1280*960*4*2
-#define VR_NETWORK_SEND_BUF_SIZE_HALF 307200 // 320*240*4 //691200 // 480*360*4 //1228800 //640*480*4 //4915200 // 1280*960*4 
+
+/* Dimensions (per eye) of the streamed images. */
+#define VR_NETWORK_IMAGE_WIDTH	640
+#define VR_NETWORK_IMAGE_HEIGHT	480
+/* Number of least significant color bits dropped by the streaming codec (0 = lossless). */
+#define VR_NETWORK_IMAGE_QUANT_BITS	0
+
+/* Number of frame slots shared by the render thread and the image thread (triple buffer). */
+#define VR_NETWORK_FRAME_SLOTS	3
+/* Flag in VR_Network::frame_ready marking a published frame that was not acquired yet. */
+#define VR_NETWORK_FRAME_FRESH	0x80000000
+/* Number of encoded packets queued between the image thread and the networking thread. */
+#define VR_NETWORK_PACKET_SLOTS	2
 
 /* Whether to enable image streaming. */
 #define VR_NETWORK_IMAGE_STREAMING 1
@@ -167,41 +180,68 @@ public:
     uint h;	/* Image height in pixels. */
     uint d; /* Image depth. */
     uchar *buf;	/* Image buffer to receive the image pixel data to be sent. */
-    uint compressed_size;	/* Size of the encoded image buffer in bytes. */
-    uint quality; /* PNG compression quality. */
   } ImageData;
-  static ImageData image_data[VR_SIDES];
+
+  /* Stereo frame (render thread -> image thread). */
+  typedef struct FrameSlot {
+    ImageData image[VR_SIDES];	/* Image per eye. */
+  } FrameSlot;
+  static FrameSlot frame_slots[VR_NETWORK_FRAME_SLOTS];	/* Triple buffer of frames. */
+  static std::atomic<uint> frame_ready;	/* Index of the last published frame slot (| VR_NETWORK_FRAME_FRESH if not acquired yet). */
+  static uint frame_back;	/* Index of the frame slot owned by the render thread. */
+  static uint frame_front;	/* Index of the frame slot owned by the image thread. */
+
+  static ImageData *begin_frame();	/* Render thread: get the images (one per eye) to write the next frame to. */
+  static void publish_frame();	/* Render thread: hand the written frame over to the image thread (does not wait for the image thread). */
+  static bool frame_pending();	/* Whether the last published frame was not acquired by the image thread yet. */
+  static bool acquire_frame();	/* Image thread: swap the latest published frame (if any) into the front slot. */
+
+  /* Encoded stereo frame (image thread -> networking thread). */
+  typedef struct Packet {
+    uchar *buf;	/* Encoded left image, followed by the encoded right image. */
+    uint size[VR_SIDES];	/* Encoded size per eye in bytes. */
+    uint generation;	/* Stream generation the packet was encoded for. */
+  } Packet;
+  static Packet packets[VR_NETWORK_PACKET_SLOTS];	/* Single-producer / single-consumer ring of packets. */
+  static uint packet_buf_size;	/* Allocated size of each packet buffer in bytes. */
+  static std::atomic<uint> packet_head;	/* Number of packets encoded (written by the image thread only). */
+  static std::atomic<uint> packet_tail;	/* Number of packets sent or discarded (written by the networking thread only). */
+  static std::atomic<uint> stream_generation;	/* Incremented for each new client. Packets of older generations are discarded. */
+
+  static Packet *next_packet();	/* Networking thread: get the next packet to send (NULL if none). */
+  static void release_packet();	/* Networking thread: free the slot of the packet that was just sent. */
+
+  static VR_Codec codec[VR_SIDES];	/* Streaming codecs (one per eye, used by the image thread only). */
 
   static bool set_image_size(uint width, uint height, uint depth);	/* Set the desired image dimensions. */
+  static void reset_stream();	/* Discard queued packets and restart the stream with a key frame (i.e. for a new client). */
   static bool resample_pixels(const uchar *pixels, uint w_old, uint h_old,
     uchar *pixels_new, uint w_new, uint h_new, uint depth,
     const uint *depth_buffer = 0);	/* Image resampler helper function.*/
 
   static char recv_buf[VR_NETWORK_RECV_BUF_SIZE];	/* Buffer for receiving VR data. */
-  static char send_buf[VR_NETWORK_SEND_BUF_SIZE];	/* Buffer for sending VR data. */
 
   static char control_sequence[4];  /* Control sequence for sending / receiving network data. */
   static bool initialized;  /* Whether the VR params have been initialized / received from client device. */
-  static std::atomic<bool> data_new;	/* Whether the data is new / was already sent. */
-  static std::atomic<bool> img_processed; /* Whether the image data has been processed. */
+  static std::atomic<bool> data_new;	/* Whether the data is new / was already sent (without image streaming). */
 
   static NetworkStatus network_status;	/* Current status of networking. */
 
   static void *thread;	/* Networking thread handle. */
   static Thread::Runlevel	runlvl;	/* Networking thread runlevel. */
-  static Thread::Condition condition;	/* Condition variable for accessing the VR data buffer. */
+  static Thread::Condition condition;	/* Condition variable for accessing the VR data buffer (signaled when a packet was encoded). */
   static void *img_thread;	/* Image processing thread handle. */
   static Thread::Runlevel	img_runlvl;	/* Image thread runlevel. */
-  static Thread::Condition img_condition;	/* Condition variable for accessing the image data. */
+  static Thread::Condition img_condition;	/* Condition variable for accessing the image data (signaled when a frame was published or a packet sent). */
 
 #ifdef WIN32
   static bool receive_data(unsigned long long& socket); /* Receive data from client. */
-  static bool send_data(unsigned long long& socket);  /* Send data to client. */
+  static bool send_data(unsigned long long& socket, const Packet *packet);  /* Send data (and the packet, if any) to client. */
   static uint __stdcall thread_func(void *data);	/* Thread function for the networking thread (to external machine via WiFi). */
   static uint __stdcall img_thread_func(void *data);	/* Thread function for the image processing thread. */
 #else
   static bool receive_data(int& socket); /* Receive data from client. */
-  static bool send_data(int& socket); /* Send data to client. */
+  static bool send_data(int& socket, const Packet *packet); /* Send data (and the packet, if any) to client. */
   static void thread_func();	/* Thread function for the networking thread (to external machine via WiFi). */
   static void img_thread_func();	/* Thread function for the image processing thread. */
 #endif
@@ -0,0 +1,320 @@
+/*
+* ***** BEGIN GPL LICENSE BLOCK *****
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software Foundation,
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+* The Original Code is Copyright (C) 2019 by Blender Foundation.
+* All rights reserved.
+*
+* Contributor(s): MARUI-PlugIn, Multiplexed Reality
+*
+* ***** END GPL LICENSE BLOCK *****
+*/
+
+
+/** \file blender/vr/intern/vr_resample.cpp
+*   \ingroup vr
+*
+* Image resampling kernel for remote image streaming.
+*/
+
+#include "vr_types.h"
+
+#include "vr_resample.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <vector>
+
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+#ifdef __AVX2__
+#  include <immintrin.h>
+#endif
+
+/***************************************************************************************************
+ * \class										VR_Resample
+ ***************************************************************************************************
+ * Image resampling kernel for remote image streaming.
+ **************************************************************************************************/
+
+/* Alpha of a pixel at the far plane / of any other pixel (little-endian RGBA). */
+#define VR_RESAMPLE_ALPHA 0xFF000000u
+/* Depth buffer value (<depth 24, stencil 8>) at the far plane, with the stencil bits set. */
+#define VR_RESAMPLE_DEPTH_FAR 0xFFFFFFFFu
+
+/* Source pixel indices of the 2x2 box of the output pixels (along one axis). */
+typedef struct SampleIndex {
+	std::vector<int> i0;	/* First sample. */
+	std::vector<int> i1;	/* Second sample. */
+	bool box;		/* Whether two samples are averaged (else only i0 is used). */
+	bool identity;	/* Whether i0[i] == i (no resampling along this axis). */
+} SampleIndex;
+
+static void sample_index_init(SampleIndex& index, uint n_old, uint n_new)
+{
+	index.i0.resize(n_new);
+	index.i1.resize(n_new);
+	/* Only filter when reducing by 1.5x or more, else the box would blur / shift the image. */
+	index.box = (n_old * 2 >= n_new * 3);
+	index.identity = (n_old == n_new);
+	for (uint i = 0; i < n_new; ++i) {
+		/* Footprint center (in source pixels, scaled by 2 * n_new to stay integer). */
+		const uint64_t center = (uint64_t)(2 * i + 1) * n_old;
+		int i0, i1;
+		if (index.box) {
+			/* The two pixels around the center. */
+			i0 = (int)((center - n_new) / (2 * n_new));
+			i1 = i0 + 1;
+		}
+		else {
+			/* The pixel containing the center. */
+			i0 = i1 = (int)(center / (2 * n_new));
+		}
+		index.i0[i] = (i0 < (int)n_old) ? i0 : (int)n_old - 1;
+		index.i1[i] = (i1 < (int)n_old) ? i1 : (int)n_old - 1;
+	}
+}
+
+/* Arguments of the row kernels. Optional entries are NULL if not used. */
+typedef struct RowArgs {
+	const uint *row0;	/* First source row. */
+	const uint *row1;	/* Second source row (optional: no vertical box). */
+	const uint *depth0;	/* Depth of the first source row (optional: opaque output). */
+	const uint *depth1;	/* Depth of the second source row (optional). */
+	const int *x0;		/* First source column per output pixel (optional: identity). */
+	const int *x1;		/* Second source column per output pixel (optional: no horizontal box). */
+	uint *out;			/* Output row. */
+} RowArgs;
+
+/* Per-byte average of two packed pixels, rounding up (same as _mm_avg_epu8). */
+static inline uint pixel_avg(uint a, uint b)
+{
+	return (a | b) - (((a ^ b) & 0xFEFEFEFEu) >> 1);
+}
+
+/* Alpha mask of a depth buffer value. */
+static inline uint depth_mask(uint d)
+{
+	return ((d | 0xFFu) == VR_RESAMPLE_DEPTH_FAR) ? 0u : 0xFFFFFFFFu;
+}
+
+/* The kernels below average in the same order, so all of them give identical results. */
+
+static inline uint sample_scalar(const uint *row0, const uint *row1, const RowArgs& r, uint x, bool mask)
+{
+	const int a = r.x0 ? r.x0[x] : (int)x;
+	uint v = mask ? depth_mask(row0[a]) : row0[a];
+	if (r.x1) {
+		v = pixel_avg(v, mask ? depth_mask(row0[r.x1[x]]) : row0[r.x1[x]]);
+	}
+	if (row1) {
+		uint v1 = mask ? depth_mask(row1[a]) : row1[a];
+		if (r.x1) {
+			v1 = pixel_avg(v1, mask ? depth_mask(row1[r.x1[x]]) : row1[r.x1[x]]);
+		}
+		v = pixel_avg(v, v1);
+	}
+	return v;
+}
+
+static void downsample_row_scalar(const RowArgs& r, uint x_begin, uint x_end)
+{
+	for (uint x = x_begin; x < x_end; ++x) {
+		const uint color = sample_scalar(r.row0, r.row1, r, x, false);
+		const uint alpha = r.depth0 ? sample_scalar(r.depth0, r.depth1, r, x, true) : VR_RESAMPLE_ALPHA;
+		r.out[x] = (color & ~VR_RESAMPLE_ALPHA) | (alpha & VR_RESAMPLE_ALPHA);
+	}
+}
+
+#ifdef __SSE2__
+static inline __m128i load4_sse2(const uint *p, const int *i, uint x)
+{
+	if (!i) {
+		return _mm_loadu_si128((const __m128i*)&p[x]);
+	}
+	i += x;
+	return _mm_set_epi32((int)p[i[3]], (int)p[i[2]], (int)p[i[1]], (int)p[i[0]]);
+}
+
+static inline __m128i depth_mask_sse2(__m128i d)
+{
+	const __m128i far = _mm_set1_epi32((int)VR_RESAMPLE_DEPTH_FAR);
+	const __m128i is_far = _mm_cmpeq_epi32(_mm_or_si128(d, _mm_set1_epi32(0xFF)), far);
+	return _mm_andnot_si128(is_far, far);
+}
+
+static inline __m128i sample_sse2(const uint *row0, const uint *row1, const RowArgs& r, uint x, bool mask)
+{
+	__m128i v = load4_sse2(row0, r.x0, x);
+	if (mask) {
+		v = depth_mask_sse2(v);
+	}
+	if (r.x1) {
+		__m128i b = load4_sse2(row0, r.x1, x);
+		v = _mm_avg_epu8(v, mask ? depth_mask_sse2(b) : b);
+	}
+	if (row1) {
+		__m128i v1 = load4_sse2(row1, r.x0, x);
+		if (mask) {
+			v1 = depth_mask_sse2(v1);
+		}
+		if (r.x1) {
+			__m128i b = load4_sse2(row1, r.x1, x);
+			v1 = _mm_avg_epu8(v1, mask ? depth_mask_sse2(b) : b);
+		}
+		v = _mm_avg_epu8(v, v1);
+	}
+	return v;
+}
+
+static uint downsample_row_sse2(const RowArgs& r, uint w_new)
+{
+	const __m128i alpha_bits = _mm_set1_epi32((int)VR_RESAMPLE_ALPHA);
+	uint x = 0;
+	for (; x + 4 <= w_new; x += 4) {
+		const __m128i color = sample_sse2(r.row0, r.row1, r, x, false);
+		const __m128i alpha = r.depth0 ? sample_sse2(r.depth0, r.depth1, r, x, true) : alpha_bits;
+		_mm_storeu_si128((__m128i*)&r.out[x],
+						 _mm_or_si128(_mm_andnot_si128(alpha_bits, color), _mm_and_si128(alpha, alpha_bits)));
+	}
+	return x;
+}
+#endif
+
+#ifdef __AVX2__
+static inline __m256i load8_avx2(const uint *p, const int *i, uint x)
+{
+	if (!i) {
+		return _mm256_loadu_si256((const __m256i*)&p[x]);
+	}
+	return _mm256_i32gather_epi32((const int*)p, _mm256_loadu_si256((const __m256i*)&i[x]), 4);
+}
+
+static inline __m256i depth_mask_avx2(__m256i d)
+{
+	const __m256i far = _mm256_set1_epi32((int)VR_RESAMPLE_DEPTH_FAR);
+	const __m256i is_far = _mm256_cmpeq_epi32(_mm256_or_si256(d, _mm256_set1_epi32(0xFF)), far);
+	return _mm256_andnot_si256(is_far, far);
+}
+
+static inline __m256i sample_avx2(const uint *row0, const uint *row1, const RowArgs& r, uint x, bool mask)
+{
+	__m256i v = load8_avx2(row0, r.x0, x);
+	if (mask) {
+		v = depth_mask_avx2(v);
+	}
+	if (r.x1) {
+		__m256i b = load8_avx2(row0, r.x1, x);
+		v = _mm256_avg_epu8(v, mask ? depth_mask_avx2(b) : b);
+	}
+	if (row1) {
+		__m256i v1 = load8_avx2(row1, r.x0, x);
+		if (mask) {
+			v1 = depth_mask_avx2(v1);
+		}
+		if (r.x1) {
+			__m256i b = load8_avx2(row1, r.x1, x);
+			v1 = _mm256_avg_epu8(v1, mask ? depth_mask_avx2(b) : b);
+		}
+		v = _mm256_avg_epu8(v, v1);
+	}
+	return v;
+}
+
+static uint downsample_row_avx2(const RowArgs& r, uint w_new)
+{
+	const __m256i alpha_bits = _mm256_set1_epi32((int)VR_RESAMPLE_ALPHA);
+	uint x = 0;
+	for (; x + 8 <= w_new; x += 8) {
+		const __m256i color = sample_avx2(r.row0, r.row1, r, x, false);
+		const __m256i alpha = r.depth0 ? sample_avx2(r.depth0, r.depth1, r, x, true) : alpha_bits;
+		_mm256_storeu_si256((__m256i*)&r.out[x],
+							_mm256_or_si256(_mm256_andnot_si256(alpha_bits, color), _mm256_and_si256(alpha, alpha_bits)));
+	}
+	return x;
+}
+#endif
+
+VR_Resample::ISA VR_Resample::isa_best()
+{
+#if defined(__AVX2__)
+	return ISA_AVX2;
+#elif defined(__SSE2__)
+	return ISA_SSE2;
+#else
+	return ISA_SCALAR;
+#endif
+}
+
+bool VR_Resample::isa_available(ISA isa)
+{
+	return (isa == ISA_BEST || isa <= isa_best());
+}
+
+bool VR_Resample::downsample(const uchar *pixels, uint w_old, uint h_old,
+							 uchar *pixels_new, uint w_new, uint h_new,
+							 const uint *depth_buffer, ISA isa)
+{
+	if (!pixels || !pixels_new || w_old == 0 || h_old == 0 || w_new == 0 || h_new == 0) {
+		return false;
+	}
+	if (isa == ISA_BEST || !isa_available(isa)) {
+		isa = isa_best();
+	}
+
+	SampleIndex xi, yi;
+	sample_index_init(xi, w_old, w_new);
+	sample_index_init(yi, h_old, h_new);
+
+	const uint *src = (const uint*)pixels;
+	uint *dst = (uint*)pixels_new;
+
+#pragma omp parallel for
+	for (int y = 0; y < (int)h_new; ++y) {
+		/* NOTE: Vertical flip (source rows are bottom first). */
+		const size_t r0 = (size_t)(h_old - 1 - yi.i0[y]) * w_old;
+		const size_t r1 = (size_t)(h_old - 1 - yi.i1[y]) * w_old;
+		RowArgs r;
+		r.row0 = &src[r0];
+		r.row1 = yi.box ? &src[r1] : NULL;
+		r.depth0 = depth_buffer ? &depth_buffer[r0] : NULL;
+		r.depth1 = (depth_buffer && yi.box) ? &depth_buffer[r1] : NULL;
+		r.x0 = xi.identity ? NULL : &xi.i0[0];
+		r.x1 = xi.box ? &xi.i1[0] : NULL;
+		r.out = &dst[(size_t)y * w_new];
+
+		uint x = 0;
+		switch (isa) {
+#ifdef __AVX2__
+		case ISA_AVX2:
+			x = downsample_row_avx2(r, w_new);
+			break;
+#endif
+#ifdef __SSE2__
+		case ISA_SSE2:
+			x = downsample_row_sse2(r, w_new);
+			break;
+#endif
+		default:
+			break;
+		}
+		/* Remaining pixels (or all of them for the scalar kernel). */
+		downsample_row_scalar(r, x, w_new);
+	}
+
+	return true;
+}
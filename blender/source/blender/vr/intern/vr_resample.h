@@ -0,0 +1,65 @@
+/*
+* ***** BEGIN GPL LICENSE BLOCK *****
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software Foundation,
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+* The Original Code is Copyright (C) 2019 by Blender Foundation.
+* All rights reserved.
+*
+* Contributor(s): MARUI-PlugIn, Multiplexed Reality
+*
+* ***** END GPL LICENSE BLOCK *****
+*/
+
+
+/** \file blender/vr/intern/vr_resample.h
+*   \ingroup vr
+*/
+
+#ifndef __VR_RESAMPLE_H__
+#define __VR_RESAMPLE_H__
+
+#include "vr_types.h"
+
+/* Image resampling kernel for remote image streaming.
+ * Downsamples an RGBA8 OpenGL image (bottom row first) into an RGBA8 image with
+ * the top row first, in one pass. Each output pixel is the 2x2 box average around
+ * the center of its footprint (plain nearest-neighbor along axes that are not
+ * reduced by at least 1.5x). If a depth buffer (<depth 24, stencil 8> format) is
+ * given, alpha is the fraction of the box that is not at the far plane, which
+ * removes the viewport background for see-through displays. */
+class VR_Resample
+{
+public:
+	/* Instruction sets of the kernel variants. */
+	typedef enum ISA {
+		ISA_SCALAR	= 0	/* Portable C++. */
+		,
+		ISA_SSE2	= 1	/* SSE2 (4 pixels per iteration). */
+		,
+		ISA_AVX2	= 2	/* AVX2 with gathers (8 pixels per iteration). */
+		,
+		ISA_BEST	= 3	/* The best variant compiled into this build. */
+	} ISA;
+
+	static ISA isa_best();	/* Get the best instruction set compiled into this build. */
+	static bool isa_available(ISA isa);	/* Whether the given kernel variant is compiled into this build. */
+
+	static bool downsample(const uchar *pixels, uint w_old, uint h_old,
+						   uchar *pixels_new, uint w_new, uint h_new,
+						   const uint *depth_buffer = 0, ISA isa = ISA_BEST);	/* Resample, flip and apply the depth mask. */
+};
+
+#endif /* __VR_RESAMPLE_H__ */
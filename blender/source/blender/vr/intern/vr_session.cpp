@@ -0,0 +1,756 @@
+/*
+* ***** BEGIN GPL LICENSE BLOCK *****
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software Foundation,
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+* The Original Code is Copyright (C) 2019 by Blender Foundation.
+* All rights reserved.
+*
+* Contributor(s): MARUI-PlugIn, Multiplexed Reality
+*
+* ***** END GPL LICENSE BLOCK *****
+*/
+
+/** \file blender/vr/intern/vr_session.cpp
+*   \ingroup vr
+*/
+
+#include "vr_types.h"
+#include "vr_main.h"
+
+#include "vr_session.h"
+#include "vr_ui.h"
+#include "vr_draw.h"
+
+#include "BLI_math.h"
+
+#include "BKE_context.h"
+#include "BKE_layer.h"
+#include "BKE_object.h"
+#include "BKE_scene.h"
+
+#include "DEG_depsgraph.h"
+
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+#include "ED_object.h"
+
+#include "WM_api.h"
+#include "WM_types.h"
+
+#ifdef WIN32
+#include <WinSock2.h>
+#include <Ws2tcpip.h>
+#else
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <fcntl.h>
+#endif
+#include <stdlib.h>
+
+/***************************************************************************************************
+ * \class										VR_Session
+ ***************************************************************************************************
+ * Collaborative multi-user session (see VR_SessionProtocol for the wire format).
+ **************************************************************************************************/
+static_assert(VR_SESSION_POSE_FLOATS == 64, "VR_Session::Pose must fit into a 64bit change mask.");
+
+VR_Session::Peer VR_Session::peers[VR_SESSION_MAX_PEERS];
+
+bool VR_Session::initialized(false);
+bool VR_Session::enabled(false);
+bool VR_Session::is_host(false);
+uchar VR_Session::local_peer(0);
+VR_Session::Socket VR_Session::listen_socket(VR_SESSION_INVALID_SOCKET);
+std::vector<VR_Session::Connection> VR_Session::connections;
+uchar VR_Session::next_peer(1);
+
+VR_Session::Pose VR_Session::pose_sent;
+bool VR_Session::pose_full(true);
+std::map<std::string, VR_Session::ObjectState> VR_Session::objects;
+uint VR_Session::transforms_received(0);
+
+/* Close a socket handle. */
+static void session_close_socket(VR_Session::Socket s)
+{
+#ifdef WIN32
+	closesocket(s);
+#else
+	::close(s);
+#endif
+}
+
+/* Switch a socket to non-blocking mode and disable Nagle's algorithm (small, frequent messages). */
+static bool session_setup_socket(VR_Session::Socket s)
+{
+#ifdef WIN32
+	u_long non_blocking = 1;
+	if (ioctlsocket(s, FIONBIO, &non_blocking) != 0) {
+		return false;
+	}
+#else
+	int flags = fcntl(s, F_GETFL, 0);
+	if (flags < 0 || fcntl(s, F_SETFL, flags | O_NONBLOCK) < 0) {
+		return false;
+	}
+#endif
+	int no_delay = 1;
+	setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char*)&no_delay, sizeof(no_delay));
+	return true;
+}
+
+/* Whether the last socket operation failed only because it would have blocked. */
+static bool session_would_block()
+{
+#ifdef WIN32
+	int error = WSAGetLastError();
+	return (error == WSAEWOULDBLOCK || error == WSAEINTR || error == WSAEINPROGRESS);
+#else
+	return (errno == EWOULDBLOCK || errno == EAGAIN || errno == EINTR);
+#endif
+}
+
+bool VR_Session::start()
+{
+	const char *config = getenv(VR_SESSION_ENV);
+	if (!config || !config[0]) {
+		return false;
+	}
+
+	/* Parse "host[:port]" / "<address>[:port]". */
+	std::string address(config);
+	int port = VR_SESSION_PORT_NUM;
+	size_t colon = address.rfind(':');
+	if (colon != std::string::npos) {
+		port = atoi(address.c_str() + colon + 1);
+		address.resize(colon);
+	}
+	if (port <= 0 || port > 65535) {
+		printf("VR session: invalid port in %s=%s\n", VR_SESSION_ENV, config);
+		return false;
+	}
+	is_host = (address == "host");
+
+#ifdef WIN32
+	WSADATA wsa_data;
+	if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) {
+		printf("VR session: WSAStartup failed\n");
+		return false;
+	}
+#endif
+
+	Socket s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (s == VR_SESSION_INVALID_SOCKET) {
+		printf("VR session: failed to create socket\n");
+		stop();
+		return false;
+	}
+
+	if (is_host) {
+		int reuse = 1;
+		setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+		sockaddr_in addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_ANY);
+		addr.sin_port = htons((ushort)port);
+		if (bind(s, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(s, VR_SESSION_MAX_PEERS) != 0 || !session_setup_socket(s)) {
+			printf("VR session: failed to listen on port %d\n", port);
+			session_close_socket(s);
+			stop();
+			return false;
+		}
+		listen_socket = s;
+		local_peer = 0;
+		next_peer = 1;
+		printf("VR session: hosting on port %d\n", port);
+	}
+	else {
+		addrinfo hints;
+		memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_STREAM;
+		hints.ai_protocol = IPPROTO_TCP;
+		addrinfo *result = 0;
+		char port_str[8];
+		sprintf(port_str, "%d", port);
+		/* Connect while still blocking (the session starts with the VR UI). */
+		if (getaddrinfo(address.c_str(), port_str, &hints, &result) != 0 || !result ||
+			connect(s, result->ai_addr, (int)result->ai_addrlen) != 0 || !session_setup_socket(s)) {
+			printf("VR session: failed to connect to %s:%d\n", address.c_str(), port);
+			if (result) {
+				freeaddrinfo(result);
+			}
+			session_close_socket(s);
+			stop();
+			return false;
+		}
+		freeaddrinfo(result);
+
+		Connection c;
+		c.socket = s;
+		c.peer = 0;
+		c.transforms_sent = 0;
+		connections.push_back(c);
+		peers[0].active = true;
+		printf("VR session: connected to %s:%d\n", address.c_str(), port);
+	}
+
+	pose_full = true;
+	objects.clear();
+	transforms_received = 0;
+	return true;
+}
+
+void VR_Session::stop()
+{
+	for (std::vector<Connection>::iterator it = connections.begin(); it != connections.end(); ++it) {
+		if (it->socket != VR_SESSION_INVALID_SOCKET) {
+			session_close_socket(it->socket);
+		}
+	}
+	connections.clear();
+	if (listen_socket != VR_SESSION_INVALID_SOCKET) {
+		session_close_socket(listen_socket);
+		listen_socket = VR_SESSION_INVALID_SOCKET;
+	}
+	for (int i = 0; i < VR_SESSION_MAX_PEERS; ++i) {
+		peers[i].active = false;
+		peers[i].pose_valid = false;
+	}
+	objects.clear();
+#ifdef WIN32
+	WSACleanup();
+#endif
+}
+
+void VR_Session::accept_clients()
+{
+	for (;;) {
+		Socket s = accept(listen_socket, 0, 0);
+		if (s == VR_SESSION_INVALID_SOCKET) {
+			return;
+		}
+		/* Find a free peer ID. */
+		uchar peer = 0;
+		for (uint i = 0; i < VR_SESSION_MAX_PEERS - 1 && !peer; ++i) {
+			uchar id = (uchar)((next_peer - 1 + i) % (VR_SESSION_MAX_PEERS - 1) + 1);
+			if (!peers[id].active) {
+				peer = id;
+			}
+		}
+		if (!peer || !session_setup_socket(s)) {
+			printf("VR session: rejected client (session full)\n");
+			session_close_socket(s);
+			continue;
+		}
+		next_peer = (uchar)(peer % (VR_SESSION_MAX_PEERS - 1) + 1);
+
+		Connection c;
+		c.socket = s;
+		c.peer = peer;
+		c.transforms_sent = 0;
+		connections.push_back(c);
+		Connection& client = connections.back();
+		peers[peer].active = true;
+		peers[peer].pose_valid = false;
+
+		/* Assign the peer ID, announce the new peer and bring it up to date. */
+		std::vector<uchar> payload(1, peer);
+		write(client, MESSAGE_HELLO, 0, payload);
+		payload.clear();
+		broadcast(MESSAGE_JOIN, payload, peer, &client);
+		send_snapshot(client);
+		pose_full = true;
+		printf("VR session: peer %d joined\n", (int)peer);
+	}
+}
+
+bool VR_Session::receive(Connection& c)
+{
+	uchar buf[4096];
+	for (;;) {
+		int ret = (int)recv(c.socket, (char*)buf, sizeof(buf), 0);
+		if (ret > 0) {
+			c.recv_buf.insert(c.recv_buf.end(), buf, buf + ret);
+			continue;
+		}
+		if (ret == 0 || !session_would_block()) {
+			return false; /* Disconnected. */
+		}
+		break;
+	}
+
+	/* Dispatch all complete messages. */
+	size_t offset = 0;
+	MessageHeader header;
+	for (;;) {
+		ParseResult result = parse_message(c.recv_buf.data() + offset, c.recv_buf.size() - offset, header);
+		if (result == PARSE_ERROR) {
+			printf("VR session: protocol error\n");
+			return false;
+		}
+		if (result == PARSE_INCOMPLETE) {
+			break;
+		}
+		const uchar *payload = c.recv_buf.data() + offset + sizeof(header);
+		offset += sizeof(header) + header.size;
+		dispatch(c, header, payload);
+	}
+	c.recv_buf.erase(c.recv_buf.begin(), c.recv_buf.begin() + offset);
+	return true;
+}
+
+bool VR_Session::flush(Connection& c)
+{
+	size_t sent = 0;
+	while (sent < c.send_buf.size()) {
+#ifdef MSG_NOSIGNAL
+		int ret = (int)send(c.socket, (const char*)c.send_buf.data() + sent, (int)(c.send_buf.size() - sent), MSG_NOSIGNAL);
+#else
+		int ret = (int)send(c.socket, (const char*)c.send_buf.data() + sent, (int)(c.send_buf.size() - sent), 0);
+#endif
+		if (ret > 0) {
+			sent += ret;
+			continue;
+		}
+		if (ret < 0 && session_would_block()) {
+			break; /* Try again next update. */
+		}
+		return false;
+	}
+	c.send_buf.erase(c.send_buf.begin(), c.send_buf.begin() + sent);
+	return true;
+}
+
+void VR_Session::close(Connection& c)
+{
+	if (c.socket != VR_SESSION_INVALID_SOCKET) {
+		session_close_socket(c.socket);
+		c.socket = VR_SESSION_INVALID_SOCKET;
+	}
+	c.recv_buf.clear();
+	c.send_buf.clear();
+}
+
+void VR_Session::write(Connection& c, MessageType type, uchar peer, const std::vector<uchar>& payload)
+{
+	if (c.socket == VR_SESSION_INVALID_SOCKET) {
+		return;
+	}
+	put_message(c.send_buf, type, peer, payload);
+}
+
+void VR_Session::broadcast(MessageType type, const std::vector<uchar>& payload, uchar origin, const Connection *except)
+{
+	for (std::vector<Connection>::iterator it = connections.begin(); it != connections.end(); ++it) {
+		if (&(*it) != except) {
+			write(*it, type, origin, payload);
+		}
+	}
+}
+
+void VR_Session::dispatch(Connection& c, const MessageHeader& header, const uchar *payload)
+{
+	/* The host knows who sent it (don't trust the header). */
+	uchar origin = is_host ? c.peer : header.peer;
+	if (origin >= VR_SESSION_MAX_PEERS) {
+		return;
+	}
+
+	switch (header.type) {
+	case MESSAGE_HELLO: {
+		if (!is_host && header.size >= 1 && payload[0] < VR_SESSION_MAX_PEERS) {
+			local_peer = payload[0];
+			pose_full = true;
+			printf("VR session: joined as peer %d\n", (int)local_peer);
+		}
+		return;
+	}
+	case MESSAGE_JOIN: {
+		if (!is_host && origin != local_peer) {
+			peers[origin].active = true;
+			peers[origin].pose_valid = false;
+			pose_full = true;
+		}
+		return;
+	}
+	case MESSAGE_LEAVE: {
+		if (!is_host) {
+			peers[origin].active = false;
+			peers[origin].pose_valid = false;
+		}
+		return;
+	}
+	case MESSAGE_POSE: {
+		apply_pose(origin, payload, header.size);
+		break;
+	}
+	case MESSAGE_TRANSFORM: {
+		/* Not relayed, the host sends the resulting state instead. */
+		if (!is_host) {
+			++transforms_received;
+		}
+		apply_transform(c, payload, header.size);
+		return;
+	}
+	case MESSAGE_SELECT: {
+		apply_select(payload, header.size);
+		break;
+	}
+	default:
+		return;
+	}
+
+	/* Relay edit events to the other clients. */
+	if (is_host) {
+		std::vector<uchar> relay(payload, payload + header.size);
+		broadcast((MessageType)header.type, relay, origin, &c);
+	}
+}
+
+void VR_Session::send_pose()
+{
+	Pose pose;
+	pose.navigation = VR_UI::navigation_matrix_get();
+	pose.hmd = VR_UI::hmd_position_get(VR_SPACE_REAL);
+	for (int side = 0; side < VR_SIDES; ++side) {
+		pose.cursor[side] = VR_UI::cursor_position_get(VR_SPACE_REAL, (VR_Side)side);
+	}
+
+	std::vector<uchar> payload;
+	if (put_delta<ui64>(payload, (const float*)&pose, (float*)&pose_sent, VR_SESSION_POSE_FLOATS, pose_full)) {
+		broadcast(MESSAGE_POSE, payload, local_peer);
+	}
+	pose_full = false;
+}
+
+void VR_Session::send_objects(bContext *C)
+{
+	Scene *scene = CTX_data_scene(C);
+	ViewLayer *view_layer = CTX_data_view_layer(C);
+	if (!scene || !view_layer) {
+		return;
+	}
+
+	std::vector<uchar> select_payload;
+	std::vector<uchar> payload;
+	for (Base *base = (Base*)view_layer->object_bases.first; base; base = base->next) {
+		Object *ob = base->object;
+		const char *name = ob->id.name + 2;
+		bool selected = (base->flag & BASE_SELECTED) != 0;
+
+		std::map<std::string, ObjectState>::iterator it = objects.find(name);
+		if (it == objects.end()) {
+			/* Not shared yet: other peers are expected to start from the same file. */
+			ObjectState& state = objects[name];
+			state.obmat = *(Mat44f*)ob->obmat;
+			state.selected = selected;
+			continue;
+		}
+		ObjectState& state = it->second;
+
+		payload.clear();
+		if (!is_host) {
+			put(payload, &transforms_received, sizeof(transforms_received));
+		}
+		put_name(payload, name);
+		if (put_delta<ushort>(payload, (const float*)ob->obmat, (float*)state.obmat.m, 16, false)) {
+			if (is_host) {
+				/* Send the changes against the state of each client instead. */
+				sync_transform_all(it->first, state.obmat);
+			}
+			else {
+				broadcast(MESSAGE_TRANSFORM, payload, local_peer);
+			}
+		}
+
+		if (selected != state.selected) {
+			put_name(select_payload, name);
+			select_payload.push_back(selected ? 1 : 0);
+			state.selected = selected;
+			if (select_payload.size() > VR_SESSION_MAX_PAYLOAD - MAX_ID_NAME) {
+				broadcast(MESSAGE_SELECT, select_payload, local_peer);
+				select_payload.clear();
+			}
+		}
+	}
+	if (!select_payload.empty()) {
+		broadcast(MESSAGE_SELECT, select_payload, local_peer);
+	}
+}
+
+void VR_Session::send_snapshot(Connection& c)
+{
+	std::vector<uchar> select_payload;
+	for (std::map<std::string, ObjectState>::iterator it = objects.begin(); it != objects.end(); ++it) {
+		ObjectState& state = it->second;
+		sync_transform(c, it->first, state.obmat);
+
+		put_name(select_payload, it->first.c_str());
+		select_payload.push_back(state.selected ? 1 : 0);
+		if (select_payload.size() > VR_SESSION_MAX_PAYLOAD - MAX_ID_NAME) {
+			write(c, MESSAGE_SELECT, local_peer, select_payload);
+			select_payload.clear();
+		}
+	}
+	if (!select_payload.empty()) {
+		write(c, MESSAGE_SELECT, local_peer, select_payload);
+	}
+}
+
+void VR_Session::sync_transform(Connection& c, const std::string& name, const Mat44f& obmat)
+{
+	/* Objects the client wasn't sent yet are sent in full. */
+	std::map<std::string, Mat44f>::iterator it = c.objects_sent.find(name);
+	const bool full = (it == c.objects_sent.end());
+	Mat44f& sent = full ? c.objects_sent[name] : it->second;
+
+	std::vector<uchar> payload;
+	put_name(payload, name.c_str());
+	if (put_delta<ushort>(payload, (const float*)obmat.m, (float*)sent.m, 16, full)) {
+		write(c, MESSAGE_TRANSFORM, local_peer, payload);
+		++c.transforms_sent;
+	}
+}
+
+void VR_Session::sync_transform_all(const std::string& name, const Mat44f& obmat)
+{
+	for (std::vector<Connection>::iterator it = connections.begin(); it != connections.end(); ++it) {
+		sync_transform(*it, name, obmat);
+	}
+}
+
+void VR_Session::apply_pose(uchar peer, const uchar *payload, uint size)
+{
+	Peer& p = peers[peer];
+	const uchar *end = payload + size;
+	ui64 mask;
+	if (!get_delta<ui64>(payload, end, (float*)&p.pose, VR_SESSION_POSE_FLOATS, &mask)) {
+		return;
+	}
+	p.active = true;
+	if (mask == ~(ui64)0) {
+		p.pose_valid = true;
+	}
+}
+
+void VR_Session::apply_transform(Connection& c, const uchar *payload, uint size)
+{
+	bContext *C = vr_get_obj()->ctx;
+	Scene *scene = CTX_data_scene(C);
+	const uchar *end = payload + size;
+
+	/* Client edits tell how much of the host state the client had when editing. */
+	uint received = 0;
+	if (is_host) {
+		if (end - payload < (ptrdiff_t)sizeof(received)) {
+			return;
+		}
+		memcpy(&received, payload, sizeof(received));
+		payload += sizeof(received);
+	}
+
+	std::string name;
+	if (!scene || !get_name(payload, end, name)) {
+		return;
+	}
+	Object *ob = BKE_scene_object_find_by_name(scene, name.c_str());
+	if (!ob) {
+		return;
+	}
+	/* Apply the delta on top of the last shared state. */
+	std::map<std::string, ObjectState>::iterator it = objects.find(name);
+	if (it == objects.end()) {
+		ObjectState& state = objects[name];
+		state.obmat = *(Mat44f*)ob->obmat;
+		state.selected = false;
+		it = objects.find(name);
+	}
+	ObjectState& state = it->second;
+	Mat44f obmat = state.obmat;
+	ushort mask;
+	if (!get_delta<ushort>(payload, end, (float*)obmat.m, 16, &mask)) {
+		return;
+	}
+	state.obmat = obmat;
+
+	copy_m4_m4(ob->obmat, obmat.m);
+	BKE_object_apply_mat4(ob, obmat.m, true, true);
+	DEG_id_tag_update(&ob->id, ID_RECALC_TRANSFORM);
+	WM_main_add_notifier(NC_OBJECT | ND_TRANSFORM, ob);
+
+	if (is_host) {
+		/* A client which had all the host state has the edited components as it sent them,
+		 * otherwise messages still on their way overwrite them and the result is sent back. */
+		std::map<std::string, Mat44f>::iterator sent = c.objects_sent.find(name);
+		if (received == c.transforms_sent && sent != c.objects_sent.end()) {
+			for (int i = 0; i < 16; ++i) {
+				if (mask & (1 << i)) {
+					((float*)sent->second.m)[i] = ((const float*)obmat.m)[i];
+				}
+			}
+		}
+		sync_transform_all(name, obmat);
+	}
+}
+
+void VR_Session::apply_select(const uchar *payload, uint size)
+{
+	bContext *C = vr_get_obj()->ctx;
+	Scene *scene = CTX_data_scene(C);
+	ViewLayer *view_layer = CTX_data_view_layer(C);
+	if (!scene || !view_layer) {
+		return;
+	}
+	const uchar *end = payload + size;
+
+	bool changed = false;
+	std::string name;
+	while (payload < end) {
+		if (!get_name(payload, end, name) || payload >= end) {
+			break;
+		}
+		bool selected = (*payload++ != 0);
+
+		Object *ob = BKE_scene_object_find_by_name(scene, name.c_str());
+		Base *base = ob ? BKE_view_layer_base_find(view_layer, ob) : 0;
+		if (!base) {
+			continue;
+		}
+		objects[name].selected = selected;
+		if (((base->flag & BASE_SELECTED) != 0) != selected) {
+			ED_object_base_select(base, selected ? BA_SELECT : BA_DESELECT);
+			changed = true;
+		}
+	}
+
+	if (changed) {
+		DEG_id_tag_update(&scene->id, ID_RECALC_SELECT);
+		WM_main_add_notifier(NC_SCENE | ND_OB_SELECT, scene);
+	}
+}
+
+void VR_Session::update(bContext *C)
+{
+	if (!initialized) {
+		initialized = true;
+		enabled = start();
+	}
+	if (!enabled) {
+		return;
+	}
+
+	if (is_host) {
+		accept_clients();
+	}
+
+	/* Apply remote events first, so that they are part of the shared state (and not sent back). */
+	for (std::vector<Connection>::iterator it = connections.begin(); it != connections.end(); ++it) {
+		if (it->socket != VR_SESSION_INVALID_SOCKET && !receive(*it)) {
+			close(*it);
+		}
+	}
+
+	send_pose();
+	send_objects(C);
+
+	for (std::vector<Connection>::iterator it = connections.begin(); it != connections.end(); ++it) {
+		if (it->socket != VR_SESSION_INVALID_SOCKET && !flush(*it)) {
+			close(*it);
+		}
+	}
+
+	/* Remove closed connections. */
+	for (size_t i = 0; i < connections.size();) {
+		if (connections[i].socket != VR_SESSION_INVALID_SOCKET) {
+			++i;
+			continue;
+		}
+		uchar peer = connections[i].peer;
+		connections.erase(connections.begin() + i);
+		peers[peer].active = false;
+		peers[peer].pose_valid = false;
+		if (is_host) {
+			std::vector<uchar> payload;
+			broadcast(MESSAGE_LEAVE, payload, peer);
+			printf("VR session: peer %d left\n", (int)peer);
+		}
+		else {
+			printf("VR session: disconnected from host\n");
+			stop();
+			enabled = false;
+			return;
+		}
+	}
+}
+
+void VR_Session::render(VR_Side side)
+{
+	if (!enabled) {
+		return;
+	}
+
+	/* Peer real space -> Blender space -> local real space. */
+	const Mat44f& nav_inv = VR_UI::navigation_inverse_get();
+	static const float colors[][4] = {
+		{ 1.0f, 0.5f, 0.0f, 0.8f },
+		{ 0.0f, 0.7f, 1.0f, 0.8f },
+		{ 0.8f, 0.0f, 1.0f, 0.8f },
+		{ 0.2f, 1.0f, 0.2f, 0.8f } };
+
+	for (int i = 0; i < VR_SESSION_MAX_PEERS; ++i) {
+		const Peer& p = peers[i];
+		if (i == local_peer || !p.active || !p.pose_valid) {
+			continue;
+		}
+		const Mat44f to_local = p.pose.navigation * nav_inv;
+		VR_Draw::set_color(colors[i % 4]);
+
+		Mat44f m = p.pose.hmd * to_local;
+		VR_Draw::update_modelview_matrix(&m, 0);
+		VR_Draw::render_box(Coord3Df(-0.09f, -0.05f, -0.06f), Coord3Df(0.09f, 0.05f, 0.06f));
+
+		for (int s = 0; s < VR_SIDES; ++s) {
+			m = p.pose.cursor[s] * to_local;
+			VR_Draw::update_modelview_matrix(&m, 0);
+			VR_Draw::render_ball(0.02f);
+		}
+	}
+}
+
+void VR_Session::shutdown()
+{
+	if (enabled) {
+		/* Send what is still pending (best effort). */
+		for (std::vector<Connection>::iterator it = connections.begin(); it != connections.end(); ++it) {
+			if (it->socket != VR_SESSION_INVALID_SOCKET) {
+				flush(*it);
+			}
+		}
+		stop();
+	}
+	enabled = false;
+	initialized = false;
+}
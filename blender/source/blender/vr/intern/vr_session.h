@@ -0,0 +1,138 @@
+/*
+* ***** BEGIN GPL LICENSE BLOCK *****
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software Foundation,
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+* The Original Code is Copyright (C) 2019 by Blender Foundation.
+* All rights reserved.
+*
+* Contributor(s): MARUI-PlugIn, Multiplexed Reality
+*
+* ***** END GPL LICENSE BLOCK *****
+*/
+
+/** \file blender/vr/intern/vr_session.h
+*   \ingroup vr
+*/
+
+#ifndef __VR_SESSION_H__
+#define __VR_SESSION_H__
+
+#include "vr_types.h"
+#include "vr_math.h"
+#include "vr_session_protocol.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+struct bContext;
+
+/* Environment variable to join or host a shared session:
+ * "host[:port]" to host one, "<address>[:port]" to connect to a host. */
+#define VR_SESSION_ENV	"BLENDERXR_SESSION"
+/* Default port of shared sessions. */
+#define VR_SESSION_PORT_NUM	27020
+/* Maximum number of peers in a session (including the host). */
+#define VR_SESSION_MAX_PEERS	16
+
+/* Collaborative multi-user session.
+ * Peers share one scene by exchanging edit events (instead of images):
+ * the host accepts clients and relays the messages of each client to all other clients.
+ * Object transforms are owned by the host: clients send their edits to the host, which applies
+ * them and sends the resulting state to each client, so concurrent edits can't diverge.
+ * All networking is non-blocking and runs on the main thread (VR_Session::update()). */
+class VR_Session : public VR_SessionProtocol
+{
+public:
+	/* Shared pose of a peer: navigation matrix, HMD and cursors (real space). */
+	typedef struct Pose {
+		Mat44f navigation;	/* Navigation matrix (real -> Blender space). */
+		Mat44f hmd;	/* HMD position (real space). */
+		Mat44f cursor[VR_SIDES];	/* Cursor positions (real space). */
+	} Pose;
+#define VR_SESSION_POSE_FLOATS	(sizeof(VR_Session::Pose) / sizeof(float))
+
+	/* Remote peer as seen by this peer. */
+	typedef struct Peer {
+		bool active;	/* Whether the peer is connected. */
+		bool pose_valid;	/* Whether a full pose was received. */
+		Pose pose;	/* Last reconstructed pose. */
+	} Peer;
+	static Peer peers[VR_SESSION_MAX_PEERS];	/* Remote peers by peer ID. */
+
+#ifdef WIN32
+	typedef unsigned long long Socket;	/* Socket handle (SOCKET). */
+#else
+	typedef int Socket;	/* Socket handle (file descriptor). */
+#endif
+#define VR_SESSION_INVALID_SOCKET	((VR_Session::Socket)-1)
+
+	/* Network connection (socket with pending in- and outgoing bytes). */
+	typedef struct Connection {
+		Socket socket;	/* Socket handle (VR_SESSION_INVALID_SOCKET if closed). */
+		uchar peer;	/* Peer ID of the remote end (host only, 0 = the host itself). */
+		std::vector<uchar> recv_buf;	/* Received bytes not parsed yet. */
+		std::vector<uchar> send_buf;	/* Bytes not sent yet. */
+		std::map<std::string, Mat44f> objects_sent;	/* Host: object matrices the client has (as sent to it), by name. */
+		uint transforms_sent;	/* Host: number of transform messages sent to the client. */
+	} Connection;
+
+	/* Last shared state of an object. */
+	typedef struct ObjectState {
+		Mat44f obmat;	/* World matrix (host: authoritative). */
+		bool selected;	/* Whether the base is selected. */
+	} ObjectState;
+
+	static bool initialized;	/* Whether the session was started (or found to be disabled). */
+	static bool enabled;	/* Whether a session is running (VR_SESSION_ENV). */
+	static bool is_host;	/* Whether this peer hosts the session. */
+	static uchar local_peer;	/* ID of this peer (assigned by the host). */
+	static Socket listen_socket;	/* Listening socket (host only, VR_SESSION_INVALID_SOCKET if none). */
+	static std::vector<Connection> connections;	/* Host: one per client. Client: the host. */
+	static uchar next_peer;	/* Host: ID to assign to the next client. */
+
+	static Pose pose_sent;	/* Last pose sent (base of the pose deltas). */
+	static bool pose_full;	/* Whether the next pose has to be sent in full (i.e. after a peer joined). */
+	static std::map<std::string, ObjectState> objects;	/* Last shared state of the objects, by name. */
+	static uint transforms_received;	/* Client: number of transform messages received from the host. */
+
+	static bool start();	/* Start hosting / connect to the host as configured by VR_SESSION_ENV. */
+	static void stop();	/* Close all connections. */
+
+	static void accept_clients();	/* Host: accept pending connections. */
+	static bool receive(Connection& c);	/* Read available bytes and dispatch complete messages. */
+	static bool flush(Connection& c);	/* Send as many pending bytes as possible. */
+	static void close(Connection& c);	/* Close a connection. */
+
+	static void write(Connection& c, MessageType type, uchar peer, const std::vector<uchar>& payload);	/* Queue a message on a connection. */
+	static void broadcast(MessageType type, const std::vector<uchar>& payload, uchar origin, const Connection *except = 0);	/* Queue a message to all (other) connections. */
+	static void dispatch(Connection& c, const MessageHeader& header, const uchar *payload);	/* Handle a received message. */
+
+	static void send_pose();	/* Broadcast the local pose (if changed). */
+	static void send_objects(struct bContext *C);	/* Broadcast local object transform / selection changes. */
+	static void send_snapshot(Connection& c);	/* Send the full shared object state to a (new) connection. */
+	static void sync_transform(Connection& c, const std::string& name, const Mat44f& obmat);	/* Host: send the changes of an object matrix to a client. */
+	static void sync_transform_all(const std::string& name, const Mat44f& obmat);	/* Host: send the changes of an object matrix to all clients. */
+	static void apply_pose(uchar peer, const uchar *payload, uint size);	/* Apply a remote pose delta. */
+	static void apply_transform(Connection& c, const uchar *payload, uint size);	/* Apply a remote transform delta (host: a client edit, client: the host state). */
+	static void apply_select(const uchar *payload, uint size);	/* Apply remote selection changes. */
+
+	static void update(struct bContext *C);	/* Exchange events with the other peers (call once per UI update). */
+	static void render(VR_Side side);	/* Render the avatars (HMD and cursors) of the remote peers. */
+	static void shutdown();	/* End the session. */
+};
+
+#endif /* __VR_SESSION_H__ */
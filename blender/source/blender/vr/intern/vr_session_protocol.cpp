@@ -0,0 +1,104 @@
+/*
+* ***** BEGIN GPL LICENSE BLOCK *****
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software Foundation,
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+* The Original Code is Copyright (C) 2019 by Blender Foundation.
+* All rights reserved.
+*
+* Contributor(s): MARUI-PlugIn, Multiplexed Reality
+*
+* ***** END GPL LICENSE BLOCK *****
+*/
+
+/** \file blender/vr/intern/vr_session_protocol.cpp
+*   \ingroup vr
+*/
+
+#include "vr_types.h"
+
+#include "vr_session_protocol.h"
+
+#include <string.h>
+
+/***************************************************************************************************
+ * \class										VR_SessionProtocol
+ ***************************************************************************************************
+ * Wire format of collaborative sessions (native little-endian, no padding):
+ *   MessageHeader, followed by header.size bytes of payload:
+ *   HELLO:     uint8 peer ID assigned to the receiver.
+ *   JOIN:      (empty) header.peer joined.
+ *   LEAVE:     (empty) header.peer left.
+ *   POSE:      uint64 mask, then one float per set bit of the mask (components of VR_Session::Pose).
+ *   TRANSFORM: uint8 name length, name, uint16 mask, then one float per set bit (components of obmat).
+ *              From clients, preceded by the uint32 number of TRANSFORM messages received from the host.
+ *   SELECT:    per object: uint8 name length, name, uint8 selected.
+ * Deltas (masks) are relative to the previous message of the same sender, which is valid
+ * since TCP delivers the messages of each connection reliably and in order.
+ * Object transforms are not relayed: the host applies the edits of the clients and sends each
+ * client the changes against the state it sent that client before. A client edit whose count of
+ * received TRANSFORM messages is behind the host may have been made on an outdated state,
+ * the host then sends the result back to that client too.
+ **************************************************************************************************/
+
+void VR_SessionProtocol::put_message(std::vector<uchar>& buf, MessageType type, uchar peer, const std::vector<uchar>& payload)
+{
+	MessageHeader header;
+	header.size = (uint)payload.size();
+	header.type = (uchar)type;
+	header.peer = peer;
+	header.reserved = 0;
+	put(buf, &header, sizeof(header));
+	buf.insert(buf.end(), payload.begin(), payload.end());
+}
+
+VR_SessionProtocol::ParseResult VR_SessionProtocol::parse_message(const uchar *data, size_t size, MessageHeader& r_header)
+{
+	if (size < sizeof(MessageHeader)) {
+		return PARSE_INCOMPLETE;
+	}
+	memcpy(&r_header, data, sizeof(r_header));
+	if (r_header.size > VR_SESSION_MAX_PAYLOAD || r_header.type >= MESSAGE_TYPES) {
+		return PARSE_ERROR;
+	}
+	if (size - sizeof(MessageHeader) < r_header.size) {
+		return PARSE_INCOMPLETE;
+	}
+	return PARSE_OK;
+}
+
+void VR_SessionProtocol::put(std::vector<uchar>& payload, const void *data, size_t size)
+{
+	const uchar *bytes = (const uchar*)data;
+	payload.insert(payload.end(), bytes, bytes + size);
+}
+
+void VR_SessionProtocol::put_name(std::vector<uchar>& payload, const char *name)
+{
+	uchar len = (uchar)strnlen(name, VR_SESSION_MAX_NAME);
+	payload.push_back(len);
+	put(payload, name, len);
+}
+
+bool VR_SessionProtocol::get_name(const uchar *&p, const uchar *end, std::string& name)
+{
+	if (p >= end || end - p < 1 + *p) {
+		return false;
+	}
+	uchar len = *p++;
+	name.assign((const char*)p, len);
+	p += len;
+	return true;
+}
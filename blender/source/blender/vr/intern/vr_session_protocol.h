@@ -0,0 +1,144 @@
+/*
+* ***** BEGIN GPL LICENSE BLOCK *****
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software Foundation,
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+* The Original Code is Copyright (C) 2019 by Blender Foundation.
+* All rights reserved.
+*
+* Contributor(s): MARUI-PlugIn, Multiplexed Reality
+*
+* ***** END GPL LICENSE BLOCK *****
+*/
+
+/** \file blender/vr/intern/vr_session_protocol.h
+*   \ingroup vr
+*/
+
+#ifndef __VR_SESSION_PROTOCOL_H__
+#define __VR_SESSION_PROTOCOL_H__
+
+#include "vr_types.h"
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+/* Maximum payload size (bytes) of a session message. */
+#define VR_SESSION_MAX_PAYLOAD	65536
+/* Maximum length of a name in a session message (length is sent as uint8). */
+#define VR_SESSION_MAX_NAME	255
+/* Relative threshold below which pose / matrix components are considered unchanged. */
+#define VR_SESSION_EPSILON	1e-5f
+
+/* Wire format of collaborative sessions (see VR_Session).
+ * Kept free of Blender dependencies, so that message framing and delta coding can be tested on their own. */
+class VR_SessionProtocol
+{
+public:
+	/* Message types. */
+	typedef enum MessageType {
+		MESSAGE_HELLO = 0	/* Host -> new client: assigned peer ID (uint8). */
+		,
+		MESSAGE_JOIN = 1	/* Host -> clients: a peer joined (resend full pose). */
+		,
+		MESSAGE_LEAVE = 2	/* Host -> clients: a peer left. */
+		,
+		MESSAGE_POSE = 3	/* Navigation matrix, HMD and cursor poses (delta-compressed). */
+		,
+		MESSAGE_TRANSFORM = 4	/* World matrix of an object (delta-compressed, client edits or host state). */
+		,
+		MESSAGE_SELECT = 5	/* Object selection changes. */
+		,
+		MESSAGE_TYPES
+	} MessageType;
+
+	/* Message header (followed by the payload). */
+	typedef struct MessageHeader {
+		uint size;	/* Payload size in bytes. */
+		uchar type;	/* MessageType. */
+		uchar peer;	/* ID of the peer that sent the message (0 = host). */
+		ushort reserved;	/* Unused (padding). */
+	} MessageHeader;
+
+	/* Result of parsing the next message of a byte stream. */
+	typedef enum ParseResult {
+		PARSE_OK = 0	/* A complete message is available. */
+		,
+		PARSE_INCOMPLETE = 1	/* More bytes have to be received first. */
+		,
+		PARSE_ERROR = 2	/* Invalid header (the stream can't be recovered). */
+	} ParseResult;
+
+	static void put_message(std::vector<uchar>& buf, MessageType type, uchar peer, const std::vector<uchar>& payload);	/* Append a message (header and payload) to a byte stream. */
+	static ParseResult parse_message(const uchar *data, size_t size, MessageHeader& r_header);	/* Parse the header of the next message of a byte stream. */
+
+	static void put(std::vector<uchar>& payload, const void *data, size_t size);	/* Append raw bytes to a payload. */
+	static void put_name(std::vector<uchar>& payload, const char *name);	/* Append a (length-prefixed) name to a payload. */
+	static bool get_name(const uchar *&p, const uchar *end, std::string& name);	/* Read a name from a payload (false if the payload is too short). */
+
+	template<typename MaskType>
+	static MaskType put_delta(std::vector<uchar>& payload, const float *a, float *base, uint count, bool full);	/* Encode the components of a that differ from base (and update base). Returns the change mask. */
+	template<typename MaskType>
+	static bool get_delta(const uchar *&p, const uchar *end, float *a, uint count, MaskType *r_mask = 0);	/* Decode a delta encoded by put_delta() into a (false if the payload is too short). */
+};
+
+template<typename MaskType>
+MaskType VR_SessionProtocol::put_delta(std::vector<uchar>& payload, const float *a, float *base, uint count, bool full)
+{
+	MaskType mask = 0;
+	for (uint i = 0; i < count; ++i) {
+		if (full || fabsf(a[i] - base[i]) > VR_SESSION_EPSILON * (1.0f + fabsf(base[i]))) {
+			mask |= (MaskType)1 << i;
+		}
+	}
+	if (!mask) {
+		return 0;
+	}
+	put(payload, &mask, sizeof(mask));
+	for (uint i = 0; i < count; ++i) {
+		if (mask & ((MaskType)1 << i)) {
+			put(payload, &a[i], sizeof(float));
+			base[i] = a[i];
+		}
+	}
+	return mask;
+}
+
+template<typename MaskType>
+bool VR_SessionProtocol::get_delta(const uchar *&p, const uchar *end, float *a, uint count, MaskType *r_mask)
+{
+	MaskType mask;
+	if (end - p < (ptrdiff_t)sizeof(mask)) {
+		return false;
+	}
+	memcpy(&mask, p, sizeof(mask));
+	p += sizeof(mask);
+	for (uint i = 0; i < count; ++i) {
+		if (mask & ((MaskType)1 << i)) {
+			if (end - p < (ptrdiff_t)sizeof(float)) {
+				return false;
+			}
+			memcpy(&a[i], p, sizeof(float));
+			p += sizeof(float);
+		}
+	}
+	if (r_mask) {
+		*r_mask = mask;
+	}
+	return true;
+}
+
+#endif /* __VR_SESSION_PROTOCOL_H__ */
@@ -0,0 +1,339 @@
+/*
+* ***** BEGIN GPL LICENSE BLOCK *****
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software Foundation,
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+* The Original Code is Copyright (C) 2019 by Blender Foundation.
+* All rights reserved.
+*
+* Contributor(s): MARUI-PlugIn, Multiplexed Reality
+*
+* ***** END GPL LICENSE BLOCK *****
+*/
+
+/** \file blender/vr/intern/vr_timing.cpp
+*   \ingroup vr
+*
+* Frame timing instrumentation of the VR module.
+*/
+
+#include "vr_types.h"
+
+#include "vr_timing.h"
+#include "vr_draw.h"
+#include "vr_math.h"
+
+#include "BLI_math.h"
+
+#include "PIL_time.h"
+
+#include "vr_api.h"
+
+#include <stdio.h>
+#include <vector>
+
+/***************************************************************************************************
+ * \class										VR_Timing
+ ***************************************************************************************************
+ * Frame timing instrumentation of the VR module.
+ **************************************************************************************************/
+
+bool VR_Timing::show_graph(VR_TIMING_GRAPH);
+VR_Timing::Slot VR_Timing::slots[VR_TIMING_SAMPLES];
+std::atomic<uint> VR_Timing::head(0);
+std::atomic<uint> VR_Timing::frame(0);
+std::atomic<uint> VR_Timing::frame_sums[VR_TIMING_HISTORY + 1][VR_TIMING_STAGES];
+double VR_Timing::epoch(0.0);
+double VR_Timing::frame_start(0.0);
+std::string VR_Timing::labels[VR_TIMING_STAGES][VR_TIMING_INDICES];
+
+/* Default names of the stages (used if no label is set). */
+static const char *const stage_names[VR_TIMING_STAGES] = {
+	"frame",
+	"tracking",
+	"operations",
+	"scene",
+	"widget",
+	"blit",
+	"encode",
+};
+
+/* Colors of the stages in the graph. */
+static const float stage_colors[VR_TIMING_STAGES][4] = {
+	{ 1.0f, 1.0f, 1.0f, 1.0f },	/* frame */
+	{ 0.2f, 0.8f, 0.2f, 1.0f },	/* tracking */
+	{ 0.9f, 0.9f, 0.2f, 1.0f },	/* operations */
+	{ 0.2f, 0.5f, 1.0f, 1.0f },	/* scene */
+	{ 1.0f, 0.5f, 0.0f, 1.0f },	/* widget */
+	{ 0.9f, 0.2f, 0.2f, 1.0f },	/* blit */
+	{ 0.7f, 0.3f, 0.9f, 1.0f },	/* encode */
+};
+
+double VR_Timing::now()
+{
+	return PIL_check_seconds_timer();
+}
+
+void VR_Timing::begin_frame()
+{
+	const double t = now();
+	if (epoch == 0.0) {
+		epoch = frame_start = t;
+	}
+	else {
+		/* Complete the previous frame. */
+		record(VR_TIMING_FRAME, 0, frame_start);
+		frame_start = t;
+	}
+
+	const uint f = frame.load(std::memory_order_relaxed) + 1;
+	std::atomic<uint> *sums = frame_sums[f % (VR_TIMING_HISTORY + 1)];
+	for (int i = 0; i < VR_TIMING_STAGES; ++i) {
+		sums[i].store(0, std::memory_order_relaxed);
+	}
+	frame.store(f, std::memory_order_relaxed);
+}
+
+void VR_Timing::record(VR_TimingStage stage, int index, double start)
+{
+	const double end = now();
+	const uint f = frame.load(std::memory_order_relaxed);
+	const uint duration = (end > start) ? (uint)((end - start) * 1000000.0) : 0;
+	const ui64 start_us = (start > epoch) ? (ui64)((start - epoch) * 1000000.0) : 0;
+
+	frame_sums[f % (VR_TIMING_HISTORY + 1)][stage].fetch_add(duration, std::memory_order_relaxed);
+
+	/* Claim a slot and mark it as incomplete while writing (seqlock). */
+	const uint n = head.fetch_add(1, std::memory_order_relaxed);
+	Slot& slot = slots[n & (VR_TIMING_SAMPLES - 1)];
+	slot.seq.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.frame.store(f, std::memory_order_relaxed);
+	slot.id.store((uint)stage | ((uint)(index & (VR_TIMING_INDICES - 1)) << 8), std::memory_order_relaxed);
+	slot.start.store(start_us, std::memory_order_relaxed);
+	slot.duration.store(duration, std::memory_order_relaxed);
+	slot.seq.store(n + 1, std::memory_order_release);
+}
+
+void VR_Timing::set_label(VR_TimingStage stage, int index, const std::string& label)
+{
+	labels[stage][index & (VR_TIMING_INDICES - 1)] = label;
+}
+
+uint VR_Timing::get_samples(Sample *samples, uint max_samples)
+{
+	const uint h = head.load(std::memory_order_acquire);
+	uint count = (h < VR_TIMING_SAMPLES) ? h : VR_TIMING_SAMPLES;
+	if (count > max_samples) {
+		count = max_samples;
+	}
+
+	uint num = 0;
+	for (uint n = h - count; n != h; ++n) {
+		const Slot& slot = slots[n & (VR_TIMING_SAMPLES - 1)];
+		if (slot.seq.load(std::memory_order_acquire) != n + 1) {
+			/* Being written or already overwritten. */
+			continue;
+		}
+		Sample& s = samples[num];
+		s.frame = slot.frame.load(std::memory_order_relaxed);
+		const uint id = slot.id.load(std::memory_order_relaxed);
+		s.stage = (uchar)(id & 0xFF);
+		s.index = (uchar)(id >> 8);
+		s.start = slot.start.load(std::memory_order_relaxed);
+		s.duration = slot.duration.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.seq.load(std::memory_order_relaxed) != n + 1) {
+			continue;
+		}
+		++num;
+	}
+
+	return num;
+}
+
+float VR_Timing::get_frame_time(uint frames_ago, VR_TimingStage stage)
+{
+	const uint f = frame.load(std::memory_order_relaxed);
+	if (frames_ago >= VR_TIMING_HISTORY || f < frames_ago + 1) {
+		return 0.0f;
+	}
+	const uint sum = frame_sums[(f - frames_ago - 1) % (VR_TIMING_HISTORY + 1)][stage].load(std::memory_order_relaxed);
+	return (float)sum / 1000.0f;
+}
+
+/* Write a string with JSON escaping. */
+static void write_json_string(FILE *file, const char *str)
+{
+	fputc('"', file);
+	for (; *str; ++str) {
+		if (*str == '"' || *str == '\\') {
+			fputc('\\', file);
+		}
+		if ((uchar)*str >= 0x20) {
+			fputc(*str, file);
+		}
+	}
+	fputc('"', file);
+}
+
+bool VR_Timing::dump(const char *filepath)
+{
+	std::vector<Sample> samples(VR_TIMING_SAMPLES);
+	const uint num = get_samples(samples.data(), VR_TIMING_SAMPLES);
+
+	FILE *file = fopen(filepath, "w");
+	if (!file) {
+		return false;
+	}
+
+	const size_t len = strlen(filepath);
+	const bool csv = (len >= 4 && strcmp(&filepath[len - 4], ".csv") == 0);
+
+	if (csv) {
+		fprintf(file, "frame,stage,index,label,start_us,duration_us\n");
+	}
+	else {
+		/* Chrome trace event format (chrome://tracing, Perfetto). */
+		fprintf(file, "{\"traceEvents\":[\n");
+	}
+
+	for (uint i = 0; i < num; ++i) {
+		const Sample& s = samples[i];
+		const char *stage = (s.stage < VR_TIMING_STAGES) ? stage_names[s.stage] : "unknown";
+		const std::string& label = (s.stage < VR_TIMING_STAGES) ? labels[s.stage][s.index] : labels[0][0];
+		const char *name = label.empty() ? stage : label.c_str();
+		if (csv) {
+			fprintf(file, "%u,%s,%u,%s,%llu,%u\n", s.frame, stage, (uint)s.index, name, (unsigned long long)s.start, s.duration);
+		}
+		else {
+			fprintf(file, "%s{\"name\":", i ? ",\n" : "");
+			write_json_string(file, name);
+			/* The encode runs on the image thread. */
+			fprintf(file, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%u,\"pid\":0,\"tid\":%d,\"args\":{\"frame\":%u,\"index\":%u}}",
+				stage, (unsigned long long)s.start, s.duration, (s.stage == VR_TIMING_ENCODE) ? 1 : 0, s.frame, (uint)s.index);
+		}
+	}
+
+	if (!csv) {
+		fprintf(file, "\n]}\n");
+	}
+
+	return (fclose(file) == 0);
+}
+
+void VR_Timing::render_graph(const Mat44f& t_hmd)
+{
+	static const float width = 0.3f;
+	static const float height = 0.1f;
+	static const float left = -width / 2.0f;
+	static const float bottom = -height / 2.0f;
+	static const float bar_width = width / VR_TIMING_HISTORY;
+	/* Stages drawn stacked (all sequential on the main thread). */
+	static const VR_TimingStage stacked[] = { VR_TIMING_TRACKING, VR_TIMING_OPERATIONS, VR_TIMING_SCENE, VR_TIMING_WIDGET, VR_TIMING_BLIT };
+
+	/* Below the center of the view, facing the HMD. */
+	Mat44f model = VR_Math::identity_f;
+	model.m[3][1] = -0.12f;
+	model.m[3][2] = -0.5f;
+	model = model * t_hmd;
+
+	const Mat44f prior_model_matrix = VR_Draw::get_model_matrix();
+	VR_Draw::update_modelview_matrix(&model, 0);
+	VR_Draw::begin_batch();
+	VR_Draw::set_depth_test(false, false);
+	VR_Draw::set_blend(true);
+
+	/* Background */
+	VR_Draw::set_color(0.0f, 0.0f, 0.0f, 0.6f);
+	VR_Draw::render_rect(left, -left, -bottom, bottom, 0.0f);
+
+	const float scale = height / VR_TIMING_GRAPH_RANGE;
+	for (uint i = 0; i < VR_TIMING_HISTORY; ++i) {
+		/* Oldest frame on the left. */
+		const uint frames_ago = VR_TIMING_HISTORY - 1 - i;
+		const float x0 = left + (float)i * bar_width;
+		const float x1 = x0 + bar_width;
+		float y = bottom;
+		for (uint j = 0; j < sizeof(stacked) / sizeof(stacked[0]); ++j) {
+			float t = get_frame_time(frames_ago, stacked[j]);
+			if (stacked[j] == VR_TIMING_SCENE) {
+				/* The widgets are drawn as part of the scene. */
+				t -= get_frame_time(frames_ago, VR_TIMING_WIDGET);
+			}
+			if (t <= 0.0f) {
+				continue;
+			}
+			const float y1 = min_ff(y + t * scale, -bottom);
+			VR_Draw::set_color(stage_colors[stacked[j]]);
+			VR_Draw::render_rect(x0, x1, y1, y, 0.001f);
+			y = y1;
+		}
+		/* Frame interval (includes waiting for the HMD compositor). */
+		const float frame_time = get_frame_time(frames_ago, VR_TIMING_FRAME);
+		if (frame_time > 0.0f) {
+			const float yf = min_ff(bottom + frame_time * scale, -bottom);
+			VR_Draw::set_color(stage_colors[VR_TIMING_FRAME]);
+			VR_Draw::render_rect(x0, x1, yf + 0.0005f, yf - 0.0005f, 0.002f);
+		}
+	}
+
+	/* Frame budget */
+	const float yb = bottom + VR_TIMING_GRAPH_BUDGET * scale;
+	VR_Draw::set_color(1.0f, 0.0f, 0.0f, 0.8f);
+	VR_Draw::render_rect(left, -left, yb + 0.0005f, yb - 0.0005f, 0.002f);
+
+	/* Last frame / encode times */
+	static char str[64];
+	sprintf(str, "%.1f ms  enc %.1f ms", get_frame_time(0, VR_TIMING_FRAME), get_frame_time(0, VR_TIMING_ENCODE));
+	VR_Draw::set_color(1.0f, 1.0f, 1.0f, 1.0f);
+	VR_Draw::render_string(str, 0.006f, 0.009f, VR_HALIGN_LEFT, VR_VALIGN_TOP, left + 0.005f, -bottom - 0.005f, 0.003f);
+
+	VR_Draw::set_depth_test(true, true);
+	VR_Draw::end_batch();
+	VR_Draw::update_modelview_matrix(&prior_model_matrix, 0);
+}
+
+/***************************************************************************************************
+ *											 vr_api
+ ***************************************************************************************************/
+/* Current time stamp to pass to vr_api_timing_record(). */
+double vr_api_timing_now()
+{
+	return VR_Timing::now();
+}
+
+/* Start a new frame for the frame timing instrumentation. */
+int vr_api_timing_begin_frame()
+{
+	VR_Timing::begin_frame();
+	return 0;
+}
+
+/* Record the time of a frame stage from start until now. */
+int vr_api_timing_record(int stage, int index, double start)
+{
+	if (stage < 0 || stage >= VR_TIMING_STAGES) {
+		return -1;
+	}
+	VR_Timing::record((VR_TimingStage)stage, index, start);
+	return 0;
+}
+
+/* Write the recorded frame timings to a CSV or JSON trace file. */
+int vr_api_timing_dump(const char *filepath)
+{
+	return VR_Timing::dump(filepath) ? 0 : -1;
+}
@@ -0,0 +1,107 @@
+/*
+* ***** BEGIN GPL LICENSE BLOCK *****
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software Foundation,
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*
+* The Original Code is Copyright (C) 2019 by Blender Foundation.
+* All rights reserved.
+*
+* Contributor(s): MARUI-PlugIn, Multiplexed Reality
+*
+* ***** END GPL LICENSE BLOCK *****
+*/
+
+/** \file blender/vr/intern/vr_timing.h
+*   \ingroup vr
+*/
+
+#ifndef __VR_TIMING_H__
+#define __VR_TIMING_H__
+
+#include "vr_types.h"
+#include "vr_main.h"
+
+#include <atomic>
+#include <string>
+
+#define VR_TIMING_SAMPLES		4096	/* Capacity of the sample ring buffer (power of two). */
+#define VR_TIMING_HISTORY		90		/* Number of frames shown in the graph. */
+#define VR_TIMING_INDICES		256		/* Number of distinguishable indices (eyes, widget types) per stage. */
+#define VR_TIMING_GRAPH			0		/* Show the frame timing graph in the HMD by default. */
+#define VR_TIMING_GRAPH_RANGE	22.2f	/* Time (in ms) corresponding to the full height of the graph. */
+#define VR_TIMING_GRAPH_BUDGET	11.1f	/* Frame time budget (in ms) marked in the graph (90 Hz). */
+
+/* Frame timing instrumentation.
+ * Timers of the VR frame stages (see VR_TimingStage) are recorded into a fixed-size
+ * ring buffer that can be written from any thread without locking (the image thread
+ * records the network encode). The most recent samples can be dumped to a CSV or
+ * JSON (Chrome trace event format) file, and the per-frame sums are shown as a
+ * stacked bar graph in the HMD. */
+class VR_Timing
+{
+public:
+	/* Recorded timer sample. */
+	typedef struct Sample {
+		uint	frame;		/* Frame number the sample was recorded in. */
+		uchar	stage;		/* Frame stage (see VR_TimingStage). */
+		uchar	index;		/* Stage-dependent index (eye, widget type, ...). */
+		ui64	start;		/* Start time in microseconds (since the first frame). */
+		uint	duration;	/* Duration in microseconds. */
+	} Sample;
+
+	static bool show_graph;	/* Whether to render the timing graph in the HMD. */
+
+	static double now();	/* Current time stamp (in seconds) to pass to record(). */
+	static void begin_frame();	/* Start a new frame. Must be called once per VR frame from the main thread. */
+	static void record(VR_TimingStage stage, int index, double start);	/* Record the time from start until now. Thread-safe, lock-free. */
+	static void set_label(VR_TimingStage stage, int index, const std::string& label);	/* Set a human-readable name for a stage index (main thread only). */
+
+	static uint get_samples(Sample *samples, uint max_samples);	/* Copy the most recent samples (oldest first). Returns the number of samples copied. */
+	static float get_frame_time(uint frames_ago, VR_TimingStage stage);	/* Summed time (in ms) of a stage in a completed frame (0 = last completed frame). */
+
+	static bool dump(const char *filepath);	/* Write the recorded samples to a file (".csv": CSV, otherwise JSON trace events). */
+	static void render_graph(const Mat44f& t_hmd);	/* Render the frame timing graph in front of the HMD (real-world space). */
+
+	/* RAII helper recording the lifetime of the object as one sample. */
+	class Scope {
+	public:
+		Scope(VR_TimingStage stage, int index = 0) : stage(stage), index(index), start(VR_Timing::now()) {}
+		~Scope() { VR_Timing::record(stage, index, start); }
+	protected:
+		VR_TimingStage	stage;
+		int		index;
+		double	start;
+	};
+protected:
+	/* Ring buffer slot. Fields are written before seq, which is
+	 * set to the sample number + 1 once the slot is complete. */
+	typedef struct Slot {
+		std::atomic<uint> seq;		/* Sample number + 1 of the stored sample (0 while being written). */
+		std::atomic<uint> frame;	/* See Sample::frame. */
+		std::atomic<uint> id;		/* Stage | (index << 8). */
+		std::atomic<ui64> start;	/* See Sample::start. */
+		std::atomic<uint> duration;	/* See Sample::duration. */
+	} Slot;
+
+	static Slot slots[VR_TIMING_SAMPLES];	/* Sample ring buffer. */
+	static std::atomic<uint> head;	/* Number of samples recorded so far. */
+	static std::atomic<uint> frame;	/* Current frame number. */
+	static std::atomic<uint> frame_sums[VR_TIMING_HISTORY + 1][VR_TIMING_STAGES];	/* Summed duration (microseconds) per stage, for the current and the last completed frames. */
+	static double epoch;	/* Time stamp of the first frame. */
+	static double frame_start;	/* Time stamp of the start of the current frame. */
+	static std::string labels[VR_TIMING_STAGES][VR_TIMING_INDICES];	/* Names of the stage indices (if set). */
+};
+
+#endif /* __VR_TIMING_H__ */
@@ -37,6 +37,7 @@
 #include "vr_widget_transform.h"
 #include "vr_widget_navi.h"
 #include "vr_widget_animation.h"
+#include "vr_widget_annotate.h"
 
 #include "vr_ui.h"
 
@@ -45,6 +46,8 @@
 #include "vr_math.h"
 #include "vr_draw.h"
 #include "vr_network.h"
+#include "vr_session.h"
+#include "vr_timing.h"
 
 #ifdef WIN32
 #include "BLI_winstuff.h"
@@ -1120,6 +1123,9 @@ VR_UI::Error VR_UI::execute_operations()
 	/* Update any object bindings. */
 	Widget_Animation::update_bindings();
 
+	/* Exchange edit events with the other peers of a shared session (if any). */
+	VR_Session::update(vr_get_obj()->ctx);
+
 	/* Update menus. */
 	//VR_UI::update_menus();
 
@@ -1602,40 +1608,57 @@ VR_UI::Error VR_UI::execute_post_render_operations()
 {
 	if (VR_UI::ui_type == VR_DEVICE_TYPE_MAGICLEAP) {
 		/* Get viewport bitmap and send to client. */
-		if (VR_Network::network_status == VR_Network::NETWORKSTATUS_CONNECTED &&
-			!VR_Network::data_new) {
+		if (VR_Network::network_status == VR_Network::NETWORKSTATUS_CONNECTED) {
 #if VR_NETWORK_IMAGE_STREAMING
-			for (int i = 0; i < VR_SIDES; ++i) {
-				GPUViewport *viewport = vr_get_obj()->viewport[i];
-				if (viewport) {
+			/* Pick up the readback of a previous frame (if finished) and start the one for this frame. */
+			VR_Network::ImageData *images = VR_Network::begin_frame();
+			if (vr_stream_readback_fetch(images[VR_SIDE_LEFT].buf, images[VR_SIDE_RIGHT].buf) == 0) {
+				/* Hand both eyes over at once. */
+				VR_Network::publish_frame();
+				images = VR_Network::begin_frame();
+			}
+			if (vr_stream_readback_queue(images[VR_SIDE_LEFT].w, images[VR_SIDE_LEFT].h, 1) < 0) {
+				/* No GPU readback available: fall back to a synchronous read.
+				 * A frame the image thread did not pick up yet is replaced by this one. */
+				bool complete = true;
+				for (int i = 0; i < VR_SIDES; ++i) {
+					GPUViewport *viewport = vr_get_obj()->viewport[i];
 					GPUTexture *color_tex = NULL;
 					GPUTexture *depth_tex = NULL;
-					DefaultFramebufferList *dfbl = viewport->fbl;
-					if (dfbl->default_fb) {
-						DefaultTextureList *dtxl = viewport->txl;
-						color_tex = dtxl->color;
-						depth_tex = dtxl->depth;
-					}
-					if (color_tex && depth_tex) {
-						uchar *color_data = (uchar*)GPU_texture_read(color_tex, GPU_DATA_UNSIGNED_BYTE, 0);
-						uint *depth_data = (uint*)GPU_texture_read(depth_tex, GPU_DATA_UNSIGNED_INT_24_8, 0);
-						if (color_data && depth_data) {
-							/* Resample */
-							/* TODO_XR: Do this on image processing thread. */
-							VR_Network::ImageData& data = VR_Network::image_data[i];
-							VR_Network::resample_pixels(color_data, color_tex->w, color_tex->h,
-								data.buf, data.w, data.h, data.d,
-								depth_data);
-
-							VR_Network::data_new = true;
-						}
-						if (color_data) {
-							MEM_freeN(color_data);
-						}
-						if (depth_data) {
-							MEM_freeN(depth_data);
+					if (viewport) {
+						DefaultFramebufferList *dfbl = viewport->fbl;
+						if (dfbl->default_fb) {
+							DefaultTextureList *dtxl = viewport->txl;
+							color_tex = dtxl->color;
+							depth_tex = dtxl->depth;
 						}
 					}
+					if (!color_tex || !depth_tex) {
+						complete = false;
+						break;
+					}
+					uchar *color_data = (uchar*)GPU_texture_read(color_tex, GPU_DATA_UNSIGNED_BYTE, 0);
+					uint *depth_data = (uint*)GPU_texture_read(depth_tex, GPU_DATA_UNSIGNED_INT_24_8, 0);
+					if (color_data && depth_data) {
+						/* Resample */
+						VR_Network::ImageData& data = images[i];
+						VR_Network::resample_pixels(color_data, color_tex->w, color_tex->h,
+							data.buf, data.w, data.h, data.d,
+							depth_data);
+					}
+					else {
+						complete = false;
+					}
+					if (color_data) {
+						MEM_freeN(color_data);
+					}
+					if (depth_data) {
+						MEM_freeN(depth_data);
+					}
+				}
+				if (complete) {
+					/* Hand both eyes over at once. */
+					VR_Network::publish_frame();
 				}
 			}
 #else
@@ -1685,6 +1708,9 @@ VR_UI::Error VR_UI::post_render(VR_Side side)
 	/* Apply widget render functions (if any). */
 	execute_widget_renders(side);
 
+	/* Render the other peers of a shared session (if any). */
+	VR_Session::render(side);
+
 	if (VR_UI::ui_type == VR_DEVICE_TYPE_FOVE) {
 		/* Render box for eye cursor (convergence) position. */
 		VR_Draw::update_modelview_matrix(&VR_Math::identity_f, 0);
@@ -1695,7 +1721,9 @@ VR_UI::Error VR_UI::post_render(VR_Side side)
 							*(Coord3Df*)(t_controller.m[3]) + Coord3Df(-1, -1, -1) * 0.02f);
 
 		const Mat44f& t_hmd = VR_UI::hmd_position_get(VR_SPACE_REAL);
+		VR_Draw::begin_batch();
 		VR_UI::render_widget_icons(VR_SIDE_MONO, t_hmd);
+		VR_Draw::end_batch();
 	}
 	else {
 		/* Create controllers if they haven't already been created. */
@@ -1750,6 +1778,10 @@ VR_UI::Error VR_UI::post_render(VR_Side side)
 	/* Render menus. */
 	//render_menus(0, 0);
 
+	if (VR_Timing::show_graph) {
+		VR_Timing::render_graph(VR_UI::hmd_position_get(VR_SPACE_REAL));
+	}
+
 	return ERROR_NONE;
 }
 
@@ -1873,8 +1905,10 @@ VR_UI::Error VR_UI::render_controller(VR_Side controller_side)
 			break;
 		}
 		}
+		VR_Draw::begin_batch();
 		render_widget_icons(VR_SIDE_LEFT, t_controller_left);
 		render_widget_icons(VR_SIDE_RIGHT, t_controller_right);
+		VR_Draw::end_batch();
 
 		return ERROR_NONE;
 	}
@@ -1934,7 +1968,9 @@ VR_UI::Error VR_UI::render_controller(VR_Side controller_side)
 	VR_Draw::render_rect(-0.005f, 0.005f, 0.005f, -0.005f, 0.001f, 1.0f, 1.0f, VR_Draw::cursor_tex);
 	VR_Draw::set_depth_test(true, true);
 	
+	VR_Draw::begin_batch();
 	render_widget_icons(controller_side, t_controller);
+	VR_Draw::end_batch();
 
 	return ERROR_NONE;
 }
@@ -2131,6 +2167,12 @@ VR_UI::Error VR_UI::execute_widget_renders(VR_Side side)
 			VR_Widget* widget = VR_Layout::current_layout->m[controller_side][btn];
 			if (widget && widget->do_render[side]) {
 				VR_Widget::Type type = widget->type();
+				static bool timing_labeled[VR_TIMING_INDICES] = { false };
+				if (!timing_labeled[type]) {
+					VR_Timing::set_label(VR_TIMING_WIDGET, type, widget->name());
+					timing_labeled[type] = true;
+				}
+				VR_Timing::Scope timing(VR_TIMING_WIDGET, type);
 				if ((type == VR_Widget::TYPE_TRANSFORM 
 					|| type == VR_Widget::TYPE_EXTRUDE) && !manip_rendered) {
 					/* Manipulator */
@@ -2323,6 +2365,8 @@ int vr_api_post_render(int side)
 /* Un-initialize the internal object. */
 int vr_api_uninit_ui()
 {
+	VR_Session::shutdown();
+	Widget_Annotate::free_batches();
 	VR_Draw::uninit();
 	VR_UI::shutdown();
 	return 0;
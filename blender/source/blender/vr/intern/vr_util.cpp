@@ -36,8 +36,14 @@
 #include "vr_ui.h"
 #include "vr_util.h"
 
+#include "MEM_guardedalloc.h"
+
+#include "BLI_kdopbvh.h"
 #include "BLI_math.h"
 
+extern "C" {
+#include "BKE_bvhutils.h"
+}
 #include "BKE_context.h"
 #include "BKE_editmesh.h"
 #include "BKE_layer.h"
@@ -45,6 +51,8 @@
 
 #include "DEG_depsgraph.h"
 
+#include "DNA_mesh_types.h"
+
 #include "ED_gpencil.h"
 #include "ED_mesh.h"
 #include "ED_object.h"
@@ -168,48 +176,264 @@ void VR_Util::deselectall_edit(BMesh *bm, int mode)
 	}
 }
 
-/* Adapted from view3d_select.c */
-void VR_Util::raycast_select_single_vertex(const Coord3Df& p, ViewContext *vc, bool extend, bool deselect)
+/* Get the pick ray (Blender space) from the dominant eye through p (real space). */
+static void raycast_ray_get(const Coord3Df& p, float r_start[3], float r_dir[3])
 {
-	/* TODO_XR: Use rv3d->persmat of dominant eye. */
-	bContext *C = vr_get_obj()->ctx;
-	ARegion *ar = CTX_wm_region(C);
-	RegionView3D *rv3d = (RegionView3D*)ar->regiondata;
-	float dist = ED_view3d_select_dist_px() * 1.3333f;
-	int mval[2];
-	VR_Side side = VR_UI::eye_dominance_get();
-	VR_UI::get_pixel_coordinates(p, mval[0], mval[1], side);
-	const float mval_fl[2] = { (float)mval[0], (float)mval[1] };
-	float screen_co[2];
-	bool is_inside = false;
+	const Mat44f& eye = VR_UI::eye_position_get(VR_SPACE_BLENDER, VR_UI::eye_dominance_get());
+	const Coord3Df end = VR_UI::convert_space(p, VR_SPACE_REAL, VR_SPACE_BLENDER);
+	copy_v3_v3(r_start, eye.m[3]);
+	sub_v3_v3v3(r_dir, (const float*)&end, r_start);
+	normalize_v3(r_dir);
+}
 
-	BM_mesh_elem_table_ensure(vc->em->bm, BM_VERT);
-	BMVert *sv = NULL;
+/* Transform the ray into object space (the BVH trees are built in mesh space). */
+static void raycast_ray_to_object(
+	const float obmat[4][4], const float start[3], const float dir[3],
+	float r_start[3], float r_dir[3])
+{
+	float imat[4][4];
+	invert_m4_m4(imat, obmat);
+	mul_v3_m4v3(r_start, imat, start);
+	mul_v3_mat3_m4v3(r_dir, imat, dir);
+	normalize_v3(r_dir);
+}
 
-	const Mat44f& offset = *(Mat44f*)vc->obedit->obmat;
-	static Coord3Df pos;
-	BMVert *v;
-	BMIter iter;
-	BMesh *bm = vc->em->bm;
-	BM_ITER_MESH(v, &iter, bm, BM_VERTS_OF_MESH) {
-		if (!BM_elem_flag_test(v, BM_ELEM_HIDDEN)) {
-			VR_Math::multiply_mat44_coord3D(pos, offset, *(Coord3Df*)v->co);
-			if (view3d_project(
-				ar, rv3d->persmat, false, (float*)&pos, screen_co,
-				(eV3DProjTest)(V3D_PROJ_TEST_CLIP_BB | V3D_PROJ_TEST_CLIP_NEAR)) == V3D_PROJ_RET_OK)
-			{
-				float dist_temp = len_manhattan_v2v2(mval_fl, screen_co);
-				dist_temp += (dist * 0.1f); //10.0f
-				if (dist_temp < dist) {
-					dist = dist_temp;
-					sv = v;
-					is_inside = true;
+/* Ray cast callback for edit-mesh looptris, skipping hidden faces. */
+static void raycast_edit_looptri_cb(void *userdata, int index, const BVHTreeRay *ray, BVHTreeRayHit *hit)
+{
+	const BMEditMesh *em = (const BMEditMesh*)userdata;
+	BMLoop **ltri = em->looptris[index];
+	if (BM_elem_flag_test(ltri[0]->f, BM_ELEM_HIDDEN)) {
+		return;
+	}
+	const float dist = bvhtree_ray_tri_intersection(ray, hit->dist, ltri[0]->v->co, ltri[1]->v->co, ltri[2]->v->co);
+	if (dist >= 0.0f && dist < hit->dist) {
+		hit->index = index;
+		hit->dist = dist;
+		madd_v3_v3v3fl(hit->co, ray->origin, ray->direction, dist);
+		normal_tri_v3(hit->no, ltri[0]->v->co, ltri[1]->v->co, ltri[2]->v->co);
+	}
+}
+
+/* Projected distance callback for edit-mesh vertices (userdata: BMEditMesh). */
+static void raycast_edit_nearest_vert_cb(
+	void *userdata, int index, const DistProjectedAABBPrecalc *precalc,
+	const float (*clip_plane)[4], const int clip_plane_len, BVHTreeNearest *nearest)
+{
+	const BMEditMesh *em = (const BMEditMesh*)userdata;
+	BMVert *v = BM_vert_at_index(em->bm, index);
+	if (BM_elem_flag_test(v, BM_ELEM_HIDDEN)) {
+		return;
+	}
+	float co2d[2] = {
+		dot_m4_v3_row_x(precalc->pmat, v->co) + precalc->pmat[3][0],
+		dot_m4_v3_row_y(precalc->pmat, v->co) + precalc->pmat[3][1] };
+	const float w = mul_project_m4_v3_zfac(precalc->pmat, v->co);
+	if (w <= 0.0f) {
+		return;
+	}
+	mul_v2_fl(co2d, 1.0f / w);
+	const float dist_sq = len_squared_v2v2(precalc->mval, co2d);
+	if (dist_sq < nearest->dist_sq) {
+		nearest->index = index;
+		nearest->dist_sq = dist_sq;
+		copy_v3_v3(nearest->co, v->co);
+	}
+}
+
+/* Projected distance callback for edit-mesh edges (userdata: BMEditMesh). Edges are picked by their midpoints. */
+static void raycast_edit_nearest_edge_cb(
+	void *userdata, int index, const DistProjectedAABBPrecalc *precalc,
+	const float (*clip_plane)[4], const int clip_plane_len, BVHTreeNearest *nearest)
+{
+	const BMEditMesh *em = (const BMEditMesh*)userdata;
+	BMEdge *e = BM_edge_at_index(em->bm, index);
+	if (BM_elem_flag_test(e, BM_ELEM_HIDDEN)) {
+		return;
+	}
+	float mid[3];
+	mid_v3_v3v3(mid, e->v1->co, e->v2->co);
+	float co2d[2] = {
+		dot_m4_v3_row_x(precalc->pmat, mid) + precalc->pmat[3][0],
+		dot_m4_v3_row_y(precalc->pmat, mid) + precalc->pmat[3][1] };
+	const float w = mul_project_m4_v3_zfac(precalc->pmat, mid);
+	if (w <= 0.0f) {
+		return;
+	}
+	mul_v2_fl(co2d, 1.0f / w);
+	const float dist_sq = len_squared_v2v2(precalc->mval, co2d);
+	if (dist_sq < nearest->dist_sq) {
+		nearest->index = index;
+		nearest->dist_sq = dist_sq;
+		copy_v3_v3(nearest->co, mid);
+	}
+}
+
+Base *VR_Util::raycast_pick_object(const Coord3Df& p, ViewContext *vc, Base *startbase, float *r_dist)
+{
+	float ray_start[3], ray_dir[3];
+	raycast_ray_get(p, ray_start, ray_dir);
+
+	const int object_type_exclude_select = (
+		vc->v3d->object_type_exclude_viewport | vc->v3d->object_type_exclude_select);
+	Base *basact = NULL;
+	float dist_min = BVH_RAYCAST_DIST_MAX;
+
+	Base *base = startbase;
+	while (base) {
+		Object *ob = base->object;
+		if (BASE_SELECTABLE(vc->v3d, base) &&
+			((object_type_exclude_select & (1 << ob->type)) == 0) &&
+			ob->type == OB_MESH)
+		{
+			/* The trees are cached in the runtime data of the evaluated mesh,
+			 * so they persist across frames until the depsgraph re-evaluates the object. */
+			Mesh *me_eval = BKE_object_get_evaluated_mesh(vc->depsgraph, ob);
+			if (me_eval) {
+				BVHTreeFromMesh treedata = { NULL };
+				BKE_bvhtree_from_mesh_get(&treedata, me_eval, BVHTREE_FROM_LOOPTRI, 4);
+				if (treedata.tree) {
+					float start_local[3], dir_local[3];
+					raycast_ray_to_object(ob->obmat, ray_start, ray_dir, start_local, dir_local);
+
+					BVHTreeRayHit hit;
+					hit.index = -1;
+					hit.dist = BVH_RAYCAST_DIST_MAX;
+					if (BLI_bvhtree_ray_cast(
+						treedata.tree, start_local, dir_local, 0.0f, &hit,
+						treedata.raycast_callback, &treedata) != -1)
+					{
+						mul_m4_v3(ob->obmat, hit.co);
+						const float dist = len_v3v3(ray_start, hit.co);
+						if (dist < dist_min) {
+							dist_min = dist;
+							basact = base;
+						}
+					}
 				}
+				free_bvhtree_from_mesh(&treedata);
 			}
 		}
+		base = base->next;
+
+		if (base == NULL) base = (Base*)FIRSTBASE(vc->view_layer);
+		if (base == startbase) break;
 	}
 
-	if (is_inside && sv) {
+	if (r_dist) {
+		*r_dist = dist_min;
+	}
+	return basact;
+}
+
+BMElem *VR_Util::raycast_pick_edit(const Coord3Df& p, ViewContext *vc, char htype)
+{
+	BMEditMesh *em = vc->em;
+	BMesh *bm = em->bm;
+	Object *obedit = vc->obedit;
+	BVHCache **bvh_cache = em->mesh_eval_final ? &em->mesh_eval_final->runtime.bvh_cache : NULL;
+
+	float ray_start[3], ray_dir[3], start_local[3], dir_local[3];
+	raycast_ray_get(p, ray_start, ray_dir);
+	raycast_ray_to_object(obedit->obmat, ray_start, ray_dir, start_local, dir_local);
+
+	BM_mesh_elem_table_ensure(bm, htype);
+
+	/* 1: Ray cast against the faces. */
+	BMElem *ele = NULL;
+	BVHTreeFromEditMesh treedata = { NULL };
+	BKE_bvhtree_from_editmesh_get(&treedata, em, 4, BVHTREE_FROM_EM_LOOPTRI, bvh_cache);
+	if (treedata.tree) {
+		BVHTreeRayHit hit;
+		hit.index = -1;
+		hit.dist = BVH_RAYCAST_DIST_MAX;
+		if (BLI_bvhtree_ray_cast(
+			treedata.tree, start_local, dir_local, 0.0f, &hit,
+			raycast_edit_looptri_cb, em) != -1)
+		{
+			BMFace *f = em->looptris[hit.index][0]->f;
+			switch (htype) {
+			case BM_VERT: {
+				/* Nearest vertex of the hit face. */
+				float dist_min = FLT_MAX;
+				BMLoop *l = f->l_first;
+				for (int i = 0; i < f->len; ++i, l = l->next) {
+					const float dist = len_squared_v3v3(hit.co, l->v->co);
+					if (dist < dist_min && !BM_elem_flag_test(l->v, BM_ELEM_HIDDEN)) {
+						dist_min = dist;
+						ele = (BMElem*)l->v;
+					}
+				}
+				break;
+			}
+			case BM_EDGE: {
+				/* Nearest edge of the hit face. */
+				float dist_min = FLT_MAX;
+				BMLoop *l = f->l_first;
+				for (int i = 0; i < f->len; ++i, l = l->next) {
+					const float dist = dist_squared_to_line_segment_v3(hit.co, l->e->v1->co, l->e->v2->co);
+					if (dist < dist_min && !BM_elem_flag_test(l->e, BM_ELEM_HIDDEN)) {
+						dist_min = dist;
+						ele = (BMElem*)l->e;
+					}
+				}
+				break;
+			}
+			default: {
+				ele = (BMElem*)f;
+				break;
+			}
+			}
+		}
+	}
+	free_bvhtree_from_editmesh(&treedata);
+
+	if (ele || htype == BM_FACE) {
+		return ele;
+	}
+
+	/* 2: Missed all faces: nearest projected vertex / edge within the selection distance. */
+	const bool is_vert = (htype == BM_VERT);
+	memset(&treedata, 0, sizeof(treedata));
+	BKE_bvhtree_from_editmesh_get(&treedata, em, 2, is_vert ? BVHTREE_FROM_EM_VERTS : BVHTREE_FROM_EM_EDGES, bvh_cache);
+	if (treedata.tree) {
+		VR *vr = vr_get_obj();
+		const VR_Side side = VR_UI::eye_dominance_get();
+		/* Object space -> clip space of the dominant eye. */
+		Mat44f projmat = *(Mat44f*)obedit->obmat
+			* VR_UI::eye_position_get(VR_SPACE_BLENDER, side, true)
+			* VR_UI::viewport_projection[side];
+		float winsize[2] = { (float)vr->tex_width, (float)vr->tex_height };
+		float mval[2];
+		VR_UI::get_screen_coordinates(p, mval[0], mval[1], side);
+		mval[0] = (mval[0] + 1.0f) * 0.5f * winsize[0];
+		mval[1] = (mval[1] + 1.0f) * 0.5f * winsize[1];
+
+		const float dist_px = ED_view3d_select_dist_px() * 1.3333f;
+		BVHTreeNearest nearest;
+		nearest.index = -1;
+		nearest.dist_sq = dist_px * dist_px;
+		if (BLI_bvhtree_find_nearest_projected(
+			treedata.tree, (float(*)[4])projmat.m, winsize, mval, NULL, 0, &nearest,
+			is_vert ? raycast_edit_nearest_vert_cb : raycast_edit_nearest_edge_cb, em) != -1)
+		{
+			ele = is_vert ? (BMElem*)BM_vert_at_index(bm, nearest.index) : (BMElem*)BM_edge_at_index(bm, nearest.index);
+		}
+	}
+	free_bvhtree_from_editmesh(&treedata);
+
+	return ele;
+}
+
+/* Adapted from view3d_select.c */
+void VR_Util::raycast_select_single_vertex(const Coord3Df& p, ViewContext *vc, bool extend, bool deselect)
+{
+	bContext *C = vr_get_obj()->ctx;
+
+	BMVert *sv = (BMVert*)raycast_pick_edit(p, vc, BM_VERT);
+	const bool is_inside = (sv != NULL);
+
+	if (is_inside) {
 		const bool is_select = BM_elem_flag_test(sv, BM_ELEM_SELECT);
 		const int sel_op_result = ED_select_op_action_deselected(deselect ? SEL_OP_SUB : SEL_OP_SET, is_select, is_inside);
 		if (sel_op_result != -1) {
@@ -220,7 +444,7 @@ void VR_Util::raycast_select_single_vertex(const Coord3Df& p, ViewContext *vc, b
 
 			DEG_id_tag_update((ID*)vc->obedit->data, ID_RECALC_SELECT);
 			WM_event_add_notifier(C, NC_GEOM | ND_SELECT, vc->obedit->data);
-			ED_undo_push(C, "Select");
+			ED_undo_push_select(C, "Select");
 		}
 	}
 	else {
@@ -230,54 +454,19 @@ void VR_Util::raycast_select_single_vertex(const Coord3Df& p, ViewContext *vc, b
 
 			DEG_id_tag_update((ID*)vc->obedit->data, ID_RECALC_SELECT);
 			WM_event_add_notifier(C, NC_GEOM | ND_SELECT, vc->obedit->data);
-			ED_undo_push(C, "Select");
+			ED_undo_push_select(C, "Select");
 		}
 	}
 }
 
 void VR_Util::raycast_select_single_edge(const Coord3Df& p, ViewContext *vc, bool extend, bool deselect)
 {
-	/* TODO_XR: Use rv3d->persmat of dominant eye. */
 	bContext *C = vr_get_obj()->ctx;
-	ARegion *ar = CTX_wm_region(C);
-	RegionView3D *rv3d = (RegionView3D*)ar->regiondata;
-	float dist = ED_view3d_select_dist_px() * 1.3333f;
-	int mval[2];
-	VR_Side side = VR_UI::eye_dominance_get();
-	VR_UI::get_pixel_coordinates(p, mval[0], mval[1], side);
-	const float mval_fl[2] = { (float)mval[0], (float)mval[1] };
-	float screen_co[2];
-	float med_co[3];
-	bool is_inside = false;
 
-	BM_mesh_elem_table_ensure(vc->em->bm, BM_EDGE);
-	BMEdge *se = NULL;
-
-	const Mat44f& offset = *(Mat44f*)vc->obedit->obmat;
-	static Coord3Df pos;
-	BMEdge *e;
-	BMIter iter;
-	BMesh *bm = vc->em->bm;
-	BM_ITER_MESH(e, &iter, bm, BM_EDGES_OF_MESH) {
-		if (!BM_elem_flag_test(e, BM_ELEM_HIDDEN)) {
-			*(Coord3Df*)med_co = (*(Coord3Df*)e->v1->co + *(Coord3Df*)e->v2->co) / 2.0f;
-			VR_Math::multiply_mat44_coord3D(pos, offset, *(Coord3Df*)med_co);
-			if (view3d_project(
-				ar, rv3d->persmat, false, (float*)&pos, screen_co,
-				(eV3DProjTest)(V3D_PROJ_TEST_CLIP_BB | V3D_PROJ_TEST_CLIP_NEAR)) == V3D_PROJ_RET_OK)
-			{
-				float dist_temp = len_manhattan_v2v2(mval_fl, screen_co);
-				dist_temp += (dist * 0.1f); //10.0f
-				if (dist_temp < dist) {
-					dist = dist_temp;
-					se = e;
-					is_inside = true;
-				}
-			}
-		}
-	}
+	BMEdge *se = (BMEdge*)raycast_pick_edit(p, vc, BM_EDGE);
+	const bool is_inside = (se != NULL);
 
-	if (is_inside && se) {
+	if (is_inside) {
 		const bool is_select = BM_elem_flag_test(se, BM_ELEM_SELECT);
 		const int sel_op_result = ED_select_op_action_deselected(deselect ? SEL_OP_SUB : SEL_OP_SET, is_select, is_inside);
 		if (sel_op_result != -1) {
@@ -288,7 +477,7 @@ void VR_Util::raycast_select_single_edge(const Coord3Df& p, ViewContext *vc, boo
 
 			DEG_id_tag_update((ID*)vc->obedit->data, ID_RECALC_SELECT);
 			WM_event_add_notifier(C, NC_GEOM | ND_SELECT, vc->obedit->data);
-			ED_undo_push(C, "Select");
+			ED_undo_push_select(C, "Select");
 		}
 	}
 	else {
@@ -298,60 +487,19 @@ void VR_Util::raycast_select_single_edge(const Coord3Df& p, ViewContext *vc, boo
 
 			DEG_id_tag_update((ID*)vc->obedit->data, ID_RECALC_SELECT);
 			WM_event_add_notifier(C, NC_GEOM | ND_SELECT, vc->obedit->data);
-			ED_undo_push(C, "Select");
+			ED_undo_push_select(C, "Select");
 		}
 	}
 }
 
 void VR_Util::raycast_select_single_face(const Coord3Df& p, ViewContext *vc, bool extend, bool deselect)
 {
-	/* TODO_XR: Use rv3d->persmat of dominant eye. */
 	bContext *C = vr_get_obj()->ctx;
-	ARegion *ar = CTX_wm_region(C);
-	RegionView3D *rv3d = (RegionView3D*)ar->regiondata;
-	float dist = ED_view3d_select_dist_px() * 1.3333f;
-	int mval[2];
-	VR_Side side = VR_UI::eye_dominance_get();
-	VR_UI::get_pixel_coordinates(p, mval[0], mval[1], side);
-	const float mval_fl[2] = { (float)mval[0], (float)mval[1] };
-	float screen_co[2];
-	bool is_inside = false;
 
-	BM_mesh_elem_table_ensure(vc->em->bm, BM_FACE);
-	BMFace *sf = NULL;
+	BMFace *sf = (BMFace*)raycast_pick_edit(p, vc, BM_FACE);
+	const bool is_inside = (sf != NULL);
 
-	const Mat44f& offset = *(Mat44f*)vc->obedit->obmat;
-	static Coord3Df pos;
-	static Coord3Df cent;
-	BMFace *f;
-	BMLoop *l;
-	BMIter iter;
-	BMesh *bm = vc->em->bm;
-	BM_ITER_MESH(f, &iter, bm, BM_FACES_OF_MESH) {
-		l = f->l_first;
-		memset(&cent, 0, sizeof(float) * 3);
-		for (int i = 0; i < f->len; ++i, l = l->next) {
-			cent += *(Coord3Df*)l->v->co;
-		}
-		cent /= f->len;
-		if (!BM_elem_flag_test(f, BM_ELEM_HIDDEN)) {
-			VR_Math::multiply_mat44_coord3D(pos, offset, cent);
-			if (view3d_project(
-				ar, rv3d->persmat, false, (float*)&pos, screen_co,
-				(eV3DProjTest)(V3D_PROJ_TEST_CLIP_BB | V3D_PROJ_TEST_CLIP_NEAR)) == V3D_PROJ_RET_OK)
-			{
-				float dist_temp = len_manhattan_v2v2(mval_fl, screen_co);
-				dist_temp += (dist * 0.1f); //10.0f
-				if (dist_temp < dist) {
-					dist = dist_temp;
-					sf = f;
-					is_inside = true;
-				}
-			}
-		}
-	}
-
-	if (is_inside && sf) {
+	if (is_inside) {
 		const bool is_select = BM_elem_flag_test(sf, BM_ELEM_SELECT);
 		const int sel_op_result = ED_select_op_action_deselected(deselect ? SEL_OP_SUB : SEL_OP_SET, is_select, is_inside);
 		if (sel_op_result != -1) {
@@ -362,7 +510,7 @@ void VR_Util::raycast_select_single_face(const Coord3Df& p, ViewContext *vc, boo
 
 			DEG_id_tag_update((ID*)vc->obedit->data, ID_RECALC_SELECT);
 			WM_event_add_notifier(C, NC_GEOM | ND_SELECT, vc->obedit->data);
-			ED_undo_push(C, "Select");
+			ED_undo_push_select(C, "Select");
 		}
 	}
 	else {
@@ -372,7 +520,7 @@ void VR_Util::raycast_select_single_face(const Coord3Df& p, ViewContext *vc, boo
 
 			DEG_id_tag_update((ID*)vc->obedit->data, ID_RECALC_SELECT);
 			WM_event_add_notifier(C, NC_GEOM | ND_SELECT, vc->obedit->data);
-			ED_undo_push(C, "Select");
+			ED_undo_push_select(C, "Select");
 		}
 	}
 }
@@ -459,186 +607,59 @@ Base *VR_Util::raycast_select_single(
 	startbase = (Base*)FIRSTBASE(view_layer);
 	if (BASACT(view_layer) && BASACT(view_layer)->next) startbase = BASACT(view_layer)->next;
 
-	/* This block uses the control key to make the object selected by its center point rather than its contents */
-	/* in editmode do not activate */
-	if (obcenter) {
-		/* note; shift+alt goes to group-flush-selecting */
-		if (enumerate) {
-			//basact = object_mouse_select_menu(C, &vc, NULL, 0, mval, toggle);
+	/* Pick the nearest mesh surface along the ray from the dominant eye.
+	 * Objects without surfaces (empties, lights, cameras, ...) are selected by their
+	 * projected origin, as are all objects if obcenter is set. */
+	/* note; shift+alt goes to group-flush-selecting */
+	if (enumerate) {
+		//basact = object_mouse_select_menu(C, &vc, NULL, 0, mval, toggle);
+	}
+	else {
+		if (!obcenter) {
+			basact = raycast_pick_object(p, &vc, startbase);
 		}
-		else {
-			const int object_type_exclude_select = (
-				vc.v3d->object_type_exclude_viewport | vc.v3d->object_type_exclude_select);
-			base = startbase;
-			while (base) {
-				if (BASE_SELECTABLE(v3d, base) &&
-					((object_type_exclude_select & (1 << base->object->type)) == 0))
+		const int object_type_exclude_select = (
+			vc.v3d->object_type_exclude_viewport | vc.v3d->object_type_exclude_select);
+		base = basact ? NULL : startbase;
+		while (base) {
+			if (BASE_SELECTABLE(v3d, base) &&
+				((object_type_exclude_select & (1 << base->object->type)) == 0) &&
+				(obcenter || base->object->type != OB_MESH))
+			{
+				float screen_co[2];
+				/* TODO_XR: Use rv3d->persmat of dominant eye. */
+				RegionView3D *rv3d = (RegionView3D*)ar->regiondata;
+				if (view3d_project(
+					ar, rv3d->persmat, false, base->object->obmat[3], screen_co,
+					(eV3DProjTest)(V3D_PROJ_TEST_CLIP_BB | V3D_PROJ_TEST_CLIP_NEAR)) == V3D_PROJ_RET_OK)
 				{
-					float screen_co[2];
-					/* TODO_XR: Use rv3d->persmat of dominant eye. */
-					RegionView3D *rv3d = (RegionView3D*)ar->regiondata;
-					if (view3d_project(
-						ar, rv3d->persmat, false, base->object->obmat[3], screen_co,
-						(eV3DProjTest)(V3D_PROJ_TEST_CLIP_BB | V3D_PROJ_TEST_CLIP_NEAR)) == V3D_PROJ_RET_OK)
-					{
-						float dist_temp = len_manhattan_v2v2(mval_fl, screen_co);
-						if (base == BASACT(view_layer)) dist_temp += (dist * 0.1f); //10.0f
-						if (dist_temp < dist) {
-							dist = dist_temp;
-							basact = base;
-						}
-					}
-				}
-				base = base->next;
-
-				if (base == NULL) base = (Base*)FIRSTBASE(view_layer);
-				if (base == startbase) break;
-			}
-		}
-		if (scene->toolsettings->object_flag & SCE_OBJECT_MODE_LOCK) {
-			if (is_obedit == false) {
-				if (basact && !BKE_object_is_mode_compat(basact->object, object_mode)) {
-					if (object_mode == OB_MODE_OBJECT) {
-						struct Main *bmain = CTX_data_main(C);
-						ED_object_mode_generic_exit(bmain, vc.depsgraph, scene, basact->object);
-					}
-					if (!BKE_object_is_mode_compat(basact->object, object_mode)) {
-						basact = NULL;
+					float dist_temp = len_manhattan_v2v2(mval_fl, screen_co);
+					if (base == BASACT(view_layer)) dist_temp += (dist * 0.1f); //10.0f
+					if (dist_temp < dist) {
+						dist = dist_temp;
+						basact = base;
 					}
 				}
 			}
+			base = base->next;
+
+			if (base == NULL) base = (Base*)FIRSTBASE(view_layer);
+			if (base == startbase) break;
 		}
 	}
-#if 0 /* TODO_XR */
-	else {
-		uint buffer[MAXPICKBUF];
-		bool do_nearest;
-
-		// TIMEIT_START(select_time);
-
-		/* if objects have posemode set, the bones are in the same selection buffer */
-		const eV3DSelectObjectFilter select_filter = (
-			(scene->toolsettings->object_flag & SCE_OBJECT_MODE_LOCK) ?
-			VIEW3D_SELECT_FILTER_OBJECT_MODE_LOCK : VIEW3D_SELECT_FILTER_NOP);
-		hits = mixed_bones_object_selectbuffer(
-			&vc, buffer, mval,
-			true, enumerate, select_filter,
-			&do_nearest);
-
-		// TIMEIT_END(select_time);
-
-		if (hits > 0) {
-			/* note: bundles are handling in the same way as bones */
-			const bool has_bones = selectbuffer_has_bones(buffer, hits);
-
-			/* note; shift+alt goes to group-flush-selecting */
-			if (enumerate) {
-				//basact = object_mouse_select_menu(C, &vc, buffer, hits, mval, toggle);
-			}
-			else {
-				basact = mouse_select_eval_buffer(&vc, buffer, hits, startbase, has_bones, do_nearest);
-			}
-
-			if (scene->toolsettings->object_flag & SCE_OBJECT_MODE_LOCK) {
-				if (is_obedit == false) {
-					if (basact && !BKE_object_is_mode_compat(basact->object, object_mode)) {
-						if (object_mode == OB_MODE_OBJECT) {
-							struct Main *bmain = CTX_data_main(C);
-							ED_object_mode_generic_exit(bmain, vc.depsgraph, scene, basact->object);
-						}
-						if (!BKE_object_is_mode_compat(basact->object, object_mode)) {
-							basact = NULL;
-						}
-					}
-				}
-			}
-
-			if (has_bones && basact) {
-				if (basact->object->type == OB_CAMERA) {
-					if (BASACT(view_layer) == basact) {
-						int i, hitresult;
-						bool changed = false;
-
-						for (i = 0; i < hits; i++) {
-							hitresult = buffer[3 + (i * 4)];
-
-							/* if there's bundles in buffer select bundles first,
-							 * so non-camera elements should be ignored in buffer */
-							if (basact->object->select_color != (hitresult & 0xFFFF)) {
-								continue;
-							}
-
-							/* index of bundle is 1<<16-based. if there's no "bone" index
-							 * in height word, this buffer value belongs to camera. not to bundle */
-							if (buffer[4 * i + 3] & 0xFFFF0000) {
-								MovieClip *clip = BKE_object_movieclip_get(scene, basact->object, false);
-								MovieTracking *tracking = &clip->tracking;
-								ListBase *tracksbase;
-								MovieTrackingTrack *track;
-
-								track = BKE_tracking_track_get_indexed(&clip->tracking, hitresult >> 16, &tracksbase);
-
-								if (TRACK_SELECTED(track) && extend) {
-									changed = false;
-									BKE_tracking_track_deselect(track, TRACK_AREA_ALL);
-								}
-								else {
-									int oldsel = TRACK_SELECTED(track) ? 1 : 0;
-									if (!extend)
-										deselect_all_tracks(tracking);
-
-									BKE_tracking_track_select(tracksbase, track, TRACK_AREA_ALL, extend);
-
-									if (oldsel != (TRACK_SELECTED(track) ? 1 : 0))
-										changed = true;
-								}
-
-								basact->flag |= BASE_SELECTED;
-								BKE_scene_object_base_flag_sync_from_base(basact);
-
-								DEG_id_tag_update(&scene->id, ID_RECALC_SELECT);
-								DEG_id_tag_update(&clip->id, ID_RECALC_SELECT);
-								WM_event_add_notifier(C, NC_MOVIECLIP | ND_SELECT, track);
-								WM_event_add_notifier(C, NC_SCENE | ND_OB_SELECT, scene);
-
-								break;
-							}
-						}
-
-						if (!changed) {
-							/* fallback to regular object selection if no new bundles were selected,
-							 * allows to select object parented to reconstruction object */
-							basact = mouse_select_eval_buffer(&vc, buffer, hits, startbase, 0, do_nearest);
-						}
-					}
-				}
-				else if (ED_armature_pose_select_pick_with_buffer(
-					view_layer, basact, buffer, hits, extend, deselect, toggle, do_nearest))
-				{
-					/* then bone is found */
-
-					/* we make the armature selected:
-					 * not-selected active object in posemode won't work well for tools */
-					basact->flag |= BASE_SELECTED;
-					BKE_scene_object_base_flag_sync_from_base(basact);
-
-					WM_event_add_notifier(C, NC_OBJECT | ND_BONE_SELECT, basact->object);
-					WM_event_add_notifier(C, NC_OBJECT | ND_BONE_ACTIVE, basact->object);
-
-					/* in weightpaint, we use selected bone to select vertexgroup, so no switch to new active object */
-					if (BASACT(view_layer) && (BASACT(view_layer)->object->mode & OB_MODE_WEIGHT_PAINT)) {
-						/* prevent activating */
-						basact = NULL;
-					}
-
+	if (scene->toolsettings->object_flag & SCE_OBJECT_MODE_LOCK) {
+		if (is_obedit == false) {
+			if (basact && !BKE_object_is_mode_compat(basact->object, object_mode)) {
+				if (object_mode == OB_MODE_OBJECT) {
+					struct Main *bmain = CTX_data_main(C);
+					ED_object_mode_generic_exit(bmain, vc.depsgraph, scene, basact->object);
 				}
-				/* prevent bone selecting to pass on to object selecting */
-				if (basact == BASACT(view_layer))
+				if (!BKE_object_is_mode_compat(basact->object, object_mode)) {
 					basact = NULL;
+				}
 			}
 		}
 	}
-#endif
 
 	if (scene->toolsettings->object_flag & SCE_OBJECT_MODE_LOCK) {
 		/* Disallow switching modes,
@@ -717,7 +738,7 @@ Base *VR_Util::raycast_select_single(
 
 		DEG_id_tag_update(&scene->id, ID_RECALC_SELECT);
 		WM_event_add_notifier(C, NC_SCENE | ND_OB_SELECT, scene);
-		ED_undo_push(C, "Select");
+		ED_undo_push_select(C, "Select");
 	}
 	else {
 		if (!extend && !deselect) {
@@ -725,7 +746,7 @@ Base *VR_Util::raycast_select_single(
 			object_deselect_all_visible(view_layer, v3d);
 			DEG_id_tag_update(&scene->id, ID_RECALC_SELECT);
 			WM_event_add_notifier(C, NC_SCENE | ND_OB_SELECT, scene);
-			ED_undo_push(C, "Select");
+			ED_undo_push_select(C, "Select");
 		}
 	}
 
@@ -34,6 +34,7 @@
 #include "ED_view3d.h"
 
 struct BMesh;
+struct BMElem;
 
 /* Modified from view3d_project.c */
 #define WIDGET_SELECT_RAYCAST_NEAR_CLIP 0.0001f
@@ -54,6 +55,14 @@ public:
 
     static void deselectall_edit(BMesh *bm, int mode);
 
+    /* Ray picking against the BVH trees of the evaluated meshes (cached in the mesh runtime, rebuilt by the depsgraph).
+     * The pick ray starts at the dominant eye and passes through p (real space). */
+    static Base *raycast_pick_object(const Coord3Df& p, ViewContext *vc, Base *startbase, float *r_dist = NULL);
+
+    /* Pick the vertex / edge / face (htype) of the edit-mesh under p. Falls back to the nearest
+     * projected element within the selection distance if the ray misses all faces (loose geometry). */
+    static BMElem *raycast_pick_edit(const Coord3Df& p, ViewContext *vc, char htype);
+
     /* Adapted from view3d_select.c */
     static void raycast_select_single_vertex(const Coord3Df& p, ViewContext *vc, bool extend, bool deselect);
 
@@ -75,7 +84,7 @@ public:
 	    bool toggle = false,
 	    bool enumerate = false,
 	    bool object = true,
-	    bool obcenter = true);
+	    bool obcenter = false);
 };
 
 #endif /* __VR_UTIL_H__ */
@@ -37,7 +37,9 @@
 #include "vr_widget_annotate.h"
 
 #include "vr_draw.h"
+#include "vr_api.h"
 
+#include "BLI_listbase.h"
 #include "BLI_math.h"
 
 #include "BKE_context.h"
@@ -49,6 +51,7 @@
 
 #include "gpencil_intern.h"
 
+#include "GPU_batch.h"
 #include "GPU_immediate.h"
 #include "GPU_state.h"
 
@@ -91,10 +94,18 @@ bool Widget_Annotate::eraser(false);
 VR_Side Widget_Annotate::cursor_side;
 float Widget_Annotate::eraser_radius(0.05f);
 
+GPUBatch *Widget_Annotate::stroke_batches[WIDGET_ANNOTATE_NUM_LAYERS] = { 0 };
+GPUBatch *Widget_Annotate::point_batches[WIDGET_ANNOTATE_NUM_LAYERS] = { 0 };
+bool Widget_Annotate::batches_valid[WIDGET_ANNOTATE_NUM_LAYERS] = { false };
+float Widget_Annotate::batches_ink[WIDGET_ANNOTATE_NUM_LAYERS][4];
+float Widget_Annotate::batches_thickness[WIDGET_ANNOTATE_NUM_LAYERS];
+Widget_Annotate::BatchesKey Widget_Annotate::batches_key[WIDGET_ANNOTATE_NUM_LAYERS];
+
 int Widget_Annotate::init(bool new_scene)
 {
 	/* Allocate gpencil data/layer/frame and set to active. */
 	bContext *C = vr_get_obj()->ctx;
+	invalidate_strokes();
 	if (new_scene) {
 		gpl.clear();
 		gpf.clear();
@@ -145,7 +156,7 @@ int Widget_Annotate::init(bool new_scene)
 	return 0;
 }
 
-void Widget_Annotate::erase_stroke(bGPDstroke *gps, bGPDframe *gp_frame) {
+bool Widget_Annotate::erase_stroke(bGPDstroke *gps, bGPDframe *gp_frame) {
 
 	/* Adapted from gp_stroke_eraser_do_stroke() in annotate_paint.c */
 
@@ -155,6 +166,7 @@ void Widget_Annotate::erase_stroke(bGPDstroke *gps, bGPDframe *gp_frame) {
 	if (gps->totpoints == 0) {
 		/* just free stroke */
 		BKE_gpencil_free_stroke(gps);
+		return true;
 	}
 	else if (gps->totpoints == 1) {
 		/* only process if it hasn't been masked out... */
@@ -165,6 +177,7 @@ void Widget_Annotate::erase_stroke(bGPDstroke *gps, bGPDframe *gp_frame) {
 			if ((pt_pos - c_pos).length() <= eraser_radius * VR_UI::navigation_scale_get()) {
 				gps->points->flag |= GP_SPOINT_TAG;
 				gp_stroke_delete_tagged_points(gp_frame, gps, gps->next, GP_SPOINT_TAG, false, 0);
+				return true;
 			}
 		//}
 	}
@@ -215,8 +228,11 @@ void Widget_Annotate::erase_stroke(bGPDstroke *gps, bGPDframe *gp_frame) {
 		/* Second Pass: Remove any points that are tagged */
 		if (inside_sphere) {
 			gp_stroke_delete_tagged_points(gp_frame, gps, gps->next, GP_SPOINT_TAG, false, 0);
+			return true;
 		}
 	} 
+
+	return false;
 }
 
 void Widget_Annotate::add_stroke(const std::vector<bGPDspoint>& pts, uint layer, bool set_active)
@@ -238,6 +254,7 @@ void Widget_Annotate::add_stroke(const std::vector<bGPDspoint>& pts, uint layer,
 
 	bGPDstroke *gps = BKE_gpencil_add_stroke(gpf[layer], 0, tot_points, line_thickness);
 	memcpy(gps->points, &pts[0], sizeof(bGPDspoint) * tot_points);
+	invalidate_strokes(layer);
 
 	if (set_active) {
 		BKE_gpencil_layer_setactive(Widget_Annotate::gpd, Widget_Annotate::gpl[layer]);
@@ -324,7 +341,9 @@ void Widget_Annotate::drag_start(VR_UI::Cursor& c)
 				if (gpf[i]) {
 					for (bGPDstroke *gps = (bGPDstroke*)gpf[i]->strokes.first; gps; gps = gpn) {
 						gpn = gps->next;
-						Widget_Annotate::erase_stroke(gps, gpf[i]);
+						if (Widget_Annotate::erase_stroke(gps, gpf[i])) {
+							invalidate_strokes(i);
+						}
 					}
 				}
 			}
@@ -365,7 +384,9 @@ void Widget_Annotate::drag_contd(VR_UI::Cursor& c)
 				if (gpf[i]) {
 					for (bGPDstroke *gps = (bGPDstroke*)gpf[i]->strokes.first; gps; gps = gpn) {
 						gpn = gps->next;
-						Widget_Annotate::erase_stroke(gps, gpf[i]);
+						if (Widget_Annotate::erase_stroke(gps, gpf[i])) {
+							invalidate_strokes(i);
+						}
 					}
 				}
 			}
@@ -418,89 +439,280 @@ void Widget_Annotate::drag_stop(VR_UI::Cursor& c)
 
 void Widget_Annotate::render_points(const std::vector<bGPDspoint>& pts, uint layer)
 {
-	/* Adapted from gp_draw_stroke_3d() in annotate_draw.c. */
+	/* Adapted from gp_draw_stroke_3d() in drawgpencil.c.
+	 * The stroke geometry shader draws one continuous stroke with the thickness
+	 * tapered by the pressure of each point. */
 
 	int tot_points = pts.size();
 
 	if (tot_points <= 1) {
 		/* If click, point will already be finalized and drawn.
 		 * If drag, need at least two points to draw a line. */
+		return;
 	}
-	else {
-		/* if cyclic needs one vertex more */
-		bool cyclic = false;
-		if ((*(Coord3Df*)&pts[0] == *(Coord3Df*)&pts[tot_points - 1])) {
-			cyclic = true;
+
+	/* A closed stroke (last point on the first) continues through the first point. */
+	bool cyclic = false;
+	if (tot_points > 2 && (*(Coord3Df*)&pts[0] == *(Coord3Df*)&pts[tot_points - 1])) {
+		cyclic = true;
+	}
+
+	GPUVertFormat *format = immVertexFormat();
+	uint pos = GPU_vertformat_attr_add(format, "pos", GPU_COMP_F32, 3, GPU_FETCH_FLOAT);
+	uint color = GPU_vertformat_attr_add(format, "color", GPU_COMP_F32, 4, GPU_FETCH_FLOAT);
+	uint thickness = GPU_vertformat_attr_add(format, "thickness", GPU_COMP_F32, 1, GPU_FETCH_FLOAT);
+
+	float viewport[4];
+	GPU_viewport_size_get_f(viewport);
+
+	immBindBuiltinProgram(GPU_SHADER_GPENCIL_STROKE);
+	immUniform2f("Viewport", viewport[2], viewport[3]);
+	immUniform1f("pixsize", 1.0f);
+	immUniform1f("objscale", 1.0f);
+	immUniform1i("keep_size", 1);
+	immUniform1f("pixfactor", 1.0f);
+	immUniform1i("xraymode", GP_XRAY_3DSPACE);
+	immUniform1i("caps_start", GP_STROKE_CAP_ROUND);
+	immUniform1i("caps_end", GP_STROKE_CAP_ROUND);
+	immUniform1i("fill_stroke", 0);
+
+	/* The first and last vertex are only used for adjacency (not drawn). */
+	immBegin(GPU_PRIM_LINE_STRIP_ADJ, tot_points + 2);
+	for (int i = -1; i <= tot_points; ++i) {
+		int p = i;
+		if (i < 0) {
+			p = cyclic ? tot_points - 2 : 1;
 		}
-		int cyclic_add = 0;
-		if (cyclic) {
-			++cyclic_add;
+		else if (i == tot_points) {
+			p = cyclic ? 1 : tot_points - 2;
 		}
+		immAttr4fv(color, colors[layer]);
+		immAttr1f(thickness, max_ff(pts[p].pressure * line_thickness, 1.0f));
+		immVertex3fv(pos, &pts[p].x);
+	}
+	immEnd();
+	immUnbindProgram();
+}
 
-		float cyclic_fpt[3];
-		int draw_points = 0;
+void Widget_Annotate::invalidate_strokes(int layer)
+{
+	if (layer < 0) {
+		for (int i = 0; i < WIDGET_ANNOTATE_NUM_LAYERS; ++i) {
+			batches_valid[i] = false;
+		}
+	}
+	else if (layer < WIDGET_ANNOTATE_NUM_LAYERS) {
+		batches_valid[layer] = false;
+	}
+}
 
-		float cur_pressure = pts[0].pressure;
+void Widget_Annotate::free_batches()
+{
+	for (int i = 0; i < WIDGET_ANNOTATE_NUM_LAYERS; ++i) {
+		GPU_BATCH_DISCARD_SAFE(stroke_batches[i]);
+		GPU_BATCH_DISCARD_SAFE(point_batches[i]);
+		batches_valid[i] = false;
+	}
+}
 
-		GPUVertFormat *format = immVertexFormat();
-		uint pos = GPU_vertformat_attr_add(format, "pos", GPU_COMP_F32, 3, GPU_FETCH_FLOAT);
+Widget_Annotate::BatchesKey Widget_Annotate::batches_key_get(const bGPDframe *gp_frame)
+{
+	BatchesKey key = { gp_frame, NULL, 0, 0 };
+	if (gp_frame) {
+		for (const bGPDstroke *gps = (const bGPDstroke*)gp_frame->strokes.first; gps; gps = gps->next) {
+			++key.num_strokes;
+			key.num_points += gps->totpoints;
+		}
+		key.last_stroke = (const bGPDstroke*)gp_frame->strokes.last;
+	}
+	return key;
+}
 
-		immBindBuiltinProgram(GPU_SHADER_3D_UNIFORM_COLOR);
-		immUniformColor4fv(colors[layer]);
+void Widget_Annotate::update_batches(uint layer, const bGPDlayer *gp_layer, const bGPDframe *gp_frame)
+{
+	GPU_BATCH_DISCARD_SAFE(stroke_batches[layer]);
+	GPU_BATCH_DISCARD_SAFE(point_batches[layer]);
 
-		/* TODO: implement this with a geometry shader to draw one continuous tapered stroke */
+	/* Same settings as annotation_draw_data_layers() in annotate_draw.c. */
+	copy_v3_v3(batches_ink[layer], gp_layer->color);
+	batches_ink[layer][3] = gp_layer->opacity;
+	batches_thickness[layer] = max_ff(gp_layer->thickness, 1.0f);
+	batches_key[layer] = batches_key_get(gp_frame);
+	batches_valid[layer] = true;
 
-		/* draw stroke curve */
-		GPU_line_width(max_ff(cur_pressure * line_thickness, 1.0f));
-		immBeginAtMost(GPU_PRIM_LINE_STRIP, tot_points + cyclic_add);
-		for (int i = 0; i < tot_points; ++i) {
-			/* if there was a significant pressure change, stop the curve, change the thickness of the stroke,
-			 * and continue drawing again (since line-width cannot change in middle of GL_LINE_STRIP)
-			 * Note: we want more visible levels of pressures when thickness is bigger.
-			 */
-			if (fabsf(pts[i].pressure - cur_pressure) > 0.2f / (float)line_thickness) {
-				/* if the pressure changes before get at least 2 vertices, need to repeat last point to avoid assert in immEnd() */
-				if (draw_points < 2) {
-					immVertex3fv(pos, &pts[i - 1].x);
-				}
-				immEnd();
-				draw_points = 0;
+	if (!gp_frame) {
+		return;
+	}
 
-				cur_pressure = pts[i].pressure;
-				GPU_line_width(max_ff(cur_pressure * line_thickness, 1.0f));
-				immBeginAtMost(GPU_PRIM_LINE_STRIP, tot_points - i + 1 + cyclic_add);
+	const float thickness = batches_thickness[layer];
+	uchar ink[4];
+	rgba_float_to_uchar(ink, batches_ink[layer]);
 
-				/* need to roll-back one point to ensure that there are no gaps in the stroke */
-				if (i != 0) {
-					immVertex3fv(pos, &pts[i - 1].x);
-					++draw_points;
-				}
+	uint tot_verts = 0, tot_segments = 0, tot_points = 0;
+	for (const bGPDstroke *gps = (const bGPDstroke*)gp_frame->strokes.first; gps; gps = gps->next) {
+		if (!(gps->flag & GP_STROKE_3DSPACE) || !gps->points) {
+			continue;
+		}
+		if (gps->totpoints == 1) {
+			++tot_points;
+		}
+		else if (gps->totpoints > 1) {
+			tot_verts += gps->totpoints;
+			tot_segments += gps->totpoints - 1;
+			if ((gps->flag & GP_STROKE_CYCLIC) && gps->totpoints > 2) {
+				++tot_segments;
+			}
+		}
+	}
+
+	if (tot_verts > 0) {
+		static GPUVertFormat format = { 0 };
+		static uint pos, color, size;
+		if (format.attr_len == 0) {
+			pos = GPU_vertformat_attr_add(&format, "pos", GPU_COMP_F32, 3, GPU_FETCH_FLOAT);
+			color = GPU_vertformat_attr_add(&format, "color", GPU_COMP_U8, 4, GPU_FETCH_INT_TO_FLOAT_UNIT);
+			size = GPU_vertformat_attr_add(&format, "thickness", GPU_COMP_F32, 1, GPU_FETCH_FLOAT);
+		}
+
+		GPUVertBuf *vbo = GPU_vertbuf_create_with_format(&format);
+		GPU_vertbuf_data_alloc(vbo, tot_verts);
+
+		/* Each segment is drawn with its neighbor points for adjacency
+		 * (mirrored at the ends of open strokes, so the shader adds caps). */
+		GPUIndexBufBuilder elb;
+		GPU_indexbuf_init_ex(&elb, GPU_PRIM_LINES_ADJ, tot_segments * 4, tot_verts);
+
+		uint v = 0;
+		for (const bGPDstroke *gps = (const bGPDstroke*)gp_frame->strokes.first; gps; gps = gps->next) {
+			if (!(gps->flag & GP_STROKE_3DSPACE) || !gps->points || gps->totpoints < 2) {
+				continue;
+			}
+			const uint n = gps->totpoints;
+			const bool cyclic = ((gps->flag & GP_STROKE_CYCLIC) && n > 2);
+			for (uint i = 0; i < n; ++i) {
+				const bGPDspoint *pt = &gps->points[i];
+				GPU_vertbuf_attr_set(vbo, pos, v + i, &pt->x);
+				GPU_vertbuf_attr_set(vbo, color, v + i, ink);
+				const float pt_thickness = max_ff(pt->pressure * thickness, 1.0f);
+				GPU_vertbuf_attr_set(vbo, size, v + i, &pt_thickness);
+			}
+			for (uint i = 0; i + 1 < n; ++i) {
+				const uint prev = (i > 0) ? i - 1 : (cyclic ? n - 1 : i + 1);
+				const uint next = (i + 2 < n) ? i + 2 : (cyclic ? (i + 2) % n : i);
+				GPU_indexbuf_add_line_adj_verts(&elb, v + prev, v + i, v + i + 1, v + next);
 			}
+			if (cyclic) {
+				GPU_indexbuf_add_line_adj_verts(&elb, v + n - 2, v + n - 1, v, v + 1);
+			}
+			v += n;
+		}
 
-			/* now the point we want */
-			immVertex3fv(pos, &pts[i].x);
-			++draw_points;
+		stroke_batches[layer] = GPU_batch_create_ex(GPU_PRIM_LINES_ADJ, vbo, GPU_indexbuf_build(&elb), GPU_BATCH_OWNS_VBO | GPU_BATCH_OWNS_INDEX);
+	}
 
-			if (cyclic && i == 0) {
-				/* save first point to use in cyclic */
-				copy_v3_v3(cyclic_fpt, &pts[i].x);
+	if (tot_points > 0) {
+		static GPUVertFormat format = { 0 };
+		static uint pos, color, size;
+		if (format.attr_len == 0) {
+			pos = GPU_vertformat_attr_add(&format, "pos", GPU_COMP_F32, 3, GPU_FETCH_FLOAT);
+			size = GPU_vertformat_attr_add(&format, "size", GPU_COMP_F32, 1, GPU_FETCH_FLOAT);
+			color = GPU_vertformat_attr_add(&format, "color", GPU_COMP_U8, 4, GPU_FETCH_INT_TO_FLOAT_UNIT);
+		}
+
+		GPUVertBuf *vbo = GPU_vertbuf_create_with_format(&format);
+		GPU_vertbuf_data_alloc(vbo, tot_points);
+
+		uint v = 0;
+		for (const bGPDstroke *gps = (const bGPDstroke*)gp_frame->strokes.first; gps; gps = gps->next) {
+			if (!(gps->flag & GP_STROKE_3DSPACE) || !gps->points || gps->totpoints != 1) {
+				continue;
 			}
+			/* Same size as annotation_draw_stroke_point() in annotate_draw.c. */
+			const float pt_size = (thickness + 2.0f) * gps->points->pressure;
+			GPU_vertbuf_attr_set(vbo, pos, v, &gps->points->x);
+			GPU_vertbuf_attr_set(vbo, size, v, &pt_size);
+			GPU_vertbuf_attr_set(vbo, color, v, ink);
+			++v;
 		}
 
-		if (cyclic) {
-			/* draw line to first point to complete the cycle */
-			immVertex3fv(pos, cyclic_fpt);
-			++draw_points;
+		point_batches[layer] = GPU_batch_create_ex(GPU_PRIM_POINTS, vbo, NULL, GPU_BATCH_OWNS_VBO);
+	}
+}
+
+bool Widget_Annotate::render_strokes(bGPdata *gp_data, int cfra)
+{
+	if (!gp_data || gp_data != gpd || gpf.size() != WIDGET_ANNOTATE_NUM_LAYERS) {
+		return false;
+	}
+	/* Layers added outside of VR aren't cached, leave those to the regular annotation drawing. */
+	if (BLI_listbase_count(&gpd->layers) != WIDGET_ANNOTATE_NUM_LAYERS) {
+		return false;
+	}
+	/* Onion skins aren't cached either. */
+	for (const bGPDlayer *gp_layer = (const bGPDlayer*)gpd->layers.first; gp_layer; gp_layer = gp_layer->next) {
+		if ((gp_layer->onion_flag & GP_LAYER_ONIONSKIN) && !(gp_layer->flag & GP_LAYER_HIDE)) {
+			return false;
+		}
+	}
+
+	float viewport[4];
+	GPU_viewport_size_get_f(viewport);
+
+	GPU_blend_set_func_separate(GPU_SRC_ALPHA, GPU_ONE_MINUS_SRC_ALPHA, GPU_ONE, GPU_ONE_MINUS_SRC_ALPHA);
+	GPU_blend(true);
+	GPU_program_point_size(true);
+
+	/* The layers are taken from gpd (not gpl), since undo may have replaced them. */
+	uint i = 0;
+	for (bGPDlayer *gp_layer = (bGPDlayer*)gpd->layers.first; gp_layer; gp_layer = gp_layer->next, ++i) {
+		if (gp_layer->flag & GP_LAYER_HIDE) {
+			continue;
+		}
+
+		/* Same frame as annotation_draw_data_layers() in annotate_draw.c. */
+		const bGPDframe *gp_frame = BKE_gpencil_layer_getframe(gp_layer, cfra, GP_GETFRAME_USE_PREV);
+
+		/* The layer settings and strokes can also be changed from the regular UI. */
+		if (batches_valid[i]) {
+			const BatchesKey key = batches_key_get(gp_frame);
+			if (batches_ink[i][3] != gp_layer->opacity ||
+				!equals_v3v3(batches_ink[i], gp_layer->color) ||
+				batches_thickness[i] != max_ff(gp_layer->thickness, 1.0f) ||
+				key.frame != batches_key[i].frame || key.last_stroke != batches_key[i].last_stroke ||
+				key.num_strokes != batches_key[i].num_strokes || key.num_points != batches_key[i].num_points) {
+				batches_valid[i] = false;
+			}
+		}
+		if (!batches_valid[i]) {
+			update_batches(i, gp_layer, gp_frame);
 		}
 
-		/* if less of two points, need to repeat last point to avoid assert in immEnd() */
-		if (draw_points < 2) {
-			immVertex3fv(pos, &pts[tot_points - 1].x);
+		GPUBatch *batch = stroke_batches[i];
+		if (batch) {
+			GPU_batch_program_set_builtin(batch, GPU_SHADER_GPENCIL_STROKE);
+			GPU_batch_uniform_2f(batch, "Viewport", viewport[2], viewport[3]);
+			GPU_batch_uniform_1f(batch, "pixsize", 1.0f);
+			GPU_batch_uniform_1f(batch, "objscale", 1.0f);
+			GPU_batch_uniform_1i(batch, "keep_size", 1);
+			GPU_batch_uniform_1f(batch, "pixfactor", 1.0f);
+			GPU_batch_uniform_1i(batch, "xraymode", GP_XRAY_3DSPACE);
+			GPU_batch_uniform_1i(batch, "caps_start", GP_STROKE_CAP_ROUND);
+			GPU_batch_uniform_1i(batch, "caps_end", GP_STROKE_CAP_ROUND);
+			GPU_batch_uniform_1i(batch, "fill_stroke", 0);
+			GPU_batch_draw(batch);
 		}
 
-		immEnd();
-		immUnbindProgram();
+		batch = point_batches[i];
+		if (batch) {
+			GPU_batch_program_set_builtin(batch, GPU_SHADER_3D_POINT_VARYING_SIZE_VARYING_COLOR);
+			GPU_batch_draw(batch);
+		}
 	}
+
+	GPU_program_point_size(false);
+	GPU_blend(false);
+
+	return true;
 }
 
 void Widget_Annotate::render(VR_Side side)
@@ -528,3 +740,12 @@ void Widget_Annotate::render(VR_Side side)
 
 	Widget_Annotate::obj.do_render[side] = false;
 }
+
+/***************************************************************************************************
+ *											 vr_api
+ ***************************************************************************************************/
+/* Draw the committed VR annotation strokes from the cached batches. */
+int vr_api_draw_annotations(bGPdata *gpd, int cfra)
+{
+	return Widget_Annotate::render_strokes(gpd, cfra) ? 1 : 0;
+}
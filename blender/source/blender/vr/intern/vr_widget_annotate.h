@@ -37,6 +37,7 @@ struct bGPdata;
 struct bGPDlayer;
 struct bGPDframe;
 struct bGPDstroke;
+struct GPUBatch;
 struct Main;
 class Widget_Measure;
 
@@ -66,10 +67,30 @@ class Widget_Annotate : public VR_Widget
 	static bool eraser;	/* Whether the annotate widget is in eraser mode. */
 	static VR_Side cursor_side;	/* Side of the current interaction cursor. */
 	static float eraser_radius;	/* Radius of the eraser ball. */
-	static void erase_stroke(bGPDstroke *gps, bGPDframe *gp_frame);	/*	Helper function to erase a stroke. */
+	static bool erase_stroke(bGPDstroke *gps, bGPDframe *gp_frame);	/*	Helper function to erase a stroke. Returns whether the stroke was changed. */
+
+	static struct GPUBatch *stroke_batches[WIDGET_ANNOTATE_NUM_LAYERS];	/* Cached line batches of the committed strokes per layer. */
+	static struct GPUBatch *point_batches[WIDGET_ANNOTATE_NUM_LAYERS];	/* Cached point batches of the committed single-point strokes per layer. */
+	static bool batches_valid[WIDGET_ANNOTATE_NUM_LAYERS];	/* Whether the batches of a layer are up to date. */
+	static float batches_ink[WIDGET_ANNOTATE_NUM_LAYERS][4];	/* Layer color and opacity the batches were built with. */
+	static float batches_thickness[WIDGET_ANNOTATE_NUM_LAYERS];	/* Layer thickness the batches were built with. */
+	/* Identifies the strokes the batches of a layer were built from, so that changes made outside of the
+	 * VR widget (desktop annotation tool, undo, frame changes) are noticed. */
+	typedef struct BatchesKey {
+		const struct bGPDframe *frame;	/* Frame that was drawn. */
+		const struct bGPDstroke *last_stroke;	/* Last stroke of the frame. */
+		uint num_strokes;	/* Number of strokes in the frame. */
+		uint num_points;	/* Total number of points of the strokes. */
+	} BatchesKey;
+	static BatchesKey batches_key[WIDGET_ANNOTATE_NUM_LAYERS];	/* Strokes the batches of a layer were built from. */
+	static BatchesKey batches_key_get(const struct bGPDframe *gp_frame);	/* Get the key of the strokes of a frame. */
+	static void update_batches(uint layer, const struct bGPDlayer *gp_layer, const struct bGPDframe *gp_frame);	/* Rebuild the cached batches of a layer. */
 public:
   static void add_stroke(const std::vector<bGPDspoint>& ptrs, uint layer, bool set_active); /* Helper function to add a stroke. */
   static void render_points(const std::vector<bGPDspoint>& pts, uint layer);  /* Helper function to render annotation points. */
+  static void invalidate_strokes(int layer = -1);	/* Mark the cached batches of a layer (-1: all layers) for rebuild. Must be called when strokes are added, changed or removed. */
+  static void free_batches();	/* Free the cached batches. */
+  static bool render_strokes(struct bGPdata *gpd, int cfra);	/* Render the committed strokes of frame cfra from the cached batches. Returns false if gpd isn't the VR gpencil data (or can't be drawn from the batches). */
 public:
 	static Widget_Annotate obj;	/* Singleton implementation object. */
 	virtual std::string name() override { return "ANNOTATE"; };	/* Get the name of this widget. */
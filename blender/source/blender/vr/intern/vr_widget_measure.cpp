@@ -123,6 +123,7 @@ void Widget_Measure::draw_line(VR_UI::Cursor& c, Coord3Df& localP0, Coord3Df& lo
 
 	current_stroke = BKE_gpencil_add_stroke(Widget_Annotate::gpf[WIDGET_ANNOTATE_MEASURE_LAYER], 0, 3, line_thickness * 1.6f);
 	memcpy(current_stroke->points, current_stroke_points, sizeof(bGPDspoint) * 3);
+	Widget_Annotate::invalidate_strokes(WIDGET_ANNOTATE_MEASURE_LAYER);
 
 	BKE_gpencil_layer_setactive(Widget_Annotate::gpd, Widget_Annotate::gpl[WIDGET_ANNOTATE_MEASURE_LAYER]);
 }
@@ -197,6 +198,7 @@ void Widget_Measure::drag_stop(VR_UI::Cursor& c)
 				point.pressure = 1.0f;
 				mul_qt_v3(quat, dir_tmp);
 			}
+			Widget_Annotate::invalidate_strokes(WIDGET_ANNOTATE_MEASURE_LAYER);
 
 			BKE_gpencil_layer_setactive(Widget_Annotate::gpd, Widget_Annotate::gpl[WIDGET_ANNOTATE_MEASURE_LAYER]);
 		}
@@ -44,9 +44,18 @@
 
 #include "BKE_context.h"
 #include "BKE_editmesh.h"
+extern "C" {
+#include "BKE_bvhutils.h"
+}
 #include "BKE_object.h"
 #include "BKE_layer.h"
 
+#include "MEM_guardedalloc.h"
+
+#include "BLI_kdopbvh.h"
+
+#include "DNA_mesh_types.h"
+
 #include "DEG_depsgraph.h"
 
 #include "ED_gpencil.h"
@@ -450,7 +459,7 @@ static void raycast_select_multiple(
 
 		DEG_id_tag_update(&scene->id, ID_RECALC_SELECT);
 		WM_event_add_notifier(C, NC_SCENE | ND_OB_SELECT, scene);
-		ED_undo_push(C, "Select");
+		ED_undo_push_select(C, "Select");
 	}
 
 	/* This block uses the control key to make the object selected by its center point rather than its contents */
@@ -712,7 +721,7 @@ static void raycast_select_multiple(
 	if (hit) {
 		DEG_id_tag_update(&scene->id, ID_RECALC_SELECT);
 		WM_event_add_notifier(C, NC_SCENE | ND_OB_SELECT, scene);
-		ED_undo_push(C, "Select");
+		ED_undo_push_select(C, "Select");
 	}
 }
 
@@ -747,7 +756,7 @@ static void raycast_select_multiple_vertex(
 
 		DEG_id_tag_update((ID*)vc->obedit->data, ID_RECALC_SELECT);
 		WM_event_add_notifier(C, NC_GEOM | ND_SELECT, vc->obedit->data);
-		ED_undo_push(C, "Select");
+		ED_undo_push_select(C, "Select");
 	}
 
 	BM_mesh_elem_table_ensure(vc->em->bm, BM_VERT);
@@ -782,7 +791,7 @@ static void raycast_select_multiple_vertex(
 	if (is_inside) {
 		DEG_id_tag_update((ID*)vc->obedit->data, ID_RECALC_SELECT);
 		WM_event_add_notifier(C, NC_GEOM | ND_SELECT, vc->obedit->data);
-		ED_undo_push(C, "Select");
+		ED_undo_push_select(C, "Select");
 	}
 }
 
@@ -816,7 +825,7 @@ static void raycast_select_multiple_edge(
 
 		DEG_id_tag_update((ID*)vc->obedit->data, ID_RECALC_SELECT);
 		WM_event_add_notifier(C, NC_GEOM | ND_SELECT, vc->obedit->data);
-		ED_undo_push(C, "Select");
+		ED_undo_push_select(C, "Select");
 	}
 
 	BM_mesh_elem_table_ensure(vc->em->bm, BM_EDGE);
@@ -852,7 +861,7 @@ static void raycast_select_multiple_edge(
 	if (is_inside) {
 		DEG_id_tag_update((ID*)vc->obedit->data, ID_RECALC_SELECT);
 		WM_event_add_notifier(C, NC_GEOM | ND_SELECT, vc->obedit->data);
-		ED_undo_push(C, "Select");
+		ED_undo_push_select(C, "Select");
 	}
 }
 
@@ -885,7 +894,7 @@ static void raycast_select_multiple_face(
 
 		DEG_id_tag_update((ID*)vc->obedit->data, ID_RECALC_SELECT);
 		WM_event_add_notifier(C, NC_GEOM | ND_SELECT, vc->obedit->data);
-		ED_undo_push(C, "Select");
+		ED_undo_push_select(C, "Select");
 	}
 
 	BM_mesh_elem_table_ensure(vc->em->bm, BM_FACE);
@@ -928,7 +937,7 @@ static void raycast_select_multiple_face(
 	if (is_inside) {
 		DEG_id_tag_update((ID*)vc->obedit->data, ID_RECALC_SELECT);
 		WM_event_add_notifier(C, NC_GEOM | ND_SELECT, vc->obedit->data);
-		ED_undo_push(C, "Select");
+		ED_undo_push_select(C, "Select");
 	}
 }
 
@@ -1125,7 +1134,7 @@ static void proximity_select_multiple(
 
 		DEG_id_tag_update(&scene->id, ID_RECALC_SELECT);
 		WM_event_add_notifier(C, NC_SCENE | ND_OB_SELECT, scene);
-		ED_undo_push(C, "Select");
+		ED_undo_push_select(C, "Select");
 	}
 
 	/* This block uses the control key to make the object selected by its center point rather than its contents */
@@ -1383,8 +1392,137 @@ static void proximity_select_multiple(
 	if (hit) {
 		DEG_id_tag_update(&scene->id, ID_RECALC_SELECT);
 		WM_event_add_notifier(C, NC_SCENE | ND_OB_SELECT, scene);
-		ED_undo_push(C, "Select");
+		ED_undo_push_select(C, "Select");
+	}
+}
+
+/* Selection box and edit object for the proximity overlap tests. */
+typedef struct ProximityOverlapData {
+	BMEditMesh *em;	/* Edit mesh of the edit object. */
+	Mat44f obmat;	/* Object matrix of the edit object. */
+	Coord3Df center;	/* Center of the selection box (Blender space). */
+	Coord3Df bounds;	/* Half size of the selection box (Blender space). */
+} ProximityOverlapData;
+
+/* Whether a point (in object space) lies inside the selection box. */
+static bool proximity_point_inside(const ProximityOverlapData *data, const Coord3Df& co)
+{
+	Coord3Df pos;
+	VR_Math::multiply_mat44_coord3D(pos, data->obmat, co);
+	return (fabs(pos.x - data->center.x) < data->bounds.x &&
+			fabs(pos.y - data->center.y) < data->bounds.y &&
+			fabs(pos.z - data->center.z) < data->bounds.z);
+}
+
+/* Overlap callbacks: exact test of a candidate element (called from multiple threads). */
+static bool proximity_overlap_vert_cb(void *userdata, int index, int UNUSED(index_box), int UNUSED(thread))
+{
+	const ProximityOverlapData *data = (const ProximityOverlapData*)userdata;
+	BMVert *v = BM_vert_at_index(data->em->bm, index);
+	return (!BM_elem_flag_test(v, BM_ELEM_HIDDEN) && proximity_point_inside(data, *(Coord3Df*)v->co));
+}
+
+static bool proximity_overlap_edge_cb(void *userdata, int index, int UNUSED(index_box), int UNUSED(thread))
+{
+	const ProximityOverlapData *data = (const ProximityOverlapData*)userdata;
+	BMEdge *e = BM_edge_at_index(data->em->bm, index);
+	return (!BM_elem_flag_test(e, BM_ELEM_HIDDEN) &&
+			proximity_point_inside(data, (*(Coord3Df*)e->v1->co + *(Coord3Df*)e->v2->co) / 2.0f));
+}
+
+static bool proximity_overlap_face_cb(void *userdata, int index, int UNUSED(index_box), int UNUSED(thread))
+{
+	const ProximityOverlapData *data = (const ProximityOverlapData*)userdata;
+	BMFace *f = BM_face_at_index(data->em->bm, index);
+	Coord3Df cent;
+	BM_face_calc_center_median(f, (float*)&cent);
+	return proximity_point_inside(data, cent);
+}
+
+/* Find the elements of a tree inside the selection box, the tree is traversed in parallel. */
+static BVHTreeOverlap *proximity_overlap_tree(
+	const ProximityOverlapData *data,
+	BVHTree *tree,
+	BVHTree_OverlapCallback callback,
+	uint *r_overlap_tot)
+{
+	/* Selection box in object space (as a single-leaf tree). */
+	const Mat44f obmat_inv = data->obmat.inverse();
+	float corners[8][3];
+	for (int i = 0; i < 8; ++i) {
+		const Coord3Df corner(
+			data->center.x + ((i & 1) ? data->bounds.x : -data->bounds.x),
+			data->center.y + ((i & 2) ? data->bounds.y : -data->bounds.y),
+			data->center.z + ((i & 4) ? data->bounds.z : -data->bounds.z));
+		VR_Math::multiply_mat44_coord3D(*(Coord3Df*)corners[i], obmat_inv, corner);
+	}
+	BVHTree *box_tree = BLI_bvhtree_new(1, 0.0f, 2, 6);
+	BLI_bvhtree_insert(box_tree, 0, &corners[0][0], 8);
+	BLI_bvhtree_balance(box_tree);
+
+	BVHTreeOverlap *overlap = BLI_bvhtree_overlap(tree, box_tree, r_overlap_tot, callback, (void*)data);
+
+	BLI_bvhtree_free(box_tree);
+
+	return overlap;
+}
+
+/* Find the elements inside the selection box.
+ * The element BVH tree is cached with the evaluated edit mesh, so it is only rebuilt when the
+ * mesh geometry changes (not on selection changes). */
+static BVHTreeOverlap *proximity_overlap(
+	const ProximityOverlapData *data,
+	int bvh_cache_type,
+	BVHTree_OverlapCallback callback,
+	uint *r_overlap_tot)
+{
+	*r_overlap_tot = 0;
+
+	BMEditMesh *em = data->em;
+	BVHCache **bvh_cache = em->mesh_eval_final ? &em->mesh_eval_final->runtime.bvh_cache : NULL;
+	BVHTreeFromEditMesh treedata;
+	BKE_bvhtree_from_editmesh_get(&treedata, em, 2, bvh_cache_type, bvh_cache);
+	if (!treedata.tree) {
+		return NULL;
 	}
+
+	BVHTreeOverlap *overlap = proximity_overlap_tree(data, treedata.tree, callback, r_overlap_tot);
+
+	free_bvhtree_from_editmesh(&treedata);
+
+	return overlap;
+}
+
+/* Find the faces whose center is inside the selection box.
+ * Faces are tested by their center, which for a concave face may lie outside of all its
+ * triangles, so the tree holds the face centers (of the visible faces) instead of triangles. */
+static BVHTreeOverlap *proximity_overlap_faces(const ProximityOverlapData *data, uint *r_overlap_tot)
+{
+	*r_overlap_tot = 0;
+
+	BMesh *bm = data->em->bm;
+	if (bm->totface == 0) {
+		return NULL;
+	}
+
+	BVHTree *tree = BLI_bvhtree_new(bm->totface, 0.0f, 2, 6);
+	BMIter iter;
+	BMFace *f;
+	int i;
+	BM_ITER_MESH_INDEX (f, &iter, bm, BM_FACES_OF_MESH, i) {
+		if (!BM_elem_flag_test(f, BM_ELEM_HIDDEN)) {
+			float cent[3];
+			BM_face_calc_center_median(f, cent);
+			BLI_bvhtree_insert(tree, i, cent, 1);
+		}
+	}
+	BLI_bvhtree_balance(tree);
+
+	BVHTreeOverlap *overlap = proximity_overlap_tree(data, tree, proximity_overlap_face_cb, r_overlap_tot);
+
+	BLI_bvhtree_free(tree);
+
+	return overlap;
 }
 
 /* Adapted from view3d_select.c */
@@ -1408,39 +1546,36 @@ static void proximity_select_multiple_vertex(
 
 		DEG_id_tag_update((ID*)vc->obedit->data, ID_RECALC_SELECT);
 		WM_event_add_notifier(C, NC_GEOM | ND_SELECT, vc->obedit->data);
-		ED_undo_push(C, "Select");
+		ED_undo_push_select(C, "Select");
 	}
 
 	BM_mesh_elem_table_ensure(vc->em->bm, BM_VERT);
 	BMVert *sv = NULL;
 
-	const Mat44f& offset = *(Mat44f*)vc->obedit->obmat;
-	static Coord3Df pos;
-	BMVert *v;
-	BMIter iter;
-	BMesh *bm = vc->em->bm;
-	BM_ITER_MESH(v, &iter, bm, BM_VERTS_OF_MESH) {
-		if (!BM_elem_flag_test(v, BM_ELEM_HIDDEN)) {
-			VR_Math::multiply_mat44_coord3D(pos, offset, *(Coord3Df*)v->co);
-			if (fabs(pos.x - center.x) < bounds_x &&
-				fabs(pos.y - center.y) < bounds_y &&
-				fabs(pos.z - center.z) < bounds_z)
-			{
-				sv = v;
-				is_inside = true;
-				const bool is_select = BM_elem_flag_test(sv, BM_ELEM_SELECT);
-				const int sel_op_result = ED_select_op_action_deselected(deselect ? SEL_OP_SUB : SEL_OP_ADD, is_select, is_inside);
-				if (sel_op_result != -1) {
-					BM_vert_select_set(vc->em->bm, sv, sel_op_result);
-				}
-			}
+	ProximityOverlapData data;
+	data.em = vc->em;
+	data.obmat = *(Mat44f*)vc->obedit->obmat;
+	data.center = center;
+	data.bounds = Coord3Df(bounds_x, bounds_y, bounds_z);
+	uint overlap_tot;
+	BVHTreeOverlap *overlap = proximity_overlap(&data, BVHTREE_FROM_EM_VERTS, proximity_overlap_vert_cb, &overlap_tot);
+	for (uint i = 0; i < overlap_tot; ++i) {
+		sv = BM_vert_at_index(vc->em->bm, overlap[i].indexA);
+		is_inside = true;
+		const bool is_select = BM_elem_flag_test(sv, BM_ELEM_SELECT);
+		const int sel_op_result = ED_select_op_action_deselected(deselect ? SEL_OP_SUB : SEL_OP_ADD, is_select, is_inside);
+		if (sel_op_result != -1) {
+			BM_vert_select_set(vc->em->bm, sv, sel_op_result);
 		}
 	}
+	if (overlap) {
+		MEM_freeN(overlap);
+	}
 
 	if (is_inside) {
 		DEG_id_tag_update((ID*)vc->obedit->data, ID_RECALC_SELECT);
 		WM_event_add_notifier(C, NC_GEOM | ND_SELECT, vc->obedit->data);
-		ED_undo_push(C, "Select");
+		ED_undo_push_select(C, "Select");
 	}
 }
 
@@ -1455,7 +1590,6 @@ static void proximity_select_multiple_edge(
 	float bounds_y = fabsf(p1.y - p0.y) / 2.0f;
 	float bounds_z = fabsf(p1.z - p0.z) / 2.0f;
 	Coord3Df center = p0 + (p1 - p0) / 2.0f;
-	float med_co[3];
 	bool is_inside = false;
 
 	if (!extend && !deselect) {
@@ -1465,40 +1599,36 @@ static void proximity_select_multiple_edge(
 
 		DEG_id_tag_update((ID*)vc->obedit->data, ID_RECALC_SELECT);
 		WM_event_add_notifier(C, NC_GEOM | ND_SELECT, vc->obedit->data);
-		ED_undo_push(C, "Select");
+		ED_undo_push_select(C, "Select");
 	}
 
 	BM_mesh_elem_table_ensure(vc->em->bm, BM_EDGE);
 	BMEdge *se = NULL;
 
-	const Mat44f& offset = *(Mat44f*)vc->obedit->obmat;
-	static Coord3Df pos;
-	BMEdge *e;
-	BMIter iter;
-	BMesh *bm = vc->em->bm;
-	BM_ITER_MESH(e, &iter, bm, BM_EDGES_OF_MESH) {
-		if (!BM_elem_flag_test(e, BM_ELEM_HIDDEN)) {
-			*(Coord3Df*)med_co = (*(Coord3Df*)e->v1->co + *(Coord3Df*)e->v2->co) / 2.0f;
-			VR_Math::multiply_mat44_coord3D(pos, offset, *(Coord3Df*)med_co);
-			if (fabs(pos.x - center.x) < bounds_x &&
-				fabs(pos.y - center.y) < bounds_y &&
-				fabs(pos.z - center.z) < bounds_z)
-			{
-				se = e;
-				is_inside = true;
-				const bool is_select = BM_elem_flag_test(se, BM_ELEM_SELECT);
-				const int sel_op_result = ED_select_op_action_deselected(deselect ? SEL_OP_SUB : SEL_OP_ADD, is_select, is_inside);
-				if (sel_op_result != -1) {
-					BM_edge_select_set(vc->em->bm, se, sel_op_result);
-				}
-			}
+	ProximityOverlapData data;
+	data.em = vc->em;
+	data.obmat = *(Mat44f*)vc->obedit->obmat;
+	data.center = center;
+	data.bounds = Coord3Df(bounds_x, bounds_y, bounds_z);
+	uint overlap_tot;
+	BVHTreeOverlap *overlap = proximity_overlap(&data, BVHTREE_FROM_EM_EDGES, proximity_overlap_edge_cb, &overlap_tot);
+	for (uint i = 0; i < overlap_tot; ++i) {
+		se = BM_edge_at_index(vc->em->bm, overlap[i].indexA);
+		is_inside = true;
+		const bool is_select = BM_elem_flag_test(se, BM_ELEM_SELECT);
+		const int sel_op_result = ED_select_op_action_deselected(deselect ? SEL_OP_SUB : SEL_OP_ADD, is_select, is_inside);
+		if (sel_op_result != -1) {
+			BM_edge_select_set(vc->em->bm, se, sel_op_result);
 		}
 	}
+	if (overlap) {
+		MEM_freeN(overlap);
+	}
 
 	if (is_inside) {
 		DEG_id_tag_update((ID*)vc->obedit->data, ID_RECALC_SELECT);
 		WM_event_add_notifier(C, NC_GEOM | ND_SELECT, vc->obedit->data);
-		ED_undo_push(C, "Select");
+		ED_undo_push_select(C, "Select");
 	}
 }
 
@@ -1522,47 +1652,36 @@ static void proximity_select_multiple_face(
 
 		DEG_id_tag_update((ID*)vc->obedit->data, ID_RECALC_SELECT);
 		WM_event_add_notifier(C, NC_GEOM | ND_SELECT, vc->obedit->data);
-		ED_undo_push(C, "Select");
+		ED_undo_push_select(C, "Select");
 	}
 
 	BM_mesh_elem_table_ensure(vc->em->bm, BM_FACE);
 	BMFace *sf = NULL;
 
-	const Mat44f& offset = *(Mat44f*)vc->obedit->obmat;
-	static Coord3Df pos;
-	static Coord3Df cent;
-	BMFace *f;
-	BMLoop *l;
-	BMIter iter;
-	BMesh *bm = vc->em->bm;
-	BM_ITER_MESH(f, &iter, bm, BM_FACES_OF_MESH) {
-		l = f->l_first;
-		memset(&cent, 0, sizeof(float) * 3);
-		for (int i = 0; i < f->len; ++i, l = l->next) {
-			cent += *(Coord3Df*)l->v->co;
-		}
-		cent /= f->len;
-		if (!BM_elem_flag_test(f, BM_ELEM_HIDDEN)) {
-			VR_Math::multiply_mat44_coord3D(pos, offset, cent);
-			if (fabs(pos.x - center.x) < bounds_x &&
-				fabs(pos.y - center.y) < bounds_y &&
-				fabs(pos.z - center.z) < bounds_z)
-			{
-				sf = f;
-				is_inside = true;
-				const bool is_select = BM_elem_flag_test(sf, BM_ELEM_SELECT);
-				const int sel_op_result = ED_select_op_action_deselected(deselect ? SEL_OP_SUB : SEL_OP_ADD, is_select, is_inside);
-				if (sel_op_result != -1) {
-					BM_face_select_set(vc->em->bm, sf, sel_op_result);
-				}
-			}
+	ProximityOverlapData data;
+	data.em = vc->em;
+	data.obmat = *(Mat44f*)vc->obedit->obmat;
+	data.center = center;
+	data.bounds = Coord3Df(bounds_x, bounds_y, bounds_z);
+	uint overlap_tot;
+	BVHTreeOverlap *overlap = proximity_overlap_faces(&data, &overlap_tot);
+	for (uint i = 0; i < overlap_tot; ++i) {
+		sf = BM_face_at_index(vc->em->bm, overlap[i].indexA);
+		is_inside = true;
+		const bool is_select = BM_elem_flag_test(sf, BM_ELEM_SELECT);
+		const int sel_op_result = ED_select_op_action_deselected(deselect ? SEL_OP_SUB : SEL_OP_ADD, is_select, is_inside);
+		if (sel_op_result != -1) {
+			BM_face_select_set(vc->em->bm, sf, sel_op_result);
 		}
 	}
+	if (overlap) {
+		MEM_freeN(overlap);
+	}
 
 	if (is_inside) {
 		DEG_id_tag_update((ID*)vc->obedit->data, ID_RECALC_SELECT);
 		WM_event_add_notifier(C, NC_GEOM | ND_SELECT, vc->obedit->data);
-		ED_undo_push(C, "Select");
+		ED_undo_push_select(C, "Select");
 	}
 }
 
@@ -1650,7 +1769,7 @@ void Widget_Select::Proximity::click(VR_UI::Cursor& c)
 	}
 	/* Update manipulators */
 	Widget_Transform::update_manipulator();
-	ED_undo_push(C, "Select");
+	ED_undo_push_select(C, "Select");
 }
 
 void Widget_Select::Proximity::drag_start(VR_UI::Cursor& c)
@@ -42,6 +42,7 @@
 #include "vr_draw.h"
 
 #include "BLI_math.h"
+#include "BLI_task.h"
 
 #include "BKE_context.h"
 #include "BKE_editmesh.h"
@@ -92,6 +93,11 @@ bool Widget_Transform::snapped(false);
 #define WIDGET_TRANSFORM_ROT_PRECISION (PI/36.0f)
 #define WIDGET_TRANSFORM_SCALE_PRECISION 0.005f
 
+/* Number of vertices per task when applying drag updates in edit mode. */
+#define WIDGET_TRANSFORM_DRAG_CHUNK 1024
+/* Minimum number of vertices to apply drag updates on multiple threads. */
+#define WIDGET_TRANSFORM_DRAG_THREADING_MIN 10000
+
 //bool Widget_Transform::edit(false);
 VR_UI::TransformSpace Widget_Transform::transform_space(VR_UI::TRANSFORMSPACE_GLOBAL);
 bool Widget_Transform::is_dragging(false);
@@ -109,6 +115,13 @@ float Widget_Transform::manip_scale_factor(0.2f);
 
 Mat44f Widget_Transform::obmat_inv;
 
+Object *Widget_Transform::drag_obedit(NULL);
+BMesh *Widget_Transform::drag_bm(NULL);
+std::vector<BMVert*> Widget_Transform::drag_verts;
+std::vector<float> Widget_Transform::drag_co;
+Coord3Df Widget_Transform::drag_center;
+Mat44f Widget_Transform::drag_t = VR_Math::identity_f;
+
 /* Manipulator colors. */
 static const float c_manip[4][4] = { 1.0f, 0.2f, 0.322f, 0.4f,
 									 0.545f, 0.863f, 0.0f, 0.4f,
@@ -641,6 +654,162 @@ void Widget_Transform::update_manipulator()
 	}
 }
 
+void Widget_Transform::drag_snapshot(Object *obedit, BMesh *bm, short selectmode)
+{
+	drag_clear();
+
+	/* Collect each vertex of the selection once (edges and faces share vertices).
+	 * The center is weighted like in update_manipulator(). */
+	BM_mesh_elem_hflag_disable_all(bm, BM_VERT, BM_ELEM_TAG, false);
+	drag_center = Coord3Df(0.0f, 0.0f, 0.0f);
+	int count = 0;
+	BMIter iter;
+	if (selectmode & SCE_SELECT_VERTEX) {
+		BMVert *v;
+		BM_ITER_MESH(v, &iter, bm, BM_VERTS_OF_MESH) {
+			if (BM_elem_flag_test(v, BM_ELEM_SELECT)) {
+				drag_verts.push_back(v);
+				drag_center += *(Coord3Df*)v->co;
+				++count;
+			}
+		}
+	}
+	else if (selectmode & SCE_SELECT_EDGE) {
+		BMEdge *e;
+		BM_ITER_MESH(e, &iter, bm, BM_EDGES_OF_MESH) {
+			if (BM_elem_flag_test(e, BM_ELEM_SELECT)) {
+				BMVert *v[2] = { e->v1, e->v2 };
+				for (int i = 0; i < 2; ++i) {
+					if (!BM_elem_flag_test(v[i], BM_ELEM_TAG)) {
+						BM_elem_flag_enable(v[i], BM_ELEM_TAG);
+						drag_verts.push_back(v[i]);
+					}
+					drag_center += *(Coord3Df*)v[i]->co;
+				}
+				count += 2;
+			}
+		}
+	}
+	else if (selectmode & SCE_SELECT_FACE) {
+		BMFace *f;
+		BMLoop *l;
+		BM_ITER_MESH(f, &iter, bm, BM_FACES_OF_MESH) {
+			if (BM_elem_flag_test(f, BM_ELEM_SELECT)) {
+				l = f->l_first;
+				for (int i = 0; i < f->len; ++i, l = l->next) {
+					if (!BM_elem_flag_test(l->v, BM_ELEM_TAG)) {
+						BM_elem_flag_enable(l->v, BM_ELEM_TAG);
+						drag_verts.push_back(l->v);
+					}
+					drag_center += *(Coord3Df*)l->v->co;
+					++count;
+				}
+			}
+		}
+	}
+	if (count) {
+		drag_center /= (float)count;
+	}
+
+	/* Pack the original positions. */
+	const size_t totvert = drag_verts.size();
+	drag_co.resize(totvert * 3);
+	float *x = drag_co.data();
+	float *y = x + totvert;
+	float *z = y + totvert;
+	for (size_t i = 0; i < totvert; ++i) {
+		const float *co = drag_verts[i]->co;
+		x[i] = co[0];
+		y[i] = co[1];
+		z[i] = co[2];
+	}
+
+	drag_obedit = obedit;
+	drag_bm = bm;
+}
+
+typedef struct TransformDragData {
+	BMVert **verts;
+	const float *x;
+	const float *y;
+	const float *z;
+	int totvert;
+	float m[4][4];
+} TransformDragData;
+
+static void transform_drag_apply_task_cb(void *__restrict userdata,
+										  const int n,
+										  const TaskParallelTLS *__restrict UNUSED(tls))
+{
+	const TransformDragData *data = (const TransformDragData*)userdata;
+	const int start = n * WIDGET_TRANSFORM_DRAG_CHUNK;
+	const int len = min_ii(WIDGET_TRANSFORM_DRAG_CHUNK, data->totvert - start);
+	const float (*m)[4] = data->m;
+	const float *__restrict x = data->x + start;
+	const float *__restrict y = data->y + start;
+	const float *__restrict z = data->z + start;
+
+	/* Transform the packed positions (vectorizable), then scatter them to the vertices. */
+	float co[3][WIDGET_TRANSFORM_DRAG_CHUNK];
+	for (int j = 0; j < 3; ++j) {
+		float *__restrict r = co[j];
+		for (int i = 0; i < len; ++i) {
+			r[i] = x[i] * m[0][j] + y[i] * m[1][j] + z[i] * m[2][j] + m[3][j];
+		}
+	}
+	BMVert **verts = data->verts + start;
+	for (int i = 0; i < len; ++i) {
+		float *v_co = verts[i]->co;
+		v_co[0] = co[0][i];
+		v_co[1] = co[1][i];
+		v_co[2] = co[2][i];
+	}
+}
+
+void Widget_Transform::drag_apply(const Mat44f& delta)
+{
+	if (memcmp(delta.m, VR_Math::identity_f.m, sizeof(float) * 4 * 4) == 0) {
+		return; /* Nothing changed. */
+	}
+	drag_t = drag_t * delta;
+
+	const int totvert = (int)drag_verts.size();
+	if (!totvert) {
+		return;
+	}
+	TransformDragData data;
+	data.verts = drag_verts.data();
+	data.x = drag_co.data();
+	data.y = data.x + totvert;
+	data.z = data.y + totvert;
+	data.totvert = totvert;
+	memcpy(data.m, drag_t.m, sizeof(float) * 4 * 4);
+
+	TaskParallelSettings settings;
+	BLI_parallel_range_settings_defaults(&settings);
+	settings.use_threading = (totvert >= WIDGET_TRANSFORM_DRAG_THREADING_MIN);
+	const int num_chunks = (totvert + WIDGET_TRANSFORM_DRAG_CHUNK - 1) / WIDGET_TRANSFORM_DRAG_CHUNK;
+	BLI_task_parallel_range(0, num_chunks, &data, transform_drag_apply_task_cb, &settings);
+}
+
+void Widget_Transform::drag_clear()
+{
+	drag_obedit = NULL;
+	drag_bm = NULL;
+	drag_verts.clear();
+	drag_co.clear();
+	drag_t = VR_Math::identity_f;
+}
+
+void Widget_Transform::update_manipulator_drag()
+{
+	/* The manipulator orientation doesn't change while dragging
+	 * (normals are only updated on drag_stop()), only its location does. */
+	static Coord3Df pos;
+	VR_Math::multiply_mat44_coord3D(pos, drag_t, drag_center);
+	VR_Math::multiply_mat44_coord3D(*(Coord3Df*)manip_t.m[3], *(Mat44f*)drag_obedit->obmat, pos);
+}
+
 bool Widget_Transform::has_click(VR_UI::Cursor& c) const
 {
 	return true;
@@ -814,6 +983,13 @@ void Widget_Transform::drag_start(VR_UI::Cursor& c)
 	if (obedit) {
 		obmat_inv = (*(Mat44f*)obedit->obmat).inverse();
 		manip_t_orig = manip_t * obmat_inv;
+		/* Capture the selected vertices. */
+		if (obedit->type == OB_MESH) {
+			BMesh *bm = ((Mesh*)obedit->data)->edit_mesh->bm;
+			if (bm) {
+				drag_snapshot(obedit, bm, CTX_data_scene(C)->toolsettings->selectmode);
+			}
+		}
 	}
 	else {
 		manip_t_orig = manip_t;
@@ -858,6 +1034,9 @@ void Widget_Transform::drag_contd(VR_UI::Cursor& c)
 			if (!bm) {
 				return;
 			}
+			if (drag_obedit != obedit || drag_bm != bm) {
+				drag_snapshot(obedit, bm, ts->selectmode);
+			}
 		}
 	}
 
@@ -1465,45 +1644,7 @@ void Widget_Transform::drag_contd(VR_UI::Cursor& c)
 				if (snap_mode == VR_UI::SNAPMODE_ROTATION) {
 					memset(delta.m[3], 0, sizeof(float) * 3);
 				}
-				BMIter iter;
-
-				if (ts->selectmode & SCE_SELECT_VERTEX) {
-					BMVert *v;
-					BM_ITER_MESH(v, &iter, bm, BM_VERTS_OF_MESH) {
-						if (BM_elem_flag_test(v, BM_ELEM_SELECT)) {
-							float *co = v->co;
-							memcpy((float*)&temp1, co, sizeof(float) * 3);
-							mul_v3_m4v3(co, delta.m, (float*)&temp1);
-						}
-					}
-				}
-				else if (ts->selectmode & SCE_SELECT_EDGE) {
-					BMEdge *e;
-					BM_ITER_MESH(e, &iter, bm, BM_EDGES_OF_MESH) {
-						if (BM_elem_flag_test(e, BM_ELEM_SELECT)) {
-							float *co1 = e->v1->co;
-							float *co2 = e->v2->co;
-							memcpy((float*)&temp1, co1, sizeof(float) * 3);
-							memcpy((float*)&temp2, co2, sizeof(float) * 3);
-							mul_v3_m4v3(co1, delta.m, (float*)&temp1);
-							mul_v3_m4v3(co2, delta.m, (float*)&temp2);
-						}
-					}
-				}
-				else if (ts->selectmode & SCE_SELECT_FACE) {
-					BMFace *f;
-					BMLoop *l;
-					BM_ITER_MESH(f, &iter, bm, BM_FACES_OF_MESH) {
-						if (BM_elem_flag_test(f, BM_ELEM_SELECT)) {
-							l = f->l_first;
-							for (int i = 0; i < f->len; ++i, l = l->next) {
-								float *co = l->v->co;
-								memcpy((float*)&temp1, co, sizeof(float) * 3);
-								mul_v3_m4v3(co, delta.m, (float*)&temp1);
-							}
-						}
-					}
-				}
+				drag_apply(delta);
 
 				/* Set recalc flags. */
 				DEG_id_tag_update((ID*)obedit->data, 0);
@@ -1721,44 +1862,7 @@ void Widget_Transform::drag_contd(VR_UI::Cursor& c)
 				}
 				}
 
-				BMIter iter;
-				if (ts->selectmode & SCE_SELECT_VERTEX) {
-					BMVert *v;
-					BM_ITER_MESH(v, &iter, bm, BM_VERTS_OF_MESH) {
-						if (BM_elem_flag_test(v, BM_ELEM_SELECT)) {
-							float *co = v->co;
-							memcpy((float*)&temp1, co, sizeof(float) * 3);
-							mul_v3_m4v3(co, delta.m, (float*)&temp1);
-						}
-					}
-				}
-				else if (ts->selectmode & SCE_SELECT_EDGE) {
-					BMEdge *e;
-					BM_ITER_MESH(e, &iter, bm, BM_EDGES_OF_MESH) {
-						if (BM_elem_flag_test(e, BM_ELEM_SELECT)) {
-							float *co1 = e->v1->co;
-							float *co2 = e->v2->co;
-							memcpy((float*)&temp1, co1, sizeof(float) * 3);
-							memcpy((float*)&temp2, co2, sizeof(float) * 3);
-							mul_v3_m4v3(co1, delta.m, (float*)&temp1);
-							mul_v3_m4v3(co2, delta.m, (float*)&temp2);
-						}
-					}
-				}
-				else if (ts->selectmode & SCE_SELECT_FACE) {
-					BMFace *f;
-					BMLoop *l;
-					BM_ITER_MESH(f, &iter, bm, BM_FACES_OF_MESH) {
-						if (BM_elem_flag_test(f, BM_ELEM_SELECT)) {
-							l = f->l_first;
-							for (int i = 0; i < f->len; ++i, l = l->next) {
-								float *co = l->v->co;
-								memcpy((float*)&temp1, co, sizeof(float) * 3);
-								mul_v3_m4v3(co, delta.m, (float*)&temp1);
-							}
-						}
-					}
-				}
+				drag_apply(delta);
 
 				/* Set recalc flags. */
 				DEG_id_tag_update((ID*)obedit->data, 0);
@@ -1839,7 +1943,12 @@ void Widget_Transform::drag_contd(VR_UI::Cursor& c)
 		else {
 			/* Don't update manipulator transformation for rotations. */
 			if (transform_mode != TRANSFORMMODE_ROTATE) {
-				update_manipulator();
+				if (obedit && drag_obedit == obedit) {
+					update_manipulator_drag();
+				}
+				else {
+					update_manipulator();
+				}
 			}
 		}
 
@@ -1882,6 +1991,7 @@ void Widget_Transform::drag_stop(VR_UI::Cursor& c)
 	}
 
 	is_dragging = false;
+	drag_clear();
 
 	if (Widget_Sculpt::is_dragging) {
 		return;
@@ -82,6 +82,20 @@ class Widget_Transform : public VR_Widget
 
 	static Mat44f obmat_inv;	/* The inverse of the selected object's transformation (edit mode). */
 
+	/* Edit mode drag snapshot: the selected vertices are captured once on drag_start() and
+	 * each drag update is applied to their original positions. */
+	static struct Object *drag_obedit;	/* The edit object of the snapshot (NULL if none). */
+	static struct BMesh *drag_bm;	/* The edit mesh of the snapshot. */
+	static std::vector<struct BMVert*> drag_verts;	/* The selected vertices (each vertex once). */
+	static std::vector<float> drag_co;	/* Original vertex positions (SoA: all x, then all y, then all z). */
+	static Coord3Df drag_center;	/* Original selection center (object space, as in update_manipulator()). */
+	static Mat44f drag_t;	/* Transformation accumulated since drag_start() (object space). */
+
+	static void drag_snapshot(struct Object *obedit, struct BMesh *bm, short selectmode);	/* Capture the selected vertices of the edit mesh. */
+	static void drag_apply(const Mat44f& delta);	/* Apply a transformation delta to the captured vertices. */
+	static void drag_clear();	/* Release the snapshot. */
+	static void update_manipulator_drag();	/* Update the manipulator location from the snapshot. */
+
 	static void raycast_select_manipulator(const Coord3Df& p, bool *extrude=0);	/* Select a manipulator component with raycast selection. */
 public:
 	static void update_manipulator();	/* Update the manipulator transform. */
@@ -34,6 +34,7 @@
 extern "C" {
 #endif
 
+struct bGPdata;
 struct rcti;
 
 int vr_api_create_ui();	/* Create a object internally. Must be called before the functions below. */
@@ -52,8 +53,14 @@ int vr_api_update_projection_matrix(int side, const float _projection[4][4]);	/*
 int vr_api_update_viewport_bounds(const struct rcti *bounds);	/* Update viewport (window) bounds for the UI module. */
 int vr_api_pre_render(int side);	/* Pre-render UI elements. */
 int vr_api_post_render(int side);/* Post-render UI elements. */
+int vr_api_draw_annotations(struct bGPdata *gpd, int cfra);	/* Draw the VR annotation strokes of frame cfra from cached batches. Returns 1 if gpd holds the VR annotations (and was drawn), 0 otherwise. */
 int vr_api_uninit_ui();	/* Un-initialize the internal object. */
 
+double vr_api_timing_now(); /* Current time stamp to pass to vr_api_timing_record(). */
+int vr_api_timing_begin_frame(); /* Start a new frame for the frame timing instrumentation. */
+int vr_api_timing_record(int stage, int index, double start); /* Record the time of a frame stage (VR_TimingStage) from start until now. */
+int vr_api_timing_dump(const char *filepath); /* Write the recorded frame timings to a CSV (".csv") or JSON trace file. */
+
 int vr_api_init_remote(int timeout_sec); /* Start remote device stream. */
 int vr_api_get_params_remote(); /* Transfer remote VR params to VR module. */
 int vr_api_get_transforms_remote(); /* Transfer remote tracking transforms to VR module. */
@@ -83,9 +83,41 @@ typedef enum VR_Type
   ,
   VR_TYPE_MAGICLEAP = 5 /* Magic Leap API was used for implementation. */
   ,
-	VR_TYPES = 6 /* Number of VR types. */
+  VR_TYPE_REPLAY = 6 /* Recorded session replayed without hardware (BlenderXR_Replay). */
+  ,
+	VR_TYPES = 7 /* Number of VR types. */
 } VR_Type; 
 
+/* Instrumented stages of a VR frame (see vr_api_timing_record()). */
+typedef enum VR_TimingStage
+{
+	VR_TIMING_FRAME		= 0	/* Whole frame (from one tracking update to the next). */
+	,
+	VR_TIMING_TRACKING	= 1	/* Tracking update (vr_update_tracking()). */
+	,
+	VR_TIMING_OPERATIONS	= 2	/* UI operations (vr_do_interaction()). */
+	,
+	VR_TIMING_SCENE		= 3	/* Scene draw of one eye (index: eye), including the widgets. */
+	,
+	VR_TIMING_WIDGET	= 4	/* Render function of one widget (index: widget type). */
+	,
+	VR_TIMING_BLIT		= 5	/* Blit and submit to the HMD (vr_blit()). */
+	,
+	VR_TIMING_ENCODE	= 6	/* Encoding of a frame for remote streaming (image thread). */
+	,
+	VR_TIMING_STAGES	= 7	/* Number of stages. */
+} VR_TimingStage;
+
+/* Draw passes of a VR eye (see vr_draw_region_bind_pass()). */
+typedef enum VR_DrawPass
+{
+	VR_DRAW_PASS_FULL	= 0	/* Whole eye image at the render resolution. */
+	,
+	VR_DRAW_PASS_INSET	= 1	/* Foveated rendering: full-resolution inset around the gaze point. */
+	,
+	VR_DRAW_PASS_PERIPHERY	= 2	/* Foveated rendering: whole eye image at reduced resolution (composited with the inset). */
+} VR_DrawPass;
+
 /* Simple struct for 3D input device information. */
 typedef struct VR_Controller {
 	VR_Side	side;		/* Side of the controller.  */
@@ -124,6 +156,19 @@ typedef struct VR {
 	float aperture_u;	/* The aperture of the texture(0~u) that contains the rendering. */
 	float aperture_v;	/* The aperture of the texture(0~v) that contains the rendering. */
 
+	float render_scale;	/* Current render scale (fraction of tex_width / tex_height the eyes are rendered with). */
+	float render_scale_min;	/* Lower bound of the adaptive render scale. */
+	float render_scale_max;	/* Upper bound of the adaptive render scale. */
+	int render_width;	/* Eye render width (tex_width * render_scale). */
+	int render_height;	/* Eye render height (tex_height * render_scale). */
+	float gpu_time;	/* Smoothed GPU time of the eye renders of one frame (ms, 0 if not measured). */
+
+	int foveation;	/* Whether foveated rendering is enabled (see vr_set_foveation()). */
+	int gaze_synthetic;	/* Whether the gaze point was set with vr_set_gaze() (instead of coming from the eye tracker). */
+	float gaze[VR_SIDES][2];	/* Gaze point per eye (0~1 from the bottom-left of the eye image). */
+	float foveation_inset[VR_SIDES][4];	/* Full-resolution inset per eye (umin, vmin, umax, vmax; 0~1 from the bottom-left). */
+	VR_DrawPass draw_pass;	/* The pass that is currently drawn. */
+
 	float clip_sta;	/* Near clip plane. */
 	float clip_end;	/* Far clip plane. */
 
@@ -131,6 +176,8 @@ typedef struct VR {
 	float t_hmd_inv[VR_SPACES][4][4];	/* Inverses of t_hmd. */
 	float t_eye[VR_SPACES][VR_SIDES][4][4];	/* Last tracked position of the eyes. */
 	float t_eye_inv[VR_SPACES][VR_SIDES][4][4]; /* Inverses of t_eye. */
+	float t_hmd_rendered[4][4];	/* Predicted (real-world) position of the HMD that the current frame is rendered with. */
+	int tracking_latched;	/* Whether late-latching was already attempted for the current frame. */
 
 	struct VR_Controller *controller[VR_MAX_CONTROLLERS];		/* Controllers associated with the HMD device. */
 	float t_controller[VR_SPACES][VR_MAX_CONTROLLERS][4][4];	/* Last tracked positions of the controllers. */
@@ -138,7 +185,10 @@ typedef struct VR {
 
 	struct GPUOffScreen *offscreen[VR_SIDES];	/* Offscreen render buffers (one per eye). */
 	struct GPUViewport *viewport[VR_SIDES];		/* Viewports corresponding to offscreen buffers. */
+	struct GPUViewport *viewport_inset[VR_SIDES];	/* Viewports of the full-resolution insets (foveated rendering). */
+	struct GPUOffScreen *foveated[VR_SIDES];	/* Composited eye images (foveated rendering). */
 	struct wmWindow *window;	/* The window that contains the VR viewports. */
+	int single_pass;	/* Whether the VR region is currently drawn with single-pass stereo (both eyes from one draw manager cache population). */
 
 	struct bContext *ctx; /* The Blender context associated with the VR module. */
 } VR;
@@ -149,16 +199,44 @@ int vr_init_ui(void);	/* Initialize VR UI operations. Returns 0 on success, -1 o
 int vr_uninit(void);	/* Un-intialize VR operations. Returns 0 on success, -1 on failure. */
 
 struct ARegion;
+struct View3D;
 
 int vr_create_viewports(struct ARegion *ar);	/* Create VR offscreen buffers and viewports. */
 void vr_free_viewports(struct ARegion *ar);		/* Free VR offscreen buffers and viewports. */
 void vr_draw_region_bind(struct ARegion *ar, int side);	/* Bind the VR offscreen buffer for rendering. */
+int vr_draw_region_passes(void);	/* Number of draw passes per eye (2 with foveated rendering, else 1). */
+void vr_draw_region_bind_pass(struct ARegion *ar, int side, int pass);	/* Bind the VR offscreen buffer for rendering pass (0 ~ vr_draw_region_passes() - 1) of an eye. */
 void vr_draw_region_unbind(struct ARegion *ar, int side);	/* Unbind the VR offscreen buffer. */
+int vr_draw_region_single_pass_supported(const struct View3D *v3d);	/* Whether both eyes of the VR region can be drawn from a single draw manager cache population. */
+void vr_set_render_scale_range(float scale_min, float scale_max);	/* Set the range of the adaptive render scale (min == max for a fixed scale). */
+void vr_set_foveation(int enable);	/* Enable / disable foveated rendering. */
+void vr_set_gaze(const float gaze[2]);	/* Set a synthetic gaze point for foveated rendering (0~1 from the bottom-left of the eye images), NULL to use the eye tracker. */
+
+/* Remote streaming functions. */
+int vr_stream_readback_queue(int width, int height, int depth_to_alpha);	/* Downscale the eye images on the GPU and start an asynchronous readback. Returns 0 on success, 1 if all readback buffers are in use, -1 on failure. */
+int vr_stream_readback_fetch(unsigned char *pixels_left, unsigned char *pixels_right);	/* Copy the oldest finished readback (RGBA, top row first) without stalling. Returns 0 on success, -1 if no readback finished. */
+void vr_stream_readback_free(void);	/* Free the remote streaming readback buffers. */
+
+/* Session recording for the BlenderXR_Replay backend (see src/vr_replay.h for the file format). */
+int vr_record_begin(const char *filepath);	/* Start recording the tracking and controller states of every frame. Returns 0 on success, -1 on failure. */
+int vr_record_end(void);	/* Stop recording. Returns the number of recorded frames, -1 if not recording. */
 
 /* VR module functions. */
 int vr_update_tracking(void);	/* Update tracking. */
+int vr_latch_tracking(void);	/* Re-sample the eye positions shortly before rendering (late-latching). Returns 0 if the eye positions were updated, -1 otherwise. */
 int vr_blit(void);	/* Blit the hmd. */
 
+/* Pose prediction measurement. Called with the HMD position that the last frame was rendered with,
+ * and the measured HMD position at the time it was displayed (both real-world space). */
+typedef void (*VR_PosePredictionHook)(const float t_predicted[4][4], const float t_actual[4][4], void *userdata);
+void vr_set_pose_prediction_hook(VR_PosePredictionHook hook, void *userdata);	/* Set (or clear, with NULL) the pose prediction measurement hook. */
+void vr_pose_prediction_log(const float t_predicted[4][4], const float t_actual[4][4], void *userdata);	/* Hook that prints pose prediction error statistics to the console. */
+
+/* Frame timing functions. */
+double vr_timing_now(void);	/* Current time stamp to pass to vr_timing_record(). */
+void vr_timing_record(VR_TimingStage stage, int index, double start);	/* Record the time of a frame stage from start until now. */
+int vr_timing_dump(const char *filepath);	/* Write the recorded frame timings to a CSV (".csv") or JSON (Chrome trace) file. Returns 0 on success, -1 on failure. */
+
 /* Interaction/execution function. */
 void vr_do_interaction(void);	/* Interaction update/execution where the VR module may alter scene data. */
 void vr_do_post_render_interaction(void);	/* Interaction update/execution for special operations (i.e. undo/redo) that need to be called after the scene is rendered.	*/
@@ -167,6 +245,10 @@ void vr_do_post_render_interaction(void);	/* Interaction update/execution for sp
 void vr_pre_scene_render(int side);	/* Pre-scene rendering call. */
 void vr_post_scene_render(int side);/* Post-scene rendering call. */
 
+struct bGPdata;
+
+int vr_draw_annotations(struct bGPdata *gpd, int cfra);	/* Draw the VR annotation strokes of frame cfra (3D space). Returns 1 if gpd holds the VR annotations (and was drawn), 0 otherwise. */
+
 void vr_update_view_matrix(int side, const float view[4][4]);	/* Update the OpenGL view matrix for the VR module. */
 void vr_update_projection_matrix(int side, const float projection[4][4]);	/* Update the OpenGL projection matrix for the VR module. */
 
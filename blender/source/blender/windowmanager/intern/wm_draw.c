@@ -668,15 +668,32 @@ static void wm_draw_window_offscreen(bContext *C, wmWindow *win, bool stereo)
 
         /* Draw to VR offscreen buffers. */
         vr_update_viewport_bounds(&ar->winrct);
+        VR *vr = vr_get_obj();
+        vr->single_pass = !VR_PANCAKE && vr_draw_region_single_pass_supported(sa->spacedata.first);
+        if (vr->single_pass) {
+          /* Single-pass stereo: the draw manager populates its caches once and draws
+           * both eyes, starting with the left one (see DRW_draw_render_loop_ex). */
+          wm_draw_region_stereo_set(bmain, sa, ar, STEREO_LEFT_ID);
+          vr_draw_region_bind(ar, STEREO_RIGHT_ID);
+          ED_region_do_draw(C, ar);
+          vr_draw_region_unbind(ar, STEREO_RIGHT_ID);
+          vr->single_pass = 0;
+        }
+        else {
 #if VR_PANCAKE
-        for (int view = 1; view < 2; ++view) {
+          for (int view = 1; view < 2; ++view) {
 #else
-        for (int view = 0; view < 2; ++view) {
+          for (int view = 0; view < 2; ++view) {
 #endif
-          wm_draw_region_stereo_set(bmain, sa, ar, view);
-          vr_draw_region_bind(ar, view);
-          ED_region_do_draw(C, ar);
-          vr_draw_region_unbind(ar, view);
+            wm_draw_region_stereo_set(bmain, sa, ar, view);
+            /* Foveated rendering draws every eye in several passes. */
+            const int passes = vr_draw_region_passes();
+            for (int pass = 0; pass < passes; ++pass) {
+              vr_draw_region_bind_pass(ar, view, pass);
+              ED_region_do_draw(C, ar);
+              vr_draw_region_unbind(ar, view);
+            }
+          }
         }
 
         /* Perform post-render interactions. */
@@ -255,8 +255,11 @@ int main(int argc,
   /* NOTE: Special exception for guarded allocator type switch:
    *       we need to perform switch from lock-free to fully
    *       guarded allocator before any allocation happened.
+   *       The same goes for the thread-caching allocator,
+   *       the guarded allocator wins when both are requested.
    */
   {
+    bool use_thread_cache_allocator = false;
     int i;
     for (i = 0; i < argc; i++) {
       if (STR_ELEM(argv[i], "-d", "--debug", "--debug-memory", "--debug-all")) {
@@ -264,10 +267,16 @@ int main(int argc,
         MEM_use_guarded_allocator();
         break;
       }
+      else if (STREQ(argv[i], "--memory-thread-cache")) {
+        use_thread_cache_allocator = true;
+      }
       else if (STREQ(argv[i], "--")) {
         break;
       }
     }
+    if (use_thread_cache_allocator) {
+      MEM_use_thread_cache_allocator();
+    }
   }
 
 #ifdef BUILD_DATE
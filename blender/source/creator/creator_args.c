@@ -527,6 +527,8 @@ static int arg_handle_print_help(int UNUSED(argc), const char **UNUSED(argv), vo
   BLI_argsPrintArgDoc(ba, "--render-output");
   BLI_argsPrintArgDoc(ba, "--engine");
   BLI_argsPrintArgDoc(ba, "--threads");
+  BLI_argsPrintArgDoc(ba, "--numa-affinity");
+  BLI_argsPrintArgDoc(ba, "--memory-thread-cache");
 
   printf("\n");
   printf("Format Options:\n");
@@ -1477,6 +1479,29 @@ static int arg_handle_threads_set(int argc, const char **argv, void *UNUSED(data
   }
 }
 
+static const char arg_handle_numa_affinity_set_doc[] =
+    "\n\t"
+    "Pin task scheduler threads to NUMA nodes (on systems with several NUMA nodes).";
+static int arg_handle_numa_affinity_set(int UNUSED(argc),
+                                        const char **UNUSED(argv),
+                                        void *UNUSED(data))
+{
+  BLI_system_numa_affinity_set(true);
+  return 0;
+}
+
+static const char arg_handle_memory_thread_cache_set_doc[] =
+    "\n\t"
+    "Keep small memory blocks in per-thread caches, faster for many small allocations.\n"
+    "\tIgnored when memory debugging is enabled.";
+static int arg_handle_memory_thread_cache_set(int UNUSED(argc),
+                                              const char **UNUSED(argv),
+                                              void *UNUSED(data))
+{
+  /* Allocator is switched in main(), before any allocation happened. */
+  return 0;
+}
+
 static const char arg_handle_verbosity_set_doc[] =
     "<verbose>\n"
     "\tSet logging verbosity level for debug messages which supports it.";
@@ -2216,6 +2241,9 @@ void main_args_setup(bContext *C, bArgs *ba)
 
   BLI_argsAdd(ba, 4, "-F", "--render-format", CB(arg_handle_image_type_set), C);
   BLI_argsAdd(ba, 1, "-t", "--threads", CB(arg_handle_threads_set), NULL);
+  BLI_argsAdd(ba, 1, NULL, "--numa-affinity", CB(arg_handle_numa_affinity_set), NULL);
+  BLI_argsAdd(
+      ba, 1, NULL, "--memory-thread-cache", CB(arg_handle_memory_thread_cache_set), NULL);
   BLI_argsAdd(ba, 4, "-x", "--use-extension", CB(arg_handle_extension_set), C);
 
 #  undef CB
@@ -13,6 +13,9 @@ extern "C" {
 #include "BLI_string.h"
 #include "BLI_rand.h"
 #include "BLI_ressource_strings.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+#include "PIL_time.h"
 }
 
 /* print memory savings */
@@ -803,6 +806,160 @@ TEST(array_store, TestChunk_Rand31_Stride11_Chunk21)
   random_chunk_mutate_helper(31, 100, 11, 21, 7117);
 }
 
+/* -------------------------------------------------------------------- */
+/* Layered Data Timing
+ *
+ * Similar to how mesh undo stores custom-data,
+ * many large layers (of different strides) added along with their previous state. */
+
+#define LAYERS_STRIDE_NUM 5
+static const int layers_stride[LAYERS_STRIDE_NUM] = {4, 8, 12, 20, 64};
+#define LAYERS_PER_STRIDE 3
+#define LAYERS_ELEM_NUM 100000
+#define LAYERS_CHUNK_COUNT 256
+
+typedef struct LayerStore {
+  BArrayStore *bs;
+  int stride;
+  /* Per layer, the data and the state it was last added as. */
+  char *data[LAYERS_PER_STRIDE];
+  size_t data_len[LAYERS_PER_STRIDE];
+  BArrayState *states[LAYERS_PER_STRIDE];
+} LayerStore;
+
+static void layer_store_add(LayerStore *ls)
+{
+  for (int i = 0; i < LAYERS_PER_STRIDE; i++) {
+    BArrayState *state_reference = ls->states[i];
+    ls->states[i] = BLI_array_store_state_add(
+        ls->bs, ls->data[i], ls->data_len[i], state_reference);
+    if (state_reference) {
+      BLI_array_store_state_remove(ls->bs, state_reference);
+    }
+  }
+}
+
+static void layer_store_add_cb(void *__restrict userdata,
+                               const int index,
+                               const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  LayerStore *layer_stores = (LayerStore *)userdata;
+  layer_store_add(&layer_stores[index]);
+}
+
+static void layer_stores_add(LayerStore *layer_stores, const bool use_threading)
+{
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = use_threading;
+  settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(0, LAYERS_STRIDE_NUM, layer_stores, layer_store_add_cb, &settings);
+}
+
+static void layer_stores_validate(LayerStore *layer_stores)
+{
+  for (int s = 0; s < LAYERS_STRIDE_NUM; s++) {
+    LayerStore *ls = &layer_stores[s];
+    for (int i = 0; i < LAYERS_PER_STRIDE; i++) {
+      size_t data_len;
+      char *data = (char *)BLI_array_store_state_data_get_alloc(ls->states[i], &data_len);
+      EXPECT_EQ(data_len, ls->data_len[i]);
+      EXPECT_EQ(memcmp(data, ls->data[i], data_len), 0);
+      MEM_freeN(data);
+    }
+    EXPECT_TRUE(BLI_array_store_is_valid(ls->bs));
+  }
+}
+
+/* Change a few elements, as when editing a small part of a mesh. */
+static void layer_data_edit(LayerStore *ls, RNG *rng)
+{
+  for (int i = 0; i < LAYERS_PER_STRIDE; i++) {
+    for (int j = 0; j < 8; j++) {
+      const size_t elem = BLI_rng_get_uint(rng) % (ls->data_len[i] / ls->stride);
+      BLI_rng_get_char_n(rng, &ls->data[i][elem * ls->stride], ls->stride);
+    }
+  }
+}
+
+/* Remove the first element (offsetting all data after it) and change the last,
+ * so neither end matches and chunks need to be looked up by their hash. */
+static void layer_data_shift(LayerStore *ls, RNG *rng)
+{
+  for (int i = 0; i < LAYERS_PER_STRIDE; i++) {
+    ls->data_len[i] -= ls->stride;
+    memmove(ls->data[i], &ls->data[i][ls->stride], ls->data_len[i]);
+    BLI_rng_get_char_n(rng, &ls->data[i][ls->data_len[i] - ls->stride], ls->stride);
+  }
+}
+
+static void layer_store_timing_test(const bool use_threading)
+{
+  LayerStore layer_stores[LAYERS_STRIDE_NUM];
+  RNG *rng = BLI_rng_new(0);
+  for (int s = 0; s < LAYERS_STRIDE_NUM; s++) {
+    LayerStore *ls = &layer_stores[s];
+    ls->stride = layers_stride[s];
+    ls->bs = BLI_array_store_create(ls->stride, LAYERS_CHUNK_COUNT);
+    for (int i = 0; i < LAYERS_PER_STRIDE; i++) {
+      ls->data_len[i] = (size_t)LAYERS_ELEM_NUM * ls->stride;
+      ls->data[i] = (char *)MEM_mallocN(ls->data_len[i], __func__);
+      BLI_rng_get_char_n(rng, ls->data[i], ls->data_len[i]);
+      ls->states[i] = NULL;
+    }
+  }
+
+  printf("%s threading:\n", use_threading ? "With" : "Without");
+
+  double time_start = PIL_check_seconds_timer();
+  layer_stores_add(layer_stores, use_threading);
+  printf("\tinitial: %fs\n", PIL_check_seconds_timer() - time_start);
+  layer_stores_validate(layer_stores);
+
+  time_start = PIL_check_seconds_timer();
+  layer_stores_add(layer_stores, use_threading);
+  printf("\tunchanged: %fs\n", PIL_check_seconds_timer() - time_start);
+  layer_stores_validate(layer_stores);
+
+  for (int s = 0; s < LAYERS_STRIDE_NUM; s++) {
+    layer_data_edit(&layer_stores[s], rng);
+  }
+  time_start = PIL_check_seconds_timer();
+  layer_stores_add(layer_stores, use_threading);
+  printf("\tedit: %fs\n", PIL_check_seconds_timer() - time_start);
+  layer_stores_validate(layer_stores);
+
+  for (int s = 0; s < LAYERS_STRIDE_NUM; s++) {
+    layer_data_shift(&layer_stores[s], rng);
+  }
+  time_start = PIL_check_seconds_timer();
+  layer_stores_add(layer_stores, use_threading);
+  printf("\tshift: %fs\n", PIL_check_seconds_timer() - time_start);
+  layer_stores_validate(layer_stores);
+
+  for (int s = 0; s < LAYERS_STRIDE_NUM; s++) {
+    LayerStore *ls = &layer_stores[s];
+    for (int i = 0; i < LAYERS_PER_STRIDE; i++) {
+      MEM_freeN(ls->data[i]);
+    }
+    BLI_array_store_destroy(ls->bs);
+  }
+  BLI_rng_free(rng);
+}
+
+TEST(array_store, LayersTiming)
+{
+  BLI_threadapi_init();
+  layer_store_timing_test(false);
+  layer_store_timing_test(true);
+  BLI_threadapi_exit();
+}
+
+#undef LAYERS_STRIDE_NUM
+#undef LAYERS_PER_STRIDE
+#undef LAYERS_ELEM_NUM
+#undef LAYERS_CHUNK_COUNT
+
 #if 0
 /* -------------------------------------------------------------------- */
 
@@ -7,6 +7,7 @@
 extern "C" {
 #include "BLI_utildefines.h"
 #include "BLI_edgehash.h"
+#include "BLI_hash_lockfree.h"
 }
 
 #define VALUE_1 POINTER_FROM_INT(1)
@@ -405,3 +406,55 @@ TEST(edgeset, HasKeyExisting)
 
   BLI_edgeset_free(es);
 }
+
+TEST(edgehash_lockfree, AddLookup)
+{
+  LockfreeHash *lh = BLI_lockfree_hash_new(__func__, 8);
+
+  ASSERT_TRUE(BLI_edgehash_lockfree_add(lh, 1, 2, VALUE_1));
+  ASSERT_TRUE(BLI_edgehash_lockfree_add(lh, 3, 1, VALUE_2));
+  ASSERT_FALSE(BLI_edgehash_lockfree_add(lh, 2, 1, VALUE_3));
+
+  ASSERT_EQ(BLI_lockfree_hash_len(lh), 2);
+  ASSERT_EQ(BLI_edgehash_lockfree_lookup(lh, 2, 1), VALUE_1);
+  ASSERT_EQ(BLI_edgehash_lockfree_lookup(lh, 1, 3), VALUE_2);
+  ASSERT_TRUE(BLI_edgehash_lockfree_haskey(lh, 1, 2));
+  ASSERT_FALSE(BLI_edgehash_lockfree_haskey(lh, 2, 3));
+
+  BLI_lockfree_hash_free(lh);
+}
+
+TEST(edgehash_lockfree, IteratorDecodesEdges)
+{
+  LockfreeHash *lh = BLI_lockfree_hash_new(__func__, 8);
+
+  BLI_edgehash_lockfree_add(lh, 5, 4, VALUE_1);
+
+  LockfreeHashIterator lhi;
+  uint64_t key;
+  void *value;
+  unsigned int v0, v1;
+  BLI_lockfree_hash_iterator_init(&lhi, lh);
+  ASSERT_TRUE(BLI_lockfree_hash_iterator_step(&lhi, &key, &value));
+  BLI_edgehash_lockfree_key_decode(key, &v0, &v1);
+  ASSERT_EQ(v0, 4u);
+  ASSERT_EQ(v1, 5u);
+  ASSERT_EQ(value, VALUE_1);
+  ASSERT_FALSE(BLI_lockfree_hash_iterator_step(&lhi, &key, &value));
+
+  BLI_lockfree_hash_free(lh);
+}
+
+TEST(edgeset_lockfree, AddHasKey)
+{
+  LockfreeSet *ls = BLI_lockfree_set_new(__func__, 8);
+
+  ASSERT_TRUE(BLI_edgeset_lockfree_add(ls, 1, 2));
+  ASSERT_FALSE(BLI_edgeset_lockfree_add(ls, 2, 1));
+  ASSERT_TRUE(BLI_edgeset_lockfree_add(ls, 1, 3));
+  ASSERT_EQ(BLI_lockfree_set_len(ls), 2);
+  ASSERT_TRUE(BLI_edgeset_lockfree_haskey(ls, 3, 1));
+  ASSERT_FALSE(BLI_edgeset_lockfree_haskey(ls, 2, 3));
+
+  BLI_lockfree_set_free(ls);
+}
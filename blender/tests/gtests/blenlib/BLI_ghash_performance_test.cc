@@ -8,9 +8,13 @@
 extern "C" {
 #include "MEM_guardedalloc.h"
 #include "BLI_utildefines.h"
+#include "BLI_edgehash.h"
 #include "BLI_ghash.h"
+#include "BLI_hash_lockfree.h"
 #include "BLI_rand.h"
 #include "BLI_string.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
 #include "PIL_time_utildefines.h"
 }
 
@@ -553,3 +557,133 @@ TEST(ghash, MultiRandIntMurmur2a200000)
 
   multi_small_ghash_tests(ghash, "MultiSmall RandIntGHash - Murmur2a - 200000", 200000);
 }
+
+/* Lock-free: serial GHash / EdgeHash filling vs. parallel filling of their lock-free
+ * counterparts, as done when building the edges of a mesh. */
+
+static void randint_lockfree_add_func(void *__restrict userdata,
+                                      const int iter,
+                                      const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  void **data = (void **)userdata;
+  LockfreeHash *lh = (LockfreeHash *)data[0];
+  const unsigned int *keys = (const unsigned int *)data[1];
+  BLI_lockfree_hash_add(lh, keys[iter], POINTER_FROM_UINT(keys[iter]));
+}
+
+static void randedge_lockfree_add_func(void *__restrict userdata,
+                                       const int iter,
+                                       const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  void **data = (void **)userdata;
+  LockfreeHash *lh = (LockfreeHash *)data[0];
+  const unsigned int(*edges)[2] = (const unsigned int(*)[2])data[1];
+  BLI_edgehash_lockfree_add(lh, edges[iter][0], edges[iter][1], POINTER_FROM_INT(iter));
+}
+
+static void lockfree_tests(const char *id, const unsigned int nbr)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  BLI_threadapi_init();
+
+  unsigned int *keys = (unsigned int *)MEM_mallocN(sizeof(*keys) * (size_t)nbr, __func__);
+  unsigned int(*edges)[2] = (unsigned int(*)[2])MEM_mallocN(sizeof(*edges) * (size_t)nbr,
+                                                             __func__);
+  {
+    RNG *rng = BLI_rng_new(0);
+    for (unsigned int i = 0; i < nbr; i++) {
+      keys[i] = BLI_rng_get_uint(rng) >> 1;
+      /* Edges between vertices of a small neighborhood, with many duplicates. */
+      edges[i][0] = BLI_rng_get_uint(rng) % nbr;
+      edges[i][1] = (edges[i][0] + 1 + BLI_rng_get_uint(rng) % 8) % nbr;
+    }
+    BLI_rng_free(rng);
+  }
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1024;
+
+  {
+    GHash *ghash = BLI_ghash_int_new_ex(__func__, nbr);
+
+    TIMEIT_START(int_insert_ghash);
+
+    for (unsigned int i = 0; i < nbr; i++) {
+      BLI_ghash_reinsert(
+          ghash, POINTER_FROM_UINT(keys[i]), POINTER_FROM_UINT(keys[i]), NULL, NULL);
+    }
+
+    TIMEIT_END(int_insert_ghash);
+
+    LockfreeHash *lh = BLI_lockfree_hash_new(__func__, nbr);
+    void *data[2] = {lh, keys};
+
+    TIMEIT_START(int_insert_lockfree);
+
+    BLI_task_parallel_range(0, (int)nbr, data, randint_lockfree_add_func, &settings);
+
+    TIMEIT_END(int_insert_lockfree);
+
+    EXPECT_EQ(BLI_lockfree_hash_len(lh), (int)BLI_ghash_len(ghash));
+
+    TIMEIT_START(int_lookup_lockfree);
+
+    for (unsigned int i = 0; i < nbr; i++) {
+      void *v = BLI_lockfree_hash_lookup(lh, keys[i]);
+      EXPECT_EQ(POINTER_AS_UINT(v), keys[i]);
+    }
+
+    TIMEIT_END(int_lookup_lockfree);
+
+    BLI_ghash_free(ghash, NULL, NULL);
+    BLI_lockfree_hash_free(lh);
+  }
+
+  {
+    EdgeHash *eh = BLI_edgehash_new_ex(__func__, nbr);
+
+    TIMEIT_START(edge_insert_edgehash);
+
+    for (unsigned int i = 0; i < nbr; i++) {
+      void **val_p;
+      if (!BLI_edgehash_ensure_p(eh, edges[i][0], edges[i][1], &val_p)) {
+        *val_p = POINTER_FROM_UINT(i);
+      }
+    }
+
+    TIMEIT_END(edge_insert_edgehash);
+
+    LockfreeHash *lh = BLI_lockfree_hash_new(__func__, nbr);
+    void *data[2] = {lh, edges};
+
+    TIMEIT_START(edge_insert_lockfree);
+
+    BLI_task_parallel_range(0, (int)nbr, data, randedge_lockfree_add_func, &settings);
+
+    TIMEIT_END(edge_insert_lockfree);
+
+    EXPECT_EQ(BLI_lockfree_hash_len(lh), BLI_edgehash_len(eh));
+
+    BLI_edgehash_free(eh, NULL);
+    BLI_lockfree_hash_free(lh);
+  }
+
+  MEM_freeN(keys);
+  MEM_freeN(edges);
+
+  BLI_threadapi_exit();
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(ghash, LockfreeRandInt12000)
+{
+  lockfree_tests("Lockfree - RandInt & Edges - 12000", 12000);
+}
+
+TEST(ghash, LockfreeRandInt5000000)
+{
+  lockfree_tests("Lockfree - RandInt & Edges - 5000000", 5000000);
+}
@@ -0,0 +1,156 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_utildefines.h"
+#include "BLI_hash_lockfree.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+
+#include "atomic_ops.h"
+
+#define NUM_ITEMS 100000
+
+TEST(LockfreeHash, AddLookup)
+{
+  LockfreeHash *lh = BLI_lockfree_hash_new(__func__, 4);
+
+  EXPECT_EQ(BLI_lockfree_hash_len(lh), 0);
+  EXPECT_TRUE(BLI_lockfree_hash_add(lh, 1, POINTER_FROM_INT(10)));
+  EXPECT_TRUE(BLI_lockfree_hash_add(lh, 2, POINTER_FROM_INT(20)));
+  EXPECT_EQ(BLI_lockfree_hash_len(lh), 2);
+
+  EXPECT_EQ(BLI_lockfree_hash_lookup(lh, 1), POINTER_FROM_INT(10));
+  EXPECT_EQ(BLI_lockfree_hash_lookup(lh, 2), POINTER_FROM_INT(20));
+  EXPECT_EQ(BLI_lockfree_hash_lookup(lh, 3), nullptr);
+  EXPECT_EQ(BLI_lockfree_hash_lookup_default(lh, 3, POINTER_FROM_INT(-1)), POINTER_FROM_INT(-1));
+  EXPECT_TRUE(BLI_lockfree_hash_haskey(lh, 1));
+  EXPECT_FALSE(BLI_lockfree_hash_haskey(lh, 3));
+
+  BLI_lockfree_hash_free(lh);
+}
+
+TEST(LockfreeHash, AddExistingKeepsValue)
+{
+  LockfreeHash *lh = BLI_lockfree_hash_new(__func__, 4);
+
+  EXPECT_TRUE(BLI_lockfree_hash_add(lh, 0, POINTER_FROM_INT(1)));
+  EXPECT_FALSE(BLI_lockfree_hash_add(lh, 0, POINTER_FROM_INT(2)));
+  EXPECT_EQ(BLI_lockfree_hash_len(lh), 1);
+  EXPECT_EQ(BLI_lockfree_hash_lookup(lh, 0), POINTER_FROM_INT(1));
+
+  BLI_lockfree_hash_free(lh);
+}
+
+TEST(LockfreeHash, PointerKeys)
+{
+  int data[8];
+  LockfreeHash *lh = BLI_lockfree_hash_new(__func__, ARRAY_SIZE(data));
+
+  for (int i = 0; i < ARRAY_SIZE(data); i++) {
+    EXPECT_TRUE(BLI_lockfree_hash_add(lh, BLI_HASH_LOCKFREE_PTR_KEY(&data[i]), &data[i]));
+  }
+  for (int i = 0; i < ARRAY_SIZE(data); i++) {
+    EXPECT_EQ(BLI_lockfree_hash_lookup(lh, BLI_HASH_LOCKFREE_PTR_KEY(&data[i])), &data[i]);
+  }
+
+  BLI_lockfree_hash_free(lh);
+}
+
+TEST(LockfreeHash, IteratorAndClear)
+{
+  LockfreeHash *lh = BLI_lockfree_hash_new(__func__, NUM_ITEMS);
+
+  for (int i = 0; i < NUM_ITEMS; i++) {
+    BLI_lockfree_hash_add(lh, (uint64_t)i, POINTER_FROM_INT(i));
+  }
+
+  bool *visited = (bool *)MEM_callocN(sizeof(bool) * NUM_ITEMS, __func__);
+  LockfreeHashIterator lhi;
+  uint64_t key;
+  void *value;
+  int len = 0;
+  BLI_lockfree_hash_iterator_init(&lhi, lh);
+  while (BLI_lockfree_hash_iterator_step(&lhi, &key, &value)) {
+    ASSERT_LT(key, NUM_ITEMS);
+    EXPECT_EQ(POINTER_AS_INT(value), (int)key);
+    EXPECT_FALSE(visited[key]);
+    visited[key] = true;
+    len++;
+  }
+  EXPECT_EQ(len, NUM_ITEMS);
+  MEM_freeN(visited);
+
+  BLI_lockfree_hash_clear(lh);
+  EXPECT_EQ(BLI_lockfree_hash_len(lh), 0);
+  EXPECT_FALSE(BLI_lockfree_hash_haskey(lh, 0));
+
+  BLI_lockfree_hash_free(lh);
+}
+
+TEST(LockfreeSet, AddHasKey)
+{
+  LockfreeSet *ls = BLI_lockfree_set_new(__func__, 4);
+
+  EXPECT_TRUE(BLI_lockfree_set_add(ls, 5));
+  EXPECT_FALSE(BLI_lockfree_set_add(ls, 5));
+  EXPECT_TRUE(BLI_lockfree_set_add(ls, 6));
+  EXPECT_EQ(BLI_lockfree_set_len(ls), 2);
+  EXPECT_TRUE(BLI_lockfree_set_haskey(ls, 5));
+  EXPECT_FALSE(BLI_lockfree_set_haskey(ls, 7));
+
+  BLI_lockfree_set_free(ls);
+}
+
+namespace {
+
+struct ConcurrentAddData {
+  LockfreeHash *lh;
+  LockfreeSet *ls;
+  int num_added;
+};
+
+/* Every key is added by two iterations, only one of them may succeed. */
+void concurrent_add_func(void *__restrict userdata,
+                         const int iter,
+                         const TaskParallelTLS *__restrict /*tls*/)
+{
+  ConcurrentAddData *data = (ConcurrentAddData *)userdata;
+  const int key = iter / 2;
+  if (BLI_lockfree_hash_add(data->lh, (uint64_t)key, POINTER_FROM_INT(key))) {
+    atomic_add_and_fetch_uint32((uint32_t *)&data->num_added, 1);
+  }
+  BLI_lockfree_set_add(data->ls, (uint64_t)key);
+}
+
+}  // namespace
+
+TEST(LockfreeHash, AddConcurrent)
+{
+  BLI_threadapi_init();
+
+  ConcurrentAddData data;
+  data.lh = BLI_lockfree_hash_new(__func__, NUM_ITEMS);
+  data.ls = BLI_lockfree_set_new(__func__, NUM_ITEMS);
+  data.num_added = 0;
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.scheduling_mode = TASK_SCHEDULING_DYNAMIC;
+  BLI_task_parallel_range(0, NUM_ITEMS * 2, &data, concurrent_add_func, &settings);
+
+  EXPECT_EQ(data.num_added, NUM_ITEMS);
+  EXPECT_EQ(BLI_lockfree_hash_len(data.lh), NUM_ITEMS);
+  EXPECT_EQ(BLI_lockfree_set_len(data.ls), NUM_ITEMS);
+  for (int i = 0; i < NUM_ITEMS; i++) {
+    EXPECT_EQ(BLI_lockfree_hash_lookup(data.lh, (uint64_t)i), POINTER_FROM_INT(i));
+    EXPECT_TRUE(BLI_lockfree_set_haskey(data.ls, (uint64_t)i));
+  }
+
+  BLI_lockfree_hash_free(data.lh);
+  BLI_lockfree_set_free(data.ls);
+
+  BLI_threadapi_exit();
+}
@@ -0,0 +1,102 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <chrono>
+#include <cstdio>
+
+#define KDOPBVH_INTERNAL_API
+
+extern "C" {
+#include "BLI_compiler_attrs.h"
+#include "BLI_kdopbvh.h"
+#include "BLI_math_vector.h"
+#include "BLI_rand.h"
+#include "BLI_string.h"
+#include "BLI_threads.h"
+#include "MEM_guardedalloc.h"
+}
+
+#include "stubs/bf_intern_eigen_stubs.h"
+
+#include "BLI_kdopbvh_test_util.h"
+
+#define NUM_SPHERES 100000
+#define NUM_QUERIES 50000
+
+namespace {
+
+double time_now()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+/* Run the queries on a tree, returns a checksum of the results. */
+long long queries_test(BVHTree *tree, const SpheresData *spheres, const char *id)
+{
+  long long checksum = 0;
+  struct RNG *rng = BLI_rng_new(0);
+
+  double time_start = time_now();
+  for (int i = 0; i < NUM_QUERIES; i++) {
+    float co[3], dir[3];
+    rng_v3_round(co, 3, rng, 100000, 1.0f);
+    BLI_rng_get_float_unit_v3(rng, dir);
+    BVHTreeRayHit hit;
+    hit.index = -1;
+    hit.dist = BVH_RAYCAST_DIST_MAX;
+    BLI_bvhtree_ray_cast(tree, co, dir, 0.0f, &hit, spheres_raycast_cb, (void *)spheres);
+    checksum += hit.index;
+  }
+  printf("\t%s, ray cast: %fs\n", id, time_now() - time_start);
+
+  time_start = time_now();
+  for (int i = 0; i < NUM_QUERIES; i++) {
+    float co[3];
+    rng_v3_round(co, 3, rng, 100000, 1.0f);
+    BVHTreeNearest nearest;
+    nearest.index = -1;
+    nearest.dist_sq = FLT_MAX;
+    BLI_bvhtree_find_nearest(tree, co, &nearest, spheres_nearest_cb, (void *)spheres);
+    checksum += nearest.index;
+  }
+  printf("\t%s, find nearest: %fs\n", id, time_now() - time_start);
+
+  time_start = time_now();
+  uint overlap_len;
+  BVHTreeOverlap *overlap = BLI_bvhtree_overlap(tree, tree, &overlap_len, NULL, NULL);
+  printf("\t%s, self overlap (%u pairs): %fs\n", id, overlap_len, time_now() - time_start);
+  checksum += overlap_len;
+  MEM_SAFE_FREE(overlap);
+
+  BLI_rng_free(rng);
+  return checksum;
+}
+
+}  // namespace
+
+TEST(kdopbvh, QueriesPerformance)
+{
+  SpheresData spheres;
+  spheres_random(&spheres, NUM_SPHERES, 0.005f, 0);
+
+  BLI_threadapi_init();
+  printf("\n========== STARTING %s ==========\n", "kdopbvh queries");
+  for (char tree_type : {2, 4, 8}) {
+    char id[64];
+    BVHTree *tree = spheres_tree_new(&spheres, NUM_SPHERES, tree_type, 6);
+    BLI_snprintf(id, sizeof(id), "Tree type %d, wide", tree_type);
+    const long long checksum = queries_test(tree, &spheres, id);
+
+    /* Same tree, traversing its own nodes. */
+    BLI_bvhtree_wide_free(tree);
+    BLI_snprintf(id, sizeof(id), "Tree type %d, narrow", tree_type);
+    EXPECT_EQ(checksum, queries_test(tree, &spheres, id));
+    BLI_bvhtree_free(tree);
+  }
+  printf("========== ENDED %s ==========\n\n", "kdopbvh queries");
+  BLI_threadapi_exit();
+
+  MEM_freeN(spheres.centers);
+}
@@ -4,26 +4,21 @@
 
 /* TODO: ray intersection, overlap ... etc.*/
 
+#include <algorithm>
+#include <vector>
+
 extern "C" {
 #include "BLI_compiler_attrs.h"
 #include "BLI_kdopbvh.h"
 #include "BLI_rand.h"
 #include "BLI_math_vector.h"
+#include "BLI_threads.h"
 #include "MEM_guardedalloc.h"
 }
 
 #include "stubs/bf_intern_eigen_stubs.h"
 
-/* -------------------------------------------------------------------- */
-/* Helper Functions */
-
-static void rng_v3_round(float *coords, int coords_len, struct RNG *rng, int round, float scale)
-{
-  for (int i = 0; i < coords_len; i++) {
-    float f = BLI_rng_get_float(rng) * 2.0f - 1.0f;
-    coords[i] = ((float)((int)(f * round)) / (float)round) * scale;
-  }
-}
+#include "BLI_kdopbvh_test_util.h"
 
 /* -------------------------------------------------------------------- */
 /* Tests */
@@ -135,3 +130,218 @@ TEST(kdopbvh, OptimalFindNearest_500)
 {
   find_nearest_points_test(500, 1.0, 1000, 12, true);
 }
+
+/* -------------------------------------------------------------------- */
+/* Wide Nodes
+ *
+ * Trees with more children per node than the wide nodes have use the original traversal,
+ * the results of the other tree types are compared against them.
+ * Only axis aligned trees get wide nodes, other k-DOP trees must not be affected. */
+
+#define TREE_TYPE_NARROW 32
+
+static void wide_raycast_test(int spheres_len, char tree_type, char axis)
+{
+  SpheresData spheres;
+  spheres_random(&spheres, spheres_len, 0.02f, 123);
+  BVHTree *tree = spheres_tree_new(&spheres, spheres_len, tree_type, axis);
+  BVHTree *tree_narrow = spheres_tree_new(&spheres, spheres_len, TREE_TYPE_NARROW, axis);
+
+  struct RNG *rng = BLI_rng_new(456);
+  for (int i = 0; i < 1000; i++) {
+    float co[3], dir[3];
+    rng_v3_round(co, 3, rng, 100000, 1.5f);
+    BLI_rng_get_float_unit_v3(rng, dir);
+    /* Some rays are aligned with an axis. */
+    if (i % 10 == 0) {
+      zero_v3(dir);
+      dir[i % 3] = (i % 20 == 0) ? 1.0f : -1.0f;
+    }
+
+    BVHTreeRayHit hit, hit_narrow;
+    hit.index = hit_narrow.index = -1;
+    hit.dist = hit_narrow.dist = BVH_RAYCAST_DIST_MAX;
+    BLI_bvhtree_ray_cast(tree, co, dir, 0.0f, &hit, spheres_raycast_cb, &spheres);
+    BLI_bvhtree_ray_cast(tree_narrow, co, dir, 0.0f, &hit_narrow, spheres_raycast_cb, &spheres);
+    EXPECT_EQ(hit.index, hit_narrow.index);
+    EXPECT_EQ(hit.dist, hit_narrow.dist);
+
+    /* Without a callback the nearest leaf bounds are hit. */
+    const int index = BLI_bvhtree_ray_cast(tree, co, dir, 0.0f, &hit, NULL, NULL);
+    const int index_narrow = BLI_bvhtree_ray_cast(
+        tree_narrow, co, dir, 0.0f, &hit_narrow, NULL, NULL);
+    EXPECT_EQ(index == -1, index_narrow == -1);
+    EXPECT_EQ(hit.dist, hit_narrow.dist);
+  }
+
+  BLI_rng_free(rng);
+  BLI_bvhtree_free(tree);
+  BLI_bvhtree_free(tree_narrow);
+  MEM_freeN(spheres.centers);
+}
+
+static void wide_find_nearest_test(int spheres_len, char tree_type, char axis)
+{
+  SpheresData spheres;
+  spheres_random(&spheres, spheres_len, 0.02f, 789);
+  BVHTree *tree = spheres_tree_new(&spheres, spheres_len, tree_type, axis);
+  BVHTree *tree_narrow = spheres_tree_new(&spheres, spheres_len, TREE_TYPE_NARROW, axis);
+
+  struct RNG *rng = BLI_rng_new(12);
+  for (int i = 0; i < 1000; i++) {
+    float co[3];
+    rng_v3_round(co, 3, rng, 100000, 1.5f);
+
+    BVHTreeNearest nearest, nearest_narrow;
+    nearest.index = nearest_narrow.index = -1;
+    nearest.dist_sq = nearest_narrow.dist_sq = FLT_MAX;
+    BLI_bvhtree_find_nearest(tree, co, &nearest, spheres_nearest_cb, &spheres);
+    BLI_bvhtree_find_nearest(tree_narrow, co, &nearest_narrow, spheres_nearest_cb, &spheres);
+    EXPECT_EQ(nearest.dist_sq, nearest_narrow.dist_sq);
+    EXPECT_EQ_ARRAY(spheres.centers[nearest.index], spheres.centers[nearest_narrow.index], 3);
+
+    /* Without a callback the distance to the nearest leaf bounds is found. */
+    nearest.dist_sq = nearest_narrow.dist_sq = FLT_MAX;
+    BLI_bvhtree_find_nearest(tree, co, &nearest, NULL, NULL);
+    BLI_bvhtree_find_nearest(tree_narrow, co, &nearest_narrow, NULL, NULL);
+    EXPECT_EQ(nearest.dist_sq, nearest_narrow.dist_sq);
+  }
+
+  BLI_rng_free(rng);
+  BLI_bvhtree_free(tree);
+  BLI_bvhtree_free(tree_narrow);
+  MEM_freeN(spheres.centers);
+}
+
+static std::vector<std::pair<int, int>> overlap_pairs(const BVHTree *tree1,
+                                                      const BVHTree *tree2)
+{
+  uint overlap_len = 0;
+  BVHTreeOverlap *overlap = BLI_bvhtree_overlap(tree1, tree2, &overlap_len, NULL, NULL);
+  std::vector<std::pair<int, int>> pairs;
+  for (uint i = 0; i < overlap_len; i++) {
+    pairs.push_back(std::make_pair(overlap[i].indexA, overlap[i].indexB));
+  }
+  std::sort(pairs.begin(), pairs.end());
+  MEM_SAFE_FREE(overlap);
+  return pairs;
+}
+
+static void wide_overlap_test(int spheres_len, char tree_type, char axis)
+{
+  SpheresData spheres1, spheres2;
+  spheres_random(&spheres1, spheres_len, 0.02f, 34);
+  spheres_random(&spheres2, spheres_len, 0.02f, 56);
+  BVHTree *tree1 = spheres_tree_new(&spheres1, spheres_len, tree_type, axis);
+  BVHTree *tree2 = spheres_tree_new(&spheres2, spheres_len, tree_type, axis);
+  BVHTree *tree1_narrow = spheres_tree_new(&spheres1, spheres_len, TREE_TYPE_NARROW, axis);
+  BVHTree *tree2_narrow = spheres_tree_new(&spheres2, spheres_len, TREE_TYPE_NARROW, axis);
+
+  const std::vector<std::pair<int, int>> pairs = overlap_pairs(tree1, tree2);
+  EXPECT_FALSE(pairs.empty());
+  EXPECT_EQ(pairs, overlap_pairs(tree1_narrow, tree2_narrow));
+
+  /* Self overlap skips the pairs of a leaf with itself. */
+  const std::vector<std::pair<int, int>> pairs_self = overlap_pairs(tree1, tree1);
+  EXPECT_EQ(pairs_self, overlap_pairs(tree1_narrow, tree1_narrow));
+  for (const std::pair<int, int> &pair : pairs_self) {
+    EXPECT_NE(pair.first, pair.second);
+  }
+
+  /* Stop at the first overlap. */
+  uint overlap_first_len = 0;
+  BVHTreeOverlap *overlap_first = BLI_bvhtree_overlap_ex(
+      tree1,
+      tree2,
+      &overlap_first_len,
+      NULL,
+      NULL,
+      BVH_OVERLAP_RETURN_PAIRS | BVH_OVERLAP_BREAK_ON_FIRST);
+  EXPECT_GT(overlap_first_len, 0u);
+  EXPECT_LE(overlap_first_len, pairs.size());
+  for (uint i = 0; i < overlap_first_len; i++) {
+    EXPECT_TRUE(std::binary_search(
+        pairs.begin(),
+        pairs.end(),
+        std::make_pair(overlap_first[i].indexA, overlap_first[i].indexB)));
+  }
+  MEM_SAFE_FREE(overlap_first);
+
+  BLI_bvhtree_free(tree1);
+  BLI_bvhtree_free(tree1_narrow);
+  BLI_bvhtree_free(tree2);
+  BLI_bvhtree_free(tree2_narrow);
+  MEM_freeN(spheres1.centers);
+  MEM_freeN(spheres2.centers);
+}
+
+/* Moving the leafs and updating the tree must update the wide nodes too. */
+static void wide_update_test(int spheres_len, char tree_type)
+{
+  SpheresData spheres;
+  spheres_random(&spheres, spheres_len, 0.02f, 1);
+  BVHTree *tree = spheres_tree_new(&spheres, spheres_len, tree_type, 6);
+
+  for (int i = 0; i < spheres_len; i++) {
+    mul_v3_fl(spheres.centers[i], 0.5f);
+    add_v3_fl(spheres.centers[i], 10.0f);
+    BLI_bvhtree_update_node(tree, i, spheres.centers[i], NULL, 1);
+  }
+  BLI_bvhtree_update_tree(tree);
+
+  for (int i = 0; i < spheres_len; i += 7) {
+    BVHTreeNearest nearest;
+    nearest.index = -1;
+    nearest.dist_sq = FLT_MAX;
+    BLI_bvhtree_find_nearest(tree, spheres.centers[i], &nearest, spheres_nearest_cb, &spheres);
+    EXPECT_EQ(nearest.dist_sq, 0.0f);
+
+    const float dir[3] = {0.0f, 0.0f, -1.0f};
+    float co[3];
+    copy_v3_v3(co, spheres.centers[i]);
+    co[2] += 1.0f;
+    BVHTreeRayHit hit;
+    hit.index = -1;
+    hit.dist = BVH_RAYCAST_DIST_MAX;
+    BLI_bvhtree_ray_cast(tree, co, dir, 0.0f, &hit, spheres_raycast_cb, &spheres);
+    EXPECT_NE(hit.index, -1);
+  }
+
+  BLI_bvhtree_free(tree);
+  MEM_freeN(spheres.centers);
+}
+
+TEST(kdopbvh, WideRayCast)
+{
+  for (char tree_type : {2, 3, 4, 8}) {
+    wide_raycast_test(1, tree_type, 6);
+    wide_raycast_test(2000, tree_type, 6);
+    wide_raycast_test(2000, tree_type, 26);
+  }
+}
+
+TEST(kdopbvh, WideFindNearest)
+{
+  for (char tree_type : {2, 3, 4, 8}) {
+    wide_find_nearest_test(1, tree_type, 6);
+    wide_find_nearest_test(2000, tree_type, 6);
+    wide_find_nearest_test(2000, tree_type, 14);
+  }
+}
+
+TEST(kdopbvh, WideOverlap)
+{
+  BLI_threadapi_init();
+  for (char tree_type : {2, 4, 8}) {
+    wide_overlap_test(3000, tree_type, 6);
+    wide_overlap_test(3000, tree_type, 26);
+  }
+  BLI_threadapi_exit();
+}
+
+TEST(kdopbvh, WideUpdate)
+{
+  for (char tree_type : {2, 4, 8}) {
+    wide_update_test(1000, tree_type);
+  }
+}
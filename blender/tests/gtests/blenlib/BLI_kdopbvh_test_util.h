@@ -0,0 +1,89 @@
+/* Apache License, Version 2.0 */
+
+#ifndef __BLENDER_TESTING_BLI_KDOPBVH_TEST_UTIL_H__
+#define __BLENDER_TESTING_BLI_KDOPBVH_TEST_UTIL_H__
+
+/* Random points and spheres for the kdopbvh tests. */
+
+extern "C" {
+#include "BLI_kdopbvh.h"
+#include "BLI_math_vector.h"
+#include "BLI_rand.h"
+#include "MEM_guardedalloc.h"
+}
+
+static void rng_v3_round(float *coords, int coords_len, struct RNG *rng, int round, float scale)
+{
+  for (int i = 0; i < coords_len; i++) {
+    float f = BLI_rng_get_float(rng) * 2.0f - 1.0f;
+    coords[i] = ((float)((int)(f * round)) / (float)round) * scale;
+  }
+}
+
+/* Spheres with the radius of the tree epsilon, so the leafs bound them. */
+struct SpheresData {
+  float (*centers)[3];
+  float radius;
+};
+
+static void spheres_random(SpheresData *spheres, int spheres_len, float radius, int random_seed)
+{
+  struct RNG *rng = BLI_rng_new(random_seed);
+  spheres->centers = (float(*)[3])MEM_mallocN(sizeof(float[3]) * spheres_len, __func__);
+  spheres->radius = radius;
+  for (int i = 0; i < spheres_len; i++) {
+    rng_v3_round(spheres->centers[i], 3, rng, 100000, 1.0f);
+  }
+  BLI_rng_free(rng);
+}
+
+static BVHTree *spheres_tree_new(const SpheresData *spheres,
+                                 int spheres_len,
+                                 char tree_type,
+                                 char axis)
+{
+  BVHTree *tree = BLI_bvhtree_new(spheres_len, spheres->radius, tree_type, axis);
+  for (int i = 0; i < spheres_len; i++) {
+    BLI_bvhtree_insert(tree, i, spheres->centers[i], 1);
+  }
+  BLI_bvhtree_balance(tree);
+  return tree;
+}
+
+static void spheres_raycast_cb(void *userdata,
+                               int index,
+                               const BVHTreeRay *ray,
+                               BVHTreeRayHit *hit)
+{
+  const SpheresData *spheres = (const SpheresData *)userdata;
+  float offset[3];
+  sub_v3_v3v3(offset, spheres->centers[index], ray->origin);
+  const float dist_along = dot_v3v3(offset, ray->direction);
+  const float dist_sq = len_squared_v3(offset) - dist_along * dist_along;
+  const float radius_sq = spheres->radius * spheres->radius;
+  if (dist_sq > radius_sq) {
+    return;
+  }
+  const float dist = dist_along - sqrtf(radius_sq - dist_sq);
+  if (dist >= 0.0f && dist < hit->dist) {
+    hit->index = index;
+    hit->dist = dist;
+    madd_v3_v3v3fl(hit->co, ray->origin, ray->direction, dist);
+  }
+}
+
+static void spheres_nearest_cb(void *userdata,
+                               int index,
+                               const float co[3],
+                               BVHTreeNearest *nearest)
+{
+  const SpheresData *spheres = (const SpheresData *)userdata;
+  const float dist_sq = len_squared_v3v3(co, spheres->centers[index]);
+  if (dist_sq < nearest->dist_sq) {
+    nearest->index = index;
+    nearest->dist_sq = dist_sq;
+    copy_v3_v3(nearest->co, spheres->centers[index]);
+  }
+}
+
+#endif /* __BLENDER_TESTING_BLI_KDOPBVH_TEST_UTIL_H__ */
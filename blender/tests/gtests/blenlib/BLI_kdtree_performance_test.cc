@@ -0,0 +1,99 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <chrono>
+#include <cstdio>
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_kdtree.h"
+#include "BLI_math_vector.h"
+#include "BLI_rand.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+}
+
+#define NUM_POINTS 1000000
+#define NUM_QUERIES 200000
+
+namespace {
+
+double time_now()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+/* Queries along a helix inside the points, each one close to the previous one,
+ * as when projecting one mesh on another. */
+void queries_coherent(float (*co)[3], int co_len)
+{
+  for (int i = 0; i < co_len; i++) {
+    const float fac = (float)i / (float)co_len;
+    const float angle = fac * (float)M_PI * 200.0f;
+    co[i][0] = 0.5f * cosf(angle);
+    co[i][1] = 0.5f * sinf(angle);
+    co[i][2] = fac * 1.6f - 0.8f;
+  }
+}
+
+void queries_random(RNG *rng, float (*co)[3], int co_len)
+{
+  for (int i = 0; i < co_len; i++) {
+    BLI_rng_get_float_unit_v3(rng, co[i]);
+  }
+}
+
+void find_nearest_test(const KDTree_3d *tree, const float (*co)[3], int co_len, const char *id)
+{
+  KDTreeNearest_3d *nearest = (KDTreeNearest_3d *)MEM_mallocN(sizeof(*nearest) * co_len,
+                                                              __func__);
+
+  double time_start = time_now();
+  for (int i = 0; i < co_len; i++) {
+    BLI_kdtree_3d_find_nearest(tree, co[i], &nearest[i]);
+  }
+  printf("\t%s, find nearest: %fs\n", id, time_now() - time_start);
+
+  time_start = time_now();
+  BLI_kdtree_3d_find_nearest_batch(tree, co, (uint)co_len, NULL, nearest);
+  printf("\t%s, find nearest batch: %fs\n", id, time_now() - time_start);
+
+  MEM_freeN(nearest);
+}
+
+}  // namespace
+
+TEST(kdtree, FindNearestPerformance)
+{
+  BLI_threadapi_init();
+  RNG *rng = BLI_rng_new(0);
+
+  printf("\n========== STARTING %s ==========\n", "kdtree find nearest");
+
+  KDTree_3d *tree = BLI_kdtree_3d_new(NUM_POINTS);
+  for (int i = 0; i < NUM_POINTS; i++) {
+    float co[3];
+    BLI_rng_get_float_unit_v3(rng, co);
+    mul_v3_fl(co, BLI_rng_get_float(rng));
+    BLI_kdtree_3d_insert(tree, i, co);
+  }
+  const double time_start = time_now();
+  BLI_kdtree_3d_balance(tree);
+  printf("\tBalance %d points: %fs\n", NUM_POINTS, time_now() - time_start);
+
+  float(*co)[3] = (float(*)[3])MEM_mallocN(sizeof(*co) * NUM_QUERIES, __func__);
+  queries_coherent(co, NUM_QUERIES);
+  find_nearest_test(tree, co, NUM_QUERIES, "Coherent queries");
+  queries_random(rng, co, NUM_QUERIES);
+  find_nearest_test(tree, co, NUM_QUERIES, "Random queries");
+
+  printf("========== ENDED %s ==========\n\n", "kdtree find nearest");
+
+  MEM_freeN(co);
+  BLI_kdtree_3d_free(tree);
+  BLI_rng_free(rng);
+  BLI_threadapi_exit();
+}
@@ -0,0 +1,191 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <cstring>
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_kdtree.h"
+#include "BLI_math_vector.h"
+#include "BLI_rand.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+}
+
+/* Large enough for balancing and batched queries to use threads. */
+#define NUM_POINTS 100000
+#define NUM_QUERIES 20000
+
+namespace {
+
+KDTree_3d *tree_random_new(RNG *rng, int points_len, float (**r_points)[3])
+{
+  float(*points)[3] = (float(*)[3])MEM_mallocN(sizeof(*points) * points_len, __func__);
+  KDTree_3d *tree = BLI_kdtree_3d_new(points_len);
+  for (int i = 0; i < points_len; i++) {
+    BLI_rng_get_float_unit_v3(rng, points[i]);
+    mul_v3_fl(points[i], BLI_rng_get_float(rng));
+    BLI_kdtree_3d_insert(tree, i, points[i]);
+  }
+  BLI_kdtree_3d_balance(tree);
+  *r_points = points;
+  return tree;
+}
+
+float nearest_dist_brute_force(const float (*points)[3], int points_len, const float co[3])
+{
+  float dist_sq_min = FLT_MAX;
+  for (int i = 0; i < points_len; i++) {
+    dist_sq_min = min_ff(dist_sq_min, len_squared_v3v3(points[i], co));
+  }
+  return sqrtf(dist_sq_min);
+}
+
+}  // namespace
+
+TEST(kdtree, FindNearest)
+{
+  BLI_threadapi_init();
+  RNG *rng = BLI_rng_new(0);
+
+  for (int points_len : {0, 1, 2, 7, 1000, NUM_POINTS}) {
+    float(*points)[3];
+    KDTree_3d *tree = tree_random_new(rng, points_len, &points);
+
+    for (int i = 0; i < 200; i++) {
+      float co[3];
+      BLI_rng_get_float_unit_v3(rng, co);
+      KDTreeNearest_3d nearest;
+      const int index = BLI_kdtree_3d_find_nearest(tree, co, &nearest);
+      if (points_len == 0) {
+        EXPECT_EQ(index, -1);
+        continue;
+      }
+      ASSERT_GE(index, 0);
+      ASSERT_LT(index, points_len);
+      EXPECT_EQ(index, nearest.index);
+      EXPECT_FLOAT_EQ(nearest.dist, nearest_dist_brute_force(points, points_len, co));
+      EXPECT_FLOAT_EQ(len_v3v3(points[index], co), nearest.dist);
+    }
+
+    BLI_kdtree_3d_free(tree);
+    MEM_freeN(points);
+  }
+
+  BLI_rng_free(rng);
+  BLI_threadapi_exit();
+}
+
+TEST(kdtree, FindNearestBatch)
+{
+  BLI_threadapi_init();
+  RNG *rng = BLI_rng_new(1);
+
+  /* Sizes that aren't a multiple of the number of queries traversing the tree together. */
+  for (int co_len : {0, 1, 3, 5, 1023, NUM_QUERIES + 1}) {
+    float(*points)[3];
+    KDTree_3d *tree = tree_random_new(rng, NUM_POINTS, &points);
+
+    float(*co)[3] = (float(*)[3])MEM_mallocN(sizeof(*co) * (co_len + 1), __func__);
+    for (int i = 0; i < co_len; i++) {
+      BLI_rng_get_float_unit_v3(rng, co[i]);
+      mul_v3_fl(co[i], 1.2f);
+    }
+    int *index = (int *)MEM_mallocN(sizeof(*index) * (co_len + 1), __func__);
+    KDTreeNearest_3d *nearest = (KDTreeNearest_3d *)MEM_mallocN(
+        sizeof(*nearest) * (co_len + 1), __func__);
+    BLI_kdtree_3d_find_nearest_batch(tree, co, co_len, index, nearest);
+
+    for (int i = 0; i < co_len; i++) {
+      KDTreeNearest_3d nearest_single;
+      BLI_kdtree_3d_find_nearest(tree, co[i], &nearest_single);
+      ASSERT_GE(index[i], 0);
+      ASSERT_LT(index[i], NUM_POINTS);
+      EXPECT_EQ(index[i], nearest[i].index);
+      EXPECT_FLOAT_EQ(nearest[i].dist, nearest_single.dist);
+      EXPECT_FLOAT_EQ(len_v3v3(points[index[i]], co[i]), nearest[i].dist);
+    }
+
+    /* Only the indices. */
+    BLI_kdtree_3d_find_nearest_batch(tree, co, co_len, index, NULL);
+    for (int i = 0; i < co_len; i++) {
+      EXPECT_EQ(index[i], nearest[i].index);
+    }
+
+    MEM_freeN(co);
+    MEM_freeN(index);
+    MEM_freeN(nearest);
+    BLI_kdtree_3d_free(tree);
+    MEM_freeN(points);
+  }
+
+  BLI_rng_free(rng);
+  BLI_threadapi_exit();
+}
+
+TEST(kdtree, FindNearestBatchEmpty)
+{
+  KDTree_3d *tree = BLI_kdtree_3d_new(0);
+  BLI_kdtree_3d_balance(tree);
+
+  const float co[2][3] = {{0.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}};
+  int index[2] = {0, 0};
+  BLI_kdtree_3d_find_nearest_batch(tree, co, 2, index, NULL);
+  EXPECT_EQ(index[0], -1);
+  EXPECT_EQ(index[1], -1);
+
+  BLI_kdtree_3d_free(tree);
+}
+
+/* Duplicates are merged in the order of the balanced nodes,
+ * which must not depend on how the balancing was spread over threads. */
+TEST(kdtree, CalcDuplicatesDeterministic)
+{
+  /* The result must not depend on the number of threads (nor on their timing). */
+  const int num_threads[2] = {1, 8};
+  int *duplicates[2];
+  for (int pass = 0; pass < 2; pass++) {
+    BLI_system_num_threads_override_set(num_threads[pass]);
+    BLI_threadapi_init();
+
+    RNG *rng = BLI_rng_new(2);
+    KDTree_3d *tree = BLI_kdtree_3d_new(NUM_POINTS);
+    for (int i = 0; i < NUM_POINTS; i++) {
+      float co[3];
+      BLI_rng_get_float_unit_v3(rng, co);
+      /* Snap to a coarse grid so there are many duplicates. */
+      mul_v3_fl(co, 20.0f);
+      co[0] = floorf(co[0]);
+      co[1] = floorf(co[1]);
+      co[2] = floorf(co[2]);
+      BLI_kdtree_3d_insert(tree, i, co);
+    }
+    BLI_kdtree_3d_balance(tree);
+
+    duplicates[pass] = (int *)MEM_mallocN(sizeof(int) * NUM_POINTS, __func__);
+    copy_vn_i(duplicates[pass], NUM_POINTS, -1);
+    EXPECT_GT(BLI_kdtree_3d_calc_duplicates_fast(tree, 0.5f, false, duplicates[pass]), 0);
+
+    BLI_kdtree_3d_free(tree);
+    BLI_rng_free(rng);
+
+    /* Frees the task scheduler, the next pass creates one with its number of threads. */
+    BLI_threadapi_exit();
+  }
+  BLI_system_num_threads_override_set(0);
+
+  for (int i = 0; i < NUM_POINTS; i++) {
+    const int target = duplicates[0][i];
+    if (target != -1) {
+      ASSERT_GE(target, 0);
+      ASSERT_LT(target, NUM_POINTS);
+      EXPECT_EQ(duplicates[0][target], target);
+    }
+  }
+  EXPECT_EQ(memcmp(duplicates[0], duplicates[1], sizeof(int) * NUM_POINTS), 0);
+
+  MEM_freeN(duplicates[0]);
+  MEM_freeN(duplicates[1]);
+}
@@ -0,0 +1,132 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_compiler_attrs.h"
+#include "BLI_utildefines.h"
+#include "BLI_rand.h"
+#include "BLI_sort.h"
+#include "BLI_threads.h"
+#include "PIL_time.h"
+}
+
+#define NUM_ELEMS 10000000
+
+namespace {
+
+struct SortElem {
+  float key;
+  uint index;
+};
+
+int sort_elem_cmp(const void *a_, const void *b_, void *UNUSED(ctx))
+{
+  const SortElem *a = (const SortElem *)a_, *b = (const SortElem *)b_;
+  return (a->key > b->key) - (a->key < b->key);
+}
+
+int uint64_cmp(const void *a_, const void *b_, void *UNUSED(ctx))
+{
+  const uint64_t a = *(const uint64_t *)a_, b = *(const uint64_t *)b_;
+  return (a > b) - (a < b);
+}
+
+/* Float keys with their index, sorted with each function. */
+void float_sort_test(const int num_elems)
+{
+  RNG *rng = BLI_rng_new(0);
+  std::vector<SortElem> elems_init(num_elems);
+  for (int i = 0; i < num_elems; i++) {
+    elems_init[i].key = BLI_rng_get_float(rng);
+    elems_init[i].index = (uint)i;
+  }
+  BLI_rng_free(rng);
+
+  std::vector<SortElem> elems = elems_init;
+  double time_start = PIL_check_seconds_timer();
+  BLI_qsort_r(elems.data(), elems.size(), sizeof(SortElem), sort_elem_cmp, NULL);
+  printf("\tBLI_qsort_r: %fs\n", PIL_check_seconds_timer() - time_start);
+
+  elems = elems_init;
+  time_start = PIL_check_seconds_timer();
+  BLI_parallel_sort(elems.data(), elems.size(), sizeof(SortElem), sort_elem_cmp, NULL);
+  printf("\tBLI_parallel_sort: %fs\n", PIL_check_seconds_timer() - time_start);
+
+  std::vector<float> keys(num_elems);
+  std::vector<uint> values(num_elems);
+  for (int i = 0; i < num_elems; i++) {
+    keys[i] = elems_init[i].key;
+    values[i] = elems_init[i].index;
+  }
+  time_start = PIL_check_seconds_timer();
+  BLI_radix_sort_float(keys.data(), values.data(), keys.size());
+  printf("\tBLI_radix_sort_float: %fs\n", PIL_check_seconds_timer() - time_start);
+
+  for (int i = 0; i < num_elems; i++) {
+    EXPECT_EQ(keys[i], elems[i].key);
+  }
+}
+
+/* Keys of the edges of a grid of quads, in the order polygons use them. */
+void edge_key_sort_test(const int num_elems)
+{
+  const uint grid_size = 2048;
+  std::vector<uint64_t> keys_init;
+  for (uint i = 0; keys_init.size() < (size_t)num_elems; i++) {
+    const uint x = i % grid_size, y = i / grid_size;
+    const uint v[4] = {y * (grid_size + 1) + x,
+                       y * (grid_size + 1) + x + 1,
+                       (y + 1) * (grid_size + 1) + x + 1,
+                       (y + 1) * (grid_size + 1) + x};
+    for (uint j = 0, j_prev = 3; j < 4; j_prev = j++) {
+      const uint v1 = std::min(v[j_prev], v[j]), v2 = std::max(v[j_prev], v[j]);
+      keys_init.push_back(((uint64_t)v1 << 32) | v2);
+    }
+  }
+
+  std::vector<uint64_t> keys = keys_init;
+  double time_start = PIL_check_seconds_timer();
+  BLI_parallel_sort(keys.data(), keys.size(), sizeof(uint64_t), uint64_cmp, NULL);
+  printf("\tBLI_parallel_sort: %fs\n", PIL_check_seconds_timer() - time_start);
+
+  std::vector<uint64_t> keys_radix = keys_init;
+  std::vector<uint> values(keys_radix.size());
+  for (size_t i = 0; i < values.size(); i++) {
+    values[i] = (uint)i;
+  }
+  time_start = PIL_check_seconds_timer();
+  BLI_radix_sort_uint64(keys_radix.data(), values.data(), keys_radix.size());
+  printf("\tBLI_radix_sort_uint64: %fs\n", PIL_check_seconds_timer() - time_start);
+
+  EXPECT_EQ(keys, keys_radix);
+}
+
+void sort_tests(const int num_threads)
+{
+  BLI_system_num_threads_override_set(num_threads);
+  BLI_threadapi_init();
+
+  printf("\n========== STARTING %d THREADS ==========\n", num_threads);
+  printf("Float keys:\n");
+  float_sort_test(NUM_ELEMS);
+  printf("Edge keys:\n");
+  edge_key_sort_test(NUM_ELEMS);
+  printf("========== ENDED %d THREADS ==========\n\n", num_threads);
+
+  BLI_threadapi_exit();
+  BLI_system_num_threads_override_set(0);
+}
+
+}  // namespace
+
+TEST(sort, SortPerformance)
+{
+  sort_tests(1);
+  sort_tests(BLI_system_thread_count());
+}
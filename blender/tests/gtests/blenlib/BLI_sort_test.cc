@@ -0,0 +1,204 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+extern "C" {
+#include "BLI_compiler_attrs.h"
+#include "BLI_utildefines.h"
+#include "BLI_rand.h"
+#include "BLI_sort.h"
+#include "BLI_threads.h"
+}
+
+/* Large enough for the sorts to split the array between threads. */
+#define NUM_ELEMS 300007
+#define NUM_THREADS 4
+
+namespace {
+
+struct SortElem {
+  int key;
+  int index;
+};
+
+int sort_elem_cmp(const void *a_, const void *b_, void *UNUSED(ctx))
+{
+  const SortElem *a = (const SortElem *)a_, *b = (const SortElem *)b_;
+  return (a->key > b->key) - (a->key < b->key);
+}
+
+/* Total order: elements with equal keys are ordered by index. */
+int sort_elem_index_cmp(const void *a_, const void *b_, void *ctx)
+{
+  const SortElem *a = (const SortElem *)a_, *b = (const SortElem *)b_;
+  const int cmp = sort_elem_cmp(a_, b_, ctx);
+  return (cmp != 0) ? cmp : (a->index > b->index) - (a->index < b->index);
+}
+
+/* Run the test body with the given number of threads in the task scheduler. */
+class SortTest : public ::testing::TestWithParam<int> {
+ protected:
+  void SetUp() override
+  {
+    BLI_system_num_threads_override_set(GetParam());
+    BLI_threadapi_init();
+  }
+  void TearDown() override
+  {
+    BLI_threadapi_exit();
+    BLI_system_num_threads_override_set(0);
+  }
+};
+
+template<typename Key>
+void radix_sort_check(std::vector<Key> &keys, void (*sort_fn)(Key *, uint *, size_t))
+{
+  typedef std::pair<Key, uint> KeyValue;
+  std::vector<KeyValue> expect;
+  std::vector<uint> values;
+  for (size_t i = 0; i < keys.size(); i++) {
+    expect.push_back(std::make_pair(keys[i], (uint)i));
+    values.push_back((uint)i);
+  }
+  std::stable_sort(expect.begin(), expect.end(), [](const KeyValue &a, const KeyValue &b) {
+    return a.first < b.first;
+  });
+
+  sort_fn(keys.data(), values.data(), keys.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    EXPECT_EQ(keys[i], expect[i].first);
+    EXPECT_EQ(values[i], expect[i].second);
+  }
+}
+
+}  // namespace
+
+TEST_P(SortTest, ParallelSort)
+{
+  RNG *rng = BLI_rng_new(0);
+  for (const int len : {0, 1, 100, 8193, NUM_ELEMS}) {
+    std::vector<SortElem> elems(len);
+    for (int i = 0; i < len; i++) {
+      /* Many equal keys. */
+      elems[i].key = (int)(BLI_rng_get_uint(rng) % 1000) - 500;
+      elems[i].index = i;
+    }
+
+    BLI_parallel_sort(elems.data(), elems.size(), sizeof(SortElem), sort_elem_cmp, NULL);
+
+    std::vector<bool> found(len, false);
+    for (int i = 0; i < len; i++) {
+      if (i > 0) {
+        EXPECT_LE(elems[i - 1].key, elems[i].key);
+      }
+      EXPECT_FALSE(found[elems[i].index]);
+      found[elems[i].index] = true;
+    }
+  }
+  BLI_rng_free(rng);
+}
+
+/* The chunks are sorted with #BLI_qsort_r, which isn't stable: ties are broken on the index,
+ * so the merges of long runs of equal keys have a single valid result. */
+TEST_P(SortTest, ParallelSortMergeTies)
+{
+  std::vector<SortElem> elems(NUM_ELEMS);
+  for (int i = 0; i < NUM_ELEMS; i++) {
+    elems[i].key = (int)(((uint)i * 7919u) % 13u);
+    elems[i].index = i;
+  }
+  std::vector<SortElem> expect = elems;
+  std::sort(expect.begin(), expect.end(), [](const SortElem &a, const SortElem &b) {
+    return (a.key != b.key) ? (a.key < b.key) : (a.index < b.index);
+  });
+
+  BLI_parallel_sort(elems.data(), elems.size(), sizeof(SortElem), sort_elem_index_cmp, NULL);
+  for (int i = 0; i < NUM_ELEMS; i++) {
+    EXPECT_EQ(elems[i].key, expect[i].key);
+    EXPECT_EQ(elems[i].index, expect[i].index);
+  }
+}
+
+TEST_P(SortTest, RadixSortUint)
+{
+  RNG *rng = BLI_rng_new(0);
+  for (const int len : {0, 1, 100, NUM_ELEMS}) {
+    std::vector<uint> keys(len);
+    for (uint &key : keys) {
+      key = BLI_rng_get_uint(rng);
+    }
+    radix_sort_check(keys, BLI_radix_sort_uint);
+  }
+  /* Only some bytes differ, the other passes are skipped. */
+  std::vector<uint> keys(NUM_ELEMS);
+  for (uint &key : keys) {
+    key = 0xff0000ffu | ((BLI_rng_get_uint(rng) % 300) << 8);
+  }
+  radix_sort_check(keys, BLI_radix_sort_uint);
+  BLI_rng_free(rng);
+}
+
+TEST_P(SortTest, RadixSortUint64)
+{
+  RNG *rng = BLI_rng_new(0);
+  std::vector<uint64_t> keys(NUM_ELEMS);
+  for (uint64_t &key : keys) {
+    /* Edge keys, as used to find the edges of polygons. */
+    const uint v1 = BLI_rng_get_uint(rng) % 100000, v2 = BLI_rng_get_uint(rng) % 100000;
+    key = ((uint64_t)v1 << 32) | v2;
+  }
+  radix_sort_check(keys, BLI_radix_sort_uint64);
+  for (uint64_t &key : keys) {
+    key = ((uint64_t)BLI_rng_get_uint(rng) << 32) | BLI_rng_get_uint(rng);
+  }
+  radix_sort_check(keys, BLI_radix_sort_uint64);
+  BLI_rng_free(rng);
+}
+
+TEST_P(SortTest, RadixSortFloat)
+{
+  RNG *rng = BLI_rng_new(0);
+  std::vector<float> keys(NUM_ELEMS);
+  for (float &key : keys) {
+    key = (BLI_rng_get_float(rng) - 0.5f) * 1000.0f;
+  }
+  keys[0] = INFINITY;
+  keys[1] = -INFINITY;
+  keys[2] = FLT_MAX;
+  keys[3] = -FLT_MIN;
+  keys[4] = 0.0f;
+  radix_sort_check(keys, BLI_radix_sort_float);
+
+  /* Negative zero sorts before positive zero. */
+  float signed_zeros[4] = {0.0f, -0.0f, 0.0f, -0.0f};
+  uint values[4] = {0, 1, 2, 3};
+  BLI_radix_sort_float(signed_zeros, values, 4);
+  EXPECT_TRUE(std::signbit(signed_zeros[0]) && std::signbit(signed_zeros[1]));
+  EXPECT_FALSE(std::signbit(signed_zeros[2]) || std::signbit(signed_zeros[3]));
+  EXPECT_EQ(values[0], 1u);
+  EXPECT_EQ(values[1], 3u);
+  EXPECT_EQ(values[2], 0u);
+  EXPECT_EQ(values[3], 2u);
+  BLI_rng_free(rng);
+}
+
+/* Keys without values. */
+TEST_P(SortTest, RadixSortKeysOnly)
+{
+  RNG *rng = BLI_rng_new(0);
+  std::vector<uint> keys(NUM_ELEMS);
+  for (uint &key : keys) {
+    key = BLI_rng_get_uint(rng);
+  }
+  std::vector<uint> expect = keys;
+  std::sort(expect.begin(), expect.end());
+  BLI_radix_sort_uint(keys.data(), NULL, keys.size());
+  EXPECT_EQ(keys, expect);
+  BLI_rng_free(rng);
+}
+
+INSTANTIATE_TEST_CASE_P(sort, SortTest, ::testing::Values(1, NUM_THREADS));
@@ -190,3 +190,171 @@ TEST(task, ListBaseIter100k)
 {
   task_listbase_test("ListBase parallel iteration - Threaded - 100000 items", 100000, true);
 }
+
+/* *** Task pool scaling over number of threads. *** */
+
+#define NUM_RUN_SCALING 10
+
+static void task_pool_tiny_func(TaskPool *__restrict pool, void *taskdata, int UNUSED(thread_id))
+{
+  int *count = (int *)BLI_task_pool_userdata(pool);
+
+  atomic_add_and_fetch_uint32((uint32_t *)count, POINTER_AS_UINT(taskdata) & 1);
+}
+
+static void task_pool_spawn_func(TaskPool *__restrict pool, void *taskdata, int thread_id)
+{
+  const int depth = POINTER_AS_INT(taskdata);
+
+  if (depth == 0) {
+    task_pool_tiny_func(pool, POINTER_FROM_INT(1), thread_id);
+    return;
+  }
+  for (int i = 0; i < 2; i++) {
+    BLI_task_pool_push_from_thread(pool,
+                                   task_pool_spawn_func,
+                                   POINTER_FROM_INT(depth - 1),
+                                   false,
+                                   TASK_PRIORITY_LOW,
+                                   thread_id);
+  }
+}
+
+static double task_pool_scaling_do(TaskScheduler *scheduler, const int num_tasks, const bool spawn)
+{
+  /* Spawn a binary tree of tasks, each one pushing its children. */
+  int depth = 0;
+  while ((2 << depth) <= num_tasks) {
+    depth++;
+  }
+
+  double averaged_timing = 0.0;
+  for (int i = 0; i < NUM_RUN_SCALING; i++) {
+    int count = 0;
+    const double init_time = PIL_check_seconds_timer();
+    TaskPool *pool = BLI_task_pool_create(scheduler, &count);
+    if (spawn) {
+      BLI_task_pool_push(
+          pool, task_pool_spawn_func, POINTER_FROM_INT(depth), false, TASK_PRIORITY_LOW);
+    }
+    else {
+      for (int j = 0; j < num_tasks; j++) {
+        BLI_task_pool_push(
+            pool, task_pool_tiny_func, POINTER_FROM_INT(j), false, TASK_PRIORITY_LOW);
+      }
+    }
+    BLI_task_pool_work_and_wait(pool);
+    BLI_task_pool_free(pool);
+    averaged_timing += PIL_check_seconds_timer() - init_time;
+
+    EXPECT_EQ(count, spawn ? (1 << depth) : num_tasks / 2);
+  }
+  return averaged_timing / NUM_RUN_SCALING;
+}
+
+static void task_pool_scaling_test(const char *id, const int num_tasks)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  BLI_threadapi_init();
+
+  const int max_threads = BLI_system_thread_count();
+  for (int num_threads = 1;; num_threads = MIN2(num_threads * 2, max_threads)) {
+    TaskScheduler *scheduler = BLI_task_scheduler_create(num_threads);
+
+    printf("\t%d threads: pushed %fs, spawned %fs on average over %d runs\n",
+           num_threads,
+           task_pool_scaling_do(scheduler, num_tasks, false),
+           task_pool_scaling_do(scheduler, num_tasks, true),
+           NUM_RUN_SCALING);
+
+    BLI_task_scheduler_free(scheduler);
+    if (num_threads == max_threads) {
+      break;
+    }
+  }
+
+  BLI_threadapi_exit();
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(task, PoolScaling64k)
+{
+  task_pool_scaling_test("Task pool scaling - 65536 tiny tasks", 65536);
+}
+
+/* *** Bandwidth bound kernel with and without NUMA affinity. *** */
+
+#define NUMA_NUM_ITEMS 64
+#define NUMA_ITEM_SIZE (1 << 20)
+#define NUMA_NUM_PASSES 16
+
+static void task_numa_triad_func(void *__restrict userdata,
+                                 const int UNUSED(iter),
+                                 const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  int *num_items = (int *)userdata;
+
+  /* Stream triad over buffers allocated (and first touched) by the thread running it. */
+  float *buffer = (float *)BLI_numa_alloc_local(sizeof(float) * NUMA_ITEM_SIZE * 3, __func__);
+  float *a = buffer;
+  float *b = a + NUMA_ITEM_SIZE;
+  float *c = b + NUMA_ITEM_SIZE;
+  for (int i = 0; i < NUMA_ITEM_SIZE; i++) {
+    b[i] = 1.0f;
+    c[i] = 2.0f;
+  }
+  for (int pass = 0; pass < NUMA_NUM_PASSES; pass++) {
+    for (int i = 0; i < NUMA_ITEM_SIZE; i++) {
+      a[i] = b[i] + 0.5f * c[i];
+    }
+    SWAP(float *, a, b);
+  }
+
+  if (b[NUMA_ITEM_SIZE - 1] == 1.0f + NUMA_NUM_PASSES) {
+    atomic_sub_and_fetch_uint32((uint32_t *)num_items, 1);
+  }
+  BLI_numa_free(buffer);
+}
+
+static void task_numa_test(const char *id, const bool use_numa)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  BLI_system_numa_affinity_set(use_numa);
+  BLI_threadapi_init();
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.scheduling_mode = TASK_SCHEDULING_DYNAMIC;
+  settings.min_iter_per_thread = 1;
+
+  double averaged_timing = 0.0;
+  for (int i = 0; i < NUM_RUN_SCALING; i++) {
+    int num_items = NUMA_NUM_ITEMS;
+    const double init_time = PIL_check_seconds_timer();
+    BLI_task_parallel_range(0, NUMA_NUM_ITEMS, &num_items, task_numa_triad_func, &settings);
+    averaged_timing += PIL_check_seconds_timer() - init_time;
+
+    EXPECT_EQ(num_items, 0);
+  }
+
+  const double num_bytes = (double)NUMA_NUM_ITEMS * NUMA_ITEM_SIZE * sizeof(float) * 3 *
+                           NUMA_NUM_PASSES;
+  printf("\tTriad: done in %fs (%.2f GB/s) on average over %d runs\n",
+         averaged_timing / NUM_RUN_SCALING,
+         num_bytes / (averaged_timing / NUM_RUN_SCALING) * 1e-9,
+         NUM_RUN_SCALING);
+
+  BLI_threadapi_exit();
+  BLI_system_numa_affinity_set(false);
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(task, NumaTriad)
+{
+  task_numa_test("Bandwidth bound kernel - Default affinity", false);
+  task_numa_test("Bandwidth bound kernel - NUMA affinity", true);
+}
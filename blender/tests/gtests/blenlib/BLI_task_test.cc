@@ -11,6 +11,9 @@ extern "C" {
 #include "BLI_listbase.h"
 #include "BLI_mempool.h"
 #include "BLI_task.h"
+#include "BLI_threads.h"
+
+#include "PIL_time.h"
 
 #include "MEM_guardedalloc.h"
 };
@@ -127,3 +130,163 @@ TEST(task, ListBaseIter)
   MEM_freeN(items_buffer);
   BLI_threadapi_exit();
 }
+
+/* *** Task pools with recursively spawned and nested tasks. *** */
+
+#define TASK_TREE_DEPTH 12
+#define TASK_NESTED_NUM 64
+
+typedef struct TaskPoolTestData {
+  TaskScheduler *scheduler;
+  int num_leaves;
+  int num_nested;
+} TaskPoolTestData;
+
+static void task_pool_tree_func(TaskPool *__restrict pool, void *taskdata, int thread_id)
+{
+  TaskPoolTestData *data = (TaskPoolTestData *)BLI_task_pool_userdata(pool);
+  const int depth = POINTER_AS_INT(taskdata);
+
+  if (depth == 0) {
+    atomic_add_and_fetch_uint32((uint32_t *)&data->num_leaves, 1);
+    return;
+  }
+  for (int i = 0; i < 2; i++) {
+    BLI_task_pool_push_from_thread(pool,
+                                   task_pool_tree_func,
+                                   POINTER_FROM_INT(depth - 1),
+                                   false,
+                                   TASK_PRIORITY_LOW,
+                                   thread_id);
+  }
+}
+
+static void task_pool_nested_func(TaskPool *__restrict pool, void *taskdata, int UNUSED(thread_id))
+{
+  TaskPoolTestData *data = (TaskPoolTestData *)BLI_task_pool_userdata(pool);
+  TaskPoolTestData nested_data = {data->scheduler, 0, 0};
+
+  /* Wait for a pool of our own from within a task. */
+  TaskPool *nested_pool = BLI_task_pool_create(data->scheduler, &nested_data);
+  BLI_task_pool_push(nested_pool, task_pool_tree_func, taskdata, false, TASK_PRIORITY_LOW);
+  BLI_task_pool_work_and_wait(nested_pool);
+  BLI_task_pool_free(nested_pool);
+
+  EXPECT_EQ(nested_data.num_leaves, 1 << POINTER_AS_INT(taskdata));
+  atomic_add_and_fetch_uint32((uint32_t *)&data->num_nested, 1);
+}
+
+TEST(task, PoolRecursive)
+{
+  BLI_threadapi_init();
+  TaskScheduler *scheduler = BLI_task_scheduler_create(8);
+  TaskPoolTestData data = {scheduler, 0, 0};
+
+  TaskPool *pool = BLI_task_pool_create(scheduler, &data);
+  BLI_task_pool_push(
+      pool, task_pool_tree_func, POINTER_FROM_INT(TASK_TREE_DEPTH), false, TASK_PRIORITY_LOW);
+  BLI_task_pool_work_and_wait(pool);
+  EXPECT_EQ(data.num_leaves, 1 << TASK_TREE_DEPTH);
+
+  /* Pool can be re-used once all its tasks are done. */
+  data.num_leaves = 0;
+  BLI_task_pool_push(
+      pool, task_pool_tree_func, POINTER_FROM_INT(TASK_TREE_DEPTH), false, TASK_PRIORITY_HIGH);
+  BLI_task_pool_work_and_wait(pool);
+  EXPECT_EQ(data.num_leaves, 1 << TASK_TREE_DEPTH);
+
+  BLI_task_pool_free(pool);
+  BLI_task_scheduler_free(scheduler);
+  BLI_threadapi_exit();
+}
+
+TEST(task, PoolNested)
+{
+  BLI_threadapi_init();
+  TaskScheduler *scheduler = BLI_task_scheduler_create(8);
+  TaskPoolTestData data = {scheduler, 0, 0};
+
+  TaskPool *pool = BLI_task_pool_create_suspended(scheduler, &data);
+  for (int i = 0; i < TASK_NESTED_NUM; i++) {
+    BLI_task_pool_push(
+        pool, task_pool_nested_func, POINTER_FROM_INT(i % 8), false, TASK_PRIORITY_LOW);
+  }
+  BLI_task_pool_work_and_wait(pool);
+  EXPECT_EQ(data.num_nested, TASK_NESTED_NUM);
+
+  BLI_task_pool_free(pool);
+  BLI_task_scheduler_free(scheduler);
+  BLI_threadapi_exit();
+}
+
+/* *** Task pools freed right after their last task was pushed. *** */
+
+#define TASK_POOL_FREE_NUM 1000
+
+typedef struct TaskPoolFreeTestData {
+  TaskPool *pool;
+  int first_started;
+  int last_done;
+} TaskPoolFreeTestData;
+
+static void task_pool_free_first_func(TaskPool *__restrict pool,
+                                      void *UNUSED(taskdata),
+                                      int UNUSED(thread_id))
+{
+  TaskPoolFreeTestData *data = (TaskPoolFreeTestData *)BLI_task_pool_userdata(pool);
+  atomic_add_and_fetch_uint32((uint32_t *)&data->first_started, 1);
+  /* Keep the pool busy until the last task ran (on another thread). */
+  while (atomic_add_and_fetch_uint32((uint32_t *)&data->last_done, 0) == 0) {
+    PIL_sleep_ms(0);
+  }
+}
+
+static void task_pool_free_last_func(TaskPool *__restrict pool,
+                                     void *UNUSED(taskdata),
+                                     int UNUSED(thread_id))
+{
+  TaskPoolFreeTestData *data = (TaskPoolFreeTestData *)BLI_task_pool_userdata(pool);
+  atomic_add_and_fetch_uint32((uint32_t *)&data->last_done, 1);
+}
+
+/* Not managed by the scheduler: pushes to the global queue. */
+static void *task_pool_free_push_thread(void *data_v)
+{
+  TaskPoolFreeTestData *data = (TaskPoolFreeTestData *)data_v;
+  BLI_task_pool_push(data->pool, task_pool_free_first_func, NULL, false, TASK_PRIORITY_LOW);
+  while (atomic_add_and_fetch_uint32((uint32_t *)&data->first_started, 0) == 0) {
+    PIL_sleep_ms(0);
+  }
+  /* The owner is (most likely) waiting for the pool now, and frees it as soon as this task ran,
+   * possibly before this push returns. */
+  BLI_task_pool_push(data->pool, task_pool_free_last_func, NULL, false, TASK_PRIORITY_LOW);
+  return NULL;
+}
+
+TEST(task, PoolFreeAfterPush)
+{
+  BLI_threadapi_init();
+  TaskScheduler *scheduler = BLI_task_scheduler_create(8);
+
+  for (int i = 0; i < TASK_POOL_FREE_NUM; i++) {
+    TaskPoolFreeTestData data = {NULL, 0, 0};
+    data.pool = BLI_task_pool_create(scheduler, &data);
+
+    ListBase threads;
+    BLI_threadpool_init(&threads, task_pool_free_push_thread, 1);
+    BLI_threadpool_insert(&threads, &data);
+
+    /* Only wait once the pool has a task, it would be done right away otherwise. */
+    while (atomic_add_and_fetch_uint32((uint32_t *)&data.first_started, 0) == 0) {
+      PIL_sleep_ms(0);
+    }
+    BLI_task_pool_work_and_wait(data.pool);
+    EXPECT_EQ(data.last_done, 1);
+    BLI_task_pool_free(data.pool);
+
+    BLI_threadpool_end(&threads);
+  }
+
+  BLI_task_scheduler_free(scheduler);
+  BLI_threadapi_exit();
+}
@@ -55,3 +55,17 @@ TEST(guardedalloc, GuardedAlignedAlloc32)
   DoBasicAlignmentChecks(32);
 }
 #endif
+
+TEST(guardedalloc, ThreadCacheAlignedAlloc16)
+{
+  MEM_use_thread_cache_allocator();
+  DoBasicAlignmentChecks(16);
+}
+
+#ifndef __APPLE__
+TEST(guardedalloc, ThreadCacheAlignedAlloc32)
+{
+  MEM_use_thread_cache_allocator();
+  DoBasicAlignmentChecks(32);
+}
+#endif
@@ -0,0 +1,141 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "MEM_guardedalloc.h"
+
+/* Number of small blocks each thread keeps alive in the churn test. */
+#define CHURN_WORKING_SET 20000
+#define CHURN_NUM_STEPS 2000000
+
+/* Size of the graph in the graph building test. */
+#define GRAPH_NUM_NODES 500000
+#define GRAPH_NUM_RELATIONS 4
+
+namespace {
+
+double TimeNow()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+/* Many small blocks of varying size allocated and freed in random order,
+ * like BMesh operators do with their temporary arrays and element lists. */
+void ChurnThread(unsigned int seed)
+{
+  std::vector<void *> blocks(CHURN_WORKING_SET, nullptr);
+  for (int step = 0; step < CHURN_NUM_STEPS; step++) {
+    seed = seed * 1103515245u + 12345u;
+    const unsigned int slot = (seed >> 8) % CHURN_WORKING_SET;
+    if (blocks[slot]) {
+      MEM_freeN(blocks[slot]);
+    }
+    const size_t len = 8 + ((seed >> 4) % 24) * 8;
+    blocks[slot] = MEM_mallocN(len, __func__);
+    memset(blocks[slot], 0, len);
+  }
+  for (void *mem : blocks) {
+    if (mem) {
+      MEM_freeN(mem);
+    }
+  }
+}
+
+double ChurnTest(int num_threads)
+{
+  const double start = TimeNow();
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; i++) {
+    threads.push_back(std::thread(ChurnThread, (unsigned int)i));
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  return TimeNow() - start;
+}
+
+struct GraphRelation {
+  GraphRelation *next;
+  struct GraphNode *from;
+  const char *name;
+};
+
+struct GraphNode {
+  GraphRelation *relations;
+  char *name;
+  float matrix[4][4];
+};
+
+/* Nodes with a name and a list of relations each, built and freed as a whole,
+ * like the dependency graph does when it's rebuilt. */
+double GraphBuildTest()
+{
+  const double start = TimeNow();
+  GraphNode **nodes = (GraphNode **)MEM_mallocN(sizeof(*nodes) * GRAPH_NUM_NODES, __func__);
+  for (int i = 0; i < GRAPH_NUM_NODES; i++) {
+    GraphNode *node = (GraphNode *)MEM_callocN(sizeof(*node), __func__);
+    char name[64];
+    snprintf(name, sizeof(name), "OBNode.%d", i);
+    node->name = (char *)MEM_mallocN(strlen(name) + 1, __func__);
+    memcpy(node->name, name, strlen(name) + 1);
+    for (int j = 0; j < GRAPH_NUM_RELATIONS && j < i; j++) {
+      GraphRelation *rel = (GraphRelation *)MEM_mallocN(sizeof(*rel), __func__);
+      rel->from = nodes[i - j - 1];
+      rel->name = "Relation";
+      rel->next = node->relations;
+      node->relations = rel;
+    }
+    nodes[i] = node;
+  }
+  for (int i = 0; i < GRAPH_NUM_NODES; i++) {
+    GraphRelation *rel = nodes[i]->relations;
+    while (rel) {
+      GraphRelation *rel_next = rel->next;
+      MEM_freeN(rel);
+      rel = rel_next;
+    }
+    MEM_freeN(nodes[i]->name);
+    MEM_freeN(nodes[i]);
+  }
+  MEM_freeN(nodes);
+  return TimeNow() - start;
+}
+
+void AllocatorTests(const char *id)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  printf("\tGraph build: %fs\n", GraphBuildTest());
+  const int num_threads_max = std::max((int)std::thread::hardware_concurrency(), 1);
+  for (int num_threads = 1;; num_threads *= 2) {
+    if (num_threads > num_threads_max) {
+      num_threads = num_threads_max;
+    }
+    printf("\tChurn with %d threads: %fs\n", num_threads, ChurnTest(num_threads));
+    if (num_threads >= num_threads_max) {
+      break;
+    }
+  }
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), 0u);
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+}  // namespace
+
+/* Both allocators in one test, since switching back to the lock-free allocator
+ * is not possible. */
+TEST(guardedalloc, SmallAllocations)
+{
+  AllocatorTests("Small allocations - Lock-free");
+  MEM_use_thread_cache_allocator();
+  AllocatorTests("Small allocations - Thread cache");
+}
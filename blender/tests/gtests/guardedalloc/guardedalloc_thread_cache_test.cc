@@ -0,0 +1,140 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "MEM_guardedalloc.h"
+
+#define NUM_THREADS 4
+#define NUM_BLOCKS 10000
+
+namespace {
+
+void FillBlock(void *mem, size_t len, unsigned char value)
+{
+  memset(mem, value, len);
+}
+
+bool CheckBlock(const void *mem, size_t len, unsigned char value)
+{
+  const unsigned char *data = (const unsigned char *)mem;
+  for (size_t i = 0; i < len; i++) {
+    if (data[i] != value) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void AllocBlocks(std::vector<void *> *blocks, int num_blocks)
+{
+  for (int i = 0; i < num_blocks; i++) {
+    const size_t len = (size_t)(1 + i % 700);
+    void *mem = MEM_mallocN(len, __func__);
+    FillBlock(mem, len, (unsigned char)i);
+    blocks->push_back(mem);
+  }
+}
+
+}  // namespace
+
+TEST(guardedalloc, ThreadCacheSizes)
+{
+  MEM_use_thread_cache_allocator();
+
+  const size_t mem_in_use = MEM_get_memory_in_use();
+  const unsigned int blocks_in_use = MEM_get_memory_blocks_in_use();
+
+  std::vector<void *> blocks;
+  size_t mem_allocated = 0;
+  for (size_t len = 0; len < 2000; len++) {
+    void *mem = MEM_callocN(len, __func__);
+    EXPECT_GE(MEM_allocN_len(mem), len);
+    EXPECT_TRUE(CheckBlock(mem, len, 0));
+    FillBlock(mem, len, 0xaa);
+    mem_allocated += MEM_allocN_len(mem);
+    blocks.push_back(mem);
+  }
+
+  EXPECT_EQ(MEM_get_memory_in_use(), mem_in_use + mem_allocated);
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_in_use + blocks.size());
+  EXPECT_GE(MEM_get_peak_memory(), mem_in_use + mem_allocated);
+
+  for (size_t len = 0; len < blocks.size(); len++) {
+    EXPECT_TRUE(CheckBlock(blocks[len], len, 0xaa));
+    MEM_freeN(blocks[len]);
+  }
+
+  EXPECT_EQ(MEM_get_memory_in_use(), mem_in_use);
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_in_use);
+}
+
+TEST(guardedalloc, ThreadCacheRealloc)
+{
+  MEM_use_thread_cache_allocator();
+
+  const size_t mem_in_use = MEM_get_memory_in_use();
+
+  /* Lengths are rounded up, only the bytes beyond the rounded length get cleared. */
+  char *mem = (char *)MEM_mallocN(10, __func__);
+  const size_t len = MEM_allocN_len(mem);
+  FillBlock(mem, len, 1);
+
+  /* Grow from a size class to a system block and back. */
+  mem = (char *)MEM_recallocN(mem, 4000);
+  EXPECT_TRUE(CheckBlock(mem, len, 1));
+  EXPECT_TRUE(CheckBlock(mem + len, 4000 - len, 0));
+  mem = (char *)MEM_reallocN(mem, 40);
+  EXPECT_TRUE(CheckBlock(mem, len, 1));
+  EXPECT_TRUE(CheckBlock(mem + len, 40 - len, 0));
+
+  char *mem_dup = (char *)MEM_dupallocN(mem);
+  EXPECT_EQ(MEM_allocN_len(mem_dup), MEM_allocN_len(mem));
+  EXPECT_EQ(memcmp(mem, mem_dup, 40), 0);
+
+  MEM_freeN(mem);
+  MEM_freeN(mem_dup);
+
+  EXPECT_EQ(MEM_get_memory_in_use(), mem_in_use);
+}
+
+/* Blocks allocated by worker threads and freed by the main thread after the
+ * workers exited must keep the counters exact. */
+TEST(guardedalloc, ThreadCacheCountersAcrossThreads)
+{
+  MEM_use_thread_cache_allocator();
+
+  const size_t mem_in_use = MEM_get_memory_in_use();
+  const unsigned int blocks_in_use = MEM_get_memory_blocks_in_use();
+
+  std::vector<void *> blocks[NUM_THREADS];
+  std::vector<std::thread> threads;
+  for (int i = 0; i < NUM_THREADS; i++) {
+    threads.push_back(std::thread(AllocBlocks, &blocks[i], NUM_BLOCKS));
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  size_t mem_allocated = 0;
+  for (int i = 0; i < NUM_THREADS; i++) {
+    for (void *mem : blocks[i]) {
+      mem_allocated += MEM_allocN_len(mem);
+    }
+  }
+  EXPECT_EQ(MEM_get_memory_in_use(), mem_in_use + mem_allocated);
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_in_use + NUM_THREADS * NUM_BLOCKS);
+
+  for (int i = 0; i < NUM_THREADS; i++) {
+    for (size_t j = 0; j < blocks[i].size(); j++) {
+      EXPECT_TRUE(CheckBlock(blocks[i][j], 1 + j % 700, (unsigned char)j));
+      MEM_freeN(blocks[i][j]);
+    }
+  }
+
+  EXPECT_EQ(MEM_get_memory_in_use(), mem_in_use);
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_in_use);
+}
@@ -0,0 +1,147 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "vr_types.h"
+#include "vr_codec.h"
+
+extern "C" {
+#include "PIL_time.h"
+}
+
+#include <stdlib.h>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+/* Loopback benchmark of the remote streaming codec:
+ * every frame is encoded, decoded again and compared to the source,
+ * and compared against the previous whole-frame zlib compression. */
+
+#define NUM_FRAMES 60
+
+typedef enum Scene {
+  /* Static background, a widget-sized rectangle moves (typical menu / tool interaction). */
+  SCENE_WIDGET = 0,
+  /* The whole image moves (head rotation, worst case for delta coding). */
+  SCENE_PAN = 1,
+} Scene;
+
+static void render_frame(std::vector<uchar> &image, uint w, uint h, Scene scene, uint frame)
+{
+  const uint pan = (scene == SCENE_PAN) ? frame * 3 : 0;
+  const uint rect_x = (frame * 4) % (w / 2);
+  const uint rect_y = h / 3;
+  for (uint y = 0; y < h; y++) {
+    for (uint x = 0; x < w; x++) {
+      uchar *p = &image[(y * w + x) * 4];
+      const uint u = x + pan;
+      /* Flat shaded "geometry" over an empty (transparent) background. */
+      const bool geometry = ((u / 64) + (y / 48)) % 3 == 0;
+      const bool widget = (x >= rect_x && x < rect_x + w / 8 && y >= rect_y && y < rect_y + h / 8);
+      if (widget) {
+        p[0] = 240;
+        p[1] = 240;
+        p[2] = 240;
+        p[3] = 255;
+      }
+      else if (geometry) {
+        /* Low-bit noise stands in for shading and anti-aliasing. */
+        const uchar noise = (uchar)(((u * 7) ^ (y * 13)) & 3);
+        p[0] = (uchar)(90 + (u % 64) + noise);
+        p[1] = (uchar)(90 + (y % 48) + noise);
+        p[2] = (uchar)(120 + noise);
+        p[3] = 255;
+      }
+      else {
+        p[0] = p[1] = p[2] = p[3] = 0;
+      }
+    }
+  }
+}
+
+static void codec_test(const char *id, uint w, uint h, Scene scene, uint quant_bits)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  VR_Codec codec;
+  EXPECT_TRUE(codec.init(w, h));
+  codec.quant_bits = quant_bits;
+
+  std::vector<uchar> image(w * h * 4), decoded(w * h * 4, 0);
+  std::vector<uchar> packet(codec.max_encoded_size());
+
+  double time_encode = 0.0, time_zlib = 0.0;
+  size_t bytes_encode = 0, bytes_zlib = 0;
+  size_t bytes_key = 0;
+
+  for (uint frame = 0; frame < NUM_FRAMES; frame++) {
+    render_frame(image, w, h, scene, frame);
+
+    double start = PIL_check_seconds_timer();
+    const uint size = codec.encode(image.data(), packet.data(), (uint)packet.size());
+    const double time = PIL_check_seconds_timer() - start;
+    EXPECT_GT(size, 0u);
+    if (frame == 0) {
+      bytes_key = size;
+    }
+    else {
+      time_encode += time;
+      bytes_encode += size;
+    }
+
+    EXPECT_TRUE(VR_Codec::decode(packet.data(), size, decoded.data(), w, h));
+    if (quant_bits == 0) {
+      EXPECT_EQ(image, decoded);
+    }
+
+    /* Reference: whole-frame zlib, as previously used for streaming. */
+    int zlib_size = 0;
+    start = PIL_check_seconds_timer();
+    uchar *zlib_out = stbi_zlib_compress(image.data(), (int)image.size(), &zlib_size, 100);
+    time_zlib += PIL_check_seconds_timer() - start;
+    bytes_zlib += (size_t)zlib_size;
+    free(zlib_out);
+  }
+
+  const uint n = NUM_FRAMES - 1;
+  printf("\tRaw frame: %u bytes, key frame: %u bytes\n", w * h * 4, (uint)bytes_key);
+  printf("\tTile codec: %u bytes/frame, %f ms/frame encode\n",
+         (uint)(bytes_encode / n),
+         time_encode * 1000.0 / n);
+  printf("\tzlib:       %u bytes/frame, %f ms/frame encode\n",
+         (uint)(bytes_zlib / NUM_FRAMES),
+         time_zlib * 1000.0 / NUM_FRAMES);
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(vr_codec, Widget320x240)
+{
+  codec_test("Streaming codec - moving widget - 320x240", 320, 240, SCENE_WIDGET, 0);
+}
+
+TEST(vr_codec, Widget640x480)
+{
+  codec_test("Streaming codec - moving widget - 640x480", 640, 480, SCENE_WIDGET, 0);
+}
+
+TEST(vr_codec, Widget1280x960)
+{
+  codec_test("Streaming codec - moving widget - 1280x960", 1280, 960, SCENE_WIDGET, 0);
+}
+
+TEST(vr_codec, Pan640x480)
+{
+  codec_test("Streaming codec - camera pan - 640x480", 640, 480, SCENE_PAN, 0);
+}
+
+TEST(vr_codec, Pan640x480Lossy)
+{
+  codec_test("Streaming codec - camera pan - 640x480 - 3 bits dropped", 640, 480, SCENE_PAN, 3);
+}
+
+TEST(vr_codec, Pan1280x960)
+{
+  codec_test("Streaming codec - camera pan - 1280x960", 1280, 960, SCENE_PAN, 0);
+}
@@ -0,0 +1,136 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "vr_types.h"
+#include "vr_codec.h"
+
+#include <stdlib.h>
+
+/* -------------------------------------------------------------------- */
+/* Helper functions */
+
+/* Fill an RGBA image with a gradient and a rectangle at the given offset. */
+static void fill_image(std::vector<uchar> &image, uint w, uint h, uint offset)
+{
+  for (uint y = 0; y < h; y++) {
+    for (uint x = 0; x < w; x++) {
+      uchar *p = &image[(y * w + x) * 4];
+      const bool inside = (x >= offset && x < offset + w / 4 && y >= h / 4 && y < h / 2);
+      p[0] = inside ? 200 : (uchar)(x * 255 / w);
+      p[1] = inside ? 30 : (uchar)(y * 255 / h);
+      p[2] = (uchar)((x ^ y) & 0x3F);
+      p[3] = inside ? 255 : 0;
+    }
+  }
+}
+
+static void round_trip(VR_Codec &codec,
+                       const std::vector<uchar> &image,
+                       std::vector<uchar> &decoded,
+                       uint w,
+                       uint h)
+{
+  std::vector<uchar> packet(codec.max_encoded_size());
+  const uint size = codec.encode(image.data(), packet.data(), (uint)packet.size());
+  EXPECT_GT(size, 0u);
+  EXPECT_TRUE(VR_Codec::decode(packet.data(), size, decoded.data(), w, h));
+}
+
+/* -------------------------------------------------------------------- */
+/* Tests */
+
+TEST(vr_codec, LosslessRoundTrip)
+{
+  /* Size not divisible by the tile size, to test partial tiles. */
+  const uint w = 100, h = 70;
+  VR_Codec codec;
+  EXPECT_TRUE(codec.init(w, h));
+
+  std::vector<uchar> image(w * h * 4), decoded(w * h * 4, 0);
+  for (uint frame = 0; frame < 4; frame++) {
+    fill_image(image, w, h, frame * 7);
+    round_trip(codec, image, decoded, w, h);
+    EXPECT_EQ(image, decoded);
+    EXPECT_EQ(codec.stats().keyframe, frame == 0);
+  }
+}
+
+TEST(vr_codec, UnchangedFrame)
+{
+  const uint w = 64, h = 64;
+  VR_Codec codec;
+  EXPECT_TRUE(codec.init(w, h));
+
+  std::vector<uchar> image(w * h * 4), decoded(w * h * 4, 0);
+  fill_image(image, w, h, 0);
+  round_trip(codec, image, decoded, w, h);
+  EXPECT_EQ(codec.stats().tiles_coded, codec.stats().tiles_total);
+
+  round_trip(codec, image, decoded, w, h);
+  EXPECT_EQ(codec.stats().tiles_coded, 0u);
+  EXPECT_EQ(codec.stats().encoded_size, (uint)sizeof(VR_Codec::FrameHeader));
+  EXPECT_EQ(image, decoded);
+}
+
+TEST(vr_codec, LossyRoundTrip)
+{
+  const uint w = 96, h = 64;
+  VR_Codec codec;
+  EXPECT_TRUE(codec.init(w, h, 16));
+  codec.quant_bits = 3;
+
+  std::vector<uchar> image(w * h * 4), decoded(w * h * 4, 0);
+  for (uint frame = 0; frame < 3; frame++) {
+    fill_image(image, w, h, frame * 5);
+    round_trip(codec, image, decoded, w, h);
+    for (size_t i = 0; i < image.size(); i++) {
+      if ((i % 4) == 3) {
+        /* Alpha is always exact. */
+        EXPECT_EQ(image[i], decoded[i]);
+      }
+      else {
+        EXPECT_EQ(image[i] & 0xF8, decoded[i]);
+      }
+    }
+  }
+}
+
+TEST(vr_codec, ResetForcesKeyframe)
+{
+  const uint w = 64, h = 32;
+  VR_Codec codec;
+  EXPECT_TRUE(codec.init(w, h));
+
+  std::vector<uchar> image(w * h * 4), decoded(w * h * 4, 0);
+  fill_image(image, w, h, 0);
+  round_trip(codec, image, decoded, w, h);
+
+  /* A client that lost its state must be able to decode the next frame on its own. */
+  codec.reset();
+  std::vector<uchar> decoded_fresh(w * h * 4, 0x55);
+  round_trip(codec, image, decoded_fresh, w, h);
+  EXPECT_TRUE(codec.stats().keyframe);
+  EXPECT_EQ(image, decoded_fresh);
+}
+
+TEST(vr_codec, MalformedInput)
+{
+  const uint w = 64, h = 64;
+  VR_Codec codec;
+  EXPECT_TRUE(codec.init(w, h));
+
+  std::vector<uchar> image(w * h * 4), decoded(w * h * 4, 0);
+  fill_image(image, w, h, 0);
+
+  std::vector<uchar> packet(codec.max_encoded_size());
+  const uint size = codec.encode(image.data(), packet.data(), (uint)packet.size());
+  EXPECT_GT(size, 0u);
+
+  /* Truncated. */
+  EXPECT_FALSE(VR_Codec::decode(packet.data(), size - 1, decoded.data(), w, h));
+  /* Wrong dimensions. */
+  EXPECT_FALSE(VR_Codec::decode(packet.data(), size, decoded.data(), w, h / 2));
+  /* Output buffer too small. */
+  EXPECT_EQ(codec.encode(image.data(), packet.data(), size - 1), 0u);
+}
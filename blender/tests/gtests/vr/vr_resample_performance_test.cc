@@ -0,0 +1,118 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "vr_types.h"
+#include "vr_resample.h"
+
+extern "C" {
+#include "PIL_time.h"
+}
+
+#include <stdlib.h>
+
+/* Benchmark of the remote streaming resampler (resample, flip and depth-to-alpha),
+ * against the previous scalar nearest-neighbor implementation. */
+
+#define NUM_RUNS 20
+
+/* Eye texture size of current PC HMDs (Vive Pro / Index). */
+#define NATIVE_WIDTH 1440
+#define NATIVE_HEIGHT 1600
+
+/* Previous implementation of VR_Network::resample_pixels(), for reference. */
+static void resample_pixels_reference(const uchar *pixels,
+                                      uint w_old,
+                                      uint h_old,
+                                      uchar *pixels_new,
+                                      uint w_new,
+                                      uint h_new,
+                                      uint depth,
+                                      const uint *depth_buffer)
+{
+  bool depth_to_alpha = depth_buffer ? true : false;
+  uchar *depth_buffer_u8 = depth_buffer ? (uchar *)depth_buffer : NULL;
+
+  int size_old = (int)(w_old * h_old * depth);
+  float w_scale = (float)w_new / (float)w_old;
+  float h_scale = (float)h_new / (float)h_old;
+#pragma omp parallel for
+  for (int y = 0; y < (int)h_new; ++y) {
+    for (int x = 0; x < (int)w_new; ++x) {
+      int pixel = (y * (w_new * depth) + ((w_new - x) * depth)) - depth;
+      int closest_pixel = ((int)((float)y / h_scale) * (w_old * depth)) +
+                          ((int)((float)x / w_scale) * depth);
+      int offset = (size_old - 1) - closest_pixel;
+      pixels_new[pixel] = pixels[offset + 1];
+      pixels_new[pixel + 1] = pixels[offset + 2];
+      pixels_new[pixel + 2] = pixels[offset + 3];
+      if (depth_to_alpha) {
+        uint d_u32 = *(uint *)(&depth_buffer_u8[offset]);
+        float d = (d_u32 >> 8) / 16777215.0f;
+        pixels_new[pixel + 3] = (d == 1.0f) ? 0 : 255;
+      }
+      else {
+        pixels_new[pixel + 3] = 255;
+      }
+    }
+  }
+}
+
+static void resample_test(const char *id, uint w_new, uint h_new)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  const uint w_old = NATIVE_WIDTH, h_old = NATIVE_HEIGHT;
+  /* One pixel of padding: the reference implementation reads one byte past the buffers. */
+  std::vector<uint> src(w_old * h_old + 1), depth(w_old * h_old + 1);
+  srand(42);
+  for (size_t i = 0; i < src.size(); i++) {
+    src[i] = ((uint)rand() << 16) ^ (uint)rand();
+    depth[i] = (i % 7 == 0) ? 0xFFFFFF00u : ((uint)rand() << 8);
+  }
+  std::vector<uint> dst(w_new * h_new);
+
+  double start = PIL_check_seconds_timer();
+  for (int run = 0; run < NUM_RUNS; run++) {
+    resample_pixels_reference(
+        (const uchar *)src.data(), w_old, h_old, (uchar *)dst.data(), w_new, h_new, 4, depth.data());
+  }
+  printf("\tPrevious (nearest): %f ms\n", (PIL_check_seconds_timer() - start) * 1000.0 / NUM_RUNS);
+
+  const char *names[] = {"Scalar", "SSE2", "AVX2"};
+  for (int isa = VR_Resample::ISA_SCALAR; isa <= VR_Resample::ISA_AVX2; isa++) {
+    if (!VR_Resample::isa_available((VR_Resample::ISA)isa)) {
+      printf("\t%-18s (not available in this build)\n", names[isa]);
+      continue;
+    }
+    start = PIL_check_seconds_timer();
+    for (int run = 0; run < NUM_RUNS; run++) {
+      VR_Resample::downsample((const uchar *)src.data(),
+                              w_old,
+                              h_old,
+                              (uchar *)dst.data(),
+                              w_new,
+                              h_new,
+                              depth.data(),
+                              (VR_Resample::ISA)isa);
+    }
+    printf("\t%-18s: %f ms\n", names[isa], (PIL_check_seconds_timer() - start) * 1000.0 / NUM_RUNS);
+  }
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(vr_resample, Resample320x240)
+{
+  resample_test("Stream resample - 1440x1600 to 320x240", 320, 240);
+}
+
+TEST(vr_resample, Resample1280x960)
+{
+  resample_test("Stream resample - 1440x1600 to 1280x960", 1280, 960);
+}
+
+TEST(vr_resample, ResampleNative)
+{
+  resample_test("Stream resample - 1440x1600 to 1440x1600", NATIVE_WIDTH, NATIVE_HEIGHT);
+}
@@ -0,0 +1,116 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "vr_types.h"
+#include "vr_resample.h"
+
+#include <stdlib.h>
+
+/* -------------------------------------------------------------------- */
+/* Helper functions */
+
+#define PIXEL(r, g, b, a) ((uint)(r) | ((uint)(g) << 8) | ((uint)(b) << 16) | ((uint)(a) << 24))
+#define DEPTH_FAR 0xFFFFFF00u
+
+static void fill_random(std::vector<uint> &pixels, std::vector<uint> &depth)
+{
+  srand(1234);
+  for (size_t i = 0; i < pixels.size(); i++) {
+    pixels[i] = ((uint)rand() << 16) ^ (uint)rand();
+    /* Roughly half of the pixels at the far plane (with random stencil). */
+    depth[i] = (rand() & 1) ? (DEPTH_FAR | (uint)(rand() & 0xFF)) : ((uint)rand() << 8);
+  }
+}
+
+/* -------------------------------------------------------------------- */
+/* Tests */
+
+TEST(vr_resample, VerticalFlip)
+{
+  const uint w = 5, h = 3;
+  std::vector<uint> src(w * h), dst(w * h);
+  for (uint i = 0; i < w * h; i++) {
+    src[i] = PIXEL(i, 2 * i, 3 * i, 7);
+  }
+
+  /* Same size: plain copy, rows in reverse order, opaque. */
+  EXPECT_TRUE(VR_Resample::downsample(
+      (const uchar *)src.data(), w, h, (uchar *)dst.data(), w, h, NULL, VR_Resample::ISA_SCALAR));
+  for (uint y = 0; y < h; y++) {
+    for (uint x = 0; x < w; x++) {
+      EXPECT_EQ(dst[y * w + x], (src[(h - 1 - y) * w + x] & 0x00FFFFFF) | 0xFF000000);
+    }
+  }
+}
+
+TEST(vr_resample, BoxFilter)
+{
+  /* 4x2 -> 2x1: each output pixel averages a 2x2 box. */
+  const uint src[8] = {
+      PIXEL(0, 0, 0, 0),
+      PIXEL(100, 0, 0, 0),
+      PIXEL(10, 20, 30, 0),
+      PIXEL(10, 20, 30, 0),
+      PIXEL(0, 0, 0, 0),
+      PIXEL(100, 0, 0, 0),
+      PIXEL(10, 20, 30, 0),
+      PIXEL(10, 20, 30, 0),
+  };
+  const uint depth[8] = {
+      DEPTH_FAR, 0, 0, 0,
+      DEPTH_FAR, 0, DEPTH_FAR, DEPTH_FAR | 0xFF,
+  };
+  uint dst[2];
+  EXPECT_TRUE(VR_Resample::downsample(
+      (const uchar *)src, 4, 2, (uchar *)dst, 2, 1, depth, VR_Resample::ISA_SCALAR));
+  /* Half of the first box is at the far plane. */
+  EXPECT_EQ(dst[0], PIXEL(50, 0, 0, 128));
+  /* Two of four samples of the second box are at the far plane (stencil is ignored). */
+  EXPECT_EQ(dst[1], PIXEL(10, 20, 30, 128));
+
+  const uint depth_near[8] = {0};
+  EXPECT_TRUE(VR_Resample::downsample(
+      (const uchar *)src, 4, 2, (uchar *)dst, 2, 1, depth_near, VR_Resample::ISA_SCALAR));
+  EXPECT_EQ(dst[0] >> 24, 255u);
+  EXPECT_EQ(dst[1] >> 24, 255u);
+}
+
+TEST(vr_resample, KernelsMatch)
+{
+  /* Odd sizes, to exercise the remainder loops. */
+  const uint w_old = 1443, h_old = 1601;
+  std::vector<uint> src(w_old * h_old), depth(w_old * h_old);
+  fill_random(src, depth);
+
+  /* Box filter, nearest-neighbor and identity (per axis). */
+  const uint sizes[][2] = {{643, 481}, {1201, 1333}, {w_old, h_old}, {643, h_old}};
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(*sizes); i++) {
+    const uint w_new = sizes[i][0], h_new = sizes[i][1];
+    std::vector<uint> ref(w_new * h_new), dst(w_new * h_new);
+    EXPECT_TRUE(VR_Resample::downsample((const uchar *)src.data(),
+                                        w_old,
+                                        h_old,
+                                        (uchar *)ref.data(),
+                                        w_new,
+                                        h_new,
+                                        depth.data(),
+                                        VR_Resample::ISA_SCALAR));
+
+    for (int isa = VR_Resample::ISA_SSE2; isa <= VR_Resample::ISA_AVX2; isa++) {
+      if (!VR_Resample::isa_available((VR_Resample::ISA)isa)) {
+        continue;
+      }
+      std::fill(dst.begin(), dst.end(), 0);
+      EXPECT_TRUE(VR_Resample::downsample((const uchar *)src.data(),
+                                          w_old,
+                                          h_old,
+                                          (uchar *)dst.data(),
+                                          w_new,
+                                          h_new,
+                                          depth.data(),
+                                          (VR_Resample::ISA)isa));
+      EXPECT_EQ(ref, dst);
+    }
+  }
+}
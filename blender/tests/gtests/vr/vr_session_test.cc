@@ -0,0 +1,195 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "vr_types.h"
+#include "vr_session_protocol.h"
+
+typedef VR_SessionProtocol Protocol;
+
+/* -------------------------------------------------------------------- */
+/* Helper functions */
+
+static void fill_floats(float *a, uint count, float offset)
+{
+  for (uint i = 0; i < count; i++) {
+    a[i] = offset + (float)i * 0.25f;
+  }
+}
+
+/* -------------------------------------------------------------------- */
+/* Tests */
+
+TEST(vr_session, DeltaFullRoundTrip)
+{
+  float a[64], base[64] = {0.0f}, decoded[64] = {0.0f};
+  fill_floats(a, 64, 1.0f);
+
+  std::vector<uchar> payload;
+  const ui64 mask = Protocol::put_delta<ui64>(payload, a, base, 64, true);
+  EXPECT_EQ(mask, ~(ui64)0);
+  EXPECT_EQ(payload.size(), sizeof(ui64) + 64 * sizeof(float));
+  EXPECT_EQ(memcmp(a, base, sizeof(a)), 0);
+
+  const uchar *p = payload.data();
+  ui64 decoded_mask = 0;
+  EXPECT_TRUE(Protocol::get_delta<ui64>(p, p + payload.size(), decoded, 64, &decoded_mask));
+  EXPECT_EQ(decoded_mask, mask);
+  EXPECT_EQ(p, payload.data() + payload.size());
+  EXPECT_EQ(memcmp(a, decoded, sizeof(a)), 0);
+}
+
+TEST(vr_session, DeltaPartialRoundTrip)
+{
+  float a[16], base[16], decoded[16];
+  fill_floats(a, 16, 2.0f);
+  memcpy(base, a, sizeof(a));
+  memcpy(decoded, a, sizeof(a));
+
+  /* Unchanged (and below the threshold): nothing is encoded. */
+  std::vector<uchar> payload;
+  a[3] += 1e-7f;
+  EXPECT_EQ(Protocol::put_delta<ushort>(payload, a, base, 16, false), 0);
+  EXPECT_TRUE(payload.empty());
+
+  a[0] = -5.0f;
+  a[15] = 100.0f;
+  const ushort mask = Protocol::put_delta<ushort>(payload, a, base, 16, false);
+  EXPECT_EQ(mask, (ushort)((1 << 0) | (1 << 15)));
+  EXPECT_EQ(payload.size(), sizeof(ushort) + 2 * sizeof(float));
+  EXPECT_EQ(base[0], -5.0f);
+  EXPECT_EQ(base[15], 100.0f);
+
+  /* The receiver applies the delta on top of its copy of the base. */
+  const uchar *p = payload.data();
+  EXPECT_TRUE(Protocol::get_delta<ushort>(p, p + payload.size(), decoded, 16));
+  EXPECT_EQ(memcmp(base, decoded, sizeof(base)), 0);
+}
+
+TEST(vr_session, DeltaTruncated)
+{
+  float a[16], base[16] = {0.0f};
+  fill_floats(a, 16, 1.0f);
+  std::vector<uchar> payload;
+  Protocol::put_delta<ushort>(payload, a, base, 16, true);
+
+  /* Every truncation must be detected (the mask or a component is missing). */
+  for (size_t size = 0; size < payload.size(); size++) {
+    float decoded[16] = {0.0f};
+    const uchar *p = payload.data();
+    EXPECT_FALSE(Protocol::get_delta<ushort>(p, p + size, decoded, 16));
+    EXPECT_LE(p, payload.data() + size);
+  }
+}
+
+TEST(vr_session, NameRoundTrip)
+{
+  std::vector<uchar> payload;
+  Protocol::put_name(payload, "Cube");
+  Protocol::put_name(payload, "");
+  payload.push_back(1);
+
+  const uchar *p = payload.data();
+  const uchar *end = p + payload.size();
+  std::string name;
+  EXPECT_TRUE(Protocol::get_name(p, end, name));
+  EXPECT_EQ(name, "Cube");
+  EXPECT_TRUE(Protocol::get_name(p, end, name));
+  EXPECT_EQ(name, "");
+  EXPECT_EQ(end - p, 1);
+}
+
+TEST(vr_session, NameWrongLength)
+{
+  /* Length prefix larger than the remaining payload. */
+  std::vector<uchar> payload;
+  Protocol::put_name(payload, "Cube");
+  payload[0] = 5;
+
+  const uchar *p = payload.data();
+  std::string name;
+  EXPECT_FALSE(Protocol::get_name(p, p + payload.size(), name));
+  EXPECT_EQ(p, payload.data());
+  EXPECT_FALSE(Protocol::get_name(p, p, name));
+}
+
+TEST(vr_session, MessageRoundTrip)
+{
+  std::vector<uchar> payload(3, 7), stream;
+  Protocol::put_message(stream, Protocol::MESSAGE_POSE, 2, payload);
+  Protocol::put_message(stream, Protocol::MESSAGE_LEAVE, 3, std::vector<uchar>());
+
+  Protocol::MessageHeader header;
+  ASSERT_EQ(Protocol::parse_message(stream.data(), stream.size(), header), Protocol::PARSE_OK);
+  EXPECT_EQ(header.type, Protocol::MESSAGE_POSE);
+  EXPECT_EQ(header.peer, 2);
+  EXPECT_EQ(header.size, 3u);
+  EXPECT_EQ(memcmp(stream.data() + sizeof(header), payload.data(), payload.size()), 0);
+
+  const size_t offset = sizeof(header) + header.size;
+  ASSERT_EQ(Protocol::parse_message(stream.data() + offset, stream.size() - offset, header),
+            Protocol::PARSE_OK);
+  EXPECT_EQ(header.type, Protocol::MESSAGE_LEAVE);
+  EXPECT_EQ(header.peer, 3);
+  EXPECT_EQ(header.size, 0u);
+}
+
+TEST(vr_session, MessageTruncated)
+{
+  std::vector<uchar> payload(10, 1), stream;
+  Protocol::put_message(stream, Protocol::MESSAGE_SELECT, 1, payload);
+
+  /* Partially received messages (header or payload) wait for more bytes. */
+  Protocol::MessageHeader header;
+  for (size_t size = 0; size < stream.size(); size++) {
+    EXPECT_EQ(Protocol::parse_message(stream.data(), size, header), Protocol::PARSE_INCOMPLETE);
+  }
+  EXPECT_EQ(Protocol::parse_message(stream.data(), stream.size(), header), Protocol::PARSE_OK);
+}
+
+TEST(vr_session, MessageWrongLength)
+{
+  std::vector<uchar> payload(4, 1), stream;
+  Protocol::put_message(stream, Protocol::MESSAGE_TRANSFORM, 1, payload);
+  Protocol::MessageHeader header;
+
+  /* Length field beyond the maximum payload size: the stream is broken. */
+  uint size = VR_SESSION_MAX_PAYLOAD + 1;
+  memcpy(stream.data(), &size, sizeof(size));
+  EXPECT_EQ(Protocol::parse_message(stream.data(), stream.size(), header), Protocol::PARSE_ERROR);
+
+  /* Length field larger than what was sent: wait for the rest. */
+  size = 5;
+  memcpy(stream.data(), &size, sizeof(size));
+  EXPECT_EQ(Protocol::parse_message(stream.data(), stream.size(), header),
+            Protocol::PARSE_INCOMPLETE);
+
+  /* Invalid message type. */
+  size = 4;
+  memcpy(stream.data(), &size, sizeof(size));
+  stream[offsetof(Protocol::MessageHeader, type)] = Protocol::MESSAGE_TYPES;
+  EXPECT_EQ(Protocol::parse_message(stream.data(), stream.size(), header), Protocol::PARSE_ERROR);
+}
+
+TEST(vr_session, MessageWrongLengthPayload)
+{
+  /* Length field shorter than the encoded delta: decoding stays within the message. */
+  float a[16], base[16] = {0.0f}, decoded[16] = {0.0f};
+  fill_floats(a, 16, 1.0f);
+  std::vector<uchar> payload, stream;
+  Protocol::put_name(payload, "Cube");
+  Protocol::put_delta<ushort>(payload, a, base, 16, true);
+  Protocol::put_message(stream, Protocol::MESSAGE_TRANSFORM, 1, payload);
+
+  const uint size = (uint)payload.size() - sizeof(float);
+  memcpy(stream.data(), &size, sizeof(size));
+
+  Protocol::MessageHeader header;
+  ASSERT_EQ(Protocol::parse_message(stream.data(), stream.size(), header), Protocol::PARSE_OK);
+  const uchar *p = stream.data() + sizeof(header);
+  const uchar *end = p + header.size;
+  std::string name;
+  EXPECT_TRUE(Protocol::get_name(p, end, name));
+  EXPECT_EQ(name, "Cube");
+  EXPECT_FALSE(Protocol::get_delta<ushort>(p, end, decoded, 16));
+}
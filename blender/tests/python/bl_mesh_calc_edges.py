@@ -0,0 +1,87 @@
+# Apache License, Version 2.0
+
+# ./blender.bin --background -noaudio --python tests/python/bl_mesh_calc_edges.py -- --verbose
+import bpy
+import unittest
+
+
+def mesh_from_polys(polys, edges=()):
+    """
+    Create a mesh from lists of vertex indices, one list per polygon,
+    with ``edges`` as its existing edges.
+    """
+    me = bpy.data.meshes.new("calc_edges")
+    loops = [v for poly in polys for v in poly]
+
+    me.vertices.add(max(loops + [v for edge in edges for v in edge]) + 1)
+    me.edges.add(len(edges))
+    for edge, verts in zip(me.edges, edges):
+        edge.vertices = verts
+    me.loops.add(len(loops))
+    for loop, v in zip(me.loops, loops):
+        loop.vertex_index = v
+    me.polygons.add(len(polys))
+    loop_start = 0
+    for poly, verts in zip(me.polygons, polys):
+        poly.loop_start = loop_start
+        poly.loop_total = len(verts)
+        loop_start += len(verts)
+    return me
+
+
+class TestMeshCalcEdges(unittest.TestCase):
+
+    def tearDown(self):
+        for me in list(bpy.data.meshes):
+            if me.name.startswith("calc_edges"):
+                bpy.data.meshes.remove(me)
+
+    def assertEdges(self, me, edges):
+        self.assertEqual([tuple(edge.vertices) for edge in me.edges], edges)
+
+    def assertLoopEdges(self, me, loop_edges):
+        self.assertEqual([loop.edge_index for loop in me.loops], loop_edges)
+
+    def test_edge_order(self):
+        # Edges are created in the order of their first use, the first edge of each polygon
+        # goes from its last loop to its first. New edges have the lower vertex first.
+        me = mesh_from_polys(((0, 1, 2, 3), (1, 4, 5, 2)))
+        me.update(calc_edges=True)
+        self.assertEdges(me, [(0, 3), (0, 1), (1, 2), (2, 3), (1, 4), (4, 5), (2, 5)])
+
+    def test_loop_edges(self):
+        # Each loop uses the edge to the next loop of its polygon.
+        me = mesh_from_polys(((0, 1, 2, 3), (1, 4, 5, 2)))
+        me.update(calc_edges=True)
+        self.assertLoopEdges(me, [1, 2, 3, 0, 4, 5, 6, 2])
+        for poly in me.polygons:
+            for j in range(poly.loop_total):
+                loop = me.loops[poly.loop_start + j]
+                loop_next = me.loops[poly.loop_start + (j + 1) % poly.loop_total]
+                self.assertEqual(
+                    set(me.edges[loop.edge_index].vertices),
+                    {loop.vertex_index, loop_next.vertex_index})
+
+    def test_update_duplicate_edges(self):
+        # Existing edges are all kept as they were, duplicates included, before the new edges.
+        # Loops use the first of the existing edges they match.
+        me = mesh_from_polys(
+            ((0, 1, 2, 3), (1, 4, 5, 2)),
+            edges=((1, 0), (0, 1), (6, 7), (2, 1)))
+        me.update(calc_edges=True)
+        self.assertEdges(
+            me, [(1, 0), (0, 1), (6, 7), (2, 1), (0, 3), (2, 3), (1, 4), (4, 5), (2, 5)])
+        self.assertLoopEdges(me, [0, 3, 5, 4, 6, 7, 8, 3])
+
+    def test_degenerate_loops(self):
+        # A loop using the same vertex as the next loop has no edge, its edge index is zero.
+        me = mesh_from_polys(((0, 1, 1, 2), (2, 3, 3)))
+        me.update(calc_edges=True)
+        self.assertEdges(me, [(0, 2), (0, 1), (1, 2), (2, 3)])
+        self.assertLoopEdges(me, [1, 0, 2, 0, 3, 0, 3])
+
+
+if __name__ == '__main__':
+    import sys
+    sys.argv = [__file__] + (sys.argv[sys.argv.index("--") + 1:] if "--" in sys.argv else [])
+    unittest.main()
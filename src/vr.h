@@ -51,7 +51,9 @@ public:
 		,
 		Type_MagicLeap = 5 //!< Magic Leap API was used for implementation.
 		,
-		Types = 6 //!< Number of API types.
+		Type_Replay = 6 //!< Recorded session replayed without hardware.
+		,
+		Types = 7 //!< Number of API types.
 	} Type; //!< API used to implement this device / module.
 
 	//                                                                  ________________
@@ -160,6 +162,8 @@ public:
 	virtual int setEyeOffset(Side side, float x, float y, float z); //!< Override the offset of the eyes (camera positions) relative to the HMD.
 
 	virtual int updateTracking();      //!< Update the HMD/Eye/Controller positions based on latest tracking data.
+	virtual int latchTracking();       //!< Re-sample the HMD/Eye positions predicted for the display time of the current frame (late-latching).
+	virtual int getActualHMDPosition(float t_hmd[4][4]); //!< Get the measured (not predicted) HMD position at the time the last frame was displayed.
 
 	virtual int blitEye(Side side, void* texture_resource, const float& aperture_u, const float& aperture_v); //!< Blit a rendered image into the internal eye texture.
 	virtual int blitEyes(void* texture_resource_left, void* texture_resource_right, const float& aperture_u, const float& aperture_v); //!< Blit rendered images into the internal eye textures.
@@ -312,6 +316,32 @@ inline int VR::updateTracking()
 	return VR::Error_NotAvailable; // Dummy implementation.
 }
 
+//                                                                          ________________________
+//_________________________________________________________________________/   latchTracking()
+/**
+ * Re-sample the HMD/Eye positions shortly before rendering (late-latching).
+ * The new positions are predicted for the same display time as the ones from updateTracking(),
+ * but are based on more recent sensor data. The pose submitted with the frame is updated accordingly.
+ * Must be called after updateTracking() and before submitFrame().
+ */
+inline int VR::latchTracking()
+{
+	return VR::Error_NotAvailable; // Dummy implementation.
+}
+
+//                                                                          ________________________
+//_________________________________________________________________________/ getActualHMDPosition()
+/**
+ * Get the measured HMD position at (or as close as available to) the time the last frame was displayed.
+ * Used to measure the error of the predicted HMD position that the frame was rendered with.
+ * \param   t_hmd   [OUT] Matrix to receive the transformation.
+ * \return  Zero on success, an error code on failure.
+ */
+inline int VR::getActualHMDPosition(float t_hmd[4][4])
+{
+	return VR::Error_NotAvailable; // Dummy implementation.
+}
+
 //                                                                          ________________________
 //_________________________________________________________________________/    submitFrame()
 /**
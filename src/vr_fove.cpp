@@ -778,6 +778,67 @@ int VR_Fove::updateTracking()
 	return VR::Error_None;
 }
 
+//                                                                          ________________________
+//_________________________________________________________________________/   latchTracking()
+/**
+ * Re-sample the t_eye positions shortly before rendering (late-latching).
+ * Replaces the render pose from updateTracking() with the latest HMD pose.
+ * The new pose is submitted with the frame, so that the compositor reprojects from it.
+ * \return	Zero on success, an error code on failure.
+ */
+int VR_Fove::latchTracking()
+{
+	if (!this->initialized) {
+		return VR_Fove::Error_NotInitialized;
+	}
+
+	Fove::Result<Fove::Pose> ret_pose = hmd.getLatestPose();
+	if (!ret_pose.isValid()) {
+		return VR::Error_InternalFailure;
+	}
+	hmd_pose = ret_pose.getValue();
+
+	// Compute the camera matrix
+	mat44_multiply(camera_matrix.mat, quatToMatrix(hmd_pose.orientation).mat, translationMatrix(hmd_pose.position.x, hmd_pose.position.y, hmd_pose.position.z).mat);
+
+	// Update eye poses
+	this->eye[Side_Left].pose = hmd_pose;
+	transformPoint(this->eye[Side_Left].offset, this->eye[Side_Left].pose.position, 1);
+	this->eye[Side_Right].pose = hmd_pose;
+	transformPoint(this->eye[Side_Right].offset, this->eye[Side_Right].pose.position, 1);
+
+	// Save the HMD position as matrices
+	transferHMDTranformation(hmd_pose, this->t_hmd);
+	transferHMDTranformation(this->eye[Side_Left].pose, this->t_eye[Side_Left]);
+	transferHMDTranformation(this->eye[Side_Right].pose, this->t_eye[Side_Right]);
+
+	return VR::Error_None;
+}
+
+//                                                                          ________________________
+//_________________________________________________________________________/ getActualHMDPosition()
+/**
+ * Get the measured HMD position at the time the last frame was displayed.
+ * waitForRenderPose() returns when the last submitted frame is displayed,
+ * so the latest (unpredicted) pose is used when this is called right after updateTracking().
+ * \param	t_hmd	[OUT] Matrix to receive the transformation.
+ * \return	Zero on success, an error code on failure.
+ */
+int VR_Fove::getActualHMDPosition(float t_hmd[4][4])
+{
+	if (!this->initialized) {
+		return VR_Fove::Error_NotInitialized;
+	}
+
+	Fove::Result<Fove::Pose> ret_pose = hmd.getLatestPose();
+	if (!ret_pose.isValid()) {
+		return VR::Error_InternalFailure;
+	}
+	transferHMDTranformation(ret_pose.getValue(), t_hmd);
+
+	return VR::Error_None;
+}
+
 //                                                                          ________________________
 //_________________________________________________________________________/     blitEye()
 /**
@@ -1162,6 +1223,22 @@ int c_updateTrackingVR()
 	return c_obj->updateTracking();
 }
 
+/**
+ * Re-sample the t_eye positions shortly before rendering (late-latching).
+ */
+int c_latchTrackingVR()
+{
+	return c_obj->latchTracking();
+}
+
+/**
+ * Measured (not predicted) position of the HMD when the last frame was displayed.
+ */
+int c_getActualHMDPosition(float t_hmd[4][4])
+{
+	return c_obj->getActualHMDPosition(t_hmd);
+}
+
 /**
  * Last tracked position of the eyes.
  */
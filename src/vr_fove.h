@@ -45,6 +45,8 @@ extern "C" __declspec(dllexport) int c_setEyeParams(int side, float fx, float fy
 extern "C" __declspec(dllexport) int c_getDefaultEyeParams(int side, float* fx, float* fy, float* cx, float* cy);	//!< Get the HMD's default parameters.
 extern "C" __declspec(dllexport) int c_getDefaultEyeTexSize(int* w, int* h, int side);	//!< Get the default eye texture size.
 extern "C" __declspec(dllexport) int c_updateTrackingVR();	//!< Update the t_eye positions based on latest tracking data.
+extern "C" __declspec(dllexport) int c_latchTrackingVR();	//!< Re-sample the t_eye positions shortly before rendering (late-latching).
+extern "C" __declspec(dllexport) int c_getActualHMDPosition(float t_hmd[4][4]);	//!< Measured (not predicted) position of the HMD when the last frame was displayed.
 extern "C" __declspec(dllexport) int c_getEyePositions(float t_eye[VR::Sides][4][4]);	//!< Last tracked position of the eyes.
 extern "C" __declspec(dllexport) int c_getHMDPosition(float t_hmd[4][4]);	//!< Last tracked position of the HMD.
 extern "C" __declspec(dllexport) int c_getControllerPositions(float t_controller[VR_MAX_CONTROLLERS][4][4]);	//!< Last tracked position of the controllers.
@@ -156,6 +158,8 @@ public:
 	virtual int getDefaultEyeTexSize(uint& w, uint& h, Side side = Side_Both); //!< Get the default eye texture size.
 
 	virtual int updateTracking();      //!< Update the t_eye positions based on latest tracking data.
+	virtual int latchTracking();       //!< Re-sample the t_eye positions shortly before rendering.
+	virtual int getActualHMDPosition(float t_hmd[4][4]); //!< Get the measured HMD position at the time the last frame was displayed.
 
 	virtual int blitEye(Side side, void* texture_resource, const float& aperture_u, const float& aperture_v); //!< Blit a rendered image into the internal eye texture.
 	virtual int blitEyes(void* texture_resource_left, void* texture_resource_right, const float& aperture_u, const float& aperture_v); //!< Blit rendered images into the internal eye textures.
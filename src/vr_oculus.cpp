@@ -667,6 +667,59 @@ int VR_Oculus::updateTracking()
 	return VR::Error_None;
 }
 
+//                                                                          ________________________
+//_________________________________________________________________________/   latchTracking()
+/**
+ * Re-sample the t_eye positions shortly before rendering (late-latching).
+ * The eye poses are predicted again for the display time of the current frame, based on the
+ * latest sensor data. The new poses and sensor sample time are submitted with the frame.
+ * \return      Zero on success, an error code on failure.
+ */
+int VR_Oculus::latchTracking()
+{
+	if (!this->initialized) {
+		return VR_Oculus::Error_NotInitialized;
+	}
+	double ftiming = ovr_GetPredictedDisplayTime(this->hmd, this->frame_index);
+	ovrTrackingState tracking_state = ovr_GetTrackingState(this->hmd, ftiming, ovrTrue);
+	ovrPosef offset[2];
+	offset[ovrEye_Left] = this->eye[Side_Left].offset;
+	offset[ovrEye_Right] = this->eye[Side_Right].offset;
+	ovrPosef pose[2];
+	ovr_GetEyePoses(this->hmd, this->frame_index, ovrTrue, offset, pose, &this->sensor_sample_time);
+	this->eye[Side_Left].pose = pose[ovrEye_Left];
+	this->eye[Side_Right].pose = pose[ovrEye_Right];
+
+	transferHMDTransformation(tracking_state.HeadPose.ThePose, this->t_hmd);
+	transferHMDTransformation(this->eye[Side_Left].pose, this->t_eye[Side_Left]);
+	transferHMDTransformation(this->eye[Side_Right].pose, this->t_eye[Side_Right]);
+
+	return VR_Oculus::Error_None;
+}
+
+//                                                                          ________________________
+//_________________________________________________________________________/ getActualHMDPosition()
+/**
+ * Get the measured HMD position at the time the last frame was displayed.
+ * For times in the past, the runtime returns the recorded sensor sample closest to it.
+ * \param   t_hmd   [OUT] Matrix to receive the transformation.
+ * \return  Zero on success, an error code on failure.
+ */
+int VR_Oculus::getActualHMDPosition(float t_hmd[4][4])
+{
+	if (!this->initialized) {
+		return VR_Oculus::Error_NotInitialized;
+	}
+	if (this->frame_index == 0) {
+		return VR_Oculus::Error_NotAvailable;
+	}
+	double ftiming = ovr_GetPredictedDisplayTime(this->hmd, this->frame_index - 1);
+	ovrTrackingState tracking_state = ovr_GetTrackingState(this->hmd, ftiming, ovrFalse);
+	transferHMDTransformation(tracking_state.HeadPose.ThePose, t_hmd);
+
+	return VR_Oculus::Error_None;
+}
+
 //                                                                          ________________________
 //_________________________________________________________________________/     blitEye()
 /**
@@ -1051,6 +1104,22 @@ int c_updateTrackingVR()
 	return c_obj->updateTracking();
 }
 
+/**
+ * Re-sample the t_eye positions shortly before rendering (late-latching).
+ */
+int c_latchTrackingVR()
+{
+	return c_obj->latchTracking();
+}
+
+/**
+ * Measured (not predicted) position of the HMD when the last frame was displayed.
+ */
+int c_getActualHMDPosition(float t_hmd[4][4])
+{
+	return c_obj->getActualHMDPosition(t_hmd);
+}
+
 /**
  * Last tracked position of the eyes.
  */
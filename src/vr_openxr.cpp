@@ -33,6 +33,7 @@
 #include <algorithm>
 #endif
 #include <ctime>
+#include <string>
 
 /***********************************************************************************************//**
  * \class                                  VR_OpenXR
@@ -152,6 +153,8 @@ VR_OpenXR::VR_OpenXR()
 	, initialized(false)
 {
 	m_frameState = { XR_TYPE_FRAME_STATE };
+	m_viewsLatched = false;
+	m_lastDisplayTime = 0;
 
 	eye_offset_override[Side_Left] = false;
 	eye_offset_override[Side_Right] = false;
@@ -2191,6 +2194,8 @@ int VR_OpenXR::updateTracking()
 		return VR::Error_InternalFailure;
 	}
 
+	m_viewsLatched = false;
+
 	// Sync action data
 	XrActiveActionSet activeActionSet{ m_inputState.actionSet, XR_NULL_PATH };
 	XrActionsSyncInfo syncInfo{ XR_TYPE_ACTIONS_SYNC_INFO };
@@ -2248,6 +2253,89 @@ int VR_OpenXR::updateTracking()
 	return VR::Error_None;
 }
 
+//                                                                          ________________________
+//_________________________________________________________________________/   latchTracking()
+/**
+ * Re-sample the t_eye positions shortly before rendering (late-latching).
+ * The views are located again for the predicted display time of the current frame, based on the
+ * latest tracking data, and are submitted with the frame as they were rendered.
+ * \return      Zero on success, an error code on failure.
+ */
+int VR_OpenXR::latchTracking()
+{
+	if (!m_instance || !m_session) {
+		return VR::Error_NotInitialized;
+	}
+
+	XrViewState viewState{ XR_TYPE_VIEW_STATE };
+	uint32_t viewCapacityInput = (uint32_t)m_views.size();
+	uint32_t viewCountOutput;
+
+	XrViewLocateInfo viewLocateInfo{ XR_TYPE_VIEW_LOCATE_INFO };
+	viewLocateInfo.viewConfigurationType = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO;
+	viewLocateInfo.displayTime = m_frameState.predictedDisplayTime;
+	viewLocateInfo.space = m_appSpace;
+	if (XR_FAILED(xrLocateViews(m_session, &viewLocateInfo, &viewState, viewCapacityInput, &viewCountOutput, m_views.data()))) {
+		return VR::Error_InternalFailure;
+	}
+	m_viewsLatched = true;
+
+	// Eyes
+	for (int i = 0; i < Sides; ++i) {
+		transferHMDTransformation(m_views[i].pose, this->t_eye[i]);
+	}
+	// HMD (average eye transforms, see updateTracking())
+	for (int i = 0; i < 4; ++i) {
+		for (int j = 0; j < 4; ++j) {
+			this->t_hmd[i][j] = (this->t_eye[Side_Left][i][j] + this->t_eye[Side_Right][i][j]) / 2.0f;
+		}
+	}
+
+	return VR::Error_None;
+}
+
+//                                                                          ________________________
+//_________________________________________________________________________/ getActualHMDPosition()
+/**
+ * Get the measured HMD position at the time the last frame was displayed.
+ * \param   t_hmd   [OUT] Matrix to receive the transformation.
+ * \return  Zero on success, an error code on failure.
+ */
+int VR_OpenXR::getActualHMDPosition(float t_hmd[4][4])
+{
+	if (!m_instance || !m_session) {
+		return VR::Error_NotInitialized;
+	}
+	if (m_lastDisplayTime == 0) {
+		return VR::Error_NotAvailable;
+	}
+
+	XrViewState viewState{ XR_TYPE_VIEW_STATE };
+	std::vector<XrView> views(m_views.size(), { XR_TYPE_VIEW });
+	uint32_t viewCountOutput;
+
+	XrViewLocateInfo viewLocateInfo{ XR_TYPE_VIEW_LOCATE_INFO };
+	viewLocateInfo.viewConfigurationType = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO;
+	viewLocateInfo.displayTime = m_lastDisplayTime;
+	viewLocateInfo.space = m_appSpace;
+	if (XR_FAILED(xrLocateViews(m_session, &viewLocateInfo, &viewState, (uint32_t)views.size(), &viewCountOutput, views.data()))
+		|| viewCountOutput < Sides) {
+		return VR::Error_InternalFailure;
+	}
+
+	float t_eye[Sides][4][4];
+	for (int i = 0; i < Sides; ++i) {
+		transferHMDTransformation(views[i].pose, t_eye[i]);
+	}
+	for (int i = 0; i < 4; ++i) {
+		for (int j = 0; j < 4; ++j) {
+			t_hmd[i][j] = (t_eye[Side_Left][i][j] + t_eye[Side_Right][i][j]) / 2.0f;
+		}
+	}
+
+	return VR::Error_None;
+}
+
 //                                                                          ________________________
 //_________________________________________________________________________/  getTrackerPosition()
 /**
@@ -3215,13 +3303,19 @@ bool VR_OpenXR::renderLayer(XrTime predictedDisplayTime, std::vector<XrCompositi
 	uint32_t viewCapacityInput = (uint32_t)m_views.size();
 	uint32_t viewCountOutput;
 
-	XrViewLocateInfo viewLocateInfo{ XR_TYPE_VIEW_LOCATE_INFO };
-	viewLocateInfo.viewConfigurationType = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO;
-	viewLocateInfo.displayTime = predictedDisplayTime;
-	viewLocateInfo.space = m_appSpace;
-	if (XR_FAILED(xrLocateViews(m_session, &viewLocateInfo, &viewState, viewCapacityInput,
-		&viewCountOutput, m_views.data()))) {
-		return false;
+	if (m_viewsLatched) {
+		// Submit the (late-latched) poses that the frame was rendered with.
+		viewCountOutput = viewCapacityInput;
+	}
+	else {
+		XrViewLocateInfo viewLocateInfo{ XR_TYPE_VIEW_LOCATE_INFO };
+		viewLocateInfo.viewConfigurationType = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO;
+		viewLocateInfo.displayTime = predictedDisplayTime;
+		viewLocateInfo.space = m_appSpace;
+		if (XR_FAILED(xrLocateViews(m_session, &viewLocateInfo, &viewState, viewCapacityInput,
+			&viewCountOutput, m_views.data()))) {
+			return false;
+		}
 	}
 
 	if (viewCountOutput == viewCapacityInput && viewCountOutput == m_configViews.size() 
@@ -3332,6 +3426,7 @@ int VR_OpenXR::submitFrame()
 	if (XR_FAILED(xrEndFrame(m_session, &frameEndInfo))) {
 		return VR::Error_InternalFailure;
 	}
+	m_lastDisplayTime = frameEndInfo.displayTime;
 
 	return VR::Error_None;
 }
@@ -3516,6 +3611,22 @@ int c_updateTrackingVR()
 	return c_obj->updateTracking();
 }
 
+/**
+ * Re-sample the t_eye positions shortly before rendering (late-latching).
+ */
+int c_latchTrackingVR()
+{
+	return c_obj->latchTracking();
+}
+
+/**
+ * Measured (not predicted) position of the HMD when the last frame was displayed.
+ */
+int c_getActualHMDPosition(float t_hmd[4][4])
+{
+	return c_obj->getActualHMDPosition(t_hmd);
+}
+
 /**
  * Last tracked position of the eyes.
  */
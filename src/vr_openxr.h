@@ -92,6 +92,8 @@ extern "C" __declspec(dllexport) int c_setEyeParams(int side, float fx, float fy
 extern "C" __declspec(dllexport) int c_getDefaultEyeParams(int side, float* fx, float* fy, float* cx, float* cy); //!< Get the HMD's default parameters.
 extern "C" __declspec(dllexport) int c_getDefaultEyeTexSize(int* w, int* h, int side); //!< Get the default eye texture size.
 extern "C" __declspec(dllexport) int c_updateTrackingVR(); //!< Update the t_eye positions based on latest tracking data.
+extern "C" __declspec(dllexport) int c_latchTrackingVR(); //!< Re-sample the t_eye positions shortly before rendering (late-latching).
+extern "C" __declspec(dllexport) int c_getActualHMDPosition(float t_hmd[4][4]); //!< Measured (not predicted) position of the HMD when the last frame was displayed.
 extern "C" __declspec(dllexport) int c_getEyePositions(float t_eye[VR::Sides][4][4]); //!< Last tracked position of the eyes.
 extern "C" __declspec(dllexport) int c_getHMDPosition(float t_hmd[4][4]);      //!< Last tracked position of the HMD.
 extern "C" __declspec(dllexport) int c_getControllerPositions(float t_controller[VR_MAX_CONTROLLERS][4][4]); //!< Last tracked position of the controller.
@@ -137,6 +139,8 @@ protected:
 
 	XrFrameState m_frameState;
 	XrSessionState m_sessionState;
+	bool m_viewsLatched; //!< Whether m_views were late-latched for the current frame and should be submitted as rendered.
+	XrTime m_lastDisplayTime; //!< Display time of the last submitted frame.
 
 	struct InputState {
 		XrActionSet actionSet;
@@ -282,6 +286,8 @@ public:
 	virtual int setEyeOffset(Side side, float x, float y, float z); //!< Override the offset of the eyes (camera positions) relative to the HMD.
 
 	virtual int updateTracking();      //!< Update the t_eye positions based on latest tracking data.
+	virtual int latchTracking();       //!< Re-sample the t_eye positions predicted for the display time of the current frame.
+	virtual int getActualHMDPosition(float t_hmd[4][4]); //!< Get the measured HMD position at the time the last frame was displayed.
 
 	virtual int blitEye(Side side, void* texture_resource, const float& aperture_u, const float& aperture_v); //!< Blit a rendered image into the internal eye texture.
 	virtual int blitEyes(void* texture_resource_left, void* texture_resource_right, const float& aperture_u, const float& aperture_v); //!< Blit rendered images into the internal eye textures.
@@ -0,0 +1,519 @@
+/***********************************************************************************************//**
+ * \file      vr_replay.cpp
+ *            Headless record-and-replay VR module.
+ *            This file contains code related to replaying recorded VR sessions without hardware.
+ *            Only tracking is implemented (rendering stays in Blender's offscreen buffers).
+ ***************************************************************************************************
+ * \brief     Headless record-and-replay VR module.
+ * \copyright MARUI-PlugIn (inc.)
+ * \contributors Multiplexed Reality
+ **************************************************************************************************/
+
+#include "vr_replay.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/***********************************************************************************************//**
+ * \class                                  VR_Replay
+ ***************************************************************************************************
+ * VR module replaying a recorded session (HMD, eye and controller poses and controller states).
+ * Does not require an HMD, a display or a GPU, which makes it usable for automated benchmarks.
+ **************************************************************************************************/
+
+//                                                                          ________________________
+//_________________________________________________________________________/      VR_Replay()
+/**
+ * Class constructor
+ */
+VR_Replay::VR_Replay()
+	: VR()
+	, frame(0)
+	, frames_replayed(0)
+	, loop(false)
+	, finished(false)
+	, hmd_type(HMDType_Null)
+	, texture_width(0)
+	, texture_height(0)
+	, initialized(false)
+{
+	memset(this->eye_params, 0, sizeof(this->eye_params));
+}
+
+//                                                                          ________________________
+//_________________________________________________________________________/     ~VR_Replay()
+/**
+ * Class destructor
+ */
+VR_Replay::~VR_Replay()
+{
+	if (this->initialized) {
+		this->uninit();
+	}
+}
+
+//                                                                          ________________________
+//_________________________________________________________________________/		type()
+/**
+ * Get which API was used in this implementation.
+ */
+VR::Type VR_Replay::type()
+{
+	return VR::Type_Replay;
+};
+
+//                                                                          ________________________
+//_________________________________________________________________________/		hmdType()
+/**
+ * Get which HMD was used in this implementation (the HMD of the recorded session).
+ */
+VR::HMDType VR_Replay::hmdType()
+{
+	return this->hmd_type;
+};
+
+//                                                                          ________________________
+//_________________________________________________________________________/         load()
+/**
+ * Read a recording into memory, so that no file access happens while replaying.
+ * \param   filepath    Path of the recording (see vr_replay.h for the format).
+ * \return  Zero on success, an error code on failure.
+ */
+int VR_Replay::load(const char* filepath)
+{
+	FILE* f = fopen(filepath, "rb");
+	if (!f) {
+		return VR::Error_InvalidParameter;
+	}
+
+	char magic[4];
+	uint32_t header[4]; // version, hmd_type, tex_width, tex_height
+	if (fread(magic, sizeof(magic), 1, f) != 1 || memcmp(magic, VR_REPLAY_MAGIC, sizeof(magic)) != 0
+		|| fread(header, sizeof(header), 1, f) != 1 || header[0] != VR_REPLAY_VERSION
+		|| fread(this->eye_params, sizeof(this->eye_params), 1, f) != 1) {
+		fclose(f);
+		return VR::Error_InvalidParameter;
+	}
+	this->hmd_type = (header[1] < HMDTypes) ? (HMDType)header[1] : HMDType_Null;
+	this->texture_width = header[2];
+	this->texture_height = header[3];
+
+	this->frames.clear();
+	for (;;) {
+		Frame fr;
+		uint8_t controller_mask;
+		if (fread(fr.t_hmd, sizeof(fr.t_hmd), 1, f) != 1
+			|| fread(fr.t_eye, sizeof(fr.t_eye), 1, f) != 1
+			|| fread(&controller_mask, sizeof(controller_mask), 1, f) != 1) {
+			break; // End of file (a truncated last frame is dropped).
+		}
+		bool complete = true;
+		for (int i = 0; i < VR_MAX_CONTROLLERS; ++i) {
+			Controller& c = fr.controller[i];
+			c = Controller();
+			c.side = (i < Sides) ? (Side)i : Side_AUX;
+			SET4X4IDENTITY(fr.t_controller[i]);
+			if (!(controller_mask & (1 << i))) {
+				continue;
+			}
+			c.available = 1;
+			float analog[6];
+			if (fread(fr.t_controller[i], sizeof(fr.t_controller[i]), 1, f) != 1
+				|| fread(&c.buttons, sizeof(c.buttons), 1, f) != 1
+				|| fread(&c.buttons_touched, sizeof(c.buttons_touched), 1, f) != 1
+				|| fread(analog, sizeof(analog), 1, f) != 1) {
+				complete = false;
+				break;
+			}
+			c.dpad[0] = analog[0];
+			c.dpad[1] = analog[1];
+			c.stick[0] = analog[2];
+			c.stick[1] = analog[3];
+			c.trigger_pressure = analog[4];
+			c.grip_pressure = analog[5];
+		}
+		if (!complete) {
+			break;
+		}
+		this->frames.push_back(fr);
+	}
+	fclose(f);
+
+	if (this->frames.empty()) {
+		return VR::Error_InvalidParameter;
+	}
+	return VR::Error_None;
+}
+
+#ifdef _WIN32
+//                                                                          ________________________
+//_________________________________________________________________________/         init()
+/**
+ * Initialize the module by loading the recording given in the BLENDERXR_REPLAY environment variable.
+ * \param   device          Ignored (no rendering is done by this module).
+ * \param   context         Ignored.
+ * \return  Zero on success, an error code on failure.
+ */
+int VR_Replay::init(void* device, void* context)
+#else
+//                                                                          ________________________
+//_________________________________________________________________________/         init()
+/**
+ * Initialize the module by loading the recording given in the BLENDERXR_REPLAY environment variable.
+ * \param   display     Ignored (no rendering is done by this module).
+ * \param   drawable    Ignored.
+ * \param   context     Ignored.
+ * \return  Zero on success, an error code on failure.
+ */
+int VR_Replay::init(void* display, void* drawable, void* context)
+#endif
+{
+	if (this->initialized) {
+		this->uninit();
+	}
+
+	const char* filepath = getenv(VR_REPLAY_ENV_FILE);
+	if (!filepath || !filepath[0]) {
+		return VR::Error_NotAvailable;
+	}
+	int error = this->load(filepath);
+	if (error) {
+		fprintf(stderr, "VR_Replay: Could not read recording \"%s\".\n", filepath);
+		return error;
+	}
+
+	const char* loop_env = getenv(VR_REPLAY_ENV_LOOP);
+	this->loop = (loop_env && atoi(loop_env) != 0);
+	this->frame = 0;
+	this->frames_replayed = 0;
+	this->finished = false;
+
+	// Start with the first frame, so the initial positions are valid.
+	const Frame& fr = this->frames[0];
+	memcpy(this->t_hmd, fr.t_hmd, sizeof(this->t_hmd));
+	memcpy(this->t_eye, fr.t_eye, sizeof(this->t_eye));
+	memcpy(this->t_controller, fr.t_controller, sizeof(this->t_controller));
+	memcpy(this->controller, fr.controller, sizeof(this->controller));
+
+	this->initialized = true;
+	return VR::Error_None;
+}
+
+//                                                                          ________________________
+//_________________________________________________________________________/        uninit()
+/**
+ * Un-initialize the module.
+ */
+int VR_Replay::uninit()
+{
+	if (this->initialized && !this->finished) {
+		printf("VR_Replay: %u of %u frames replayed.\n", this->frames_replayed, (uint)this->frames.size());
+	}
+	this->frames.clear();
+	this->initialized = false;
+	return VR::Error_None;
+}
+
+//                                                                          ________________________
+//_________________________________________________________________________/ getDefaultEyeTexSize()
+/**
+ * Get the eye texture size of the recorded session.
+ */
+int VR_Replay::getDefaultEyeTexSize(uint& w, uint& h, Side side)
+{
+	if (!this->initialized) {
+		return VR::Error_NotInitialized;
+	}
+	w = this->texture_width;
+	h = this->texture_height;
+	return VR::Error_None;
+}
+
+//                                                                          ________________________
+//_________________________________________________________________________/ getDefaultEyeParams()
+/**
+ * Get the eye parameters of the recorded session.
+ */
+int VR_Replay::getDefaultEyeParams(Side side, float& fx, float& fy, float& cx, float& cy)
+{
+	if (!this->initialized) {
+		return VR::Error_NotInitialized;
+	}
+	if (side != Side_Left && side != Side_Right) {
+		return VR::Error_InvalidParameter;
+	}
+	fx = this->eye_params[side][0];
+	fy = this->eye_params[side][1];
+	cx = this->eye_params[side][2];
+	cy = this->eye_params[side][3];
+	return VR::Error_None;
+}
+
+//                                                                          ________________________
+//_________________________________________________________________________/    setEyeParams()
+/**
+ * Set the eye parameters. Overrides the recorded parameters.
+ */
+int VR_Replay::setEyeParams(Side side, float fx, float fy, float cx, float cy)
+{
+	if (side != Side_Left && side != Side_Right) {
+		return VR::Error_InvalidParameter;
+	}
+	this->eye_params[side][0] = fx;
+	this->eye_params[side][1] = fy;
+	this->eye_params[side][2] = cx;
+	this->eye_params[side][3] = cy;
+	return VR::Error_None;
+}
+
+//                                                                          ________________________
+//_________________________________________________________________________/   updateTracking()
+/**
+ * Update the HMD/Eye/Controller positions and controller states from the next recorded frame.
+ * After the last frame, the recording restarts (if looping) or the last frame is held.
+ */
+int VR_Replay::updateTracking()
+{
+	if (!this->initialized) {
+		return VR::Error_NotInitialized;
+	}
+
+	if (this->frame >= this->frames.size()) {
+		if (this->loop) {
+			this->frame = 0;
+		}
+		else {
+			if (!this->finished) {
+				printf("VR_Replay: End of recording (%u frames).\n", this->frames_replayed);
+				this->finished = true;
+			}
+			this->tracking = true;
+			return VR::Error_None;
+		}
+	}
+
+	const Frame& fr = this->frames[this->frame++];
+	memcpy(this->t_hmd, fr.t_hmd, sizeof(this->t_hmd));
+	memcpy(this->t_eye, fr.t_eye, sizeof(this->t_eye));
+	memcpy(this->t_controller, fr.t_controller, sizeof(this->t_controller));
+	memcpy(this->controller, fr.controller, sizeof(this->controller));
+	++this->frames_replayed;
+
+	this->tracking = true;
+	return VR::Error_None;
+}
+
+//                                                                          ________________________
+//_________________________________________________________________________/       blitEye()
+/**
+ * Blit a rendered image into the internal eye texture.
+ * Nothing to do: the rendering remains in the (offscreen) texture that was passed.
+ */
+int VR_Replay::blitEye(Side side, void* texture_resource, const float& aperture_u, const float& aperture_v)
+{
+	return this->initialized ? VR::Error_None : VR::Error_NotInitialized;
+}
+
+//                                                                          ________________________
+//_________________________________________________________________________/       blitEyes()
+/**
+ * Blit rendered images into the internal eye textures.
+ * Nothing to do: the renderings remain in the (offscreen) textures that were passed.
+ */
+int VR_Replay::blitEyes(void* texture_resource_left, void* texture_resource_right, const float& aperture_u, const float& aperture_v)
+{
+	return this->initialized ? VR::Error_None : VR::Error_NotInitialized;
+}
+
+//                                                                          ________________________
+//_________________________________________________________________________/    submitFrame()
+/**
+ * Submit frame to the HMD (no-op).
+ */
+int VR_Replay::submitFrame()
+{
+	return this->initialized ? VR::Error_None : VR::Error_NotInitialized;
+}
+
+//                                                                          ________________________
+//_________________________________________________________________________/     frameCount()
+/**
+ * Number of frames in the recording.
+ */
+uint VR_Replay::frameCount() const
+{
+	return (uint)this->frames.size();
+}
+
+//                                                                          ________________________
+//_________________________________________________________________________/   framesReplayed()
+/**
+ * Number of frames replayed so far (including loops).
+ */
+uint VR_Replay::framesReplayed() const
+{
+	return this->frames_replayed;
+}
+
+/***********************************************************************************************//**
+*								Exported shared library functions.								   *
+***************************************************************************************************/
+VR_Replay* c_obj(0);
+
+/**
+ * Create an object internally. Must be called before the functions below.
+ */
+int c_createVR()
+{
+	c_obj = new VR_Replay();
+	return 0;
+}
+
+/**
+ * Initialize the internal object.
+ */
+#ifdef _WIN32
+int c_initVR(void* device, void* context)
+#else
+int c_initVR(void* display, void* drawable, void* context)
+#endif
+{
+#ifdef _WIN32
+	return c_obj->init(device, context);
+#else
+	return c_obj->init(display, drawable, context);
+#endif
+}
+
+/**
+ * Get the type of HMD used for VR (the HMD of the recorded session).
+ */
+int c_getHMDType(int* type)
+{
+	*type = c_obj->hmdType();
+	return 0;
+}
+
+/**
+ * Get the default eye texture size.
+ * \param side      Zero for left, one for right., -1 for both eyes (default).
+ */
+int c_getDefaultEyeTexSize(int* w, int* h, int side)
+{
+	return c_obj->getDefaultEyeTexSize(*(uint*)w, *(uint*)h, (VR::Side)side);
+}
+
+/**
+ * Get the HMD's default parameters.
+ * \param side       Zero for left, one for right.
+ */
+int c_getDefaultEyeParams(int side, float* fx, float* fy, float* cx, float* cy)
+{
+	return c_obj->getDefaultEyeParams((VR::Side)side, *fx, *fy, *cx, *cy);
+}
+
+/**
+ * Set rendering parameters.
+ * \param side      Zero for left, one for right.
+ */
+int c_setEyeParams(int side, float fx, float fy, float cx, float cy)
+{
+	return c_obj->setEyeParams((VR::Side)side, fx, fy, cx, cy);
+}
+
+/**
+ * Update the t_eye positions from the next recorded frame.
+ */
+int c_updateTrackingVR()
+{
+	return c_obj->updateTracking();
+}
+
+/**
+ * Last tracked position of the eyes.
+ */
+int c_getEyePositions(float t_eye[VR::Sides][4][4])
+{
+	memcpy(t_eye, c_obj->t_eye, sizeof(float) * VR::Sides * 4 * 4);
+	return 0;
+}
+
+/**
+ *  Last tracked position of the HMD.
+ */
+int c_getHMDPosition(float t_hmd[4][4])
+{
+	memcpy(t_hmd, c_obj->t_hmd, sizeof(float) * 4 * 4);
+	return 0;
+}
+
+/**
+ * Last tracked position of the controllers.
+ */
+int c_getControllerPositions(float t_controller[VR_MAX_CONTROLLERS][4][4])
+{
+	for (int i = 0; i < VR_MAX_CONTROLLERS; ++i) {
+		if (c_obj->controller[i].available) {
+			memcpy(t_controller[i], c_obj->t_controller[i], sizeof(float) * 4 * 4);
+		}
+	}
+	return 0;
+}
+
+/**
+ * Last tracked button state of the controllers.
+ */
+int c_getControllerStates(void* controller_states[VR_MAX_CONTROLLERS])
+{
+	for (int i = 0; i < VR_MAX_CONTROLLERS; ++i) {
+		if (c_obj->controller[i].available) {
+			memcpy(controller_states[i], &c_obj->controller[i], sizeof(VR::Controller));
+		}
+		else {
+			// Just copy side and availability information.
+			memcpy(controller_states[i], &c_obj->controller[i], sizeof(VR::Side) + sizeof(int));
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Blit a rendered image into the internal eye texture.
+ * \param side      Zero for left, one for right.
+ */
+int c_blitEye(int side, void* texture_resource, const float* aperture_u, const float* aperture_v)
+{
+	return c_obj->blitEye((VR::Side)side, texture_resource, *aperture_u, *aperture_v);
+}
+
+/**
+ * Blit rendered images into the internal eye textures.
+ */
+int c_blitEyes(void* texture_resource_left, void* texture_resource_right, const float* aperture_u, const float* aperture_v)
+{
+	return c_obj->blitEyes(texture_resource_left, texture_resource_right, *aperture_u, *aperture_v);
+}
+
+/**
+ * Submit frame to the HMD.
+ */
+int c_submitFrame()
+{
+	return c_obj->submitFrame();
+}
+
+/**
+ * Un-initialize the internal object.
+ */
+int c_uninitVR()
+{
+	if (c_obj) {
+		int error = c_obj->uninit();
+		delete c_obj;
+		c_obj = 0;
+		return error;
+	}
+	return 0;
+}
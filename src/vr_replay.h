@@ -0,0 +1,115 @@
+/***********************************************************************************************//**
+ * \file      vr_replay.h
+ *            Headless record-and-replay VR module.
+ *            This file contains code related to replaying recorded VR sessions without hardware.
+ *            Only tracking is implemented (rendering stays in Blender's offscreen buffers).
+ ***************************************************************************************************
+ * \brief     Headless record-and-replay VR module.
+ * \copyright MARUI-PlugIn (inc.)
+ * \contributors Multiplexed Reality
+ **************************************************************************************************/
+#ifndef __VR_REPLAY_H__
+#define __VR_REPLAY_H__
+
+#include <stdint.h>
+#include <vector>
+
+#include "vr.h"
+
+#define VR_REPLAY_ENV_FILE		"BLENDERXR_REPLAY"			//!< Environment variable with the path of the recording to replay.
+#define VR_REPLAY_ENV_LOOP		"BLENDERXR_REPLAY_LOOP"		//!< Environment variable: if set (non-zero), restart the recording after the last frame.
+
+// Recording file format (native little-endian, no padding).
+// Written by Blender's vr_main.c (vr_record_begin()), which must be kept in sync.
+//
+// Header:
+//   char    magic[4]          "BXRR"
+//   uint32  version           VR_REPLAY_VERSION
+//   uint32  hmd_type          VR::HMDType of the recorded session
+//   uint32  tex_width         Default eye texture width
+//   uint32  tex_height        Default eye texture height
+//   float   eye_params[2][4]  fx, fy, cx, cy of the left and right eye
+// Frames (until the end of the file):
+//   float   t_hmd[4][4]       HMD position (real-world space)
+//   float   t_eye[2][4][4]    Eye positions (real-world space)
+//   uint8   controller_mask   Bit i: controller i is available and follows
+//   Per available controller:
+//     float   t_controller[4][4]
+//     uint64  buttons          VR_Layout::ButtonBit bitfield
+//     uint64  buttons_touched  VR_Layout::ButtonBit bitfield
+//     float   dpad[2], stick[2], trigger_pressure, grip_pressure
+#define VR_REPLAY_MAGIC		"BXRR"	//!< File identifier of recordings.
+#define VR_REPLAY_VERSION	1		//!< Version of the recording file format.
+
+// Static-use wrapper for use in C projects that can't use the class definition.
+extern "C" __declspec(dllexport) int c_createVR(); //!< Create an object internally. Must be called before the functions below.
+#ifdef _WIN32
+extern "C" __declspec(dllexport) int c_initVR(void* device, void* context); //!< Initialize the internal object (OpenGL).
+#else
+extern "C" __declspec(dllexport) int c_initVR(void* display, void* drawable, void* context); //!< Initialize the internal object (OpenGL).
+#endif
+extern "C" __declspec(dllexport) int c_getHMDType(int* type); //!< Get the type of HMD used for VR.
+extern "C" __declspec(dllexport) int c_setEyeParams(int side, float fx, float fy, float cx, float cy);  //!< Set rendering parameters.
+extern "C" __declspec(dllexport) int c_getDefaultEyeParams(int side, float* fx, float* fy, float* cx, float* cy); //!< Get the HMD's default parameters.
+extern "C" __declspec(dllexport) int c_getDefaultEyeTexSize(int* w, int* h, int side); //!< Get the default eye texture size.
+extern "C" __declspec(dllexport) int c_updateTrackingVR(); //!< Update the t_eye positions based on latest tracking data.
+extern "C" __declspec(dllexport) int c_getEyePositions(float t_eye[VR::Sides][4][4]); //!< Last tracked position of the eyes.
+extern "C" __declspec(dllexport) int c_getHMDPosition(float t_hmd[4][4]);      //!< Last tracked position of the HMD.
+extern "C" __declspec(dllexport) int c_getControllerPositions(float t_controller[VR_MAX_CONTROLLERS][4][4]); //!< Last tracked position of the controller.
+extern "C" __declspec(dllexport) int c_getControllerStates(void* controller_states[VR_MAX_CONTROLLERS]); //!< Last tracked button states of the controllers.
+extern "C" __declspec(dllexport) int c_blitEye(int side, void* texture_resource, const float* aperture_u, const float* aperture_v); //!< Blit a rendered image into the internal eye texture.
+extern "C" __declspec(dllexport) int c_blitEyes(void* texture_resource_left, void* texture_resource_right, const float* aperture_u, const float* aperture_v); //!< Blit rendered images into the internal eye textures.
+extern "C" __declspec(dllexport) int c_submitFrame(); //!< Submit frame to the HMD.
+extern "C" __declspec(dllexport) int c_uninitVR(); //!< Un-initialize the internal object.
+
+// Headless record-and-replay VR module.
+// Replays one recorded frame per updateTracking() call (independent of wall-clock time),
+// so that repeated runs receive exactly the same input.
+class VR_Replay : public VR
+{
+protected:
+	// Recorded state of one frame.
+	typedef struct Frame {
+		float t_hmd[4][4];                          //!< HMD position.
+		float t_eye[Sides][4][4];                   //!< Eye positions.
+		float t_controller[VR_MAX_CONTROLLERS][4][4]; //!< Controller positions.
+		Controller controller[VR_MAX_CONTROLLERS];  //!< Controller states.
+	} Frame;
+
+	std::vector<Frame> frames; //!< All frames of the recording.
+	uint    frame;             //!< Index of the next frame to replay.
+	uint    frames_replayed;   //!< Number of updateTracking() calls that replayed a frame.
+	bool    loop;              //!< Whether to restart after the last frame.
+	bool    finished;          //!< Whether the end of the recording was reached (and reported).
+	HMDType hmd_type;          //!< HMD type of the recorded session.
+	uint    texture_width;     //!< Width of the eye textures in pixels.
+	uint    texture_height;    //!< Height of the eye textures in pixels.
+	float   eye_params[Sides][4]; //!< Recorded fx, fy, cx, cy of the eyes.
+	bool    initialized;       //!< Whether the recording was loaded.
+
+	int load(const char* filepath); //!< Read a recording into frames.
+public:
+	VR_Replay();           //!< Class constructor
+	virtual ~VR_Replay();  //!< Class destructor
+
+	virtual Type type();  //!< Get which API was used in this implementation.
+	virtual HMDType hmdType(); //!< Get which HMD was used in this implementation.
+#ifdef _WIN32
+	virtual int init(void* device, void* context); //!< Initialize the VR device.
+#else
+	virtual int init(void* display, void* drawable, void* context); //!< Initialize the VR device.
+#endif
+	virtual int getDefaultEyeTexSize(uint& w, uint& h, Side side = Side_Both); //!< Get the default eye texture size.
+	virtual int getDefaultEyeParams(Side side, float& fx, float& fy, float& cx, float& cy); //!< Get the HMD's default parameters.
+	virtual int setEyeParams(Side side, float fx, float fy, float cx = 0.5f, float cy = 0.5f);  //!< Set rendering parameters.
+	virtual int updateTracking(); //!< Update the HMD/Eye/Controller positions from the next recorded frame.
+	virtual int blitEye(Side side, void* texture_resource, const float& aperture_u, const float& aperture_v); //!< Blit a rendered image into the internal eye texture.
+	virtual int blitEyes(void* texture_resource_left, void* texture_resource_right, const float& aperture_u, const float& aperture_v); //!< Blit rendered images into the internal eye textures.
+	virtual int submitFrame(); //!< Submit frame to the HMD.
+	virtual int uninit(); //!< Un-initialize the module.
+
+	uint frameCount() const; //!< Number of frames in the recording.
+	uint framesReplayed() const; //!< Number of frames replayed so far (including loops).
+};
+
+#endif //__VR_REPLAY_H__
@@ -81,11 +81,14 @@ VR_Steam::VR_Steam()
 	: VR()
 	, hmd(0)
 	, hmd_type(HMDType_Null)
+	, render_pose_latched(false)
 	, initialized(false)
 {
 	eye_offset_override[Side_Left] = false;
 	eye_offset_override[Side_Right] = false;
 
+	memset(&this->render_pose, 0, sizeof(this->render_pose));
+
 	memset(&this->gl, 0, sizeof(this->gl));
 
 	SET4X4IDENTITY(t_basestation[0]);
@@ -718,6 +721,9 @@ int VR_Steam::updateTracking()
 	vr::TrackedDevicePose_t poses[vr::k_unMaxTrackedDeviceCount];
 	compositor->WaitGetPoses(poses, vr::k_unMaxTrackedDeviceCount, NULL, 0);
 
+	// New frame: submit with the poses from WaitGetPoses() unless latched again.
+	this->render_pose_latched = false;
+
 	// Assume tracking was lost
 	this->tracking = false;
 	// Just count up base stations - the order should be the same
@@ -796,6 +802,85 @@ int VR_Steam::updateTracking()
 	return VR::Error_None;
 }
 
+//                                                                          ________________________
+//_________________________________________________________________________/   latchTracking()
+/**
+ * Re-sample the t_eye positions shortly before rendering (late-latching).
+ * The HMD pose is predicted for the time the photons of the current frame hit the eyes
+ * (end of the current vsync interval + vsync-to-photons latency) and will be submitted with the frame,
+ * so that the compositor only has to reproject the remaining (smaller) prediction error.
+ * \return      Zero on success, an error code on failure.
+ */
+int VR_Steam::latchTracking()
+{
+	if (!this->hmd) {
+		return VR::Error_NotInitialized;
+	}
+
+	vr::IVRCompositor* compositor = vr::VRCompositor();
+	if (!compositor) {
+		return VR::Error_NotInitialized;
+	}
+
+	float seconds_since_vsync = 0.0f;
+	if (!this->hmd->GetTimeSinceLastVsync(&seconds_since_vsync, NULL)) {
+		return VR::Error_InternalFailure;
+	}
+	const float display_frequency = this->hmd->GetFloatTrackedDeviceProperty(vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_DisplayFrequency_Float);
+	const float vsync_to_photons = this->hmd->GetFloatTrackedDeviceProperty(vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_SecondsFromVsyncToPhotons_Float);
+	const float frame_duration = (display_frequency > 0.0f) ? (1.0f / display_frequency) : 0.0f;
+	float seconds_to_photons = frame_duration - seconds_since_vsync + vsync_to_photons;
+	if (seconds_to_photons < 0.0f) {
+		seconds_to_photons = 0.0f;
+	}
+
+	vr::TrackedDevicePose_t pose;
+	this->hmd->GetDeviceToAbsoluteTrackingPose(compositor->GetTrackingSpace(), seconds_to_photons, &pose, 1);
+	if (!pose.bPoseIsValid) {
+		return VR::Error_InternalFailure;
+	}
+
+	this->render_pose = pose.mDeviceToAbsoluteTracking;
+	this->render_pose_latched = true;
+
+	convertMatrix(pose.mDeviceToAbsoluteTracking.m, this->t_hmd);
+	mat44_multiply(this->t_eye[Side_Left], this->t_hmd, this->t_hmd2eye[Side_Left]);
+	mat44_multiply(this->t_eye[Side_Right], this->t_hmd, this->t_hmd2eye[Side_Right]);
+
+	return VR::Error_None;
+}
+
+//                                                                          ________________________
+//_________________________________________________________________________/ getActualHMDPosition()
+/**
+ * Get the measured HMD position at the time the last frame was displayed.
+ * WaitGetPoses() returns just before the vsync at which the last submitted frame is scanned out,
+ * so the current (unpredicted) pose is used when this is called right after updateTracking().
+ * \param   t_hmd   [OUT] Matrix to receive the transformation.
+ * \return  Zero on success, an error code on failure.
+ */
+int VR_Steam::getActualHMDPosition(float t_hmd[4][4])
+{
+	if (!this->hmd) {
+		return VR::Error_NotInitialized;
+	}
+
+	vr::IVRCompositor* compositor = vr::VRCompositor();
+	if (!compositor) {
+		return VR::Error_NotInitialized;
+	}
+
+	vr::TrackedDevicePose_t pose;
+	this->hmd->GetDeviceToAbsoluteTrackingPose(compositor->GetTrackingSpace(), 0.0f, &pose, 1);
+	if (!pose.bPoseIsValid) {
+		return VR::Error_InternalFailure;
+	}
+
+	convertMatrix(pose.mDeviceToAbsoluteTracking.m, t_hmd);
+
+	return VR::Error_None;
+}
+
 //                                                                          ________________________
 //_________________________________________________________________________/  getTrackerPosition()
 /**
@@ -1354,10 +1439,24 @@ int VR_Steam::submitFrame()
 		return VR::Error_NotInitialized;
 	}
 
-	vr::Texture_t leftEyeTexture = { (void*)this->gl.texture[Side_Left], vr::TextureType_OpenGL,vr::ColorSpace_Gamma };
-	compositor->Submit(vr::Eye_Left, &leftEyeTexture, 0);
-	vr::Texture_t rightEyeTexture = { (void*)this->gl.texture[Side_Right], vr::TextureType_OpenGL,vr::ColorSpace_Gamma };
-	compositor->Submit(vr::Eye_Right, &rightEyeTexture, 0);
+	if (this->render_pose_latched) {
+		// Tell the compositor which (late-latched) pose the frame was rendered with.
+		vr::VRTextureWithPose_t leftEyeTexture;
+		leftEyeTexture.handle = (void*)this->gl.texture[Side_Left];
+		leftEyeTexture.eType = vr::TextureType_OpenGL;
+		leftEyeTexture.eColorSpace = vr::ColorSpace_Gamma;
+		leftEyeTexture.mDeviceToAbsoluteTracking = this->render_pose;
+		compositor->Submit(vr::Eye_Left, &leftEyeTexture, 0, vr::Submit_TextureWithPose);
+		vr::VRTextureWithPose_t rightEyeTexture = leftEyeTexture;
+		rightEyeTexture.handle = (void*)this->gl.texture[Side_Right];
+		compositor->Submit(vr::Eye_Right, &rightEyeTexture, 0, vr::Submit_TextureWithPose);
+	}
+	else {
+		vr::Texture_t leftEyeTexture = { (void*)this->gl.texture[Side_Left], vr::TextureType_OpenGL,vr::ColorSpace_Gamma };
+		compositor->Submit(vr::Eye_Left, &leftEyeTexture, 0);
+		vr::Texture_t rightEyeTexture = { (void*)this->gl.texture[Side_Right], vr::TextureType_OpenGL,vr::ColorSpace_Gamma };
+		compositor->Submit(vr::Eye_Right, &rightEyeTexture, 0);
+	}
 	compositor->PostPresentHandoff();
 
 	return VR::Error_None;
@@ -2367,6 +2466,22 @@ int c_updateTrackingVR()
 	return c_obj->updateTracking();
 }
 
+/**
+ * Re-sample the t_eye positions shortly before rendering (late-latching).
+ */
+int c_latchTrackingVR()
+{
+	return c_obj->latchTracking();
+}
+
+/**
+ * Measured (not predicted) position of the HMD when the last frame was displayed.
+ */
+int c_getActualHMDPosition(float t_hmd[4][4])
+{
+	return c_obj->getActualHMDPosition(t_hmd);
+}
+
 /**
  * Last tracked position of the eyes.
  */